@@ -0,0 +1,50 @@
+//clustered point lights, filled by ClusteredLighting every frame and bound by the engine before the scene is drawn
+//call ShadeClusteredLights() from a fragment shader with the world space position and normal of the fragment
+layout(std140) uniform ClusterParams {
+    mat4 u_clusterView;
+    //tiles x, tiles y, slices, light count
+    vec4 u_clusterGrid;
+    //slice scale and bias, near and far plane
+    vec4 u_clusterDepth;
+    //viewport width and height in pixels
+    vec4 u_clusterViewport;
+};
+
+//two texels per light, position and radius then color times intensity
+uniform samplerBuffer u_lightData;
+//offset into u_lightIndices and light count of every cluster
+uniform usamplerBuffer u_clusters;
+uniform usamplerBuffer u_lightIndices;
+
+int ClusterIndex(vec2 fragCoord, float viewDepth) {
+    ivec3 grid = ivec3(u_clusterGrid.xyz);
+    ivec2 tile = clamp(ivec2(fragCoord / u_clusterViewport.xy * vec2(grid.xy)), ivec2(0), grid.xy - 1);
+    int slice = clamp(int(log(max(viewDepth, u_clusterDepth.z)) * u_clusterDepth.x - u_clusterDepth.y), 0, grid.z - 1);
+    return (slice * grid.y + tile.y) * grid.x + tile.x;
+}
+
+//smooth falloff that reaches zero exactly at the radius
+float LightAttenuation(float distance, float radius) {
+    float ratio = distance / radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / (distance * distance + 1.0);
+}
+
+//diffuse light of every light in the fragment's cluster
+vec3 ShadeClusteredLights(vec3 worldPosition, vec3 normal, vec3 albedo) {
+    float viewDepth = -(u_clusterView * vec4(worldPosition, 1.0)).z;
+    uvec2 cluster = texelFetch(u_clusters, ClusterIndex(gl_FragCoord.xy, viewDepth)).xy;
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < cluster.y; ++i) {
+        int light = int(texelFetch(u_lightIndices, int(cluster.x + i)).x);
+        vec4 positionRadius = texelFetch(u_lightData, light * 2);
+        vec3 color = texelFetch(u_lightData, light * 2 + 1).rgb;
+        vec3 toLight = positionRadius.xyz - worldPosition;
+        float distance = length(toLight);
+        if (distance < positionRadius.w) {
+            float diffuse = max(dot(normal, toLight / max(distance, 1e-4)), 0.0);
+            result += color * diffuse * LightAttenuation(distance, positionRadius.w);
+        }
+    }
+    return result * albedo;
+}
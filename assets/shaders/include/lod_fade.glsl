@@ -0,0 +1,24 @@
+//dithered lod cross fade, call ApplyLodFade() first thing in a fragment shader
+//the render queue sets u_lodFade, 0 keeps every pixel and two lods drawn with fade and -fade split the pixels between them
+uniform float u_lodFade;
+
+float LodFadeDither(vec2 pixel) {
+    //4x4 ordered dither, thresholds spread evenly over [0, 1)
+    const float bayer[16] = float[16](
+         0.0,  8.0,  2.0, 10.0,
+        12.0,  4.0, 14.0,  6.0,
+         3.0, 11.0,  1.0,  9.0,
+        15.0,  7.0, 13.0,  5.0);
+    ivec2 cell = ivec2(mod(pixel, 4.0));
+    return (bayer[cell.y * 4 + cell.x] + 0.5) / 16.0;
+}
+
+void ApplyLodFade() {
+    if (u_lodFade == 0.0) {
+        return;
+    }
+    float dither = LodFadeDither(gl_FragCoord.xy);
+    if (u_lodFade > 0.0 ? dither >= u_lodFade : dither < -u_lodFade) {
+        discard;
+    }
+}
@@ -0,0 +1,6 @@
+//shared by the vertex color stages, the vertex stage writes it and the fragment stage reads it
+#ifdef VERTEX_STAGE
+out vec3 vColor;
+#else
+in vec3 vColor;
+#endif
@@ -0,0 +1,8 @@
+#version 330 core
+out vec4 FragColor;
+
+#include "include/vertex_color.glsl"
+
+void main() {
+    FragColor = vec4(vColor, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+#define VERTEX_STAGE
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 color;
+
+#include "include/vertex_color.glsl"
+
+void main() {
+    vColor = color;
+    gl_Position = vec4(position.x, position.y, position.z, 1.0);
+}
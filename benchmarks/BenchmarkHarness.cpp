@@ -0,0 +1,248 @@
+#include "BenchmarkHarness.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace bench {
+
+	namespace {
+
+		const size_t kMinSamples = 5;
+		const size_t kMaxSamples = 1000;
+
+		std::string Escape(const std::string& text) {
+			std::string escaped;
+			for (char c : text) {
+				if (c == '"' || c == '\\') {
+					escaped += '\\';
+				}
+				escaped += c;
+			}
+			return escaped;
+		}
+
+		//value of "key": in object, strings come back without quotes
+		bool FindValue(const std::string& object, const std::string& key, std::string& value) {
+			size_t position = object.find("\"" + key + "\"");
+			if (position == std::string::npos) {
+				return false;
+			}
+			position = object.find(':', position);
+			if (position == std::string::npos) {
+				return false;
+			}
+			position = object.find_first_not_of(" \t\r\n", position + 1);
+			if (position == std::string::npos) {
+				return false;
+			}
+			if (object[position] == '"') {
+				value.clear();
+				for (size_t i = position + 1; i < object.size() && object[i] != '"'; ++i) {
+					if (object[i] == '\\' && i + 1 < object.size()) {
+						++i;
+					}
+					value += object[i];
+				}
+				return true;
+			}
+			size_t end = object.find_first_of(",}\r\n", position);
+			value = object.substr(position, end == std::string::npos ? std::string::npos : end - position);
+			return true;
+		}
+
+		double ToNumber(const std::string& text) {
+			return std::strtod(text.c_str(), nullptr);
+		}
+	}
+
+	Runner::Runner(const std::string& filter, double secondsPerBenchmark)
+		: m_filter(filter), m_secondsPerBenchmark(secondsPerBenchmark) {
+	}
+
+	void Runner::Run(const std::string& group, const std::string& name, size_t operations, const std::function<void()>& workload) {
+		if (!IsEnabled(name)) {
+			return;
+		}
+		operations = std::max<size_t>(operations, 1);
+		workload();
+
+		std::vector<double> samples;
+		auto start = std::chrono::steady_clock::now();
+		while (samples.size() < kMaxSamples) {
+			auto sampleStart = std::chrono::steady_clock::now();
+			workload();
+			auto sampleEnd = std::chrono::steady_clock::now();
+			samples.push_back(std::chrono::duration<double, std::nano>(sampleEnd - sampleStart).count() / double(operations));
+			if (samples.size() >= kMinSamples && std::chrono::duration<double>(sampleEnd - start).count() >= m_secondsPerBenchmark) {
+				break;
+			}
+		}
+
+		Result result;
+		result.group = group;
+		result.name = name;
+		result.samples = samples.size();
+		result.operations = operations;
+		double sum = 0.0;
+		for (double sample : samples) {
+			sum += sample;
+		}
+		result.meanNanoseconds = sum / double(samples.size());
+		std::sort(samples.begin(), samples.end());
+		result.minNanoseconds = samples.front();
+		result.medianNanoseconds = samples[samples.size() / 2];
+		m_results.push_back(result);
+
+		std::printf("%-6s %-28s %12s %12s %8zu\n", group.c_str(), name.c_str(), FormatTime(result.medianNanoseconds).c_str(), FormatTime(result.minNanoseconds).c_str(), result.samples);
+		std::fflush(stdout);
+	}
+
+	void Runner::Skip(const std::string& group, const std::string& name, const std::string& reason) {
+		if (!IsEnabled(name)) {
+			return;
+		}
+		Result result;
+		result.group = group;
+		result.name = name;
+		result.skipped = reason;
+		m_results.push_back(result);
+		std::printf("%-6s %-28s skipped: %s\n", group.c_str(), name.c_str(), reason.c_str());
+	}
+
+	bool Runner::IsEnabled(const std::string& name) const {
+		return m_filter.empty() || name.find(m_filter) != std::string::npos;
+	}
+
+	const std::vector<Result>& Runner::GetResults() const {
+		return m_results;
+	}
+
+	bool WriteJson(const std::string& path, const std::vector<Result>& results, const std::string& context) {
+		std::ofstream file(path, std::ios::binary);
+		if (!file) {
+			std::fprintf(stderr, "ERROR:BENCHMARK: cannot write %s\n", path.c_str());
+			return false;
+		}
+		file << "{\n";
+		file << "  \"context\": \"" << Escape(context) << "\",\n";
+		file << "  \"benchmarks\": [\n";
+		for (size_t i = 0; i < results.size(); ++i) {
+			const Result& result = results[i];
+			//one benchmark per line keeps diffs of checked in baselines readable
+			file << "    {\"group\": \"" << Escape(result.group) << "\", \"name\": \"" << Escape(result.name) << "\"";
+			if (!result.skipped.empty()) {
+				file << ", \"skipped\": \"" << Escape(result.skipped) << "\"}";
+			}
+			else {
+				file << ", \"median_ns\": " << result.medianNanoseconds << ", \"min_ns\": " << result.minNanoseconds
+					<< ", \"mean_ns\": " << result.meanNanoseconds << ", \"samples\": " << result.samples << ", \"operations\": " << result.operations << "}";
+			}
+			file << (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		file << "  ]\n}\n";
+		return bool(file);
+	}
+
+	bool ReadJson(const std::string& path, std::vector<Result>& results) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			std::fprintf(stderr, "ERROR:BENCHMARK: cannot read %s\n", path.c_str());
+			return false;
+		}
+		std::stringstream stream;
+		stream << file.rdbuf();
+		std::string text = stream.str();
+
+		size_t arrayStart = text.find("\"benchmarks\"");
+		if (arrayStart == std::string::npos) {
+			std::fprintf(stderr, "ERROR:BENCHMARK: %s has no benchmarks array\n", path.c_str());
+			return false;
+		}
+		results.clear();
+		size_t position = text.find('[', arrayStart);
+		while (position != std::string::npos) {
+			size_t objectStart = text.find('{', position);
+			size_t arrayEnd = text.find(']', position);
+			if (objectStart == std::string::npos || (arrayEnd != std::string::npos && arrayEnd < objectStart)) {
+				break;
+			}
+			size_t objectEnd = text.find('}', objectStart);
+			if (objectEnd == std::string::npos) {
+				std::fprintf(stderr, "ERROR:BENCHMARK: %s is truncated\n", path.c_str());
+				return false;
+			}
+			std::string object = text.substr(objectStart, objectEnd - objectStart + 1);
+			position = objectEnd + 1;
+
+			Result result;
+			std::string value;
+			if (!FindValue(object, "name", result.name)) {
+				continue;
+			}
+			FindValue(object, "group", result.group);
+			FindValue(object, "skipped", result.skipped);
+			if (FindValue(object, "median_ns", value)) {
+				result.medianNanoseconds = ToNumber(value);
+			}
+			if (FindValue(object, "min_ns", value)) {
+				result.minNanoseconds = ToNumber(value);
+			}
+			if (FindValue(object, "mean_ns", value)) {
+				result.meanNanoseconds = ToNumber(value);
+			}
+			if (FindValue(object, "samples", value)) {
+				result.samples = size_t(ToNumber(value));
+			}
+			if (FindValue(object, "operations", value)) {
+				result.operations = size_t(ToNumber(value));
+			}
+			results.push_back(result);
+		}
+		return true;
+	}
+
+	size_t Compare(const std::vector<Result>& baseline, const std::vector<Result>& current, double thresholdPercent, FILE* output) {
+		std::fprintf(output, "%-28s %12s %12s %9s\n", "benchmark", "baseline", "current", "change");
+		size_t regressions = 0;
+		for (const Result& result : current) {
+			auto match = std::find_if(baseline.begin(), baseline.end(), [&](const Result& candidate) { return candidate.name == result.name; });
+			if (match == baseline.end()) {
+				std::fprintf(output, "%-28s %12s %12s %9s\n", result.name.c_str(), "-", result.skipped.empty() ? FormatTime(result.medianNanoseconds).c_str() : "skipped", "new");
+				continue;
+			}
+			if (!result.skipped.empty() || !match->skipped.empty() || match->medianNanoseconds <= 0.0) {
+				std::fprintf(output, "%-28s %12s %12s %9s\n", result.name.c_str(), "-", "-", "skipped");
+				continue;
+			}
+			double change = (result.medianNanoseconds - match->medianNanoseconds) / match->medianNanoseconds * 100.0;
+			const char* verdict = "";
+			if (change > thresholdPercent) {
+				verdict = "  REGRESSION";
+				++regressions;
+			}
+			else if (change < -thresholdPercent) {
+				verdict = "  faster";
+			}
+			std::fprintf(output, "%-28s %12s %12s %+8.1f%%%s\n", result.name.c_str(), FormatTime(match->medianNanoseconds).c_str(),
+				FormatTime(result.medianNanoseconds).c_str(), change, verdict);
+		}
+		std::fprintf(output, "%zu regression%s beyond %.1f%%\n", regressions, regressions == 1 ? "" : "s", thresholdPercent);
+		return regressions;
+	}
+
+	std::string FormatTime(double nanoseconds) {
+		char text[32];
+		if (nanoseconds >= 1e6) {
+			std::snprintf(text, sizeof(text), "%.3f ms", nanoseconds / 1e6);
+		}
+		else if (nanoseconds >= 1e3) {
+			std::snprintf(text, sizeof(text), "%.3f us", nanoseconds / 1e3);
+		}
+		else {
+			std::snprintf(text, sizeof(text), "%.2f ns", nanoseconds);
+		}
+		return text;
+	}
+}
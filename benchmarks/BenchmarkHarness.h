@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+//times small engine workloads, writes the results as json and compares two result sets
+namespace bench {
+
+	struct Result {
+		//micro for isolated kernels, macro for whole frames
+		std::string group;
+		std::string name;
+		//per operation, every sample runs the workload once and divides by its operation count
+		double medianNanoseconds = 0.0;
+		double minNanoseconds = 0.0;
+		double meanNanoseconds = 0.0;
+		size_t samples = 0;
+		size_t operations = 0;
+		//set when the workload could not run here, e.g. no gl context
+		std::string skipped;
+	};
+
+	//keeps the compiler from throwing away a result that is never used otherwise
+	template<typename T>
+	void Consume(const T& value) {
+#if defined(_MSC_VER)
+		static const void* volatile sink;
+		sink = &value;
+#else
+		asm volatile("" : : "g"(&value) : "memory");
+#endif
+	}
+
+	class Runner {
+	public:
+		//only benchmarks whose name contains filter run, an empty filter runs all
+		explicit Runner(const std::string& filter, double secondsPerBenchmark = 0.25);
+
+		//workload is called repeatedly after one warm up call, each call performs operations units of work
+		void Run(const std::string& group, const std::string& name, size_t operations, const std::function<void()>& workload);
+		void Skip(const std::string& group, const std::string& name, const std::string& reason);
+		bool IsEnabled(const std::string& name) const;
+
+		const std::vector<Result>& GetResults() const;
+
+	private:
+		std::string m_filter;
+		double m_secondsPerBenchmark;
+		std::vector<Result> m_results;
+	};
+
+	//context ends up next to the results so a comparison can tell debug and release runs apart
+	bool WriteJson(const std::string& path, const std::vector<Result>& results, const std::string& context);
+	//reads files written by WriteJson
+	bool ReadJson(const std::string& path, std::vector<Result>& results);
+
+	//prints every benchmark present in both sets and returns how many got slower than thresholdPercent
+	size_t Compare(const std::vector<Result>& baseline, const std::vector<Result>& current, double thresholdPercent, FILE* output);
+
+	std::string FormatTime(double nanoseconds);
+}
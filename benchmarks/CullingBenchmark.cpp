@@ -0,0 +1,180 @@
+#include "render/FrustumCuller.h"
+#include "render/OcclusionCuller.h"
+#include "jobs/JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+//culls one million randomly placed objects against a perspective camera with every instruction set,
+//single threaded and on the job system, and reports the median time of several runs
+//then hides the frustum culled boxes behind a wall with the software occlusion culler
+namespace {
+
+	const size_t kObjectCount = 1000000;
+	const int kIterations = 25;
+
+	//column major perspective * look-at, camera at the origin looking down -z
+	void BuildViewProjection(float* m) {
+		const float fovY = 60.0f * 3.14159265f / 180.0f;
+		const float aspect = 16.0f / 9.0f;
+		const float nearPlane = 0.1f;
+		const float farPlane = 500.0f;
+		float f = 1.0f / std::tan(fovY * 0.5f);
+		std::fill(m, m + 16, 0.0f);
+		m[0] = f / aspect;
+		m[5] = f;
+		m[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+		m[11] = -1.0f;
+		m[14] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+	}
+
+	const char* GetName(eng::FrustumCuller::InstructionSet instructionSet) {
+		switch (instructionSet) {
+		case eng::FrustumCuller::InstructionSet::AVX2: return "avx2";
+		case eng::FrustumCuller::InstructionSet::SSE: return "sse";
+		default: return "scalar";
+		}
+	}
+
+	template<typename Bounds>
+	double Measure(eng::FrustumCuller& culler, const eng::Frustum& frustum, const Bounds& bounds, std::vector<uint32_t>& visible, eng::JobSystem* jobSystem) {
+		std::vector<double> times;
+		for (int i = 0; i < kIterations; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			culler.Cull(frustum, bounds, visible, jobSystem);
+			times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	}
+
+	//rasterizes the occluders and culls a copy of the frustum visible set every run
+	double MeasureOcclusion(eng::OcclusionCuller& culler, const float* viewProjection, const std::vector<float>& vertices, const std::vector<uint32_t>& indices,
+		const eng::AABBSoA& boxes, const std::vector<uint32_t>& candidates, std::vector<uint32_t>& visible, eng::JobSystem* jobSystem) {
+		std::vector<double> times;
+		for (int i = 0; i < kIterations; ++i) {
+			visible = candidates;
+			auto start = std::chrono::steady_clock::now();
+			culler.BeginFrame(viewProjection);
+			culler.AddOccluder(vertices.data(), vertices.size() / 3, 3, indices.data(), indices.size());
+			culler.Rasterize(jobSystem);
+			culler.Cull(boxes, visible, jobSystem);
+			times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	}
+}
+
+int main() {
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+	eng::BoundingSphereSoA spheres;
+	eng::AABBSoA boxes;
+	spheres.Reserve(kObjectCount);
+	boxes.Reserve(kObjectCount);
+	for (size_t i = 0; i < kObjectCount; ++i) {
+		float x = position(random);
+		float y = position(random);
+		float z = position(random);
+		float extent = size(random);
+		spheres.Add(eng::BoundingSphere{ x, y, z, extent });
+		boxes.Add(eng::AABB{ x, y, z, extent, extent, extent });
+	}
+
+	float viewProjection[16];
+	BuildViewProjection(viewProjection);
+	eng::Frustum frustum = eng::Frustum::FromMatrix(viewProjection);
+
+	eng::JobSystem jobSystem;
+	jobSystem.Init();
+
+	std::printf("%zu objects, %zu workers\n", kObjectCount, jobSystem.GetWorkerCount());
+	std::printf("%-8s %-8s %12s %12s %10s\n", "set", "bounds", "1 thread ms", "jobs ms", "visible");
+
+	eng::FrustumCuller culler;
+	std::vector<uint32_t> sphereReference;
+	std::vector<uint32_t> boxReference;
+	std::vector<uint32_t> visible;
+	bool consistent = true;
+
+	for (auto instructionSet : { eng::FrustumCuller::InstructionSet::Scalar, eng::FrustumCuller::InstructionSet::SSE, eng::FrustumCuller::InstructionSet::AVX2 }) {
+		if (!eng::FrustumCuller::IsSupported(instructionSet)) {
+			std::printf("%-8s unsupported on this cpu\n", GetName(instructionSet));
+			continue;
+		}
+		culler.SetInstructionSet(instructionSet);
+
+		double single = Measure(culler, frustum, spheres, visible, nullptr);
+		double parallel = Measure(culler, frustum, spheres, visible, &jobSystem);
+		if (sphereReference.empty()) {
+			sphereReference = visible;
+		}
+		consistent = consistent && visible == sphereReference;
+		std::printf("%-8s %-8s %12.3f %12.3f %10zu\n", GetName(instructionSet), "sphere", single, parallel, visible.size());
+
+		single = Measure(culler, frustum, boxes, visible, nullptr);
+		parallel = Measure(culler, frustum, boxes, visible, &jobSystem);
+		if (boxReference.empty()) {
+			boxReference = visible;
+		}
+		consistent = consistent && visible == boxReference;
+		std::printf("%-8s %-8s %12.3f %12.3f %10zu\n", GetName(instructionSet), "aabb", single, parallel, visible.size());
+	}
+
+	//a wall facing the camera 50 units in, everything completely behind its silhouette is hidden
+	const float wallDepth = -50.0f;
+	std::vector<float> wall = {
+		-40.0f, -20.0f, wallDepth,
+		40.0f, -20.0f, wallDepth,
+		40.0f, 20.0f, wallDepth,
+		-40.0f, 20.0f, wallDepth
+	};
+	std::vector<uint32_t> wallIndices = { 0, 1, 2, 0, 2, 3 };
+
+	std::printf("\n%-8s %12s %12s %10s %10s\n", "occlusion", "1 thread ms", "jobs ms", "tested", "occluded");
+	eng::OcclusionCuller occlusionCuller;
+	std::vector<uint32_t> occlusionReference;
+	for (bool simd : { false, true }) {
+		occlusionCuller.SetSIMDEnabled(simd);
+		if (simd && !occlusionCuller.IsSIMDEnabled()) {
+			std::printf("%-8s unsupported on this cpu\n", "sse");
+			continue;
+		}
+		double single = MeasureOcclusion(occlusionCuller, viewProjection, wall, wallIndices, boxes, boxReference, visible, nullptr);
+		double parallel = MeasureOcclusion(occlusionCuller, viewProjection, wall, wallIndices, boxes, boxReference, visible, &jobSystem);
+		if (occlusionReference.empty()) {
+			occlusionReference = visible;
+		}
+		consistent = consistent && visible == occlusionReference;
+		const auto& stats = occlusionCuller.GetStats();
+		std::printf("%-9s %12.3f %12.3f %10zu %10zu\n", simd ? "sse" : "scalar", single, parallel, stats.testedCount, stats.occludedCount);
+	}
+
+	//nothing in front of the wall may ever be reported hidden
+	size_t next = 0;
+	for (uint32_t index : boxReference) {
+		if (next < occlusionReference.size() && occlusionReference[next] == index) {
+			++next;
+			continue;
+		}
+		eng::AABB box = boxes.Get(index);
+		if (box.centerZ + box.extentZ >= wallDepth) {
+			std::printf("ERROR: box %u in front of the occluder was culled\n", index);
+			consistent = false;
+			break;
+		}
+	}
+
+	jobSystem.Shutdown();
+	if (!consistent) {
+		std::printf("ERROR: instruction sets disagree on the visible set\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,553 @@
+#include "BenchmarkHarness.h"
+#include "Engine.h"
+#include "graphics/Framebuffer.h"
+#include "graphics/GraphicsAPI.h"
+#include "graphics/HeadlessContext.h"
+#include "graphics/Mesh.h"
+#include "graphics/MeshData.h"
+#include "graphics/ShaderProgram.h"
+#include "input/InputManager.h"
+#include "memory/MemoryPool.h"
+#include "memory/MemoryTracker.h"
+#include "render/ClusteredLighting.h"
+#include "render/CommandList.h"
+#include "render/Frustum.h"
+#include "render/FrustumCuller.h"
+#include "render/LODSelector.h"
+#include "render/Material.h"
+#include "render/OcclusionCuller.h"
+#include "render/RenderQueue.h"
+#include "scene/DynamicBVH.h"
+#include "jobs/JobSystem.h"
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+//micro benchmarks of the engine hot paths and a synthetic frame, results as a table and optionally as json
+//usage: EngineBenchmarks [--filter text] [--seconds s] [--json out.json] [--baseline old.json] [--threshold percent]
+//       EngineBenchmarks --compare old.json new.json [--threshold percent]
+//with a baseline or in compare mode the exit code is 1 when anything got slower than the threshold
+namespace {
+
+	const size_t kObjectCount = 100000;
+	const size_t kFrameObjectCount = 20000;
+	const size_t kGLFrameObjectCount = 2000;
+	const size_t kLightCount = 4096;
+	const double kDefaultThreshold = 10.0;
+
+	const char* kVertexSource = R"(#version 330 core
+layout(location = 0) in vec3 position;
+uniform vec3 u_offset;
+void main() {
+	gl_Position = vec4(position * 0.01 + u_offset, 1.0);
+}
+)";
+
+	const char* kFragmentSource = R"(#version 330 core
+out vec4 color;
+uniform float u_param0;
+uniform float u_param1;
+uniform float u_param2;
+uniform float u_param3;
+uniform float u_param4;
+uniform float u_param5;
+uniform float u_param6;
+uniform float u_param7;
+uniform float u_lodFade;
+void main() {
+	float sum = u_param0 + u_param1 + u_param2 + u_param3 + u_param4 + u_param5 + u_param6 + u_param7;
+	color = vec4(sum, u_lodFade, 0.0, 1.0);
+}
+)";
+
+	//column major perspective * look-at, camera at the origin looking down -z
+	void BuildViewProjection(float* m, float& projectionScale) {
+		const float fovY = 60.0f * 3.14159265f / 180.0f;
+		const float aspect = 16.0f / 9.0f;
+		const float nearPlane = 0.1f;
+		const float farPlane = 500.0f;
+		float f = 1.0f / std::tan(fovY * 0.5f);
+		std::fill(m, m + 16, 0.0f);
+		m[0] = f / aspect;
+		m[5] = f;
+		m[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+		m[11] = -1.0f;
+		m[14] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+		projectionScale = 0.5f * 720.0f * f;
+	}
+
+	//hidden window so the gl benchmarks have a context, nullptr when there is no display or driver
+	GLFWwindow* CreateHiddenContext() {
+		if (!glfwInit()) {
+			return nullptr;
+		}
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		GLFWwindow* window = glfwCreateWindow(256, 256, "EngineBenchmarks", nullptr, nullptr);
+		if (!window) {
+			glfwTerminate();
+			return nullptr;
+		}
+		glfwMakeContextCurrent(window);
+		glfwSwapInterval(0);
+		if (glewInit() != GLEW_OK) {
+			glfwDestroyWindow(window);
+			glfwTerminate();
+			return nullptr;
+		}
+		return window;
+	}
+
+	eng::MeshData BuildCube() {
+		eng::MeshData cube;
+		cube.vertices = {
+			-1, -1, -1,  1, -1, -1,  1, 1, -1,  -1, 1, -1,
+			-1, -1, 1,  1, -1, 1,  1, 1, 1,  -1, 1, 1
+		};
+		cube.vertexStride = 3;
+		cube.attributes.push_back(eng::VertexAttribute{ 0, 3, 0 });
+		cube.indices = {
+			0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,  0, 1, 5, 0, 5, 4,
+			3, 6, 2, 3, 7, 6,  0, 4, 7, 0, 7, 3,  1, 2, 6, 1, 6, 5
+		};
+		cube.lods.push_back(eng::MeshLOD{ 0, uint32_t(cube.indices.size()), 0.0f });
+		cube.ComputeBounds();
+		return cube;
+	}
+
+	//objects scattered in front of the camera, some of them behind the wall of the occlusion benchmarks
+	struct Scene {
+		eng::BoundingSphereSoA spheres;
+		eng::AABBSoA boxes;
+		std::vector<eng::AABB> aabbs;
+
+		void Build(size_t count, std::mt19937& random) {
+			std::uniform_real_distribution<float> lateral(-150.0f, 150.0f);
+			std::uniform_real_distribution<float> depth(-400.0f, 20.0f);
+			std::uniform_real_distribution<float> size(0.5f, 4.0f);
+			spheres.Reserve(count);
+			boxes.Reserve(count);
+			for (size_t i = 0; i < count; ++i) {
+				eng::AABB box{ lateral(random), lateral(random) * 0.3f, depth(random), size(random), size(random), size(random) };
+				aabbs.push_back(box);
+				boxes.Add(box);
+				spheres.Add(eng::BoundingSphere{ box.centerX, box.centerY, box.centerZ,
+					std::sqrt(box.extentX * box.extentX + box.extentY * box.extentY + box.extentZ * box.extentZ) });
+			}
+		}
+	};
+
+	const std::vector<float> kWall = {
+		-40.0f, -20.0f, -50.0f,
+		40.0f, -20.0f, -50.0f,
+		40.0f, 20.0f, -50.0f,
+		-40.0f, 20.0f, -50.0f
+	};
+	const std::vector<uint32_t> kWallIndices = { 0, 1, 2, 0, 2, 3 };
+	const std::vector<float> kLODErrors = { 0.0f, 0.02f, 0.08f, 0.3f };
+
+	void RunMicroBenchmarks(bench::Runner& runner, eng::JobSystem& jobSystem, bool hasContext) {
+		float viewProjection[16];
+		float projectionScale;
+		BuildViewProjection(viewProjection, projectionScale);
+		eng::Frustum frustum = eng::Frustum::FromMatrix(viewProjection);
+		std::mt19937 random(1234);
+		Scene scene;
+		scene.Build(kObjectCount, random);
+
+		//gl state lookups the renderer does for every draw
+		if (hasContext) {
+			auto& graphicsAPI = eng::Engine::GetInstance().GetGraphicsAPI();
+			auto program = graphicsAPI.CreateShaderProgram(kVertexSource, kFragmentSource);
+			std::vector<std::string> names;
+			for (int i = 0; i < 8; ++i) {
+				names.push_back("u_param" + std::to_string(i));
+			}
+			names.push_back("u_lodFade");
+			names.push_back("u_offset");
+
+			runner.Run("micro", "uniform_lookup", names.size() * 1000, [&]() {
+				GLint sum = 0;
+				for (int repeat = 0; repeat < 1000; ++repeat) {
+					for (const auto& name : names) {
+						sum += program->GetUniformLocation(name);
+					}
+				}
+				bench::Consume(sum);
+			});
+
+			eng::Material material;
+			material.SetShaderProgram(program);
+			for (int i = 0; i < 8; ++i) {
+				material.SetParam(names[i], float(i));
+			}
+			runner.Run("micro", "material_bind", 1000, [&]() {
+				for (int repeat = 0; repeat < 1000; ++repeat) {
+					material.Bind();
+				}
+			});
+			glFinish();
+		}
+		else {
+			runner.Skip("micro", "uniform_lookup", "no gl context");
+			runner.Skip("micro", "material_bind", "no gl context");
+		}
+
+		auto& inputManager = eng::Engine::GetInstance().GetInputManager();
+		for (int key = 0; key < 256; key += 7) {
+			inputManager.SetKeyPressed(key, true);
+		}
+		runner.Run("micro", "input_polling", 256 * 100, [&]() {
+			int pressed = 0;
+			for (int repeat = 0; repeat < 100; ++repeat) {
+				for (int key = 0; key < 256; ++key) {
+					pressed += inputManager.IsKeyPressed(key) ? 1 : 0;
+				}
+			}
+			bench::Consume(pressed);
+		});
+		for (int key = 0; key < 256; key += 7) {
+			inputManager.SetKeyPressed(key, false);
+		}
+
+		//mixed sizes allocated in one go and freed in a different order, like a frame of render packets
+		const size_t allocationCount = 4096;
+		std::vector<size_t> sizes(allocationCount);
+		for (size_t i = 0; i < allocationCount; ++i) {
+			sizes[i] = 16 + (i * 7919) % 500;
+		}
+		std::vector<void*> blocks(allocationCount);
+		runner.Run("micro", "pool_alloc_free", allocationCount, [&]() {
+			for (size_t i = 0; i < allocationCount; ++i) {
+				blocks[i] = eng::MemoryPool::Allocate(sizes[i]);
+			}
+			for (size_t i = 0; i < allocationCount; i += 2) {
+				eng::MemoryPool::Free(blocks[i], sizes[i]);
+			}
+			for (size_t i = 1; i < allocationCount; i += 2) {
+				eng::MemoryPool::Free(blocks[i], sizes[i]);
+			}
+		});
+		runner.Run("micro", "malloc_free", allocationCount, [&]() {
+			for (size_t i = 0; i < allocationCount; ++i) {
+				blocks[i] = std::malloc(sizes[i]);
+			}
+			for (size_t i = 0; i < allocationCount; i += 2) {
+				std::free(blocks[i]);
+			}
+			for (size_t i = 1; i < allocationCount; i += 2) {
+				std::free(blocks[i]);
+			}
+			bench::Consume(blocks);
+		});
+		runner.Run("micro", "tracker_alloc_free", allocationCount, [&]() {
+			for (size_t i = 0; i < allocationCount; ++i) {
+				blocks[i] = eng::MemoryTracker::Allocate(sizes[i], eng::MemoryTag::Game);
+			}
+			for (size_t i = 0; i < allocationCount; ++i) {
+				eng::MemoryTracker::Free(blocks[i]);
+			}
+		});
+
+		runner.Run("micro", "frustum_from_matrix", 1000, [&]() {
+			float matrix[16];
+			std::memcpy(matrix, viewProjection, sizeof(matrix));
+			float sum = 0.0f;
+			for (int i = 0; i < 1000; ++i) {
+				matrix[12] = float(i) * 0.001f;
+				sum += eng::Frustum::FromMatrix(matrix).planes[0].d;
+			}
+			bench::Consume(sum);
+		});
+
+		eng::LODSelector lodSelector;
+		for (size_t i = 0; i < kObjectCount; ++i) {
+			lodSelector.Add(eng::BoundingSphere{ scene.spheres.x[i], scene.spheres.y[i], scene.spheres.z[i], scene.spheres.radius[i] }, kLODErrors);
+		}
+		eng::LODCamera camera{ 0.0f, 0.0f, 0.0f, projectionScale };
+		//let the cross fades of the first selection finish, a still camera is the steady state
+		for (int frame = 0; frame < 60; ++frame) {
+			lodSelector.Update(camera, 1.0f / 60.0f);
+		}
+		runner.Run("micro", "lod_select_100k", kObjectCount, [&]() {
+			lodSelector.Update(camera, 1.0f / 60.0f);
+		});
+
+		eng::FrustumCuller frustumCuller;
+		std::vector<uint32_t> visible;
+		runner.Run("micro", "frustum_cull_sphere_100k", kObjectCount, [&]() {
+			frustumCuller.Cull(frustum, scene.spheres, visible);
+		});
+		runner.Run("micro", "frustum_cull_aabb_100k", kObjectCount, [&]() {
+			frustumCuller.Cull(frustum, scene.boxes, visible);
+		});
+		runner.Run("micro", "frustum_cull_aabb_100k_jobs", kObjectCount, [&]() {
+			frustumCuller.Cull(frustum, scene.boxes, visible, &jobSystem);
+		});
+
+		//draws of a few materials and lods encoded into command lists, nothing is replayed
+		std::vector<eng::Material> recordMaterials(16);
+		std::vector<eng::RenderCommand> drawCommands(kObjectCount);
+		std::vector<uint32_t> drawOrder(kObjectCount);
+		for (size_t i = 0; i < kObjectCount; ++i) {
+			eng::RenderCommand& command = drawCommands[i];
+			command.material = &recordMaterials[(i / 64) % recordMaterials.size()];
+			command.vertexArray = 1;
+			command.count = GLsizei(36 >> (i % kLODErrors.size()));
+			command.indexType = GL_UNSIGNED_INT;
+			drawOrder[i] = uint32_t(i);
+		}
+		eng::CommandListPool commandLists;
+		runner.Run("micro", "command_record_100k", kObjectCount, [&]() {
+			eng::CommandList& list = commandLists.Acquire();
+			for (const eng::RenderCommand& command : drawCommands) {
+				list.Draw(command);
+			}
+			commandLists.Reset();
+		});
+		runner.Run("micro", "command_record_100k_jobs", kObjectCount, [&]() {
+			commandLists.RecordParallel(jobSystem, drawCommands, drawOrder, 4096);
+			commandLists.Reset();
+		});
+
+		//small lights spread over the scene, binned into the default 16 x 9 x 24 froxels
+		std::vector<eng::PointLight> lights(kLightCount * 4);
+		std::uniform_real_distribution<float> lightLateral(-150.0f, 150.0f);
+		std::uniform_real_distribution<float> lightDepth(-400.0f, 20.0f);
+		std::uniform_real_distribution<float> lightRadius(1.0f, 10.0f);
+		for (eng::PointLight& light : lights) {
+			light.x = lightLateral(random);
+			light.y = lightLateral(random) * 0.3f;
+			light.z = lightDepth(random);
+			light.radius = lightRadius(random);
+		}
+		std::vector<eng::PointLight> fewerLights(lights.begin(), lights.begin() + kLightCount);
+		eng::ClusterCamera clusterCamera;
+		eng::ClusteredLighting clusteredLighting;
+		runner.Run("micro", "cluster_bin_4k", kLightCount, [&]() {
+			clusteredLighting.Build(clusterCamera, fewerLights);
+		});
+		runner.Run("micro", "cluster_bin_4k_jobs", kLightCount, [&]() {
+			clusteredLighting.Build(clusterCamera, fewerLights, &jobSystem);
+		});
+		runner.Run("micro", "cluster_bin_16k_jobs", lights.size(), [&]() {
+			clusteredLighting.Build(clusterCamera, lights, &jobSystem);
+		});
+
+		frustumCuller.Cull(frustum, scene.boxes, visible);
+		std::vector<uint32_t> candidates = visible;
+		eng::OcclusionCuller occlusionCuller;
+		runner.Run("micro", "occlusion_cull", candidates.size(), [&]() {
+			visible = candidates;
+			occlusionCuller.BeginFrame(viewProjection);
+			occlusionCuller.AddOccluder(kWall.data(), kWall.size() / 3, 3, kWallIndices.data(), kWallIndices.size());
+			occlusionCuller.Rasterize();
+			occlusionCuller.Cull(scene.boxes, visible);
+		});
+
+		eng::DynamicBVH bvh;
+		for (size_t i = 0; i < kObjectCount; ++i) {
+			bvh.CreateProxy(scene.aabbs[i], uint32_t(i));
+		}
+		runner.Run("micro", "bvh_query_frustum_100k", 1, [&]() {
+			visible.clear();
+			bvh.QueryFrustum(frustum, visible);
+		});
+	}
+
+	//everything the engine does for a frame on the cpu: animate, cull, pick lods and build the render queue
+	//with a context the queue is also drawn and the gpu waited for
+	void RunFrame(bench::Runner& runner, const std::string& name, size_t objectCount, eng::JobSystem& jobSystem, const eng::Mesh* mesh, eng::Material* material) {
+		float viewProjection[16];
+		float projectionScale;
+		BuildViewProjection(viewProjection, projectionScale);
+		eng::Frustum frustum = eng::Frustum::FromMatrix(viewProjection);
+		std::mt19937 random(4321);
+		Scene scene;
+		scene.Build(objectCount, random);
+
+		eng::DynamicBVH bvh;
+		std::vector<int32_t> proxies(objectCount);
+		eng::LODSelector lodSelector;
+		for (size_t i = 0; i < objectCount; ++i) {
+			proxies[i] = bvh.CreateProxy(scene.aabbs[i], uint32_t(i));
+			lodSelector.Add(eng::BoundingSphere{ scene.spheres.x[i], scene.spheres.y[i], scene.spheres.z[i], scene.spheres.radius[i] }, kLODErrors);
+		}
+		eng::LODCamera camera{ 0.0f, 0.0f, 0.0f, projectionScale };
+		eng::FrustumCuller frustumCuller;
+		eng::OcclusionCuller occlusionCuller;
+		eng::RenderQueue renderQueue;
+		std::vector<uint32_t> visible;
+
+		//without a gpu mesh the commands only differ in their index range
+		std::vector<eng::RenderCommand> lodCommands(kLODErrors.size());
+		for (size_t lod = 0; lod < lodCommands.size(); ++lod) {
+			lodCommands[lod].count = GLsizei(36 >> lod);
+			lodCommands[lod].indexType = GL_UNSIGNED_INT;
+		}
+
+		auto& graphicsAPI = eng::Engine::GetInstance().GetGraphicsAPI();
+		size_t frame = 0;
+		runner.Run("macro", name, 1, [&]() {
+			//a twentieth of the scene moves every frame
+			float time = float(frame++) * (1.0f / 60.0f);
+			for (size_t i = frame % 20; i < objectCount; i += 20) {
+				eng::AABB box = scene.aabbs[i];
+				box.centerX += std::sin(time + float(i)) * 0.5f;
+				scene.boxes.Set(i, box);
+				scene.spheres.x[i] = box.centerX;
+				bvh.MoveProxy(proxies[i], box);
+				lodSelector.SetBounds(uint32_t(i), eng::BoundingSphere{ box.centerX, box.centerY, box.centerZ, scene.spheres.radius[i] });
+			}
+
+			frustumCuller.Cull(frustum, scene.boxes, visible, &jobSystem);
+			occlusionCuller.BeginFrame(viewProjection);
+			occlusionCuller.AddOccluder(kWall.data(), kWall.size() / 3, 3, kWallIndices.data(), kWallIndices.size());
+			occlusionCuller.Rasterize(&jobSystem);
+			occlusionCuller.Cull(scene.boxes, visible, &jobSystem);
+			lodSelector.Update(camera, 1.0f / 60.0f, &jobSystem);
+
+			if (mesh) {
+				for (uint32_t index : visible) {
+					eng::LODSelector::Submit(renderQueue, material, *mesh, lodSelector.GetState(index));
+				}
+				renderQueue.Flush(graphicsAPI);
+				glFinish();
+			}
+			else {
+				for (uint32_t index : visible) {
+					const eng::LODState& state = lodSelector.GetState(index);
+					renderQueue.Submit(lodCommands[state.lod]);
+				}
+				renderQueue.Clear();
+			}
+		});
+	}
+
+	int Usage() {
+		std::printf("usage: EngineBenchmarks [--filter text] [--seconds s] [--json out.json] [--baseline old.json] [--threshold percent]\n");
+		std::printf("       EngineBenchmarks --compare old.json new.json [--threshold percent]\n");
+		return 1;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::string filter;
+	std::string jsonPath;
+	std::string baselinePath;
+	std::string comparePaths[2];
+	double threshold = kDefaultThreshold;
+	double seconds = 0.25;
+	for (int i = 1; i < argc; ++i) {
+		std::string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (argument == "--filter" && hasValue) {
+			filter = argv[++i];
+		}
+		else if (argument == "--json" && hasValue) {
+			jsonPath = argv[++i];
+		}
+		else if (argument == "--baseline" && hasValue) {
+			baselinePath = argv[++i];
+		}
+		else if (argument == "--threshold" && hasValue) {
+			threshold = std::atof(argv[++i]);
+		}
+		else if (argument == "--seconds" && hasValue) {
+			seconds = std::atof(argv[++i]);
+		}
+		else if (argument == "--compare" && i + 2 < argc) {
+			comparePaths[0] = argv[++i];
+			comparePaths[1] = argv[++i];
+		}
+		else {
+			return Usage();
+		}
+	}
+
+	//two result files, nothing to run
+	if (!comparePaths[0].empty()) {
+		std::vector<bench::Result> baseline;
+		std::vector<bench::Result> current;
+		if (!bench::ReadJson(comparePaths[0], baseline) || !bench::ReadJson(comparePaths[1], current)) {
+			return 1;
+		}
+		return bench::Compare(baseline, current, threshold, stdout) > 0 ? 1 : 0;
+	}
+
+	//without a display the gl benchmarks run off-screen, on llvmpipe when there is no gpu either
+	GLFWwindow* window = CreateHiddenContext();
+	eng::HeadlessContext headlessContext;
+	eng::Framebuffer framebuffer;
+	bool hasContext = window != nullptr;
+	if (!hasContext && eng::HeadlessContext::IsSupported() && headlessContext.Create()) {
+		//the entry points are loaded before glew gives up on the missing glx display
+		GLenum glewResult = glewInit();
+		hasContext = (glewResult == GLEW_OK || glewResult == GLEW_ERROR_NO_GLX_DISPLAY) && framebuffer.Create(256, 256);
+		if (!hasContext) {
+			headlessContext.Destroy();
+		}
+	}
+	eng::JobSystem jobSystem;
+	jobSystem.Init();
+
+#ifdef NDEBUG
+	std::string context = "release";
+#else
+	std::string context = "debug";
+#endif
+	context += ", " + std::to_string(jobSystem.GetWorkerCount()) + " workers";
+	if (hasContext) {
+		context += ", " + std::string(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	}
+	std::printf("%s\n", context.c_str());
+	std::printf("%-6s %-28s %12s %12s %8s\n", "group", "benchmark", "median/op", "min/op", "samples");
+
+	bench::Runner runner(filter, seconds);
+	RunMicroBenchmarks(runner, jobSystem, hasContext);
+	RunFrame(runner, "frame_cpu_20k", kFrameObjectCount, jobSystem, nullptr, nullptr);
+	if (hasContext) {
+		auto& graphicsAPI = eng::Engine::GetInstance().GetGraphicsAPI();
+		auto mesh = graphicsAPI.CreateMesh(BuildCube());
+		eng::Material material;
+		material.SetShaderProgram(graphicsAPI.CreateShaderProgram(kVertexSource, kFragmentSource));
+		RunFrame(runner, "frame_gl_2k", kGLFrameObjectCount, jobSystem, mesh.get(), &material);
+	}
+	else {
+		runner.Skip("macro", "frame_gl_2k", "no gl context");
+	}
+	jobSystem.Shutdown();
+
+	int exitCode = 0;
+	if (!jsonPath.empty() && !bench::WriteJson(jsonPath, runner.GetResults(), context)) {
+		exitCode = 1;
+	}
+	if (!baselinePath.empty()) {
+		std::vector<bench::Result> baseline;
+		if (!bench::ReadJson(baselinePath, baseline)) {
+			exitCode = 1;
+		}
+		else {
+			std::printf("\n");
+			if (bench::Compare(baseline, runner.GetResults(), threshold, stdout) > 0) {
+				exitCode = 1;
+			}
+		}
+	}
+
+	framebuffer.Destroy();
+	headlessContext.Destroy();
+	if (window) {
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+	return exitCode;
+}
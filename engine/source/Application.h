@@ -3,6 +3,8 @@
 namespace eng {
 	class Application {
 	public:
+		//the engine deletes the application through this base, the derived members have to go with it
+		virtual ~Application() = default;
 		virtual bool Init() = 0;
 		//deltaTime in seconds
 		virtual void Update(float deltaTime) = 0;
@@ -1,99 +1,301 @@
 #include "Engine.h"
 #include "Application.h"
+#include "memory/MemoryTracker.h"
+#include "log/Log.h"
+#include "graphics/GLTrace.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
-#include <iostream>
+#include <algorithm>
+#include <sstream>
 
 namespace eng {
 
-	void keyCallback(GLFWwindow* window, int key, int, int action, int) {
-
-		auto& inputManager = eng::Engine::GetInstance().GetInputManager();
-		if (action == GLFW_PRESS) {
-
-			inputManager.SetKeyPressed(key, true);
-
-		}
-		else if (action == GLFW_RELEASE) {
+	//callbacks only queue events, the input manager applies them all at once after polling
+	//any input is also a reason to draw again when rendering on demand
+	void pushEvent(const InputEvent& event) {
+		Engine& engine = Engine::GetInstance();
+		engine.GetInputManager().PushEvent(event);
+		engine.RequestRedraw();
+	}
+	void keyCallback(GLFWwindow* window, int key, int, int action, int mods) {
 
-			inputManager.SetKeyPressed(key, false);
-		}
+		InputEvent event;
+		event.type = InputEventType::Key;
+		event.code = key;
+		event.action = action;
+		event.mods = mods;
+		pushEvent(event);
+	}
+	void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+		InputEvent event;
+		event.type = InputEventType::MouseButton;
+		event.code = button;
+		event.action = action;
+		event.mods = mods;
+		pushEvent(event);
+	}
+	void cursorPositionCallback(GLFWwindow* window, double x, double y) {
+		InputEvent event;
+		event.type = InputEventType::MouseMove;
+		event.x = x;
+		event.y = y;
+		pushEvent(event);
+	}
+	void scrollCallback(GLFWwindow* window, double x, double y) {
+		InputEvent event;
+		event.type = InputEventType::Scroll;
+		event.x = x;
+		event.y = y;
+		pushEvent(event);
+	}
+	void charCallback(GLFWwindow* window, unsigned int codepoint) {
+		InputEvent event;
+		event.type = InputEventType::Char;
+		event.code = static_cast<int>(codepoint);
+		pushEvent(event);
+	}
+	//resizes, exposes and focus changes need a fresh frame too, and wake a throttled loop right away
+	void windowRefreshCallback(GLFWwindow* window) {
+		Engine::GetInstance().RequestRedraw();
+	}
+	void framebufferSizeCallback(GLFWwindow* window, int, int) {
+		Engine::GetInstance().RequestRedraw();
+	}
+	void windowFocusCallback(GLFWwindow* window, int) {
+		Engine::GetInstance().RequestRedraw();
+	}
+	void windowIconifyCallback(GLFWwindow* window, int) {
+		Engine::GetInstance().RequestRedraw();
 	}
 	Engine& Engine::GetInstance() {
 		static Engine instance;
 		return instance;
 	}
 
-	bool Engine::Init(int width, int height) {
+	bool Engine::Init(int width, int height, bool headless) {
 		
 		//check for valid application instance
 		if (!m_application) {
 			return false;
 		}
+		//console only unless the application started the log with a file already
+		Log::Start();
 		//if application instance is valid, create a window
 		//initialize library
 
-		//if we failed to initialize the glfw library stop the program
-		if (!glfwInit())
-		{
-			std::cout << "Error initializing GLFW" << std::endl;
-			return false;
+		//the driver keeps what it allocates while the context comes up until the process exits, untagged so it does not read as a leak
+		MemoryTagScope contextScope(MemoryTag::Untagged);
+		m_headless = headless;
+		if (headless) {
+			//no window, an egl context that draws into an off-screen framebuffer instead
+			if (!m_headlessContext.Create()) {
+				LOG_ERROR(Core, "ENGINE_INIT: cannot create the headless context");
+				return false;
+			}
 		}
+		else {
+			//if we failed to initialize the glfw library stop the program
+			if (!glfwInit())
+			{
+				LOG_ERROR(Core, "ENGINE_INIT: cannot initialize glfw");
+				return false;
+			}
 
-		//let glfw know which open gl context is intended to use
-		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+			//let glfw know which open gl context is intended to use
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+			glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-		//attempt to create a window
-		//check whether the window was successfully created
-		// if failed notify the user, terminate the glfw library and exit the program
-		m_window = glfwCreateWindow(width, height, "Egypt's Game Engine <3", nullptr, nullptr);
-		if (m_window == nullptr)
-		{
-			std::cout << "Error creating window" << std::endl;
-			glfwTerminate();
-			return false;
-		}
+			//attempt to create a window
+			//check whether the window was successfully created
+			// if failed notify the user, terminate the glfw library and exit the program
+			m_window = glfwCreateWindow(width, height, "Egypt's Game Engine <3", nullptr, nullptr);
+			if (m_window == nullptr)
+			{
+				LOG_ERROR(Core, "ENGINE_INIT: cannot create the window");
+				glfwTerminate();
+				return false;
+			}
 
-		glfwSetKeyCallback(m_window, keyCallback);
+			glfwSetKeyCallback(m_window, keyCallback);
+			glfwSetMouseButtonCallback(m_window, mouseButtonCallback);
+			glfwSetCursorPosCallback(m_window, cursorPositionCallback);
+			glfwSetScrollCallback(m_window, scrollCallback);
+			glfwSetCharCallback(m_window, charCallback);
+			glfwSetWindowRefreshCallback(m_window, windowRefreshCallback);
+			glfwSetFramebufferSizeCallback(m_window, framebufferSizeCallback);
+			glfwSetWindowFocusCallback(m_window, windowFocusCallback);
+			glfwSetWindowIconifyCallback(m_window, windowIconifyCallback);
+			m_inputManager.SetWindow(m_window);
 
-		glfwMakeContextCurrent(m_window);
+			glfwMakeContextCurrent(m_window);
+		}
 
 		//if we fail to initialize glew library terminate the program
-		if (glewInit() != GLEW_OK)
+		//glew also loads the glx extensions, an egl context has no glx display for them but the gl entry points are in place by then
+		GLenum glewResult = glewInit();
+		if (glewResult != GLEW_OK && !(headless && glewResult == GLEW_ERROR_NO_GLX_DISPLAY))
 		{
-			std::cout << "Error initializing GLEW" << std::endl;
-			glfwTerminate();
+			LOG_ERROR(Core, "ENGINE_INIT: cannot initialize glew");
+			DestroyContext();
+			return false;
+		}
+		if (headless && !m_framebuffer.Create(width, height)) {
+			DestroyContext();
 			return false;
 		}
 
+		//windows hold the monitor's refresh rate by scaling the scene resolution, the application can change or disable it in Init
+		m_dynamicResolution.SetEnabled(!headless);
+		if (!headless) {
+			const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+			if (mode && mode->refreshRate > 0) {
+				DynamicResolutionSettings settings = m_dynamicResolution.GetSettings();
+				settings.targetMilliseconds = 1000.0f / static_cast<float>(mode->refreshRate);
+				m_dynamicResolution.SetSettings(settings);
+			}
+		}
+
+		//worker threads have to be up before the application starts requesting assets
+		m_jobSystem.Init();
+		MemoryTracker::SetTag(MemoryTag::Assets);
+		m_assetManager.Init(&m_jobSystem);
+		StartUploadThread();
+		MemoryTracker::SetTag(MemoryTag::Graphics);
+		m_shaderLibrary.Init(&m_assetManager);
+		m_textureManager.Init(&m_assetManager);
+
+		MemoryTracker::SetTag(MemoryTag::Game);
 		return m_application->Init();
 	}
 
 	
-	void Engine::Run() {
+	void Engine::Run(uint64_t frameCount) {
 		//check for valid application
 		if (!m_application) {
 			return;
 		}
 
-		m_lastTimePoint = std::chrono::high_resolution_clock::now();
+		m_lastTimePoint = std::chrono::steady_clock::now();
+		m_frameIndex = 0;
+		m_redrawRequested = true;
 		//main game loop lives here
 		//until the window or application needs to close run the main loop
-		while (!glfwWindowShouldClose(m_window) && !m_application->NeedsToBeClosed()) {
+		while ((m_headless || !glfwWindowShouldClose(m_window)) && !m_application->NeedsToBeClosed()) {
 			//process input
-			glfwPollEvents();
+			MemoryTracker::SetTag(MemoryTag::Input);
+			if (!m_headless) {
+				//minimised, unfocused or idle windows sleep in the event wait instead of spinning
+				if (!WaitForFrame()) {
+					continue;
+				}
+				glfwPollEvents();
+				//actions are evaluated once here, after every event of the frame arrived
+				m_inputManager.Update();
+			}
 			
 			//each frame compute delta time from the current time
-			auto now = std::chrono::high_resolution_clock::now();
+			auto now = std::chrono::steady_clock::now();
 			float deltaTime = std::chrono::duration<float>(now - m_lastTimePoint).count();
 			m_lastTimePoint = now;
 
+			//queue rebuilds for edited shader files, then hand finished loads over to the gpu before the application looks at them
+			MemoryTracker::SetTag(MemoryTag::Graphics);
+			m_shaderLibrary.Update();
+			MemoryTracker::SetTag(MemoryTag::Assets);
+			m_assetManager.Update();
+
+			//the scene pass draws whatever the application submits this frame into the window or the off-screen framebuffer
+			//with dynamic resolution it renders into the corner of a window sized target that the composite pass stretches over the frame
+			//the target only changes size with the window, a new scale is just a different viewport and does not recompile the graph
+			MemoryTracker::SetTag(MemoryTag::Graphics);
+			m_renderGraph.Reset();
+			int targetWidth = m_framebuffer.GetWidth();
+			int targetHeight = m_framebuffer.GetHeight();
+			if (!m_headless) {
+				glfwGetFramebufferSize(m_window, &targetWidth, &targetHeight);
+			}
+			RenderResource target = m_renderGraph.ImportFramebuffer("frame", m_headless ? m_framebuffer.GetID() : 0, targetWidth, targetHeight);
+			bool scaled = m_dynamicResolution.IsEnabled() && targetWidth > 0 && targetHeight > 0;
+			m_dynamicResolution.GetRenderSize(targetWidth, targetHeight, m_frameStats.renderWidth, m_frameStats.renderHeight);
+			m_frameStats.resolutionScale = m_dynamicResolution.GetScale();
+			m_renderGraph.AddPass("scene",
+				[&](RenderPassBuilder& builder) {
+					if (scaled) {
+						m_sceneTarget = builder.Create("scene color", { targetWidth, targetHeight, GL_RGBA8 });
+						builder.Create("scene depth", { targetWidth, targetHeight, GL_DEPTH24_STENCIL8 });
+					}
+					else {
+						m_sceneTarget = builder.Write(target);
+					}
+				},
+				[this, scaled](RenderPassContext&) {
+					glViewport(0, 0, m_frameStats.renderWidth, m_frameStats.renderHeight);
+					//the shaders find their tile from gl_FragCoord, which now runs over the render size only
+					m_clusteredLighting.SetViewport(scaled ? m_frameStats.renderWidth : 0, scaled ? m_frameStats.renderHeight : 0);
+					m_clusteredLighting.Upload();
+					m_clusteredLighting.Bind();
+					m_renderQueue.Flush(m_graphicsAPI);
+					m_commandLists.Execute(m_graphicsAPI);
+				});
+
+			MemoryTracker::SetTag(MemoryTag::Game);
 			m_application->Update(deltaTime);
 
-			//swap buffers so you can see whats been drawn
-			glfwSwapBuffers(m_window);
+			MemoryTracker::SetTag(MemoryTag::Graphics);
+			if (scaled) {
+				m_dynamicResolution.AddCompositePass(m_renderGraph, m_renderGraph.GetLatestVersion(m_sceneTarget), m_renderGraph.GetLatestVersion(target),
+					m_frameStats.renderWidth, m_frameStats.renderHeight);
+			}
+			std::unique_ptr<GLTrace> trace;
+			if (!m_tracePath.empty() && (m_traceFrame == UINT64_MAX || m_traceFrame == m_frameIndex)) {
+				trace = std::make_unique<GLTrace>();
+				trace->BeginCapture(m_frameStats.renderWidth, m_frameStats.renderHeight);
+			}
+			m_gpuTimer.Begin();
+			m_renderGraph.Execute();
+			m_gpuTimer.End();
+			if (trace) {
+				trace->EndCapture();
+				if (trace->Save(m_tracePath)) {
+					LOG_INFO(Graphics, "traced frame {} to {} ({} calls, {} draws)", m_frameIndex, m_tracePath, trace->GetStats().calls, trace->GetStats().draws);
+				}
+				m_tracePath.clear();
+			}
+
+			//stream texture mips in or out based on what the frame just used
+			m_textureManager.Update();
+
+			//read the frame back before the swap leaves the back buffer undefined
+			if (!m_capturePath.empty() && (m_captureFrame == UINT64_MAX || m_captureFrame == m_frameIndex)) {
+				Image image;
+				if (ReadFrame(image) && SaveImage(m_capturePath, image)) {
+					LOG_INFO(Graphics, "captured frame {} to {}", m_frameIndex, m_capturePath);
+				}
+				m_capturePath.clear();
+			}
+
+			//the next frame's resolution follows from this frame's timings
+			m_frameStats.frameMilliseconds = deltaTime * 1000.0f;
+			m_frameStats.cpuMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - now).count();
+			m_frameStats.gpuMilliseconds = m_gpuTimer.GetMilliseconds();
+			m_dynamicResolution.Update(m_frameStats.frameMilliseconds, m_frameStats.gpuMilliseconds, deltaTime);
+
+			//swap buffers so you can see whats been drawn, off-screen the frame just stays in the framebuffer
+			if (!m_headless) {
+				glfwSwapBuffers(m_window);
+			}
+			else {
+				glFlush();
+			}
+			MemoryTracker::SetTag(MemoryTag::Untagged);
+
+			//fold the per thread allocation counters into this frame's stats
+			MemoryTracker::Update();
+
+			if (++m_frameIndex == frameCount) {
+				break;
+			}
 
 		}
 	}
@@ -103,10 +305,167 @@ namespace eng {
 		if (m_application) {
 			m_application->Destroy();
 			m_application.reset();
+			//stop streaming before the context goes away, pending loads are reported as failed
+			m_shaderLibrary.Shutdown();
+			m_textureManager.Shutdown();
+			m_assetManager.Shutdown();
+			m_jobSystem.Shutdown();
+			m_renderGraph.Shutdown();
+			m_dynamicResolution.Destroy();
+			m_gpuTimer.Destroy();
+			m_clusteredLighting.Destroy();
+			DestroyContext();
+
+			//engine owned containers live as long as the singleton, release them so they do not show up as leaks
+			m_renderQueue = RenderQueue();
+			m_commandLists.Release();
+			m_renderGraph = RenderGraph();
+			m_frustumCuller = FrustumCuller();
+			m_occlusionCuller = OcclusionCuller();
+			m_spatialIndex = DynamicBVH();
+			m_inputManager.Release();
+			MemoryTracker::Update();
+
+			//through the log so the report lands in the log file too, one record per line keeps it under the string limit
+			std::ostringstream report;
+			MemoryTracker::ReportLeaks(report);
+			std::istringstream lines(report.str());
+			std::string line;
+			while (std::getline(lines, line)) {
+				if (line.compare(0, 5, "LEAK:") == 0) {
+					LOG_WARNING(Memory, "{}", line);
+				}
+				else {
+					LOG_INFO(Memory, "{}", line);
+				}
+			}
+		}
+		//last, so everything the shutdown reported still makes it out
+		Log::Shutdown();
+	}
+	bool Engine::ReadFrame(Image& image) {
+		if (m_headless) {
+			image.width = m_framebuffer.GetWidth();
+			image.height = m_framebuffer.GetHeight();
+			return m_framebuffer.ReadPixels(image.rgba);
+		}
+		if (!m_window) {
+			return false;
+		}
+		glfwGetFramebufferSize(m_window, &image.width, &image.height);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glReadBuffer(GL_BACK);
+		ReadPixels(image.width, image.height, image.rgba);
+		return true;
+	}
+
+	void Engine::RequestCapture(const std::string& path, uint64_t frameIndex) {
+		m_capturePath = path;
+		m_captureFrame = frameIndex;
+	}
+
+	void Engine::RequestTraceCapture(const std::string& path, uint64_t frameIndex) {
+		m_tracePath = path;
+		m_traceFrame = frameIndex;
+	}
+
+	uint64_t Engine::GetFrameIndex() const {
+		return m_frameIndex;
+	}
+
+	bool Engine::IsHeadless() const {
+		return m_headless;
+	}
+
+	void Engine::SetThrottleSettings(const FrameThrottleSettings& settings) {
+		m_throttleSettings = settings;
+		RequestRedraw();
+	}
+
+	const FrameThrottleSettings& Engine::GetThrottleSettings() const {
+		return m_throttleSettings;
+	}
+
+	void Engine::RequestRedraw() {
+		//skip the wakeup when the flag was set already, posting is a syscall
+		if (!m_redrawRequested.exchange(true) && m_window) {
+			glfwPostEmptyEvent();
+		}
+	}
+
+	bool Engine::WaitForFrame() {
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_lastTimePoint).count();
+
+		if (glfwGetWindowAttrib(m_window, GLFW_ICONIFIED)) {
+			glfwWaitEventsTimeout(std::max(m_throttleSettings.iconifiedWaitSeconds, 0.001));
+			//the time spent minimised is not handed to the application as one huge delta
+			m_lastTimePoint = std::chrono::steady_clock::now();
+			return false;
+		}
+
+		//early wakeups come back here and wait out the rest of the interval
+		if (m_throttleSettings.unfocusedFramesPerSecond > 0.0f && !glfwGetWindowAttrib(m_window, GLFW_FOCUSED)) {
+			double interval = 1.0 / m_throttleSettings.unfocusedFramesPerSecond;
+			if (elapsed < interval) {
+				glfwWaitEventsTimeout(interval - elapsed);
+				return false;
+			}
+		}
+
+		//delta time keeps counting while idle, an application animating on demand sees the real gap
+		if (m_throttleSettings.renderOnDemand && !m_redrawRequested.exchange(false)) {
+			if (m_throttleSettings.maxIdleSeconds <= 0.0) {
+				glfwWaitEvents();
+				return false;
+			}
+			if (elapsed < m_throttleSettings.maxIdleSeconds) {
+				glfwWaitEventsTimeout(m_throttleSettings.maxIdleSeconds - elapsed);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void Engine::StartUploadThread() {
+		bool started = false;
+		if (m_headless) {
+			if (m_uploadContext.CreateShared(m_headlessContext)) {
+				started = m_assetManager.StartUploadThread([this]() { return m_uploadContext.MakeCurrent(); }, [this]() { m_uploadContext.ReleaseCurrent(); });
+			}
+		}
+		else {
+			//glfw only hands out contexts with a window, an invisible one will do
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+			m_uploadWindow = glfwCreateWindow(1, 1, "upload", nullptr, m_window);
+			glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+			if (m_uploadWindow) {
+				GLFWwindow* window = m_uploadWindow;
+				started = m_assetManager.StartUploadThread([window]() { glfwMakeContextCurrent(window); return glfwGetCurrentContext() == window; }, []() { glfwMakeContextCurrent(nullptr); });
+			}
+		}
+		if (!started) {
+			LOG_WARNING(Graphics, "UPLOAD_CONTEXT: no shared context, streamed assets are staged on the main thread");
+		}
+	}
+
+	void Engine::DestroyContext() {
+		//the upload thread has released its context by now, the asset manager shut down first
+		m_uploadContext.Destroy();
+		if (m_uploadWindow) {
+			glfwDestroyWindow(m_uploadWindow);
+			m_uploadWindow = nullptr;
+		}
+		if (m_headless) {
+			m_framebuffer.Destroy();
+			m_headlessContext.Destroy();
+		}
+		else {
 			glfwTerminate();
 			m_window = nullptr;
+			m_inputManager.SetWindow(nullptr);
 		}
 	}
+
 	void Engine::SetApplication(Application * app) {
 
 		m_application.reset(app);
@@ -123,4 +482,60 @@ namespace eng {
 
 		return m_graphicsAPI;
 	}
+	JobSystem& Engine::GetJobSystem() {
+
+		return m_jobSystem;
+	}
+	AssetManager& Engine::GetAssetManager() {
+
+		return m_assetManager;
+	}
+	ShaderLibrary& Engine::GetShaderLibrary() {
+
+		return m_shaderLibrary;
+	}
+	TextureManager& Engine::GetTextureManager() {
+
+		return m_textureManager;
+	}
+	RenderQueue& Engine::GetRenderQueue() {
+
+		return m_renderQueue;
+	}
+	CommandListPool& Engine::GetCommandLists() {
+
+		return m_commandLists;
+	}
+	RenderGraph& Engine::GetRenderGraph() {
+
+		return m_renderGraph;
+	}
+	RenderResource Engine::GetSceneTarget() const {
+
+		return m_sceneTarget;
+	}
+	DynamicResolution& Engine::GetDynamicResolution() {
+
+		return m_dynamicResolution;
+	}
+	const FrameStats& Engine::GetFrameStats() const {
+
+		return m_frameStats;
+	}
+	ClusteredLighting& Engine::GetClusteredLighting() {
+
+		return m_clusteredLighting;
+	}
+	FrustumCuller& Engine::GetFrustumCuller() {
+
+		return m_frustumCuller;
+	}
+	OcclusionCuller& Engine::GetOcclusionCuller() {
+
+		return m_occlusionCuller;
+	}
+	DynamicBVH& Engine::GetSpatialIndex() {
+
+		return m_spatialIndex;
+	}
 }
\ No newline at end of file
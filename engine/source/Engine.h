@@ -1,12 +1,54 @@
 #pragma once
 #include <memory>
 #include <chrono>
+#include <atomic>
 #include "input/InputManager.h"
 #include "graphics/GraphicsAPI.h"
+#include "jobs/JobSystem.h"
+#include "assets/AssetManager.h"
+#include "graphics/ShaderLibrary.h"
+#include "graphics/TextureManager.h"
+#include "graphics/HeadlessContext.h"
+#include "graphics/Framebuffer.h"
+#include "graphics/Image.h"
+#include "render/RenderQueue.h"
+#include "render/CommandList.h"
+#include "render/RenderGraph.h"
+#include "render/ClusteredLighting.h"
+#include "render/DynamicResolution.h"
+#include "graphics/GpuTimer.h"
+#include "render/FrustumCuller.h"
+#include "render/OcclusionCuller.h"
+#include "scene/DynamicBVH.h"
 
 struct GLFWwindow;
 namespace eng {
 
+	//timings of the last completed frame
+	struct FrameStats {
+		//between the starts of the last two frames, includes waiting for vsync
+		float frameMilliseconds = 0.0f;
+		//from the start of the frame up to the swap
+		float cpuMilliseconds = 0.0f;
+		//render graph execution on the gpu, a few frames old and 0 until the first timer result
+		float gpuMilliseconds = 0.0f;
+		float resolutionScale = 1.0f;
+		int renderWidth = 0;
+		int renderHeight = 0;
+	};
+
+	//how the main loop backs off when the window is not being looked at, headless runs are never throttled
+	struct FrameThrottleSettings {
+		//while minimised nothing is updated or drawn, the loop only waits this long for events before checking again
+		double iconifiedWaitSeconds = 0.25;
+		//frame rate while another window has the focus, 0 keeps running at full rate
+		float unfocusedFramesPerSecond = 15.0f;
+		//for tool windows, a frame only runs after input, a resize or RequestRedraw
+		bool renderOnDemand = false;
+		//on demand, the longest gap between frames so finished loads and shader reloads still show up, 0 waits for events only
+		double maxIdleSeconds = 0.25;
+	};
+
 	class Application;
 	class Engine {
 	public:
@@ -21,20 +63,92 @@ namespace eng {
 
 	public:
 
-		bool Init(int width, int height);
-		void Run();
+		//headless renders into an off-screen framebuffer of the given size through egl, no window and no input
+		bool Init(int width, int height, bool headless = false);
+		//frameCount 0 runs until the window closes or the application asks to
+		void Run(uint64_t frameCount = 0);
 		void Destroy();
 
+		//copies the last frame out as rgba8 with the top row first
+		//off-screen the frame stays readable until the next one draws, with a window only until the buffers are swapped
+		bool ReadFrame(Image& image);
+		//saves frame frameIndex to path (.png or .rgba) once it is drawn, the default captures the next frame
+		void RequestCapture(const std::string& path, uint64_t frameIndex = UINT64_MAX);
+		//records the gl calls the render graph makes in frame frameIndex into a trace at path, for tools/GLReplay
+		void RequestTraceCapture(const std::string& path, uint64_t frameIndex = UINT64_MAX);
+		//frames completed since Run started
+		uint64_t GetFrameIndex() const;
+		bool IsHeadless() const;
+		void SetThrottleSettings(const FrameThrottleSettings& settings);
+		const FrameThrottleSettings& GetThrottleSettings() const;
+		//runs another frame in on-demand mode, an application that animates calls it every Update, safe from any thread
+		void RequestRedraw();
+
 		void SetApplication(Application* app);
 		Application* GetApplication();
 		InputManager& GetInputManager();
 		GraphicsAPI& GetGraphicsAPI();
+		JobSystem& GetJobSystem();
+		AssetManager& GetAssetManager();
+		ShaderLibrary& GetShaderLibrary();
+		TextureManager& GetTextureManager();
+		RenderQueue& GetRenderQueue();
+		//lists acquired during Update are replayed by the scene pass right after the render queue, in acquisition order
+		//jobs recording into them have to be waited on before Update returns
+		CommandListPool& GetCommandLists();
+		//rebuilt every frame, the engine adds the scene pass before Application::Update and executes the graph after it
+		RenderGraph& GetRenderGraph();
+		//the frame's target once the scene pass drew into it, passes added during Update write on top of it or read it
+		RenderResource GetSceneTarget() const;
+		//the application builds it for its camera and lights during Update, the scene pass uploads and binds it
+		ClusteredLighting& GetClusteredLighting();
+		//on by default with a window, off headless so captures stay deterministic
+		DynamicResolution& GetDynamicResolution();
+		const FrameStats& GetFrameStats() const;
+		FrustumCuller& GetFrustumCuller();
+		OcclusionCuller& GetOcclusionCuller();
+		DynamicBVH& GetSpatialIndex();
 
 	private:
+		void DestroyContext();
+		//streamed assets are staged on a second context sharing objects with the main one, the main thread does it without
+		void StartUploadThread();
+		//waits as the throttle settings ask, false when this loop iteration should not run a frame
+		bool WaitForFrame();
+
 		std::unique_ptr<Application> m_application;
 		std::chrono::steady_clock::time_point m_lastTimePoint;
+		uint64_t m_frameIndex = 0;
+		std::string m_capturePath;
+		uint64_t m_captureFrame = 0;
+		std::string m_tracePath;
+		uint64_t m_traceFrame = 0;
 		GLFWwindow* m_window = nullptr;
+		bool m_headless = false;
+		FrameThrottleSettings m_throttleSettings;
+		std::atomic<bool> m_redrawRequested{ true };
+		HeadlessContext m_headlessContext;
+		//the asset manager's upload thread owns one of them
+		HeadlessContext m_uploadContext;
+		GLFWwindow* m_uploadWindow = nullptr;
+		Framebuffer m_framebuffer;
 		InputManager m_inputManager;
 		GraphicsAPI m_graphicsAPI;
+		JobSystem m_jobSystem;
+		AssetManager m_assetManager;
+		ShaderLibrary m_shaderLibrary;
+		TextureManager m_textureManager;
+		RenderQueue m_renderQueue;
+		CommandListPool m_commandLists;
+		RenderGraph m_renderGraph;
+		RenderResource m_sceneTarget = InvalidRenderResource;
+		ClusteredLighting m_clusteredLighting;
+		DynamicResolution m_dynamicResolution;
+		GpuTimer m_gpuTimer;
+		FrameStats m_frameStats;
+		FrustumCuller m_frustumCuller;
+		OcclusionCuller m_occlusionCuller;
+		//shared by culling, picking and gameplay queries
+		DynamicBVH m_spatialIndex;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,410 @@
+#include "assets/AssetManager.h"
+#include "log/Log.h"
+#include "jobs/JobSystem.h"
+#include "memory/MemoryTracker.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace eng {
+
+	AssetManager::~AssetManager() {
+		Shutdown();
+	}
+
+	void AssetManager::Init(JobSystem* jobSystem, unsigned int ioThreadCount) {
+		if (m_running) {
+			return;
+		}
+		m_jobSystem = jobSystem;
+		m_running = true;
+		{
+			std::lock_guard<std::mutex> lock(m_uploadMutex);
+			m_uploadQueueClosed = false;
+		}
+		ioThreadCount = std::max(ioThreadCount, 1u);
+		for (unsigned int i = 0; i < ioThreadCount; ++i) {
+			m_ioThreads.emplace_back(&AssetManager::IOThreadLoop, this);
+		}
+	}
+
+	bool AssetManager::StartUploadThread(ContextFunction makeCurrent, std::function<void()> releaseCurrent) {
+		if (!m_running || m_uploadThread.joinable()) {
+			return HasUploadThread();
+		}
+		std::promise<bool> started;
+		std::future<bool> result = started.get_future();
+		m_stopUploadThread = false;
+		m_uploadThread = std::thread(&AssetManager::UploadThreadLoop, this, std::move(makeCurrent), std::move(releaseCurrent), &started);
+		if (!result.get()) {
+			m_uploadThread.join();
+			LOG_WARNING(Assets, "UPLOAD_THREAD: the shared context cannot be made current, staging stays on the main thread");
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(m_stageMutex);
+		m_uploadThreadRunning = true;
+		return true;
+	}
+
+	bool AssetManager::HasUploadThread() const {
+		return m_uploadThreadRunning.load(std::memory_order_relaxed);
+	}
+
+	void AssetManager::Shutdown() {
+		{
+			std::lock_guard<std::mutex> lock(m_readMutex);
+			if (!m_running) {
+				return;
+			}
+			m_running = false;
+		}
+		m_readCondition.notify_all();
+		for (auto& thread : m_ioThreads) {
+			thread.join();
+		}
+		m_ioThreads = decltype(m_ioThreads)();
+		StopUploadThread();
+		m_mainStaging.Destroy();
+
+		//decode jobs still in flight finish on the job system, which the engine shuts down after us
+		//everything that never made it to the gpu is reported as failed, late decodes fail themselves once the queue is closed
+		for (auto& request : m_readQueue) {
+			Fail(*request);
+		}
+		m_readQueue = decltype(m_readQueue)();
+
+		std::lock_guard<std::mutex> lock(m_uploadMutex);
+		m_uploadQueueClosed = true;
+		for (auto& request : m_uploadQueue) {
+			Fail(*request);
+		}
+		m_uploadQueue = decltype(m_uploadQueue)();
+		//swapped out, assigning an empty string would keep the buffer
+		std::string().swap(m_rootPath);
+	}
+
+	void AssetManager::Update() {
+		auto start = std::chrono::steady_clock::now();
+		bool first = true;
+		CollectStaged();
+
+		while (true) {
+			RequestPtr request;
+			{
+				std::lock_guard<std::mutex> lock(m_uploadMutex);
+				if (m_uploadQueue.empty()) {
+					return;
+				}
+				//always make progress with at least one upload, then stop once the budget is spent
+				if (!first) {
+					float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+					if (elapsed >= m_uploadBudget) {
+						return;
+					}
+				}
+				std::pop_heap(m_uploadQueue.begin(), m_uploadQueue.end(), CompareRequests);
+				request = std::move(m_uploadQueue.back());
+				m_uploadQueue.pop_back();
+			}
+			first = false;
+
+			//nobody took the staging off the main thread, it runs here with the main context
+			if (request->stage) {
+				bool staged = request->stage(request->files, m_mainStaging);
+				request->stage = StageFunction();
+				if (!staged) {
+					LOG_ERROR(Assets, "ASSET_STAGE_FAILED: {}", (request->paths.empty() ? std::string() : request->paths.front()));
+					Fail(*request);
+					continue;
+				}
+			}
+
+			if (request->upload(request->files)) {
+				request->record->m_state.store(AssetState::Ready, std::memory_order_release);
+				m_pendingCount.fetch_sub(1, std::memory_order_relaxed);
+			}
+			else {
+				LOG_ERROR(Assets, "ASSET_UPLOAD_FAILED: {}", (request->paths.empty() ? std::string() : request->paths.front()));
+				Fail(*request);
+			}
+		}
+	}
+
+	void AssetManager::SetRootPath(const std::string& rootPath) {
+		m_rootPath = rootPath;
+	}
+
+	const std::string& AssetManager::GetRootPath() const {
+		return m_rootPath;
+	}
+
+	void AssetManager::SetUploadBudget(float milliseconds) {
+		m_uploadBudget = milliseconds;
+	}
+
+	float AssetManager::PriorityFromDistance(float distance, float importance) {
+		return importance / (1.0f + std::max(distance, 0.0f));
+	}
+
+	void AssetManager::UpdatePriority(const std::shared_ptr<AssetRecord>& record, float priority) {
+		if (!record) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(m_readMutex);
+		record->m_priority.store(priority, std::memory_order_relaxed);
+		m_priorityDirty = true;
+	}
+
+	size_t AssetManager::GetPendingCount() const {
+		return m_pendingCount.load(std::memory_order_relaxed);
+	}
+
+	bool AssetManager::CompareRequests(const RequestPtr& a, const RequestPtr& b) {
+		if (a->priority != b->priority) {
+			return a->priority < b->priority;
+		}
+		return a->sequence > b->sequence;
+	}
+
+	void AssetManager::Enqueue(std::shared_ptr<AssetRecord> record, const std::vector<std::string>& paths, const std::vector<AssetFileRange>& ranges, float priority, DecodeFunction decode, StageFunction stage, std::function<bool(FileData& files)> upload) {
+		auto request = std::make_unique<Request>();
+		record->m_priority.store(priority, std::memory_order_relaxed);
+		request->record = std::move(record);
+		request->priority = priority;
+		request->paths = paths;
+		request->ranges = ranges;
+		request->decode = std::move(decode);
+		request->stage = std::move(stage);
+		request->upload = std::move(upload);
+		m_pendingCount.fetch_add(1, std::memory_order_relaxed);
+
+		{
+			std::lock_guard<std::mutex> lock(m_readMutex);
+			if (!m_running) {
+				Fail(*request);
+				return;
+			}
+			request->sequence = m_nextSequence++;
+			m_readQueue.push_back(std::move(request));
+			if (!m_priorityDirty) {
+				std::push_heap(m_readQueue.begin(), m_readQueue.end(), CompareRequests);
+			}
+		}
+		m_readCondition.notify_one();
+	}
+
+	void AssetManager::IOThreadLoop() {
+		MemoryTracker::SetTag(MemoryTag::Assets);
+		while (true) {
+			RequestPtr request;
+			{
+				std::unique_lock<std::mutex> lock(m_readMutex);
+				m_readCondition.wait(lock, [this]() { return !m_running || !m_readQueue.empty(); });
+				if (!m_running) {
+					return;
+				}
+				//priorities changed since the heap was built
+				if (m_priorityDirty) {
+					for (auto& pending : m_readQueue) {
+						pending->priority = pending->record->GetPriority();
+					}
+					std::make_heap(m_readQueue.begin(), m_readQueue.end(), CompareRequests);
+					m_priorityDirty = false;
+				}
+				std::pop_heap(m_readQueue.begin(), m_readQueue.end(), CompareRequests);
+				request = std::move(m_readQueue.back());
+				m_readQueue.pop_back();
+			}
+
+			//nobody holds a handle anymore, the load is not needed
+			if (request->record.use_count() == 1) {
+				Fail(*request);
+				continue;
+			}
+
+			if (!ReadFiles(*request)) {
+				Fail(*request);
+				continue;
+			}
+
+			if (m_jobSystem && request->decode) {
+				//std::function needs a copyable callable, so hand the request over through a shared pointer
+				auto shared = MakePooled<RequestPtr>(std::move(request));
+				m_jobSystem->Schedule([this, shared]() {
+					Decode(std::move(*shared));
+				});
+			}
+			else {
+				Decode(std::move(request));
+			}
+		}
+	}
+
+	bool AssetManager::ReadFiles(Request& request) const {
+		request.files.clear();
+		request.files.reserve(request.paths.size());
+		for (size_t i = 0; i < request.paths.size(); ++i) {
+			const auto& path = request.paths[i];
+			std::string fullPath = m_rootPath.empty() ? path : m_rootPath + "/" + path;
+			std::ifstream file(fullPath, std::ios::binary);
+			if (!file) {
+				LOG_ERROR(Assets, "ASSET_FILE_NOT_FOUND: {}", fullPath);
+				return false;
+			}
+
+			AssetFileRange range = i < request.ranges.size() ? request.ranges[i] : AssetFileRange();
+			if (range.offset > 0) {
+				file.seekg(std::streamoff(range.offset));
+			}
+			if (range.size > 0) {
+				std::string contents(size_t(range.size), '\0');
+				file.read(&contents[0], std::streamsize(range.size));
+				contents.resize(size_t(file.gcount()));
+				request.files.push_back(std::move(contents));
+			}
+			else {
+				std::ostringstream contents;
+				contents << file.rdbuf();
+				request.files.push_back(contents.str());
+			}
+		}
+		return true;
+	}
+
+	void AssetManager::Decode(RequestPtr request) {
+		if (IsUploadQueueClosed()) {
+			Fail(*request);
+			return;
+		}
+		if (request->decode && !request->decode(request->files)) {
+			LOG_ERROR(Assets, "ASSET_DECODE_FAILED: {}", (request->paths.empty() ? std::string() : request->paths.front()));
+			Fail(*request);
+			return;
+		}
+		request->priority = request->record->GetPriority();
+		if (request->stage) {
+			std::unique_lock<std::mutex> lock(m_stageMutex);
+			if (m_uploadThreadRunning) {
+				m_stageQueue.push_back(std::move(request));
+				std::push_heap(m_stageQueue.begin(), m_stageQueue.end(), CompareRequests);
+				lock.unlock();
+				m_stageCondition.notify_one();
+				return;
+			}
+		}
+		std::lock_guard<std::mutex> lock(m_uploadMutex);
+		if (m_uploadQueueClosed) {
+			Fail(*request);
+			return;
+		}
+		m_uploadQueue.push_back(std::move(request));
+		std::push_heap(m_uploadQueue.begin(), m_uploadQueue.end(), CompareRequests);
+	}
+
+	bool AssetManager::IsUploadQueueClosed() {
+		std::lock_guard<std::mutex> lock(m_uploadMutex);
+		return m_uploadQueueClosed;
+	}
+
+	void AssetManager::UploadThreadLoop(ContextFunction makeCurrent, std::function<void()> releaseCurrent, std::promise<bool>* started) {
+		MemoryTracker::SetTag(MemoryTag::Assets);
+		if (!makeCurrent()) {
+			started->set_value(false);
+			return;
+		}
+		started->set_value(true);
+
+		while (true) {
+			RequestPtr request;
+			{
+				std::unique_lock<std::mutex> lock(m_stageMutex);
+				m_stageCondition.wait(lock, [this]() { return m_stopUploadThread || !m_stageQueue.empty(); });
+				if (m_stopUploadThread) {
+					break;
+				}
+				std::pop_heap(m_stageQueue.begin(), m_stageQueue.end(), CompareRequests);
+				request = std::move(m_stageQueue.back());
+				m_stageQueue.pop_back();
+			}
+
+			if (request->record.use_count() == 1) {
+				Fail(*request);
+				continue;
+			}
+			bool staged = request->stage(request->files, m_uploadStaging);
+			request->stage = StageFunction();
+			if (!staged) {
+				LOG_ERROR(Assets, "ASSET_STAGE_FAILED: {}", (request->paths.empty() ? std::string() : request->paths.front()));
+				Fail(*request);
+				continue;
+			}
+
+			//without the flush the fence might sit in this context's queue and never pass
+			request->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+			std::lock_guard<std::mutex> lock(m_stageMutex);
+			m_fencedQueue.push_back(std::move(request));
+		}
+
+		m_uploadStaging.Destroy();
+		releaseCurrent();
+	}
+
+	void AssetManager::CollectStaged() {
+		std::vector<RequestPtr> passed;
+		{
+			std::lock_guard<std::mutex> lock(m_stageMutex);
+			//one context runs its commands in order, the first fence that has not passed ends the scan
+			size_t count = 0;
+			while (count < m_fencedQueue.size() && glClientWaitSync(m_fencedQueue[count]->fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+				++count;
+			}
+			if (count == 0) {
+				return;
+			}
+			passed.insert(passed.end(), std::make_move_iterator(m_fencedQueue.begin()), std::make_move_iterator(m_fencedQueue.begin() + count));
+			m_fencedQueue.erase(m_fencedQueue.begin(), m_fencedQueue.begin() + count);
+		}
+
+		std::lock_guard<std::mutex> lock(m_uploadMutex);
+		for (auto& request : passed) {
+			glDeleteSync(request->fence);
+			request->fence = 0;
+			request->priority = request->record->GetPriority();
+			m_uploadQueue.push_back(std::move(request));
+			std::push_heap(m_uploadQueue.begin(), m_uploadQueue.end(), CompareRequests);
+		}
+	}
+
+	void AssetManager::StopUploadThread() {
+		{
+			std::lock_guard<std::mutex> lock(m_stageMutex);
+			if (!m_uploadThread.joinable()) {
+				return;
+			}
+			m_stopUploadThread = true;
+			m_uploadThreadRunning = false;
+		}
+		m_stageCondition.notify_all();
+		m_uploadThread.join();
+
+		//whatever still waits for staging or its fence is reported as failed like the other queues
+		std::lock_guard<std::mutex> lock(m_stageMutex);
+		for (auto& request : m_stageQueue) {
+			Fail(*request);
+		}
+		m_stageQueue = decltype(m_stageQueue)();
+		for (auto& request : m_fencedQueue) {
+			glDeleteSync(request->fence);
+			Fail(*request);
+		}
+		m_fencedQueue = decltype(m_fencedQueue)();
+	}
+
+	void AssetManager::Fail(Request& request) {
+		request.record->m_state.store(AssetState::Failed, std::memory_order_release);
+		m_pendingCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
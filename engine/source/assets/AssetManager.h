@@ -0,0 +1,210 @@
+#pragma once
+
+#include "memory/MemoryPool.h"
+#include "graphics/StagingBuffer.h"
+#include <GL/glew.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace eng {
+
+	class JobSystem;
+
+	enum class AssetState {
+		Loading,
+		Ready,
+		Failed
+	};
+
+	//part of a file to read, a size of 0 reads everything from the offset on
+	//reads that hit the end of the file come back shorter instead of failing
+	struct AssetFileRange {
+		uint64_t offset = 0;
+		uint64_t size = 0;
+	};
+
+	//state shared between the handle held by the game and the loading threads
+	class AssetRecord {
+	public:
+		AssetState GetState() const { return m_state.load(std::memory_order_acquire); }
+		float GetPriority() const { return m_priority.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<AssetState> m_state{ AssetState::Loading };
+		std::atomic<float> m_priority{ 0.0f };
+
+		friend class AssetManager;
+	};
+
+	template<typename T>
+	class Asset : public AssetRecord {
+	public:
+		//only written once on the main thread before the state flips to ready
+		std::shared_ptr<T> resource;
+	};
+
+	template<typename T>
+	class AssetHandle {
+	public:
+		AssetHandle() = default;
+		explicit AssetHandle(std::shared_ptr<Asset<T>> asset) : m_asset(std::move(asset)) {}
+
+		AssetState GetState() const { return m_asset ? m_asset->GetState() : AssetState::Failed; }
+		bool IsValid() const { return m_asset != nullptr; }
+		bool IsReady() const { return GetState() == AssetState::Ready; }
+		//null until the asset is ready
+		std::shared_ptr<T> Get() const { return IsReady() ? m_asset->resource : nullptr; }
+		const std::shared_ptr<Asset<T>>& GetRecord() const { return m_asset; }
+
+	private:
+		std::shared_ptr<Asset<T>> m_asset;
+	};
+
+	//streams assets in the background
+	//file reads run on a dedicated io thread pool, decoding on the job system and gpu uploads on the main thread
+	//under a per frame time budget so big loads never show up as frame spikes
+	//loads with a stage function copy their data to the gpu on the upload thread first, which owns a context sharing
+	//objects with the main one, and only reach the main thread once the fence behind the copy has passed
+	class AssetManager {
+	private:
+		//only the engine creates and owns the asset manager
+		AssetManager() = default;
+		AssetManager(const AssetManager&) = delete;
+		AssetManager(AssetManager&&) = delete;
+		AssetManager& operator=(const AssetManager&) = delete;
+		AssetManager& operator=(AssetManager&&) = delete;
+
+	public:
+		//raw file contents, decode may rewrite them in place into whatever upload expects
+		using FileData = std::vector<std::string>;
+		using DecodeFunction = std::function<bool(FileData& files)>;
+		template<typename T>
+		using UploadFunction = std::function<std::shared_ptr<T>(FileData& files)>;
+		//fills gl objects created on the main thread, through the staging buffer, without touching anything the main thread uses
+		//runs on the upload thread, or on the main thread right before upload when there is none
+		using StageFunction = std::function<bool(FileData& files, StagingBuffer& staging)>;
+		using ContextFunction = std::function<bool()>;
+
+		~AssetManager();
+
+		void Init(JobSystem* jobSystem, unsigned int ioThreadCount = 2);
+		//makeCurrent runs first on the new thread and has to make a context current there that shares objects with the main one,
+		//releaseCurrent runs last, false when the context could not be made current and staging stays on the main thread
+		bool StartUploadThread(ContextFunction makeCurrent, std::function<void()> releaseCurrent);
+		bool HasUploadThread() const;
+		//needs the main context, deletes the fences still waited on
+		void Shutdown();
+		//runs queued gpu uploads once their staging finished, must be called on the thread that owns the gl context
+		void Update();
+
+		void SetRootPath(const std::string& rootPath);
+		const std::string& GetRootPath() const;
+		//time in milliseconds the main thread may spend on uploads each frame, at least one upload always runs
+		void SetUploadBudget(float milliseconds);
+
+		//higher priority loads first, handy to turn a distance into a priority
+		static float PriorityFromDistance(float distance, float importance = 1.0f);
+
+		//queue a generic load, decode may be empty
+		template<typename T>
+		AssetHandle<T> Load(const std::vector<std::string>& paths, float priority, DecodeFunction decode, UploadFunction<T> upload) {
+			return Load<T>(paths, {}, priority, std::move(decode), std::move(upload));
+		}
+		//same as above but only reads part of each file, ranges line up with paths
+		template<typename T>
+		AssetHandle<T> Load(const std::vector<std::string>& paths, const std::vector<AssetFileRange>& ranges, float priority, DecodeFunction decode, UploadFunction<T> upload) {
+			return Load<T>(paths, ranges, priority, std::move(decode), StageFunction(), std::move(upload));
+		}
+		//stage copies the data to the gpu off the main thread, upload then only has to finish up, e.g. bind the objects
+		//again (which makes the other context's writes visible here) and set the parameters that expose the new data
+		template<typename T>
+		AssetHandle<T> Load(const std::vector<std::string>& paths, const std::vector<AssetFileRange>& ranges, float priority, DecodeFunction decode, StageFunction stage, UploadFunction<T> upload) {
+			auto asset = std::make_shared<Asset<T>>();
+			Asset<T>* target = asset.get();
+			Enqueue(asset, paths, ranges, priority, std::move(decode), std::move(stage), [target, upload = std::move(upload)](FileData& files) {
+				target->resource = upload(files);
+				return target->resource != nullptr;
+			});
+			return AssetHandle<T>(asset);
+		}
+
+		//change the priority of a load that has not been picked up yet, e.g. when the camera moved
+		void UpdatePriority(const std::shared_ptr<AssetRecord>& record, float priority);
+
+		size_t GetPendingCount() const;
+
+	private:
+		struct Request : PoolObject {
+			std::shared_ptr<AssetRecord> record;
+			std::vector<std::string> paths;
+			std::vector<AssetFileRange> ranges;
+			FileData files;
+			DecodeFunction decode;
+			StageFunction stage;
+			std::function<bool(FileData& files)> upload;
+			//signalled once the gpu executed the staging, 0 while it has not run
+			GLsync fence = 0;
+			//snapshot of the record priority, only refreshed while the owning queue is locked
+			float priority = 0.0f;
+			uint64_t sequence = 0;
+		};
+		using RequestPtr = std::unique_ptr<Request>;
+
+		//orders the heaps so the highest priority, then the oldest request comes first
+		static bool CompareRequests(const RequestPtr& a, const RequestPtr& b);
+
+		void Enqueue(std::shared_ptr<AssetRecord> record, const std::vector<std::string>& paths, const std::vector<AssetFileRange>& ranges, float priority, DecodeFunction decode, StageFunction stage, std::function<bool(FileData& files)> upload);
+		void IOThreadLoop();
+		void UploadThreadLoop(ContextFunction makeCurrent, std::function<void()> releaseCurrent, std::promise<bool>* started);
+		//moves staged requests whose fence passed over to the upload queue
+		void CollectStaged();
+		void StopUploadThread();
+		bool ReadFiles(Request& request) const;
+		void Decode(RequestPtr request);
+		//true from Shutdown on, decodes finishing after that fail instead of queueing an upload nobody runs
+		bool IsUploadQueueClosed();
+		void Fail(Request& request);
+
+		JobSystem* m_jobSystem = nullptr;
+		std::string m_rootPath;
+		float m_uploadBudget = 2.0f;
+
+		std::vector<std::thread> m_ioThreads;
+		std::mutex m_readMutex;
+		std::condition_variable m_readCondition;
+		std::vector<RequestPtr> m_readQueue;
+		bool m_priorityDirty = false;
+		bool m_running = false;
+		uint64_t m_nextSequence = 0;
+
+		std::mutex m_uploadMutex;
+		std::vector<RequestPtr> m_uploadQueue;
+		bool m_uploadQueueClosed = false;
+
+		std::thread m_uploadThread;
+		//written with the stage mutex held, decode only routes to the upload thread while it is set
+		std::atomic<bool> m_uploadThreadRunning{ false };
+		bool m_stopUploadThread = false;
+		//guards the stage and the fenced queue
+		std::mutex m_stageMutex;
+		std::condition_variable m_stageCondition;
+		std::vector<RequestPtr> m_stageQueue;
+		//in the order the upload thread fenced them, which is the order the fences pass in
+		std::vector<RequestPtr> m_fencedQueue;
+		//one per thread that stages, the upload thread's lives in the shared context
+		StagingBuffer m_uploadStaging;
+		StagingBuffer m_mainStaging;
+
+		std::atomic<size_t> m_pendingCount{ 0 };
+
+		friend class Engine;
+	};
+}
@@ -0,0 +1,149 @@
+#include "assets/FileWatcher.h"
+#include "log/Log.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace eng {
+
+	FileWatcher::~FileWatcher() {
+		Shutdown();
+	}
+
+	bool FileWatcher::Init(const std::string& rootPath) {
+		Shutdown();
+
+		std::error_code error;
+		if (!std::filesystem::is_directory(rootPath, error)) {
+			LOG_ERROR(Assets, "FILE_WATCHER_INVALID_DIRECTORY: {}", rootPath);
+			return false;
+		}
+		m_rootPath = rootPath;
+
+#ifdef __linux__
+		m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_inotify < 0) {
+			LOG_ERROR(Assets, "FILE_WATCHER_INOTIFY_FAILED: {}", errno);
+			return false;
+		}
+		//inotify is not recursive, every directory gets its own watch
+		AddWatch("");
+		for (auto it = std::filesystem::recursive_directory_iterator(rootPath, error); it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+			if (it->is_directory(error)) {
+				AddWatch(std::filesystem::relative(it->path(), rootPath, error).generic_string());
+			}
+		}
+#else
+		ScanModificationTimes(nullptr);
+		m_lastScan = std::chrono::steady_clock::now();
+#endif
+		m_watching = true;
+		return true;
+	}
+
+	void FileWatcher::Shutdown() {
+#ifdef __linux__
+		if (m_inotify >= 0) {
+			close(m_inotify);
+			m_inotify = -1;
+		}
+		m_watchDirectories = decltype(m_watchDirectories)();
+#else
+		m_modificationTimes = decltype(m_modificationTimes)();
+#endif
+		std::string().swap(m_rootPath);
+		m_watching = false;
+	}
+
+	bool FileWatcher::IsWatching() const {
+		return m_watching;
+	}
+
+	const std::string& FileWatcher::GetRootPath() const {
+		return m_rootPath;
+	}
+
+	std::vector<std::string> FileWatcher::Poll() {
+		std::vector<std::string> changed;
+		if (!m_watching) {
+			return changed;
+		}
+
+#ifdef __linux__
+		alignas(inotify_event) char buffer[4096];
+		while (true) {
+			ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+			//EAGAIN, nothing left to read this frame
+			if (length <= 0) {
+				break;
+			}
+			for (char* cursor = buffer; cursor < buffer + length;) {
+				auto* event = reinterpret_cast<inotify_event*>(cursor);
+				cursor += sizeof(inotify_event) + event->len;
+
+				auto directory = m_watchDirectories.find(event->wd);
+				if (directory == m_watchDirectories.end() || event->len == 0) {
+					continue;
+				}
+				std::string path = directory->second.empty() ? std::string(event->name) : directory->second + "/" + event->name;
+
+				if (event->mask & IN_ISDIR) {
+					if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+						AddWatch(path);
+					}
+					continue;
+				}
+				//a freshly created file is still empty, wait until the writer closes it
+				if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+					changed.push_back(path);
+				}
+			}
+		}
+#else
+		//modification times are not free to query, a few scans per second are plenty for editing
+		auto now = std::chrono::steady_clock::now();
+		if (now - m_lastScan < std::chrono::milliseconds(250)) {
+			return changed;
+		}
+		m_lastScan = now;
+		ScanModificationTimes(&changed);
+#endif
+
+		//editors often write a file several times in a row, report it once
+		std::sort(changed.begin(), changed.end());
+		changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+		return changed;
+	}
+
+#ifdef __linux__
+	void FileWatcher::AddWatch(const std::string& relativeDirectory) {
+		std::string fullPath = relativeDirectory.empty() ? m_rootPath : m_rootPath + "/" + relativeDirectory;
+		int watch = inotify_add_watch(m_inotify, fullPath.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (watch >= 0) {
+			m_watchDirectories[watch] = relativeDirectory;
+		}
+	}
+#else
+	void FileWatcher::ScanModificationTimes(std::vector<std::string>* changed) {
+		std::error_code error;
+		for (auto it = std::filesystem::recursive_directory_iterator(m_rootPath, error); it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+			if (!it->is_regular_file(error)) {
+				continue;
+			}
+			auto time = it->last_write_time(error);
+			std::string path = std::filesystem::relative(it->path(), m_rootPath, error).generic_string();
+			auto& known = m_modificationTimes[path];
+			if (known != time) {
+				if (changed && known != std::filesystem::file_time_type()) {
+					changed->push_back(path);
+				}
+				known = time;
+			}
+		}
+	}
+#endif
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eng {
+
+	//reports files under a directory tree that were written, created or moved into place
+	//uses inotify on linux, elsewhere it falls back to comparing modification times a few times per second
+	class FileWatcher {
+	public:
+		FileWatcher() = default;
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+		~FileWatcher();
+
+		bool Init(const std::string& rootPath);
+		void Shutdown();
+		bool IsWatching() const;
+		const std::string& GetRootPath() const;
+
+		//never blocks, returns every changed path relative to the root once
+		std::vector<std::string> Poll();
+
+	private:
+#ifdef __linux__
+		void AddWatch(const std::string& relativeDirectory);
+
+		int m_inotify = -1;
+		std::unordered_map<int, std::string> m_watchDirectories;
+#else
+		void ScanModificationTimes(std::vector<std::string>* changed);
+
+		std::unordered_map<std::string, std::filesystem::file_time_type> m_modificationTimes;
+		std::chrono::steady_clock::time_point m_lastScan;
+#endif
+		std::string m_rootPath;
+		bool m_watching = false;
+	};
+}
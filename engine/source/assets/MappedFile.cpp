@@ -0,0 +1,103 @@
+#include "assets/MappedFile.h"
+#include "log/Log.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace eng {
+
+	MappedFile::~MappedFile() {
+		Close();
+	}
+
+	bool MappedFile::Open(const std::string& path) {
+		Close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			LOG_ERROR(Assets, "MAPPED_FILE_OPEN_FAILED: {}", path);
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			LOG_ERROR(Assets, "MAPPED_FILE_EMPTY: {}", path);
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (!data) {
+			LOG_ERROR(Assets, "MAPPED_FILE_MAP_FAILED: {}", path);
+			if (mapping) {
+				CloseHandle(mapping);
+			}
+			CloseHandle(file);
+			return false;
+		}
+		m_file = file;
+		m_mapping = mapping;
+		m_data = static_cast<const uint8_t*>(data);
+		m_size = size_t(size.QuadPart);
+#else
+		int file = open(path.c_str(), O_RDONLY);
+		if (file < 0) {
+			LOG_ERROR(Assets, "MAPPED_FILE_OPEN_FAILED: {}", path);
+			return false;
+		}
+		struct stat status;
+		if (fstat(file, &status) != 0 || status.st_size == 0) {
+			LOG_ERROR(Assets, "MAPPED_FILE_EMPTY: {}", path);
+			close(file);
+			return false;
+		}
+		void* data = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		//the mapping keeps its own reference to the file
+		close(file);
+		if (data == MAP_FAILED) {
+			LOG_ERROR(Assets, "MAPPED_FILE_MAP_FAILED: {}", path);
+			return false;
+		}
+		m_data = static_cast<const uint8_t*>(data);
+		m_size = size_t(status.st_size);
+#endif
+		return true;
+	}
+
+	void MappedFile::Close() {
+		if (!m_data) {
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		m_file = nullptr;
+		m_mapping = nullptr;
+#else
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	bool MappedFile::IsOpen() const {
+		return m_data != nullptr;
+	}
+
+	const uint8_t* MappedFile::GetData() const {
+		return m_data;
+	}
+
+	size_t MappedFile::GetSize() const {
+		return m_size;
+	}
+}
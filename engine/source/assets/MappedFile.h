@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace eng {
+
+	//read only view of a whole file through the virtual memory system, pages are only read when touched
+	//uses mmap on posix and a file mapping on windows
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile();
+
+		bool Open(const std::string& path);
+		void Close();
+		bool IsOpen() const;
+
+		const uint8_t* GetData() const;
+		size_t GetSize() const;
+
+	private:
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+#ifdef _WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#endif
+	};
+}
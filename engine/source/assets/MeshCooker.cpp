@@ -0,0 +1,174 @@
+#include "assets/MeshCooker.h"
+#include "log/Log.h"
+#include "assets/MeshSimplifier.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace eng {
+
+	namespace {
+
+		//obj indices are 1 based and negative ones count back from the end, returns -1 when missing or out of range
+		int ResolveObjIndex(const std::string& token, size_t count) {
+			if (token.empty()) {
+				return -1;
+			}
+			long index = std::strtol(token.c_str(), nullptr, 10);
+			if (index < 0) {
+				index += long(count);
+			}
+			else {
+				index -= 1;
+			}
+			return index >= 0 && index < long(count) ? int(index) : -1;
+		}
+	}
+
+	bool ImportObj(const std::string& path, MeshData& mesh) {
+		std::ifstream file(path);
+		if (!file) {
+			LOG_ERROR(Assets, "OBJ_OPEN_FAILED: {}", path);
+			return false;
+		}
+
+		std::vector<std::array<float, 3>> positions;
+		std::vector<std::array<float, 3>> normals;
+		std::vector<std::array<float, 2>> uvs;
+		//position, uv and normal index of every triangle corner
+		std::vector<std::array<int, 3>> corners;
+
+		std::string line;
+		size_t lineNumber = 0;
+		while (std::getline(file, line)) {
+			++lineNumber;
+			std::istringstream stream(line);
+			std::string type;
+			stream >> type;
+			if (type == "v") {
+				std::array<float, 3> position{};
+				stream >> position[0] >> position[1] >> position[2];
+				positions.push_back(position);
+			}
+			else if (type == "vn") {
+				std::array<float, 3> normal{};
+				stream >> normal[0] >> normal[1] >> normal[2];
+				normals.push_back(normal);
+			}
+			else if (type == "vt") {
+				std::array<float, 2> uv{};
+				stream >> uv[0] >> uv[1];
+				uvs.push_back(uv);
+			}
+			else if (type == "f") {
+				std::vector<std::array<int, 3>> polygon;
+				std::string vertex;
+				while (stream >> vertex) {
+					//v, v/t, v//n or v/t/n
+					std::string parts[3];
+					size_t part = 0;
+					for (char c : vertex) {
+						if (c == '/') {
+							part = std::min(part + 1, size_t(2));
+						}
+						else {
+							parts[part] += c;
+						}
+					}
+					std::array<int, 3> corner = { ResolveObjIndex(parts[0], positions.size()), ResolveObjIndex(parts[1], uvs.size()), ResolveObjIndex(parts[2], normals.size()) };
+					if (corner[0] < 0) {
+						LOG_ERROR(Assets, "OBJ_INVALID_FACE: {}:{}", path, lineNumber);
+						return false;
+					}
+					polygon.push_back(corner);
+				}
+				for (size_t i = 2; i < polygon.size(); ++i) {
+					corners.push_back(polygon[0]);
+					corners.push_back(polygon[i - 1]);
+					corners.push_back(polygon[i]);
+				}
+			}
+		}
+		if (corners.empty()) {
+			LOG_ERROR(Assets, "OBJ_NO_FACES: {}", path);
+			return false;
+		}
+
+		bool hasNormals = std::all_of(corners.begin(), corners.end(), [](const std::array<int, 3>& corner) { return corner[2] >= 0; });
+		bool hasUVs = std::all_of(corners.begin(), corners.end(), [](const std::array<int, 3>& corner) { return corner[1] >= 0; });
+
+		mesh = MeshData();
+		mesh.attributes.push_back({ 0, 3, 0 });
+		mesh.vertexStride = 3;
+		if (hasNormals) {
+			mesh.attributes.push_back({ 1, 3, mesh.vertexStride });
+			mesh.vertexStride += 3;
+		}
+		if (hasUVs) {
+			mesh.attributes.push_back({ 2, 2, mesh.vertexStride });
+			mesh.vertexStride += 2;
+		}
+
+		std::map<std::array<int, 3>, uint32_t> welded;
+		mesh.indices.reserve(corners.size());
+		for (auto corner : corners) {
+			if (!hasNormals) {
+				corner[2] = -1;
+			}
+			if (!hasUVs) {
+				corner[1] = -1;
+			}
+			auto [it, inserted] = welded.emplace(corner, uint32_t(mesh.GetVertexCount()));
+			if (inserted) {
+				const auto& position = positions[corner[0]];
+				mesh.vertices.insert(mesh.vertices.end(), position.begin(), position.end());
+				if (hasNormals) {
+					const auto& normal = normals[corner[2]];
+					mesh.vertices.insert(mesh.vertices.end(), normal.begin(), normal.end());
+				}
+				if (hasUVs) {
+					const auto& uv = uvs[corner[1]];
+					mesh.vertices.insert(mesh.vertices.end(), uv.begin(), uv.end());
+				}
+			}
+			mesh.indices.push_back(it->second);
+		}
+
+		mesh.lods.push_back({ 0, uint32_t(mesh.indices.size()), 0.0f });
+		mesh.ComputeBounds();
+		return true;
+	}
+
+	void BuildLODChain(MeshData& mesh, const LODChainSettings& settings) {
+		std::vector<uint32_t> source = mesh.indices;
+		if (!mesh.lods.empty()) {
+			source.assign(mesh.indices.begin() + mesh.lods[0].indexOffset, mesh.indices.begin() + mesh.lods[0].indexOffset + mesh.lods[0].indexCount);
+		}
+		if (mesh.bounds.radius == 0.0f) {
+			mesh.ComputeBounds();
+		}
+
+		mesh.indices = source;
+		mesh.lods.assign(1, MeshLOD{ 0, uint32_t(source.size()), 0.0f });
+
+		const float maxError = settings.maxRelativeError * mesh.bounds.radius;
+		float error = 0.0f;
+		while (mesh.lods.size() < settings.maxLODCount) {
+			size_t targetIndexCount = size_t(float(source.size() / 3) * settings.reduction) * 3;
+			float stepError = 0.0f;
+			std::vector<uint32_t> simplified = SimplifyMesh(mesh.vertices.data(), mesh.GetVertexCount(), mesh.vertexStride, source,
+				targetIndexCount, maxError - error, &stepError);
+
+			if (simplified.empty() || float(simplified.size()) > float(source.size()) * (1.0f - settings.minReduction)) {
+				break;
+			}
+			error += stepError;
+			mesh.lods.push_back({ uint32_t(mesh.indices.size()), uint32_t(simplified.size()), error });
+			mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+			source = std::move(simplified);
+		}
+	}
+}
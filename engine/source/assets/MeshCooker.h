@@ -0,0 +1,28 @@
+#pragma once
+
+#include "graphics/MeshData.h"
+#include <cstdint>
+#include <string>
+
+namespace eng {
+
+	struct LODChainSettings {
+		//including the full detail mesh
+		uint32_t maxLODCount = 5;
+		//each lod aims for this fraction of the triangles of the one before it
+		float reduction = 0.5f;
+		//no lod strays further than this fraction of the bounding radius from the original surface
+		float maxRelativeError = 0.05f;
+		//a lod that drops less than this fraction of the previous triangles is not worth its memory and ends the chain
+		float minReduction = 0.1f;
+	};
+
+	//loads positions, normals and texture coordinates from a wavefront obj, polygons are fanned into triangles
+	//identical position/normal/uv corners are welded into one vertex
+	//layout is position at location 0, normal at 1 and uv at 2, normals and uvs only when the file has them
+	bool ImportObj(const std::string& path, MeshData& mesh);
+
+	//replaces the lods of the mesh with a chain simplified from its first lod (or all indices when it has none)
+	//each lod is simplified from the previous one and its error is the sum of the errors on the way
+	void BuildLODChain(MeshData& mesh, const LODChainSettings& settings = LODChainSettings());
+}
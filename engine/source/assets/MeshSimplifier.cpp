@@ -0,0 +1,351 @@
+#include "assets/MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace eng {
+
+	namespace {
+
+		//borders are held in place by planes through the edge perpendicular to its triangle, this much stiffer than the surface
+		const double kBorderWeight = 10.0;
+		//cosine of the largest angle a surviving triangle may turn in a single collapse
+		const double kMaxNormalTurn = 0.2;
+
+		enum class VertexKind : uint8_t {
+			Interior,
+			Border,
+			Locked
+		};
+
+		//symmetric 4x4 matrix of the summed squared plane distances plus the area it was gathered over
+		struct Quadric {
+			double a2 = 0.0, b2 = 0.0, c2 = 0.0;
+			double ab = 0.0, ac = 0.0, bc = 0.0;
+			double ad = 0.0, bd = 0.0, cd = 0.0;
+			double d2 = 0.0;
+			double weight = 0.0;
+
+			void AddPlane(double a, double b, double c, double d, double w) {
+				a2 += w * a * a; b2 += w * b * b; c2 += w * c * c;
+				ab += w * a * b; ac += w * a * c; bc += w * b * c;
+				ad += w * a * d; bd += w * b * d; cd += w * c * d;
+				d2 += w * d * d;
+				weight += w;
+			}
+
+			void Add(const Quadric& other) {
+				a2 += other.a2; b2 += other.b2; c2 += other.c2;
+				ab += other.ab; ac += other.ac; bc += other.bc;
+				ad += other.ad; bd += other.bd; cd += other.cd;
+				d2 += other.d2;
+				weight += other.weight;
+			}
+
+			//weighted mean squared distance of the point to the planes
+			double Evaluate(const float* p) const {
+				double x = p[0], y = p[1], z = p[2];
+				double error = a2 * x * x + b2 * y * y + c2 * z * z
+					+ 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+					+ 2.0 * (ad * x + bd * y + cd * z)
+					+ d2;
+				return weight > 0.0 ? std::max(error, 0.0) / weight : 0.0;
+			}
+		};
+
+		struct Collapse {
+			uint32_t from;
+			uint32_t to;
+			double cost;
+		};
+
+		struct PositionKey {
+			float x, y, z;
+			bool operator==(const PositionKey& other) const {
+				return std::memcmp(this, &other, sizeof(PositionKey)) == 0;
+			}
+		};
+
+		struct PositionHash {
+			size_t operator()(const PositionKey& key) const {
+				uint32_t bits[3];
+				std::memcpy(bits, &key, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+
+		uint64_t EdgeKey(uint32_t a, uint32_t b) {
+			return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+		}
+
+		void Cross(const float* a, const float* b, const float* c, double* normal) {
+			double e1[3] = { double(b[0]) - a[0], double(b[1]) - a[1], double(b[2]) - a[2] };
+			double e2[3] = { double(c[0]) - a[0], double(c[1]) - a[1], double(c[2]) - a[2] };
+			normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		}
+	}
+
+	std::vector<uint32_t> SimplifyMesh(const float* vertices, size_t vertexCount, size_t vertexStride, const std::vector<uint32_t>& indices,
+		size_t targetIndexCount, float targetError, float* resultError) {
+
+		std::vector<uint32_t> result = indices;
+		if (resultError) {
+			*resultError = 0.0f;
+		}
+		if (result.size() <= targetIndexCount || vertexCount == 0) {
+			return result;
+		}
+		auto position = [vertices, vertexStride](uint32_t vertex) { return vertices + size_t(vertex) * vertexStride; };
+
+		//edges used by one triangle are borders, by more than two non manifold
+		std::unordered_map<uint64_t, uint32_t> edgeUse;
+		edgeUse.reserve(result.size());
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int e = 0; e < 3; ++e) {
+				++edgeUse[EdgeKey(result[i + e], result[i + (e + 1) % 3])];
+			}
+		}
+		auto isBorder = [&edgeUse](uint32_t a, uint32_t b) {
+			auto it = edgeUse.find(EdgeKey(a, b));
+			return it != edgeUse.end() && it->second == 1;
+		};
+
+		std::vector<VertexKind> kinds(vertexCount, VertexKind::Interior);
+		std::vector<uint8_t> borderEdgeCount(vertexCount, 0);
+		for (const auto& [key, use] : edgeUse) {
+			uint32_t a = uint32_t(key >> 32);
+			uint32_t b = uint32_t(key);
+			if (use > 2) {
+				kinds[a] = VertexKind::Locked;
+				kinds[b] = VertexKind::Locked;
+			}
+			else if (use == 1) {
+				borderEdgeCount[a] = uint8_t(std::min(borderEdgeCount[a] + 1, 255));
+				borderEdgeCount[b] = uint8_t(std::min(borderEdgeCount[b] + 1, 255));
+			}
+		}
+
+		//a vertex sharing its position with another sits on a uv or normal seam, moving it would tear the seam open
+		std::unordered_map<PositionKey, uint32_t, PositionHash> positionUse;
+		positionUse.reserve(vertexCount);
+		for (uint32_t index : result) {
+			const float* p = position(index);
+			positionUse.emplace(PositionKey{ p[0], p[1], p[2] }, index);
+		}
+		for (uint32_t index : result) {
+			const float* p = position(index);
+			if (positionUse[PositionKey{ p[0], p[1], p[2] }] != index) {
+				kinds[index] = VertexKind::Locked;
+				kinds[positionUse[PositionKey{ p[0], p[1], p[2] }]] = VertexKind::Locked;
+			}
+		}
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+			if (kinds[vertex] != VertexKind::Interior || borderEdgeCount[vertex] == 0) {
+				continue;
+			}
+			//more than one border loop through the vertex, no single direction to slide along
+			kinds[vertex] = borderEdgeCount[vertex] == 2 ? VertexKind::Border : VertexKind::Locked;
+		}
+
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < result.size(); i += 3) {
+			uint32_t triangle[3] = { result[i], result[i + 1], result[i + 2] };
+			double normal[3];
+			Cross(position(triangle[0]), position(triangle[1]), position(triangle[2]), normal);
+			double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (length == 0.0) {
+				continue;
+			}
+			double area = length * 0.5;
+			double n[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+			const float* p0 = position(triangle[0]);
+			double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+			for (uint32_t vertex : triangle) {
+				quadrics[vertex].AddPlane(n[0], n[1], n[2], d, area);
+			}
+
+			for (int e = 0; e < 3; ++e) {
+				uint32_t a = triangle[e];
+				uint32_t b = triangle[(e + 1) % 3];
+				if (!isBorder(a, b)) {
+					continue;
+				}
+				const float* pa = position(a);
+				const float* pb = position(b);
+				double edge[3] = { double(pb[0]) - pa[0], double(pb[1]) - pa[1], double(pb[2]) - pa[2] };
+				double edgeLengthSquared = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+				//perpendicular to both the edge and the triangle normal
+				double border[3] = { edge[1] * n[2] - edge[2] * n[1], edge[2] * n[0] - edge[0] * n[2], edge[0] * n[1] - edge[1] * n[0] };
+				double borderLength = std::sqrt(border[0] * border[0] + border[1] * border[1] + border[2] * border[2]);
+				if (borderLength == 0.0) {
+					continue;
+				}
+				border[0] /= borderLength;
+				border[1] /= borderLength;
+				border[2] /= borderLength;
+				double borderD = -(border[0] * pa[0] + border[1] * pa[1] + border[2] * pa[2]);
+				quadrics[a].AddPlane(border[0], border[1], border[2], borderD, edgeLengthSquared * kBorderWeight);
+				quadrics[b].AddPlane(border[0], border[1], border[2], borderD, edgeLengthSquared * kBorderWeight);
+			}
+		}
+
+		const double maxCost = double(targetError) * double(targetError);
+		double worstCost = 0.0;
+		std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+		std::vector<uint32_t> vertexTriangles;
+		std::vector<Collapse> collapses;
+		std::vector<uint8_t> touched(vertexCount);
+		std::vector<uint32_t> remap(vertexCount);
+
+		//each pass collapses the cheapest edges it can without two collapses touching the same neighbourhood,
+		//then rebuilds the index buffer and adjacency
+		while (result.size() > targetIndexCount) {
+			size_t triangleCount = result.size() / 3;
+
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+			for (uint32_t index : result) {
+				++triangleOffsets[index + 1];
+			}
+			for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+				triangleOffsets[vertex + 1] += triangleOffsets[vertex];
+			}
+			vertexTriangles.resize(result.size());
+			{
+				std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+				for (size_t i = 0; i < result.size(); ++i) {
+					vertexTriangles[cursor[result[i]]++] = uint32_t(i / 3);
+				}
+			}
+
+			collapses.clear();
+			auto addCollapse = [&](uint32_t from, uint32_t to, bool border) {
+				if (kinds[from] == VertexKind::Locked) {
+					return;
+				}
+				//a border vertex may only slide along its border, anything else would pull the border inwards
+				if (kinds[from] == VertexKind::Border && !border) {
+					return;
+				}
+				Quadric quadric = quadrics[from];
+				quadric.Add(quadrics[to]);
+				collapses.push_back({ from, to, quadric.Evaluate(position(to)) });
+			};
+			for (size_t i = 0; i < result.size(); i += 3) {
+				for (int e = 0; e < 3; ++e) {
+					uint32_t a = result[i + e];
+					uint32_t b = result[i + (e + 1) % 3];
+					bool border = isBorder(a, b);
+					//interior edges show up in two triangles, only take them once
+					if (a < b || border) {
+						addCollapse(a, b, border);
+						addCollapse(b, a, border);
+					}
+				}
+			}
+			if (collapses.empty()) {
+				break;
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			std::fill(touched.begin(), touched.end(), 0);
+			for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+				remap[vertex] = uint32_t(vertex);
+			}
+			size_t remainingTriangles = triangleCount;
+			size_t targetTriangles = targetIndexCount / 3;
+			size_t collapsed = 0;
+
+			for (const auto& collapse : collapses) {
+				if (remainingTriangles <= targetTriangles || collapse.cost > maxCost) {
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to]) {
+					continue;
+				}
+
+				//moving from onto to must not flip or fold any triangle that survives the collapse
+				const float* target = position(collapse.to);
+				bool flips = false;
+				size_t removed = 0;
+				for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !flips; ++t) {
+					const uint32_t* triangle = &result[vertexTriangles[t] * 3];
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+						++removed;
+						continue;
+					}
+					const float* before[3] = { position(triangle[0]), position(triangle[1]), position(triangle[2]) };
+					const float* after[3] = { before[0], before[1], before[2] };
+					for (int corner = 0; corner < 3; ++corner) {
+						if (triangle[corner] == collapse.from) {
+							after[corner] = target;
+						}
+					}
+					double normalBefore[3];
+					double normalAfter[3];
+					Cross(before[0], before[1], before[2], normalBefore);
+					Cross(after[0], after[1], after[2], normalAfter);
+					//turning a triangle by close to 90 degrees already folds the surface, not just flipping it over
+					double dot = normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2];
+					double lengthBefore = std::sqrt(normalBefore[0] * normalBefore[0] + normalBefore[1] * normalBefore[1] + normalBefore[2] * normalBefore[2]);
+					double lengthAfter = std::sqrt(normalAfter[0] * normalAfter[0] + normalAfter[1] * normalAfter[1] + normalAfter[2] * normalAfter[2]);
+					flips = dot <= kMaxNormalTurn * lengthBefore * lengthAfter;
+				}
+				if (flips) {
+					continue;
+				}
+
+				//the whole neighbourhood is frozen for the rest of the pass so the flip test above stays valid
+				for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; ++t) {
+					const uint32_t* triangle = &result[vertexTriangles[t] * 3];
+					touched[triangle[0]] = 1;
+					touched[triangle[1]] = 1;
+					touched[triangle[2]] = 1;
+				}
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].Add(quadrics[collapse.from]);
+				remainingTriangles -= removed;
+				worstCost = std::max(worstCost, collapse.cost);
+				++collapsed;
+			}
+			if (collapsed == 0) {
+				break;
+			}
+
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3) {
+				uint32_t a = remap[result[i]];
+				uint32_t b = remap[result[i + 1]];
+				uint32_t c = remap[result[i + 2]];
+				if (a == b || b == c || c == a) {
+					continue;
+				}
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+			result.resize(write);
+
+			//borders move with the collapses, a border vertex that collapsed away hands its border to the target
+			edgeUse.clear();
+			for (size_t i = 0; i < result.size(); i += 3) {
+				for (int e = 0; e < 3; ++e) {
+					++edgeUse[EdgeKey(result[i + e], result[i + (e + 1) % 3])];
+				}
+			}
+			for (const auto& [key, use] : edgeUse) {
+				if (use > 2) {
+					kinds[key >> 32] = VertexKind::Locked;
+					kinds[uint32_t(key)] = VertexKind::Locked;
+				}
+			}
+		}
+
+		if (resultError) {
+			*resultError = float(std::sqrt(worstCost));
+		}
+		return result;
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace eng {
+
+	//quadric error metric edge collapse (garland and heckbert)
+	//vertices only ever collapse onto other existing vertices, so the result indexes the same vertex buffer as the input
+	//vertices on attribute seams (several vertices sharing one position) and non manifold vertices never move,
+	//open borders only collapse along themselves so the silhouette of the mesh is kept
+	//stops at targetIndexCount or once the next collapse would exceed targetError (object units), whichever comes first
+	//resultError receives the largest error actually introduced
+	std::vector<uint32_t> SimplifyMesh(const float* vertices, size_t vertexCount, size_t vertexStride, const std::vector<uint32_t>& indices,
+		size_t targetIndexCount, float targetError, float* resultError = nullptr);
+}
@@ -3,7 +3,39 @@
 
 #include "Application.h"
 #include "Engine.h"
+#include "log/Log.h"
 #include "input/InputManager.h"
+#include "input/ActionMap.h"
 #include "graphics/ShaderProgram.h"
 #include "graphics/GraphicsAPI.h"
-#include "render/Material.h"
\ No newline at end of file
+#include "graphics/ShaderLibrary.h"
+#include "graphics/ShaderPermutation.h"
+#include "graphics/ProgramBinaryCache.h"
+#include "graphics/Texture.h"
+#include "graphics/TextureManager.h"
+#include "graphics/Mesh.h"
+#include "graphics/Framebuffer.h"
+#include "graphics/GpuTimer.h"
+#include "graphics/StagingBuffer.h"
+#include "graphics/GLTrace.h"
+#include "graphics/HeadlessContext.h"
+#include "graphics/Image.h"
+#include "graphics/ImageCompare.h"
+#include "render/Material.h"
+#include "render/RenderQueue.h"
+#include "render/CommandList.h"
+#include "render/RenderGraph.h"
+#include "render/ClusteredLighting.h"
+#include "render/DynamicResolution.h"
+#include "render/Frustum.h"
+#include "render/FrustumCuller.h"
+#include "render/OcclusionCuller.h"
+#include "render/LODSelector.h"
+#include "scene/Bounds.h"
+#include "scene/DynamicBVH.h"
+#include "scene/SceneFile.h"
+#include "jobs/JobSystem.h"
+#include "memory/MemoryTracker.h"
+#include "memory/MemoryPool.h"
+#include "memory/LinearArena.h"
+#include "assets/AssetManager.h"
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "graphics/Framebuffer.h"
+#include "log/Log.h"
+#include <cstring>
+
+namespace eng {
+
+	Framebuffer::~Framebuffer() {
+		Destroy();
+	}
+
+	bool Framebuffer::Create(int width, int height) {
+		Destroy();
+		if (width <= 0 || height <= 0) {
+			LOG_ERROR(Graphics, "FRAMEBUFFER: invalid size {}x{}", width, height);
+			return false;
+		}
+
+		glGenRenderbuffers(1, &m_colorBufferID);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_colorBufferID);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glGenRenderbuffers(1, &m_depthBufferID);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_depthBufferID);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glGenFramebuffers(1, &m_framebufferID);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBufferID);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBufferID);
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR(Graphics, "FRAMEBUFFER: incomplete, status 0x{:x}", status);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			Destroy();
+			return false;
+		}
+		m_width = width;
+		m_height = height;
+
+		//fresh renderbuffers hold garbage
+		glViewport(0, 0, width, height);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+		return true;
+	}
+
+	void Framebuffer::Destroy() {
+		if (m_framebufferID) {
+			glDeleteFramebuffers(1, &m_framebufferID);
+			m_framebufferID = 0;
+		}
+		if (m_colorBufferID) {
+			glDeleteRenderbuffers(1, &m_colorBufferID);
+			m_colorBufferID = 0;
+		}
+		if (m_depthBufferID) {
+			glDeleteRenderbuffers(1, &m_depthBufferID);
+			m_depthBufferID = 0;
+		}
+		m_width = 0;
+		m_height = 0;
+	}
+
+	void Framebuffer::Bind() {
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+		glViewport(0, 0, m_width, m_height);
+	}
+
+	bool Framebuffer::IsValid() const {
+		return m_framebufferID != 0;
+	}
+
+	GLuint Framebuffer::GetID() const {
+		return m_framebufferID;
+	}
+
+	int Framebuffer::GetWidth() const {
+		return m_width;
+	}
+
+	int Framebuffer::GetHeight() const {
+		return m_height;
+	}
+
+	bool Framebuffer::ReadPixels(std::vector<uint8_t>& rgba) const {
+		if (!m_framebufferID) {
+			return false;
+		}
+		GLint previous = 0;
+		glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebufferID);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		eng::ReadPixels(m_width, m_height, rgba);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(previous));
+		return true;
+	}
+
+	void ReadPixels(int width, int height, std::vector<uint8_t>& rgba) {
+		size_t rowSize = size_t(width) * 4;
+		rgba.resize(rowSize * size_t(height));
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+		//gl returns the bottom row first
+		std::vector<uint8_t> row(rowSize);
+		for (int y = 0; y < height / 2; ++y) {
+			uint8_t* top = rgba.data() + size_t(y) * rowSize;
+			uint8_t* bottom = rgba.data() + size_t(height - 1 - y) * rowSize;
+			std::memcpy(row.data(), top, rowSize);
+			std::memcpy(top, bottom, rowSize);
+			std::memcpy(bottom, row.data(), rowSize);
+		}
+	}
+}
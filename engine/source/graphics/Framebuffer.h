@@ -0,0 +1,41 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+
+namespace eng {
+
+	//off-screen render target with an rgba8 color and a 24 bit depth, 8 bit stencil attachment
+	class Framebuffer {
+	public:
+		Framebuffer() = default;
+		Framebuffer(const Framebuffer&) = delete;
+		Framebuffer& operator=(const Framebuffer&) = delete;
+		~Framebuffer();
+
+		//needs a current context, starts out cleared to transparent black
+		bool Create(int width, int height);
+		void Destroy();
+		//binds it for drawing and sets the viewport to cover it
+		void Bind();
+		bool IsValid() const;
+
+		GLuint GetID() const;
+		int GetWidth() const;
+		int GetHeight() const;
+
+		//waits for the gpu and copies the color attachment out, rgba8 with the top row first
+		bool ReadPixels(std::vector<uint8_t>& rgba) const;
+
+	private:
+		GLuint m_framebufferID = 0;
+		GLuint m_colorBufferID = 0;
+		GLuint m_depthBufferID = 0;
+		int m_width = 0;
+		int m_height = 0;
+	};
+
+	//reads the color buffer of whatever framebuffer is bound for reading, rgba8 with the top row first
+	void ReadPixels(int width, int height, std::vector<uint8_t>& rgba);
+}
@@ -0,0 +1,1058 @@
+#include "graphics/GLTrace.h"
+#include "graphics/GraphicsAPI.h"
+#include "log/Log.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace eng {
+
+	thread_local GLTrace* GLTrace::s_active = nullptr;
+
+	namespace {
+
+		const char kTraceMagic[8] = { 'E', 'N', 'G', 'T', 'R', 'A', 'C', 'E' };
+		const uint32_t kTraceVersion = 1;
+		//resource index standing for gl object 0
+		const uint32_t kNone = UINT32_MAX;
+		const int kMaxTextureLevels = 16;
+		//no level the engine uploads is larger, also keeps width * height * 4 far from overflowing
+		const int kMaxTextureSize = 16384;
+
+		//bytes of one component of a vertex attribute or an index, 0 for types a capture never sees
+		size_t ComponentSize(GLenum type) {
+			switch (type) {
+			case GL_BYTE:
+			case GL_UNSIGNED_BYTE:
+				return 1;
+			case GL_SHORT:
+			case GL_UNSIGNED_SHORT:
+			case GL_HALF_FLOAT:
+				return 2;
+			case GL_INT:
+			case GL_UNSIGNED_INT:
+			case GL_FLOAT:
+				return 4;
+			case GL_DOUBLE:
+				return 8;
+			default:
+				return 0;
+			}
+		}
+
+		//components of the uniform types a snapshot keeps, 0 for the ones it skips
+		uint32_t UniformComponents(GLenum type, bool& integer) {
+			integer = false;
+			switch (type) {
+			case GL_FLOAT: return 1;
+			case GL_FLOAT_VEC2: return 2;
+			case GL_FLOAT_VEC3: return 3;
+			case GL_FLOAT_VEC4: return 4;
+			case GL_FLOAT_MAT3: return 9;
+			case GL_FLOAT_MAT4: return 16;
+			case GL_INT:
+			case GL_BOOL:
+			case GL_SAMPLER_2D:
+			case GL_SAMPLER_2D_SHADOW:
+			case GL_SAMPLER_CUBE:
+			case GL_SAMPLER_BUFFER:
+			case GL_INT_SAMPLER_BUFFER:
+			case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+				integer = true;
+				return 1;
+			default:
+				return 0;
+			}
+		}
+
+		template<typename T>
+		T ReadValue(const uint8_t*& cursor) {
+			T value;
+			std::memcpy(&value, cursor, sizeof(T));
+			cursor += sizeof(T);
+			return value;
+		}
+
+		template<typename T>
+		void Patch(uint8_t* at, const T& value) {
+			std::memcpy(at, &value, sizeof(T));
+		}
+
+		//file contents, everything little endian like the machines we run on
+		class TraceWriter {
+		public:
+			template<typename T>
+			void Write(const T& value) {
+				m_bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+			}
+			void WriteString(const std::string& value) {
+				Write(uint64_t(value.size()));
+				m_bytes.append(value);
+			}
+			const std::string& GetBytes() const { return m_bytes; }
+
+		private:
+			std::string m_bytes;
+		};
+
+		//stops at the first read past the end and stays failed from there on
+		class TraceReader {
+		public:
+			explicit TraceReader(const std::string& bytes) : m_bytes(bytes) {}
+
+			template<typename T>
+			T Read() {
+				T value{};
+				if (m_failed || m_bytes.size() - m_offset < sizeof(T)) {
+					m_failed = true;
+					return value;
+				}
+				std::memcpy(&value, m_bytes.data() + m_offset, sizeof(T));
+				m_offset += sizeof(T);
+				return value;
+			}
+			std::string ReadString() {
+				uint64_t size = Read<uint64_t>();
+				if (m_failed || m_bytes.size() - m_offset < size) {
+					m_failed = true;
+					return std::string();
+				}
+				std::string value = m_bytes.substr(m_offset, size_t(size));
+				m_offset += size_t(size);
+				return value;
+			}
+			//element counts are checked against the bytes left so a corrupt count cannot allocate the world
+			uint32_t ReadCount() {
+				uint32_t count = Read<uint32_t>();
+				if (count > m_bytes.size() - m_offset) {
+					m_failed = true;
+					return 0;
+				}
+				return count;
+			}
+			bool IsFailed() const { return m_failed; }
+
+		private:
+			const std::string& m_bytes;
+			size_t m_offset = 0;
+			bool m_failed = false;
+		};
+	}
+
+	GLTrace::~GLTrace() {
+		if (s_active == this) {
+			s_active = nullptr;
+		}
+	}
+
+	void GLTrace::BeginCapture(int width, int height) {
+		Clear();
+		m_width = width;
+		m_height = height;
+		m_capturing = true;
+		s_active = this;
+	}
+
+	void GLTrace::EndCapture() {
+		if (s_active == this) {
+			s_active = nullptr;
+		}
+		m_capturing = false;
+		m_programIndices.clear();
+		m_textureIndices.clear();
+		m_vertexArrayIndices.clear();
+		m_bufferIndices.clear();
+		m_stats.programs = m_programs.size();
+		m_stats.textures = m_textures.size();
+		m_stats.vertexArrays = m_vertexArrays.size();
+		m_stats.buffers = m_buffers.size();
+	}
+
+	bool GLTrace::Save(const std::string& path) const {
+		TraceWriter writer;
+		writer.Write(kTraceMagic);
+		writer.Write(kTraceVersion);
+		writer.Write(int32_t(m_width));
+		writer.Write(int32_t(m_height));
+
+		writer.Write(uint32_t(m_programs.size()));
+		for (const ProgramSnapshot& program : m_programs) {
+			writer.WriteString(program.vertexSource);
+			writer.WriteString(program.fragmentSource);
+			writer.Write(uint32_t(program.uniforms.size()));
+			for (const UniformSnapshot& uniform : program.uniforms) {
+				writer.WriteString(uniform.name);
+				writer.Write(int32_t(uniform.location));
+				writer.Write(uint32_t(uniform.type));
+				writer.Write(uniform.values);
+			}
+		}
+
+		writer.Write(uint32_t(m_buffers.size()));
+		for (const BufferSnapshot& buffer : m_buffers) {
+			writer.WriteString(buffer.data);
+		}
+
+		writer.Write(uint32_t(m_textures.size()));
+		for (const TextureSnapshot& texture : m_textures) {
+			writer.Write(int32_t(texture.baseLevel));
+			writer.Write(int32_t(texture.maxLevel));
+			writer.Write(int32_t(texture.minFilter));
+			writer.Write(int32_t(texture.magFilter));
+			writer.Write(int32_t(texture.wrapS));
+			writer.Write(int32_t(texture.wrapT));
+			writer.Write(uint32_t(texture.levels.size()));
+			for (const TextureLevelSnapshot& level : texture.levels) {
+				writer.Write(int32_t(level.width));
+				writer.Write(int32_t(level.height));
+				writer.Write(uint32_t(level.internalFormat));
+				writer.Write(uint8_t(level.compressed));
+				writer.WriteString(level.data);
+			}
+		}
+
+		writer.Write(uint32_t(m_vertexArrays.size()));
+		for (const VertexArraySnapshot& vertexArray : m_vertexArrays) {
+			writer.Write(vertexArray.elementBuffer);
+			writer.Write(uint32_t(vertexArray.attributes.size()));
+			for (const AttributeSnapshot& attribute : vertexArray.attributes) {
+				writer.Write(uint32_t(attribute.index));
+				writer.Write(int32_t(attribute.size));
+				writer.Write(uint32_t(attribute.type));
+				writer.Write(uint8_t(attribute.normalized));
+				writer.Write(uint8_t(attribute.integer));
+				writer.Write(int32_t(attribute.stride));
+				writer.Write(attribute.offset);
+				writer.Write(attribute.buffer);
+			}
+		}
+
+		writer.Write(uint64_t(m_stats.calls));
+		writer.Write(uint64_t(m_stats.draws));
+		writer.WriteString(std::string(m_commands.begin(), m_commands.end()));
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file || !file.write(writer.GetBytes().data(), std::streamsize(writer.GetBytes().size()))) {
+			LOG_ERROR(Graphics, "GL_TRACE_WRITE_FAILED: {}", path);
+			return false;
+		}
+		return true;
+	}
+
+	bool GLTrace::Load(const std::string& path) {
+		ReleaseReplay();
+		Clear();
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			LOG_ERROR(Graphics, "GL_TRACE_NOT_FOUND: {}", path);
+			return false;
+		}
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		std::string bytes = contents.str();
+
+		TraceReader reader(bytes);
+		char magic[8];
+		for (char& c : magic) {
+			c = reader.Read<char>();
+		}
+		if (reader.IsFailed() || std::memcmp(magic, kTraceMagic, sizeof(magic)) != 0) {
+			LOG_ERROR(Graphics, "GL_TRACE_INVALID: {}", path);
+			return false;
+		}
+		uint32_t version = reader.Read<uint32_t>();
+		if (version != kTraceVersion) {
+			LOG_ERROR(Graphics, "GL_TRACE_UNSUPPORTED_VERSION: {}", version);
+			return false;
+		}
+		m_width = reader.Read<int32_t>();
+		m_height = reader.Read<int32_t>();
+
+		m_programs.resize(reader.ReadCount());
+		for (ProgramSnapshot& program : m_programs) {
+			program.vertexSource = reader.ReadString();
+			program.fragmentSource = reader.ReadString();
+			program.uniforms.resize(reader.ReadCount());
+			for (UniformSnapshot& uniform : program.uniforms) {
+				uniform.name = reader.ReadString();
+				uniform.location = reader.Read<int32_t>();
+				uniform.type = reader.Read<uint32_t>();
+				for (uint32_t& value : uniform.values) {
+					value = reader.Read<uint32_t>();
+				}
+			}
+		}
+
+		m_buffers.resize(reader.ReadCount());
+		for (BufferSnapshot& buffer : m_buffers) {
+			buffer.data = reader.ReadString();
+			m_stats.resourceBytes += buffer.data.size();
+		}
+
+		m_textures.resize(reader.ReadCount());
+		for (TextureSnapshot& texture : m_textures) {
+			texture.baseLevel = reader.Read<int32_t>();
+			texture.maxLevel = reader.Read<int32_t>();
+			texture.minFilter = reader.Read<int32_t>();
+			texture.magFilter = reader.Read<int32_t>();
+			texture.wrapS = reader.Read<int32_t>();
+			texture.wrapT = reader.Read<int32_t>();
+			texture.levels.resize(reader.ReadCount());
+			for (TextureLevelSnapshot& level : texture.levels) {
+				level.width = reader.Read<int32_t>();
+				level.height = reader.Read<int32_t>();
+				level.internalFormat = reader.Read<uint32_t>();
+				level.compressed = reader.Read<uint8_t>() != 0;
+				level.data = reader.ReadString();
+				m_stats.resourceBytes += level.data.size();
+			}
+		}
+
+		m_vertexArrays.resize(reader.ReadCount());
+		for (VertexArraySnapshot& vertexArray : m_vertexArrays) {
+			vertexArray.elementBuffer = reader.Read<uint32_t>();
+			vertexArray.attributes.resize(reader.ReadCount());
+			for (AttributeSnapshot& attribute : vertexArray.attributes) {
+				attribute.index = reader.Read<uint32_t>();
+				attribute.size = reader.Read<int32_t>();
+				attribute.type = reader.Read<uint32_t>();
+				attribute.normalized = reader.Read<uint8_t>() != 0;
+				attribute.integer = reader.Read<uint8_t>() != 0;
+				attribute.stride = reader.Read<int32_t>();
+				attribute.offset = reader.Read<uint64_t>();
+				attribute.buffer = reader.Read<uint32_t>();
+			}
+		}
+
+		m_stats.calls = size_t(reader.Read<uint64_t>());
+		m_stats.draws = size_t(reader.Read<uint64_t>());
+		std::string commands = reader.ReadString();
+		if (reader.IsFailed()) {
+			LOG_ERROR(Graphics, "GL_TRACE_TRUNCATED: {}", path);
+			Clear();
+			return false;
+		}
+		m_commands.assign(commands.begin(), commands.end());
+		if (!ValidateResources() || !ValidateCommands()) {
+			LOG_ERROR(Graphics, "GL_TRACE_CORRUPT: {}", path);
+			Clear();
+			return false;
+		}
+		m_stats.programs = m_programs.size();
+		m_stats.textures = m_textures.size();
+		m_stats.vertexArrays = m_vertexArrays.size();
+		m_stats.buffers = m_buffers.size();
+		return true;
+	}
+
+	bool GLTrace::ValidateResources() const {
+		for (const TextureSnapshot& texture : m_textures) {
+			if (texture.levels.size() > size_t(kMaxTextureLevels)) {
+				return false;
+			}
+			for (const TextureLevelSnapshot& level : texture.levels) {
+				//a level the streamer evicted is recorded as 0 x 0 without data
+				if (level.width == 0 && level.height == 0 && level.data.empty()) {
+					continue;
+				}
+				if (level.width <= 0 || level.height <= 0 || level.width > kMaxTextureSize || level.height > kMaxTextureSize || level.data.empty()) {
+					return false;
+				}
+				//compressed sizes go to the driver along with the data, it checks them itself
+				if (!level.compressed && level.data.size() != size_t(level.width) * size_t(level.height) * 4) {
+					return false;
+				}
+			}
+		}
+		for (const VertexArraySnapshot& vertexArray : m_vertexArrays) {
+			if (vertexArray.elementBuffer != kNone && vertexArray.elementBuffer >= m_buffers.size()) {
+				return false;
+			}
+			for (const AttributeSnapshot& attribute : vertexArray.attributes) {
+				if (attribute.buffer != kNone && attribute.buffer >= m_buffers.size()) {
+					return false;
+				}
+				if (attribute.size < 1 || attribute.size > 4 || attribute.stride < 0 || ComponentSize(attribute.type) == 0) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool GLTrace::ValidateCommands() const {
+		auto validIndex = [](uint32_t index, size_t count) {
+			return index == kNone || index < count;
+		};
+		//vertices [0, vertexCount) of the bound vertex array have to lie inside every attribute's buffer
+		uint32_t vertexArrayIndex = kNone;
+		auto verticesFit = [this, &vertexArrayIndex](uint64_t vertexCount) {
+			if (vertexArrayIndex == kNone || vertexCount == 0) {
+				return true;
+			}
+			for (const AttributeSnapshot& attribute : m_vertexArrays[vertexArrayIndex].attributes) {
+				//client side arrays are not captured, the driver would read them from the address
+				if (attribute.buffer == kNone) {
+					return false;
+				}
+				uint64_t elementSize = uint64_t(attribute.size) * ComponentSize(attribute.type);
+				uint64_t stride = attribute.stride ? uint64_t(attribute.stride) : elementSize;
+				uint64_t bufferSize = m_buffers[attribute.buffer].data.size();
+				if (vertexCount > bufferSize || attribute.offset > bufferSize ||
+					(vertexCount - 1) * stride + elementSize > bufferSize - attribute.offset) {
+					return false;
+				}
+			}
+			return true;
+		};
+
+		const uint8_t* cursor = m_commands.data();
+		const uint8_t* end = cursor + m_commands.size();
+		while (cursor < end) {
+			Op op = Op(*cursor++);
+			size_t payload = 0;
+			switch (op) {
+			case Op::UseProgram:
+			case Op::BindVertexArray:
+				payload = 4;
+				break;
+			case Op::Uniform1f:
+			case Op::Uniform1i:
+			case Op::BindTexture:
+				payload = 8;
+				break;
+			case Op::DrawArrays:
+				payload = 12;
+				break;
+			case Op::DrawElements:
+				payload = 20;
+				break;
+			default:
+				return false;
+			}
+			if (size_t(end - cursor) < payload) {
+				return false;
+			}
+			const uint8_t* next = cursor + payload;
+			if (op == Op::UseProgram && !validIndex(ReadValue<uint32_t>(cursor), m_programs.size())) {
+				return false;
+			}
+			if (op == Op::BindVertexArray) {
+				vertexArrayIndex = ReadValue<uint32_t>(cursor);
+				if (!validIndex(vertexArrayIndex, m_vertexArrays.size())) {
+					return false;
+				}
+			}
+			if (op == Op::DrawArrays) {
+				cursor += 4;
+				int32_t first = ReadValue<int32_t>(cursor);
+				int32_t count = ReadValue<int32_t>(cursor);
+				if (first < 0 || count < 0 || !verticesFit(count ? uint64_t(first) + uint64_t(count) : 0)) {
+					return false;
+				}
+			}
+			if (op == Op::DrawElements) {
+				cursor += 4;
+				int32_t count = ReadValue<int32_t>(cursor);
+				size_t indexSize = ComponentSize(ReadValue<uint32_t>(cursor));
+				uint64_t offset = ReadValue<uint64_t>(cursor);
+				if (count < 0 || indexSize == 0 || indexSize == 8 || vertexArrayIndex == kNone) {
+					return false;
+				}
+				uint32_t elementBuffer = m_vertexArrays[vertexArrayIndex].elementBuffer;
+				if (elementBuffer == kNone) {
+					return false;
+				}
+				const std::string& indices = m_buffers[elementBuffer].data;
+				if (offset > indices.size() || uint64_t(count) * indexSize > indices.size() - offset) {
+					return false;
+				}
+				//the largest index decides how far into the vertex buffers the draw reads
+				uint64_t vertexCount = 0;
+				const uint8_t* index = reinterpret_cast<const uint8_t*>(indices.data()) + offset;
+				for (int32_t i = 0; i < count; ++i, index += indexSize) {
+					uint32_t value = 0;
+					std::memcpy(&value, index, indexSize);
+					vertexCount = std::max<uint64_t>(vertexCount, uint64_t(value) + 1);
+				}
+				if (!verticesFit(vertexCount)) {
+					return false;
+				}
+			}
+			if (op == Op::BindTexture) {
+				cursor += 4;
+				if (!validIndex(ReadValue<uint32_t>(cursor), m_textures.size())) {
+					return false;
+				}
+			}
+			cursor = next;
+		}
+		return true;
+	}
+
+	template<typename T>
+	void GLTrace::Write(std::vector<uint8_t>& stream, const T& value) {
+		const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+		stream.insert(stream.end(), bytes, bytes + sizeof(T));
+	}
+
+	void GLTrace::WriteOp(Op op) {
+		m_commands.push_back(uint8_t(op));
+		++m_stats.calls;
+	}
+
+	void GLTrace::OnUseProgram(GLuint program) {
+		uint32_t index = CaptureProgram(program);
+		WriteOp(Op::UseProgram);
+		Write(m_commands, index);
+	}
+
+	void GLTrace::OnUniform(GLint location, float value) {
+		WriteOp(Op::Uniform1f);
+		Write(m_commands, int32_t(location));
+		Write(m_commands, value);
+	}
+
+	void GLTrace::OnUniform(GLint location, int value) {
+		WriteOp(Op::Uniform1i);
+		Write(m_commands, int32_t(location));
+		Write(m_commands, int32_t(value));
+	}
+
+	void GLTrace::OnBindTexture(int unit, GLuint texture) {
+		uint32_t index = CaptureTexture(texture);
+		WriteOp(Op::BindTexture);
+		Write(m_commands, int32_t(unit));
+		Write(m_commands, index);
+	}
+
+	void GLTrace::OnBindVertexArray(GLuint vertexArray) {
+		uint32_t index = CaptureVertexArray(vertexArray);
+		WriteOp(Op::BindVertexArray);
+		Write(m_commands, index);
+	}
+
+	void GLTrace::OnDrawArrays(GLenum mode, GLint first, GLsizei count) {
+		WriteOp(Op::DrawArrays);
+		Write(m_commands, uint32_t(mode));
+		Write(m_commands, int32_t(first));
+		Write(m_commands, int32_t(count));
+		++m_stats.draws;
+	}
+
+	void GLTrace::OnDrawElements(GLenum mode, GLsizei count, GLenum type, size_t offset) {
+		WriteOp(Op::DrawElements);
+		Write(m_commands, uint32_t(mode));
+		Write(m_commands, int32_t(count));
+		Write(m_commands, uint32_t(type));
+		Write(m_commands, uint64_t(offset));
+		++m_stats.draws;
+	}
+
+	uint32_t GLTrace::CaptureProgram(GLuint program) {
+		if (program == 0) {
+			return kNone;
+		}
+		auto it = m_programIndices.find(program);
+		if (it != m_programIndices.end()) {
+			return it->second;
+		}
+
+		ProgramSnapshot snapshot;
+		//the engine deletes its shader objects after linking, they stay attached and readable until the program goes
+		GLuint shaders[8];
+		GLsizei shaderCount = 0;
+		glGetAttachedShaders(program, 8, &shaderCount, shaders);
+		for (GLsizei i = 0; i < shaderCount; ++i) {
+			GLint type = 0;
+			GLint length = 0;
+			glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+			glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length);
+			std::string source(size_t(std::max(length, 1)), '\0');
+			glGetShaderSource(shaders[i], GLsizei(source.size()), nullptr, &source[0]);
+			source.resize(std::strlen(source.c_str()));
+			(type == GL_VERTEX_SHADER ? snapshot.vertexSource : snapshot.fragmentSource) = std::move(source);
+		}
+		if (snapshot.vertexSource.empty() || snapshot.fragmentSource.empty()) {
+			LOG_WARNING(Graphics, "GL_TRACE_PROGRAM_UNREADABLE: program {} has no attached shaders, its draws will not replay", program);
+		}
+
+		//uniforms set once after linking would be missing from the stream, so every value is taken along
+		GLint uniformCount = 0;
+		GLint maxNameLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+		std::string name(size_t(std::max(maxNameLength, 1)), '\0');
+		for (GLint i = 0; i < uniformCount; ++i) {
+			GLsizei nameLength = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(program, GLuint(i), GLsizei(name.size()), &nameLength, &size, &type, &name[0]);
+			UniformSnapshot uniform;
+			uniform.name.assign(name.data(), size_t(nameLength));
+			uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+			uniform.type = type;
+			bool integer = false;
+			//block members have no location
+			if (uniform.location < 0 || UniformComponents(type, integer) == 0) {
+				continue;
+			}
+			if (integer) {
+				glGetUniformiv(program, uniform.location, reinterpret_cast<GLint*>(uniform.values));
+			}
+			else {
+				glGetUniformfv(program, uniform.location, reinterpret_cast<GLfloat*>(uniform.values));
+			}
+			snapshot.uniforms.push_back(std::move(uniform));
+		}
+
+		uint32_t index = uint32_t(m_programs.size());
+		m_programs.push_back(std::move(snapshot));
+		m_programIndices[program] = index;
+		return index;
+	}
+
+	uint32_t GLTrace::CaptureTexture(GLuint texture) {
+		if (texture == 0) {
+			return kNone;
+		}
+		auto it = m_textureIndices.find(texture);
+		if (it != m_textureIndices.end()) {
+			return it->second;
+		}
+
+		//the texture is bound to GL_TEXTURE_2D of the active unit right now
+		TextureSnapshot snapshot;
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &snapshot.baseLevel);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &snapshot.maxLevel);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &snapshot.minFilter);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &snapshot.magFilter);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &snapshot.wrapS);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &snapshot.wrapT);
+
+		GLint packBuffer = 0;
+		glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		int lastLevel = -1;
+		snapshot.levels.resize(kMaxTextureLevels);
+		for (int i = 0; i < kMaxTextureLevels; ++i) {
+			TextureLevelSnapshot& level = snapshot.levels[i];
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_WIDTH, &level.width);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_HEIGHT, &level.height);
+			if (level.width == 0 || level.height == 0) {
+				level = TextureLevelSnapshot();
+				continue;
+			}
+			GLint format = 0;
+			GLint compressed = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_INTERNAL_FORMAT, &format);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_COMPRESSED, &compressed);
+			level.internalFormat = GLenum(format);
+			level.compressed = compressed != 0;
+			if (level.compressed) {
+				GLint size = 0;
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+				level.data.resize(size_t(size));
+				glGetCompressedTexImage(GL_TEXTURE_2D, i, &level.data[0]);
+			}
+			else {
+				level.internalFormat = GL_RGBA8;
+				level.data.resize(size_t(level.width) * size_t(level.height) * 4);
+				glGetTexImage(GL_TEXTURE_2D, i, GL_RGBA, GL_UNSIGNED_BYTE, &level.data[0]);
+			}
+			m_stats.resourceBytes += level.data.size();
+			lastLevel = i;
+		}
+		snapshot.levels.resize(size_t(lastLevel + 1));
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, GLuint(packBuffer));
+
+		uint32_t index = uint32_t(m_textures.size());
+		m_textures.push_back(std::move(snapshot));
+		m_textureIndices[texture] = index;
+		return index;
+	}
+
+	uint32_t GLTrace::CaptureVertexArray(GLuint vertexArray) {
+		if (vertexArray == 0) {
+			return kNone;
+		}
+		auto it = m_vertexArrayIndices.find(vertexArray);
+		if (it != m_vertexArrayIndices.end()) {
+			return it->second;
+		}
+
+		//the vertex array is bound right now, so the queries below read its state
+		VertexArraySnapshot snapshot;
+		GLint attributeCount = 0;
+		glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &attributeCount);
+		for (GLint i = 0; i < attributeCount; ++i) {
+			GLint enabled = 0;
+			glGetVertexAttribiv(GLuint(i), GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+			if (!enabled) {
+				continue;
+			}
+			AttributeSnapshot attribute;
+			GLint value = 0;
+			attribute.index = GLuint(i);
+			glGetVertexAttribiv(GLuint(i), GL_VERTEX_ATTRIB_ARRAY_SIZE, &attribute.size);
+			glGetVertexAttribiv(GLuint(i), GL_VERTEX_ATTRIB_ARRAY_TYPE, &value);
+			attribute.type = GLenum(value);
+			glGetVertexAttribiv(GLuint(i), GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &value);
+			attribute.normalized = value != 0;
+			glGetVertexAttribiv(GLuint(i), GL_VERTEX_ATTRIB_ARRAY_INTEGER, &value);
+			attribute.integer = value != 0;
+			glGetVertexAttribiv(GLuint(i), GL_VERTEX_ATTRIB_ARRAY_STRIDE, &attribute.stride);
+			void* pointer = nullptr;
+			glGetVertexAttribPointerv(GLuint(i), GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+			attribute.offset = uint64_t(reinterpret_cast<uintptr_t>(pointer));
+			glGetVertexAttribiv(GLuint(i), GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &value);
+			attribute.buffer = CaptureBuffer(GLuint(value));
+			snapshot.attributes.push_back(attribute);
+		}
+		GLint elementBuffer = 0;
+		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer);
+		snapshot.elementBuffer = CaptureBuffer(GLuint(elementBuffer));
+
+		uint32_t index = uint32_t(m_vertexArrays.size());
+		m_vertexArrays.push_back(std::move(snapshot));
+		m_vertexArrayIndices[vertexArray] = index;
+		return index;
+	}
+
+	uint32_t GLTrace::CaptureBuffer(GLuint buffer) {
+		if (buffer == 0) {
+			return kNone;
+		}
+		auto it = m_bufferIndices.find(buffer);
+		if (it != m_bufferIndices.end()) {
+			return it->second;
+		}
+
+		//read through the copy binding, which is not part of any vertex array
+		GLint previous = 0;
+		glGetIntegerv(GL_COPY_READ_BUFFER_BINDING, &previous);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		GLint size = 0;
+		glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+		BufferSnapshot snapshot;
+		snapshot.data.resize(size_t(size));
+		if (size > 0) {
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, &snapshot.data[0]);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, GLuint(previous));
+		m_stats.resourceBytes += snapshot.data.size();
+
+		uint32_t index = uint32_t(m_buffers.size());
+		m_buffers.push_back(std::move(snapshot));
+		m_bufferIndices[buffer] = index;
+		return index;
+	}
+
+	bool GLTrace::PrepareReplay() {
+		ReleaseReplay();
+		bool complete = true;
+
+		GraphicsAPI graphicsAPI;
+		for (ProgramSnapshot& program : m_programs) {
+			if (program.vertexSource.empty() || program.fragmentSource.empty()) {
+				continue;
+			}
+			program.replayID = graphicsAPI.CompileShaderProgram(program.vertexSource, program.fragmentSource);
+			if (program.replayID == 0) {
+				complete = false;
+				continue;
+			}
+			glUseProgram(program.replayID);
+			for (const UniformSnapshot& uniform : program.uniforms) {
+				GLint location = glGetUniformLocation(program.replayID, uniform.name.c_str());
+				program.locations[uniform.location] = location;
+				bool integer = false;
+				uint32_t components = UniformComponents(uniform.type, integer);
+				const auto* floats = reinterpret_cast<const GLfloat*>(uniform.values);
+				if (integer) {
+					glUniform1i(location, GLint(uniform.values[0]));
+				}
+				else if (components == 16) {
+					glUniformMatrix4fv(location, 1, GL_FALSE, floats);
+				}
+				else if (components == 9) {
+					glUniformMatrix3fv(location, 1, GL_FALSE, floats);
+				}
+				else if (components == 4) {
+					glUniform4fv(location, 1, floats);
+				}
+				else if (components == 3) {
+					glUniform3fv(location, 1, floats);
+				}
+				else if (components == 2) {
+					glUniform2fv(location, 1, floats);
+				}
+				else {
+					glUniform1fv(location, 1, floats);
+				}
+			}
+		}
+		glUseProgram(0);
+
+		for (BufferSnapshot& buffer : m_buffers) {
+			glGenBuffers(1, &buffer.replayID);
+			glBindBuffer(GL_ARRAY_BUFFER, buffer.replayID);
+			glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(buffer.data.size()), buffer.data.data(), GL_STATIC_DRAW);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (TextureSnapshot& texture : m_textures) {
+			glGenTextures(1, &texture.replayID);
+			glBindTexture(GL_TEXTURE_2D, texture.replayID);
+			for (size_t i = 0; i < texture.levels.size(); ++i) {
+				const TextureLevelSnapshot& level = texture.levels[i];
+				if (level.width == 0) {
+					continue;
+				}
+				if (level.compressed) {
+					glCompressedTexImage2D(GL_TEXTURE_2D, GLint(i), level.internalFormat, level.width, level.height, 0, GLsizei(level.data.size()), level.data.data());
+				}
+				else {
+					glTexImage2D(GL_TEXTURE_2D, GLint(i), GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level.data.data());
+				}
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.baseLevel);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.maxLevel);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.minFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture.magFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture.wrapS);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture.wrapT);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		for (VertexArraySnapshot& vertexArray : m_vertexArrays) {
+			glGenVertexArrays(1, &vertexArray.replayID);
+			glBindVertexArray(vertexArray.replayID);
+			for (const AttributeSnapshot& attribute : vertexArray.attributes) {
+				GLuint buffer = attribute.buffer < m_buffers.size() ? m_buffers[attribute.buffer].replayID : 0;
+				glBindBuffer(GL_ARRAY_BUFFER, buffer);
+				glEnableVertexAttribArray(attribute.index);
+				const void* offset = reinterpret_cast<const void*>(uintptr_t(attribute.offset));
+				if (attribute.integer) {
+					glVertexAttribIPointer(attribute.index, attribute.size, attribute.type, attribute.stride, offset);
+				}
+				else {
+					glVertexAttribPointer(attribute.index, attribute.size, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE, attribute.stride, offset);
+				}
+			}
+			GLuint elementBuffer = vertexArray.elementBuffer < m_buffers.size() ? m_buffers[vertexArray.elementBuffer].replayID : 0;
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		//the same stream with replay objects and locations in place of the captured indices, so Replay only decodes and calls
+		m_replayCommands = m_commands;
+		uint8_t* base = m_replayCommands.data();
+		const uint8_t* cursor = base;
+		const uint8_t* end = base + m_replayCommands.size();
+		uint32_t currentProgram = kNone;
+		while (cursor < end) {
+			Op op = Op(*cursor++);
+			switch (op) {
+			case Op::UseProgram: {
+				uint8_t* at = base + (cursor - base);
+				currentProgram = ReadValue<uint32_t>(cursor);
+				Patch(at, currentProgram < m_programs.size() ? m_programs[currentProgram].replayID : 0u);
+				break;
+			}
+			case Op::Uniform1f:
+			case Op::Uniform1i: {
+				uint8_t* at = base + (cursor - base);
+				int32_t location = ReadValue<int32_t>(cursor);
+				cursor += 4;
+				GLint replayLocation = -1;
+				if (currentProgram < m_programs.size()) {
+					const auto& locations = m_programs[currentProgram].locations;
+					auto found = locations.find(location);
+					replayLocation = found != locations.end() ? found->second : -1;
+				}
+				Patch(at, int32_t(replayLocation));
+				break;
+			}
+			case Op::BindTexture: {
+				cursor += 4;
+				uint8_t* at = base + (cursor - base);
+				uint32_t index = ReadValue<uint32_t>(cursor);
+				Patch(at, index < m_textures.size() ? m_textures[index].replayID : 0u);
+				break;
+			}
+			case Op::BindVertexArray: {
+				uint8_t* at = base + (cursor - base);
+				uint32_t index = ReadValue<uint32_t>(cursor);
+				Patch(at, index < m_vertexArrays.size() ? m_vertexArrays[index].replayID : 0u);
+				break;
+			}
+			case Op::DrawArrays:
+				cursor += 12;
+				break;
+			case Op::DrawElements:
+				cursor += 20;
+				break;
+			default:
+				LOG_ERROR(Graphics, "GL_TRACE_CORRUPT: unknown op {}", int(op));
+				m_replayCommands.clear();
+				return false;
+			}
+		}
+		m_prepared = true;
+		return complete;
+	}
+
+	void GLTrace::Replay(bool issueCalls) {
+		if (issueCalls && !m_prepared) {
+			return;
+		}
+		const std::vector<uint8_t>& stream = issueCalls ? m_replayCommands : m_commands;
+		const uint8_t* cursor = stream.data();
+		const uint8_t* end = cursor + stream.size();
+		//what the stream walk adds up to without gl, so the compiler cannot drop it
+		uint64_t checksum = 0;
+		while (cursor < end) {
+			Op op = Op(*cursor++);
+			switch (op) {
+			case Op::UseProgram: {
+				GLuint program = ReadValue<uint32_t>(cursor);
+				if (issueCalls) {
+					glUseProgram(program);
+				}
+				checksum += program;
+				break;
+			}
+			case Op::Uniform1f: {
+				GLint location = ReadValue<int32_t>(cursor);
+				float value = ReadValue<float>(cursor);
+				if (issueCalls) {
+					glUniform1f(location, value);
+				}
+				checksum += uint64_t(location);
+				break;
+			}
+			case Op::Uniform1i: {
+				GLint location = ReadValue<int32_t>(cursor);
+				GLint value = ReadValue<int32_t>(cursor);
+				if (issueCalls) {
+					glUniform1i(location, value);
+				}
+				checksum += uint64_t(location) + uint64_t(value);
+				break;
+			}
+			case Op::BindTexture: {
+				int unit = ReadValue<int32_t>(cursor);
+				GLuint texture = ReadValue<uint32_t>(cursor);
+				if (issueCalls) {
+					glActiveTexture(GL_TEXTURE0 + unit);
+					glBindTexture(GL_TEXTURE_2D, texture);
+				}
+				checksum += texture;
+				break;
+			}
+			case Op::BindVertexArray: {
+				GLuint vertexArray = ReadValue<uint32_t>(cursor);
+				if (issueCalls) {
+					glBindVertexArray(vertexArray);
+				}
+				checksum += vertexArray;
+				break;
+			}
+			case Op::DrawArrays: {
+				GLenum mode = ReadValue<uint32_t>(cursor);
+				GLint first = ReadValue<int32_t>(cursor);
+				GLsizei count = ReadValue<int32_t>(cursor);
+				if (issueCalls) {
+					glDrawArrays(mode, first, count);
+				}
+				checksum += uint64_t(count);
+				break;
+			}
+			case Op::DrawElements: {
+				GLenum mode = ReadValue<uint32_t>(cursor);
+				GLsizei count = ReadValue<int32_t>(cursor);
+				GLenum type = ReadValue<uint32_t>(cursor);
+				uint64_t offset = ReadValue<uint64_t>(cursor);
+				if (issueCalls) {
+					glDrawElements(mode, count, type, reinterpret_cast<const void*>(uintptr_t(offset)));
+				}
+				checksum += uint64_t(count) + offset;
+				break;
+			}
+			default:
+				//the stream went through ValidateCommands, a capture never writes anything else
+				cursor = end;
+				break;
+			}
+		}
+		if (issueCalls) {
+			glBindVertexArray(0);
+			glUseProgram(0);
+		}
+		volatile uint64_t sink = checksum;
+		(void)sink;
+	}
+
+	void GLTrace::ReleaseReplay() {
+		if (!m_prepared) {
+			return;
+		}
+		for (ProgramSnapshot& program : m_programs) {
+			if (program.replayID != 0) {
+				glDeleteProgram(program.replayID);
+				program.replayID = 0;
+			}
+			program.locations.clear();
+		}
+		for (TextureSnapshot& texture : m_textures) {
+			glDeleteTextures(1, &texture.replayID);
+			texture.replayID = 0;
+		}
+		for (VertexArraySnapshot& vertexArray : m_vertexArrays) {
+			glDeleteVertexArrays(1, &vertexArray.replayID);
+			vertexArray.replayID = 0;
+		}
+		for (BufferSnapshot& buffer : m_buffers) {
+			glDeleteBuffers(1, &buffer.replayID);
+			buffer.replayID = 0;
+		}
+		m_replayCommands.clear();
+		m_prepared = false;
+	}
+
+	int GLTrace::GetWidth() const {
+		return m_width;
+	}
+
+	int GLTrace::GetHeight() const {
+		return m_height;
+	}
+
+	const GLTraceStats& GLTrace::GetStats() const {
+		return m_stats;
+	}
+
+	void GLTrace::Clear() {
+		m_commands.clear();
+		m_programs.clear();
+		m_textures.clear();
+		m_vertexArrays.clear();
+		m_buffers.clear();
+		m_programIndices.clear();
+		m_textureIndices.clear();
+		m_vertexArrayIndices.clear();
+		m_bufferIndices.clear();
+		m_stats = GLTraceStats();
+		m_replayCommands.clear();
+		m_prepared = false;
+		m_width = 0;
+		m_height = 0;
+	}
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eng {
+
+	struct GLTraceStats {
+		size_t calls = 0;
+		size_t draws = 0;
+		size_t programs = 0;
+		size_t textures = 0;
+		size_t vertexArrays = 0;
+		size_t buffers = 0;
+		//captured buffer and texture contents
+		uint64_t resourceBytes = 0;
+	};
+
+	//binary recording of the gl calls a frame makes through GraphicsAPI, ShaderProgram, Material and Texture
+	//every object a call refers to is read back from the driver the first time it shows up (program sources and uniform values,
+	//texture levels, vertex array layouts and buffer contents) so a trace replays without the game or its assets
+	//framebuffer binds, clears and state set outside those classes are not recorded, a replay draws everything into one target
+	class GLTrace {
+	public:
+		GLTrace() = default;
+		GLTrace(const GLTrace&) = delete;
+		GLTrace& operator=(const GLTrace&) = delete;
+		~GLTrace();
+
+		//the trace capturing on this thread, nullptr outside of a capture
+		static GLTrace* GetActive() { return s_active; }
+
+		//forgets the previous recording and records what the calling thread does until EndCapture, needs the context
+		void BeginCapture(int width, int height);
+		void EndCapture();
+		bool Save(const std::string& path) const;
+		bool Load(const std::string& path);
+
+		//called right after the gl call they mirror, with the object already bound
+		void OnUseProgram(GLuint program);
+		void OnUniform(GLint location, float value);
+		void OnUniform(GLint location, int value);
+		void OnBindTexture(int unit, GLuint texture);
+		void OnBindVertexArray(GLuint vertexArray);
+		void OnDrawArrays(GLenum mode, GLint first, GLsizei count);
+		void OnDrawElements(GLenum mode, GLsizei count, GLenum type, size_t offset);
+
+		//creates the recorded objects in the current context, false when a program does not build
+		bool PrepareReplay();
+		//issues the recorded calls once, without gl calls it only walks the stream, which is the decoding cost alone
+		void Replay(bool issueCalls = true);
+		//deletes what PrepareReplay created, needs the context
+		void ReleaseReplay();
+
+		int GetWidth() const;
+		int GetHeight() const;
+		const GLTraceStats& GetStats() const;
+
+	private:
+		enum class Op : uint8_t {
+			UseProgram,
+			Uniform1f,
+			Uniform1i,
+			BindTexture,
+			BindVertexArray,
+			DrawArrays,
+			DrawElements
+		};
+
+		//value of an active uniform when the program was first used, restored after the replay links it
+		struct UniformSnapshot {
+			std::string name;
+			GLint location = -1;
+			GLenum type = 0;
+			//floats or ints depending on the type, up to a mat4
+			uint32_t values[16] = {};
+		};
+
+		struct ProgramSnapshot {
+			std::string vertexSource;
+			std::string fragmentSource;
+			std::vector<UniformSnapshot> uniforms;
+			GLuint replayID = 0;
+			//captured location to the replay program's location
+			std::unordered_map<GLint, GLint> locations;
+		};
+
+		struct TextureLevelSnapshot {
+			int width = 0;
+			int height = 0;
+			GLenum internalFormat = 0;
+			//uncompressed levels are read back and replayed as rgba8
+			bool compressed = false;
+			std::string data;
+		};
+
+		struct TextureSnapshot {
+			GLint baseLevel = 0;
+			GLint maxLevel = 1000;
+			GLint minFilter = GL_LINEAR;
+			GLint magFilter = GL_LINEAR;
+			GLint wrapS = GL_REPEAT;
+			GLint wrapT = GL_REPEAT;
+			//a level of width 0 was not specified, e.g. a mip the streamer evicted
+			std::vector<TextureLevelSnapshot> levels;
+			GLuint replayID = 0;
+		};
+
+		struct AttributeSnapshot {
+			GLuint index = 0;
+			GLint size = 0;
+			GLenum type = GL_FLOAT;
+			bool normalized = false;
+			bool integer = false;
+			GLsizei stride = 0;
+			uint64_t offset = 0;
+			uint32_t buffer = 0;
+		};
+
+		struct VertexArraySnapshot {
+			std::vector<AttributeSnapshot> attributes;
+			uint32_t elementBuffer = 0;
+			GLuint replayID = 0;
+		};
+
+		struct BufferSnapshot {
+			std::string data;
+			GLuint replayID = 0;
+		};
+
+		template<typename T>
+		void Write(std::vector<uint8_t>& stream, const T& value);
+		void WriteOp(Op op);
+
+		//resource index of a gl object, snapshots it the first time, kNone for object 0
+		uint32_t CaptureProgram(GLuint program);
+		uint32_t CaptureTexture(GLuint texture);
+		uint32_t CaptureVertexArray(GLuint vertexArray);
+		uint32_t CaptureBuffer(GLuint buffer);
+		void Clear();
+		//texture levels hold as many bytes as their size says and vertex arrays name loaded buffers
+		bool ValidateResources() const;
+		//every op fits in the stream, every index it holds names a loaded resource and every draw stays inside
+		//the buffers it reads, Load rejects the file otherwise
+		bool ValidateCommands() const;
+
+		static thread_local GLTrace* s_active;
+
+		int m_width = 0;
+		int m_height = 0;
+		bool m_capturing = false;
+		std::vector<uint8_t> m_commands;
+		std::vector<ProgramSnapshot> m_programs;
+		std::vector<TextureSnapshot> m_textures;
+		std::vector<VertexArraySnapshot> m_vertexArrays;
+		std::vector<BufferSnapshot> m_buffers;
+		GLTraceStats m_stats;
+
+		//gl object to resource index, only while capturing
+		std::unordered_map<GLuint, uint32_t> m_programIndices;
+		std::unordered_map<GLuint, uint32_t> m_textureIndices;
+		std::unordered_map<GLuint, uint32_t> m_vertexArrayIndices;
+		std::unordered_map<GLuint, uint32_t> m_bufferIndices;
+
+		//m_commands with the replay objects and uniform locations filled in by PrepareReplay
+		std::vector<uint8_t> m_replayCommands;
+		bool m_prepared = false;
+	};
+}
@@ -0,0 +1,72 @@
+#include "graphics/GpuTimer.h"
+
+namespace eng {
+
+	GpuTimer::~GpuTimer() {
+		Destroy();
+	}
+
+	void GpuTimer::Begin() {
+		if (m_running) {
+			return;
+		}
+		if (!m_queries[0]) {
+			glGenQueries(QueryCount, m_queries);
+		}
+		Collect();
+		//a gpu more than QueryCount frames behind loses that measurement rather than stalling the cpu
+		m_pending[m_next] = false;
+		glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+		m_running = true;
+	}
+
+	void GpuTimer::End() {
+		if (!m_running) {
+			return;
+		}
+		glEndQuery(GL_TIME_ELAPSED);
+		m_pending[m_next] = true;
+		m_next = (m_next + 1) % QueryCount;
+		m_running = false;
+	}
+
+	float GpuTimer::GetMilliseconds() const {
+		return m_milliseconds;
+	}
+
+	void GpuTimer::Destroy() {
+		if (m_running) {
+			glEndQuery(GL_TIME_ELAPSED);
+			m_running = false;
+		}
+		if (m_queries[0]) {
+			glDeleteQueries(QueryCount, m_queries);
+			for (int i = 0; i < QueryCount; ++i) {
+				m_queries[i] = 0;
+				m_pending[i] = false;
+			}
+		}
+		m_next = 0;
+		m_milliseconds = 0.0f;
+	}
+
+	void GpuTimer::Collect() {
+		//m_next is the oldest query, the rest follow in submission order
+		for (int i = 0; i < QueryCount; ++i) {
+			int query = (m_next + i) % QueryCount;
+			if (!m_pending[query]) {
+				continue;
+			}
+			GLint available = 0;
+			glGetQueryObjectiv(m_queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				//later queries cannot be done before this one
+				break;
+			}
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(m_queries[query], GL_QUERY_RESULT, &nanoseconds);
+			m_milliseconds = static_cast<float>(static_cast<double>(nanoseconds) * 1e-6);
+			m_pending[query] = false;
+		}
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <GL/glew.h>
+
+namespace eng {
+
+	//measures the gpu time between Begin and End with timer queries
+	//a few queries rotate so results are read once the gpu is done with them and nothing ever waits on it
+	class GpuTimer {
+	public:
+		GpuTimer() = default;
+		GpuTimer(const GpuTimer&) = delete;
+		GpuTimer& operator=(const GpuTimer&) = delete;
+		~GpuTimer();
+
+		//needs a current context, time elapsed queries do not nest so only one timer can be running
+		void Begin();
+		void End();
+		//newest finished measurement, usually two or three frames old, 0 before the first one
+		float GetMilliseconds() const;
+		void Destroy();
+
+	private:
+		static constexpr int QueryCount = 4;
+
+		//reads every finished query, oldest first
+		void Collect();
+
+		GLuint m_queries[QueryCount] = { 0 };
+		bool m_pending[QueryCount] = { false };
+		int m_next = 0;
+		bool m_running = false;
+		float m_milliseconds = 0.0f;
+	};
+}
@@ -1,11 +1,40 @@
 #include "graphics/GraphicsAPI.h"
+#include "log/Log.h"
 #include "graphics/ShaderProgram.h"
+#include "graphics/GLTrace.h"
+#include "graphics/Texture.h"
+#include "graphics/Mesh.h"
 #include "render/Material.h"
-#include <iostream>
+#include "render/ClusteredLighting.h"
+#include "memory/MemoryPool.h"
+#include "memory/MemoryTracker.h"
 namespace eng {
 
 	std::shared_ptr<ShaderProgram> GraphicsAPI::CreateShaderProgram(const std::string& vertexSource, const std::string& fragmentSource) {
 
+        GLuint shaderProgramID = CompileShaderProgram(vertexSource, fragmentSource);
+        if (shaderProgramID == 0) {
+            return nullptr;
+        }
+
+        //after successful compilation and linking wrap the resulting program id into shader program object and return it from the pool
+        return MakePooled<ShaderProgram>(shaderProgramID);
+	}
+    GLuint GraphicsAPI::CompileShaderProgram(const std::string& vertexSource, const std::string& fragmentSource) {
+        //the compiler caches state across programs that lives until the process exits
+        MemoryTagScope driverScope(MemoryTag::Untagged);
+
+        uint64_t sourceHash = 0;
+        if (m_programBinaryCache.IsEnabled()) {
+            sourceHash = ProgramBinaryCache::HashSources(vertexSource, fragmentSource);
+            GLuint cachedProgramID = m_programBinaryCache.Load(sourceHash);
+            if (cachedProgramID != 0) {
+                //a binary comes back with default uniform values and block bindings like a fresh link
+                ClusteredLighting::SetupProgram(cachedProgramID);
+                return cachedProgramID;
+            }
+        }
+
         //create shader in graphics card
         //compile vertex shader
         GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -21,8 +50,9 @@ namespace eng {
         {
             char infoLog[512];
             glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-            std::cerr << "ERROR:VERTEX_SHADER_COMPILATION_FAILED: " << infoLog << std::endl;
-            return nullptr;
+            LOG_ERROR(Graphics, "VERTEX_SHADER_COMPILATION_FAILED: {}", infoLog);
+            glDeleteShader(vertexShader);
+            return 0;
         }
         //compile fragment shader
         GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -36,8 +66,10 @@ namespace eng {
         {
             char infoLog[512];
             glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-            std::cerr << "ERROR:FRAGMENT_SHADER_COMPILATION_FAILED: " << infoLog << std::endl;
-            return nullptr;
+            LOG_ERROR(Graphics, "FRAGMENT_SHADER_COMPILATION_FAILED: {}", infoLog);
+            glDeleteShader(vertexShader);
+            glDeleteShader(fragmentShader);
+            return 0;
         }
 
         //combine vertex and fragment shaders into a single shader program
@@ -45,6 +77,9 @@ namespace eng {
         GLuint shaderProgramID = glCreateProgram();
         glAttachShader(shaderProgramID, vertexShader);
         glAttachShader(shaderProgramID, fragmentShader);
+        if (m_programBinaryCache.IsEnabled()) {
+            glProgramParameteri(shaderProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         glLinkProgram(shaderProgramID);
 
         //check link status check for errors
@@ -54,8 +89,11 @@ namespace eng {
         {
             char infoLog[512];
             glGetProgramInfoLog(shaderProgramID, 512, NULL, infoLog);
-            std::cerr << "ERROR:SHADER_PROGRAM_LINKING_FAILED: " << infoLog << std::endl;
-            return nullptr;
+            LOG_ERROR(Graphics, "SHADER_PROGRAM_LINKING_FAILED: {}", infoLog);
+            glDeleteShader(vertexShader);
+            glDeleteShader(fragmentShader);
+            glDeleteProgram(shaderProgramID);
+            return 0;
         }
 
         //once the shader program has successfully linked we no longer need the individual shader objects
@@ -63,10 +101,21 @@ namespace eng {
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
 
-        //after successful compilation and linking wrap the resulting program id into shader program object and return via make shared
-        return std::make_shared<ShaderProgram>(shaderProgramID);
+        if (m_programBinaryCache.IsEnabled()) {
+            m_programBinaryCache.Store(sourceHash, shaderProgramID);
+        }
+        //programs including the clustered lights read them from fixed units, rebuilt programs included
+        ClusteredLighting::SetupProgram(shaderProgramID);
+        return shaderProgramID;
+    }
+    std::shared_ptr<Mesh> GraphicsAPI::CreateMesh(const MeshData& data) {
 
-	}
+        if (data.vertices.empty() || data.indices.empty()) {
+            LOG_ERROR(Graphics, "MESH_EMPTY");
+            return nullptr;
+        }
+        return MakePooled<Mesh>(data);
+    }
     void GraphicsAPI::BindShaderProgram(ShaderProgram* shaderProgram) {
 
         if (shaderProgram) {
@@ -80,5 +129,36 @@ namespace eng {
             material->Bind();
         }
     }
+    void GraphicsAPI::BindTexture(Texture* texture, int unit) {
+
+        if (texture) {
+            texture->Bind(unit);
+        }
+    }
+    ProgramBinaryCache& GraphicsAPI::GetProgramBinaryCache() {
+
+        return m_programBinaryCache;
+    }
+    void GraphicsAPI::BindVertexArray(GLuint vertexArray) {
+
+        glBindVertexArray(vertexArray);
+        if (GLTrace* trace = GLTrace::GetActive()) {
+            trace->OnBindVertexArray(vertexArray);
+        }
+    }
+    void GraphicsAPI::DrawArrays(GLenum mode, GLint first, GLsizei count) {
+
+        glDrawArrays(mode, first, count);
+        if (GLTrace* trace = GLTrace::GetActive()) {
+            trace->OnDrawArrays(mode, first, count);
+        }
+    }
+    void GraphicsAPI::DrawElements(GLenum mode, GLsizei count, GLenum indexType, size_t offset) {
+
+        glDrawElements(mode, count, indexType, reinterpret_cast<const void*>(offset));
+        if (GLTrace* trace = GLTrace::GetActive()) {
+            trace->OnDrawElements(mode, count, indexType, offset);
+        }
+    }
 
 }
\ No newline at end of file
@@ -1,19 +1,39 @@
 #pragma once
 //this will serve as the centralized interface for rending operations
 #include "GL/glew.h"
+#include "graphics/ProgramBinaryCache.h"
 #include <memory>
 #include <string>
 namespace eng {
 
 	class ShaderProgram;
 	class Material;
+	class Texture;
+	class Mesh;
+	struct MeshData;
 	class GraphicsAPI {
 
 	public:
 		//this will receive the source code for vertex and fragment shader compile them, link them to shader program and return new shader program instance
 		std::shared_ptr<ShaderProgram> CreateShaderProgram(const std::string& vertexSource, const std::string& fragmentSource);
+		//same as above but hands back the raw program id, 0 on failure. used when a program is rebuilt in place
+		//with the binary cache on, sources that were linked before come straight from their cached binary
+		GLuint CompileShaderProgram(const std::string& vertexSource, const std::string& fragmentSource);
+		//uploads the vertices and every lod of a cooked mesh
+		std::shared_ptr<Mesh> CreateMesh(const MeshData& data);
 	
 		void BindShaderProgram(ShaderProgram* shaderProgram);
 		void BindMaterial(Material* material);
+		void BindTexture(Texture* texture, int unit);
+		//draw calls go through here so a gl trace sees them
+		void BindVertexArray(GLuint vertexArray);
+		void DrawArrays(GLenum mode, GLint first, GLsizei count);
+		//offset is in bytes into the bound element buffer
+		void DrawElements(GLenum mode, GLsizei count, GLenum indexType, size_t offset);
+
+		ProgramBinaryCache& GetProgramBinaryCache();
+
+	private:
+		ProgramBinaryCache m_programBinaryCache;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "graphics/HeadlessContext.h"
+#include "log/Log.h"
+
+#if ENG_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace eng {
+
+	HeadlessContext::~HeadlessContext() {
+		Destroy();
+	}
+
+#if ENG_HEADLESS_EGL
+	bool HeadlessContext::Create() {
+		if (IsValid()) {
+			return true;
+		}
+
+		//the surfaceless platform needs neither x11 nor a render node, the default display is the fallback for other egl stacks
+		EGLDisplay display = EGL_NO_DISPLAY;
+		auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+		if (getPlatformDisplay) {
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+		EGLint major = 0;
+		EGLint minor = 0;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+			if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+				LOG_ERROR(Graphics, "HEADLESS_CONTEXT: no egl display, error 0x{:x}", eglGetError());
+				return false;
+			}
+		}
+		m_display = display;
+
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			LOG_ERROR(Graphics, "HEADLESS_CONTEXT: egl {}.{} has no desktop gl", major, minor);
+			Destroy();
+			return false;
+		}
+
+		//only the pbuffer bit, the default asks for window surfaces which a surfaceless display has none of
+		const EGLint configAttributes[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8,
+			EGL_GREEN_SIZE, 8,
+			EGL_BLUE_SIZE, 8,
+			EGL_ALPHA_SIZE, 8,
+			EGL_NONE
+		};
+		EGLConfig config = nullptr;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+			LOG_ERROR(Graphics, "HEADLESS_CONTEXT: no desktop gl config");
+			Destroy();
+			return false;
+		}
+		m_config = config;
+
+		//same version and profile the windowed path asks glfw for
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 3,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT) {
+			LOG_ERROR(Graphics, "HEADLESS_CONTEXT: cannot create a gl 3.3 core context, error 0x{:x}", eglGetError());
+			Destroy();
+			return false;
+		}
+		m_context = context;
+
+		//without EGL_KHR_surfaceless_context the context still needs some surface, a tiny pbuffer does
+		if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+			const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+			EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+			if (surface == EGL_NO_SURFACE || !eglMakeCurrent(display, surface, surface, context)) {
+				LOG_ERROR(Graphics, "HEADLESS_CONTEXT: cannot make the context current, error 0x{:x}", eglGetError());
+				if (surface != EGL_NO_SURFACE) {
+					eglDestroySurface(display, surface);
+				}
+				Destroy();
+				return false;
+			}
+			m_surface = surface;
+		}
+		return true;
+	}
+
+	bool HeadlessContext::CreateShared(const HeadlessContext& main) {
+		if (IsValid() || !main.IsValid()) {
+			return IsValid();
+		}
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 3,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		EGLContext context = eglCreateContext(main.m_display, main.m_config, main.m_context, contextAttributes);
+		if (context == EGL_NO_CONTEXT) {
+			LOG_ERROR(Graphics, "HEADLESS_CONTEXT: cannot create a shared context, error 0x{:x}", eglGetError());
+			return false;
+		}
+		m_display = main.m_display;
+		m_config = main.m_config;
+		m_context = context;
+		m_ownsDisplay = false;
+
+		//the main context needed a pbuffer, so will this one
+		if (main.m_surface) {
+			const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+			EGLSurface surface = eglCreatePbufferSurface(m_display, m_config, surfaceAttributes);
+			if (surface == EGL_NO_SURFACE) {
+				LOG_ERROR(Graphics, "HEADLESS_CONTEXT: cannot create a pbuffer for the shared context, error 0x{:x}", eglGetError());
+				Destroy();
+				return false;
+			}
+			m_surface = surface;
+		}
+		return true;
+	}
+
+	bool HeadlessContext::MakeCurrent() {
+		if (!IsValid()) {
+			return false;
+		}
+		EGLSurface surface = m_surface ? m_surface : EGL_NO_SURFACE;
+		if (!eglMakeCurrent(m_display, surface, surface, m_context)) {
+			LOG_ERROR(Graphics, "HEADLESS_CONTEXT: cannot make the context current, error 0x{:x}", eglGetError());
+			return false;
+		}
+		return true;
+	}
+
+	void HeadlessContext::ReleaseCurrent() {
+		if (m_display) {
+			eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		}
+	}
+
+	void HeadlessContext::Destroy() {
+		if (!m_display) {
+			return;
+		}
+		//a shared context belongs to another thread, releasing here would take the main context away from this one
+		if (m_ownsDisplay) {
+			eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		}
+		if (m_surface) {
+			eglDestroySurface(m_display, m_surface);
+			m_surface = nullptr;
+		}
+		if (m_context) {
+			eglDestroyContext(m_display, m_context);
+			m_context = nullptr;
+		}
+		if (m_ownsDisplay) {
+			eglTerminate(m_display);
+		}
+		m_display = nullptr;
+		m_config = nullptr;
+		m_ownsDisplay = true;
+	}
+
+	bool HeadlessContext::IsSupported() {
+		return true;
+	}
+#else
+	bool HeadlessContext::Create() {
+		LOG_ERROR(Graphics, "HEADLESS_CONTEXT: the engine was built without egl");
+		return false;
+	}
+
+	bool HeadlessContext::CreateShared(const HeadlessContext&) {
+		return false;
+	}
+
+	bool HeadlessContext::MakeCurrent() {
+		return false;
+	}
+
+	void HeadlessContext::ReleaseCurrent() {
+	}
+
+	void HeadlessContext::Destroy() {
+	}
+
+	bool HeadlessContext::IsSupported() {
+		return false;
+	}
+#endif
+
+	bool HeadlessContext::IsValid() const {
+		return m_context != nullptr;
+	}
+}
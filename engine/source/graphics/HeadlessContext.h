@@ -0,0 +1,37 @@
+#pragma once
+
+namespace eng {
+
+	//an off-screen gl 3.3 core context without window, display server or gpu
+	//made through egl on mesa's surfaceless platform, which renders with llvmpipe when there is no gpu
+	//there is no default framebuffer to draw into, pair it with a Framebuffer
+	class HeadlessContext {
+	public:
+		HeadlessContext() = default;
+		HeadlessContext(const HeadlessContext&) = delete;
+		HeadlessContext& operator=(const HeadlessContext&) = delete;
+		~HeadlessContext();
+
+		//creates the context and makes it current on the calling thread
+		bool Create();
+		//a context sharing objects with main for another thread, it is not current anywhere until MakeCurrent
+		bool CreateShared(const HeadlessContext& main);
+		//on the calling thread
+		bool MakeCurrent();
+		void ReleaseCurrent();
+		//a shared context has to be released by its thread first and destroyed before main
+		void Destroy();
+		bool IsValid() const;
+		//false when the engine was built without egl
+		static bool IsSupported();
+
+	private:
+		//egl handles, kept opaque so the egl headers stay out of the engine headers
+		void* m_display = nullptr;
+		void* m_config = nullptr;
+		void* m_context = nullptr;
+		void* m_surface = nullptr;
+		//shared contexts borrow the display of the main one
+		bool m_ownsDisplay = true;
+	};
+}
@@ -0,0 +1,757 @@
+#include "graphics/Image.h"
+#include "log/Log.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace eng {
+
+	namespace {
+
+		const uint8_t kPNGSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		const uint32_t kRawMagic = 0x41424752; //"RGBA"
+		//8192 x 8192, the header of a broken or hostile file must not decide how much memory gets reserved
+		const size_t kMaxPNGPixels = size_t(1) << 26;
+
+		//deflate length and distance symbols, base value and extra bits
+		const uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		const uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		const uint16_t kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		const uint8_t kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		const size_t kWindowSize = 32768;
+		const size_t kMaxMatch = 258;
+		const int kMaxChainLength = 32;
+		const int kHashBits = 15;
+
+		uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+			static const struct Table {
+				uint32_t values[256];
+				Table() {
+					for (uint32_t i = 0; i < 256; ++i) {
+						uint32_t value = i;
+						for (int bit = 0; bit < 8; ++bit) {
+							value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+						}
+						values[i] = value;
+					}
+				}
+			} table;
+			crc = ~crc;
+			for (size_t i = 0; i < size; ++i) {
+				crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+			}
+			return ~crc;
+		}
+
+		uint32_t Adler32(const uint8_t* data, size_t size) {
+			uint32_t a = 1;
+			uint32_t b = 0;
+			while (size > 0) {
+				//largest run that cannot overflow before the modulo
+				size_t run = std::min<size_t>(size, 5552);
+				for (size_t i = 0; i < run; ++i) {
+					a += data[i];
+					b += a;
+				}
+				a %= 65521;
+				b %= 65521;
+				data += run;
+				size -= run;
+			}
+			return (b << 16) | a;
+		}
+
+		void AppendU32(std::string& out, uint32_t value) {
+			out.push_back(char(value >> 24));
+			out.push_back(char(value >> 16));
+			out.push_back(char(value >> 8));
+			out.push_back(char(value));
+		}
+
+		uint32_t ReadU32(const uint8_t* data) {
+			return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+		}
+
+		//deflate packs bits starting at the least significant one, huffman codes go most significant bit first
+		class BitWriter {
+		public:
+			explicit BitWriter(std::string& out) : m_out(out) {}
+
+			void Write(uint32_t bits, int count) {
+				m_buffer |= bits << m_count;
+				m_count += count;
+				while (m_count >= 8) {
+					m_out.push_back(char(m_buffer & 0xFF));
+					m_buffer >>= 8;
+					m_count -= 8;
+				}
+			}
+			void WriteCode(uint32_t code, int length) {
+				uint32_t reversed = 0;
+				for (int i = 0; i < length; ++i) {
+					reversed = (reversed << 1) | ((code >> i) & 1);
+				}
+				Write(reversed, length);
+			}
+			void Flush() {
+				if (m_count > 0) {
+					m_out.push_back(char(m_buffer & 0xFF));
+				}
+				m_buffer = 0;
+				m_count = 0;
+			}
+
+		private:
+			std::string& m_out;
+			uint32_t m_buffer = 0;
+			int m_count = 0;
+		};
+
+		//the fixed huffman code of the deflate spec
+		void WriteFixedLiteral(BitWriter& writer, int symbol) {
+			if (symbol < 144) {
+				writer.WriteCode(0x30 + symbol, 8);
+			}
+			else if (symbol < 256) {
+				writer.WriteCode(0x190 + symbol - 144, 9);
+			}
+			else if (symbol < 280) {
+				writer.WriteCode(symbol - 256, 7);
+			}
+			else {
+				writer.WriteCode(0xC0 + symbol - 280, 8);
+			}
+		}
+
+		void WriteMatch(BitWriter& writer, size_t length, size_t distance) {
+			int lengthCode = 28;
+			while (kLengthBase[lengthCode] > length) {
+				--lengthCode;
+			}
+			WriteFixedLiteral(writer, 257 + lengthCode);
+			writer.Write(uint32_t(length - kLengthBase[lengthCode]), kLengthExtra[lengthCode]);
+
+			int distanceCode = 29;
+			while (kDistanceBase[distanceCode] > distance) {
+				--distanceCode;
+			}
+			writer.WriteCode(uint32_t(distanceCode), 5);
+			writer.Write(uint32_t(distance - kDistanceBase[distanceCode]), kDistanceExtra[distanceCode]);
+		}
+
+		//zlib stream of a single fixed huffman block, lz77 over hash chains
+		//rendered frames are mostly flat runs and repeated rows, which this already shrinks a lot
+		std::string Compress(const uint8_t* data, size_t size) {
+			std::string out;
+			out.push_back(char(0x78));
+			out.push_back(char(0x01));
+			BitWriter writer(out);
+			writer.Write(1, 1);
+			writer.Write(1, 2);
+
+			std::vector<int32_t> head(size_t(1) << kHashBits, -1);
+			std::vector<int32_t> previous(size, -1);
+			auto hash = [&](size_t i) {
+				uint32_t value = uint32_t(data[i]) | (uint32_t(data[i + 1]) << 8) | (uint32_t(data[i + 2]) << 16);
+				return (value * 2654435761u) >> (32 - kHashBits);
+			};
+			auto insert = [&](size_t i) {
+				if (i + 2 < size) {
+					uint32_t h = hash(i);
+					previous[i] = head[h];
+					head[h] = int32_t(i);
+				}
+			};
+
+			size_t i = 0;
+			while (i < size) {
+				size_t bestLength = 0;
+				size_t bestDistance = 0;
+				if (i + 2 < size) {
+					size_t maxLength = std::min(kMaxMatch, size - i);
+					int32_t candidate = head[hash(i)];
+					for (int chain = 0; candidate >= 0 && i - size_t(candidate) <= kWindowSize && chain < kMaxChainLength; ++chain) {
+						const uint8_t* a = data + candidate;
+						const uint8_t* b = data + i;
+						size_t length = 0;
+						while (length < maxLength && a[length] == b[length]) {
+							++length;
+						}
+						if (length > bestLength) {
+							bestLength = length;
+							bestDistance = i - size_t(candidate);
+							if (length == maxLength) {
+								break;
+							}
+						}
+						candidate = previous[candidate];
+					}
+				}
+
+				if (bestLength >= 3) {
+					WriteMatch(writer, bestLength, bestDistance);
+					for (size_t k = 0; k < bestLength; ++k) {
+						insert(i + k);
+					}
+					i += bestLength;
+				}
+				else {
+					WriteFixedLiteral(writer, data[i]);
+					insert(i);
+					++i;
+				}
+			}
+			WriteFixedLiteral(writer, 256);
+			writer.Flush();
+			AppendU32(out, Adler32(data, size));
+			return out;
+		}
+
+		class BitReader {
+		public:
+			BitReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+			uint32_t Read(int count) {
+				uint64_t value = m_buffer;
+				while (m_count < count) {
+					if (m_position >= m_size) {
+						m_error = true;
+						return 0;
+					}
+					value |= uint64_t(m_data[m_position++]) << m_count;
+					m_count += 8;
+				}
+				m_buffer = uint32_t(value >> count);
+				m_count -= count;
+				return uint32_t(value & ((uint64_t(1) << count) - 1));
+			}
+			void AlignToByte() {
+				m_buffer = 0;
+				m_count = 0;
+			}
+			bool ReadBytes(std::vector<uint8_t>& out, size_t count) {
+				if (m_size - m_position < count) {
+					m_error = true;
+					return false;
+				}
+				out.insert(out.end(), m_data + m_position, m_data + m_position + count);
+				m_position += count;
+				return true;
+			}
+			bool HasError() const { return m_error; }
+
+		private:
+			const uint8_t* m_data;
+			size_t m_size;
+			size_t m_position = 0;
+			uint32_t m_buffer = 0;
+			int m_count = 0;
+			bool m_error = false;
+		};
+
+		//canonical huffman code as code counts per length and the symbols in code order
+		struct Huffman {
+			uint16_t counts[16];
+			uint16_t symbols[288];
+		};
+
+		bool BuildHuffman(Huffman& huffman, const uint8_t* lengths, int count) {
+			std::memset(huffman.counts, 0, sizeof(huffman.counts));
+			for (int i = 0; i < count; ++i) {
+				++huffman.counts[lengths[i]];
+			}
+			huffman.counts[0] = 0;
+			//more codes of a length than the tree has room for
+			int left = 1;
+			for (int length = 1; length < 16; ++length) {
+				left = (left << 1) - huffman.counts[length];
+				if (left < 0) {
+					return false;
+				}
+			}
+			uint16_t offsets[16];
+			offsets[1] = 0;
+			for (int length = 1; length < 15; ++length) {
+				offsets[length + 1] = offsets[length] + huffman.counts[length];
+			}
+			for (int i = 0; i < count; ++i) {
+				if (lengths[i] != 0) {
+					huffman.symbols[offsets[lengths[i]]++] = uint16_t(i);
+				}
+			}
+			return true;
+		}
+
+		int DecodeSymbol(BitReader& reader, const Huffman& huffman) {
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (int length = 1; length < 16; ++length) {
+				code |= int(reader.Read(1));
+				int count = huffman.counts[length];
+				if (code - first < count) {
+					return huffman.symbols[index + code - first];
+				}
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+
+		//out never grows past limit, a stream that wants more is treated as corrupt
+		bool InflateBlock(BitReader& reader, std::vector<uint8_t>& out, size_t limit, const Huffman& literals, const Huffman& distances) {
+			while (true) {
+				int symbol = DecodeSymbol(reader, literals);
+				if (symbol < 0 || reader.HasError()) {
+					return false;
+				}
+				if (symbol < 256) {
+					if (out.size() >= limit) {
+						return false;
+					}
+					out.push_back(uint8_t(symbol));
+					continue;
+				}
+				if (symbol == 256) {
+					return true;
+				}
+				symbol -= 257;
+				if (symbol >= 29) {
+					return false;
+				}
+				size_t length = kLengthBase[symbol] + reader.Read(kLengthExtra[symbol]);
+				int distanceSymbol = DecodeSymbol(reader, distances);
+				if (distanceSymbol < 0 || distanceSymbol >= 30) {
+					return false;
+				}
+				size_t distance = kDistanceBase[distanceSymbol] + reader.Read(kDistanceExtra[distanceSymbol]);
+				if (distance > out.size() || out.size() + length > limit || reader.HasError()) {
+					return false;
+				}
+				//the source may overlap what is being written, so byte by byte
+				size_t from = out.size() - distance;
+				for (size_t i = 0; i < length; ++i) {
+					out.push_back(out[from + i]);
+				}
+			}
+		}
+
+		bool Inflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t limit) {
+			static const uint8_t kCodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+			BitReader reader(data, size);
+			bool last = false;
+			while (!last) {
+				last = reader.Read(1) != 0;
+				uint32_t type = reader.Read(2);
+				if (type == 0) {
+					reader.AlignToByte();
+					std::vector<uint8_t> header;
+					if (!reader.ReadBytes(header, 4)) {
+						return false;
+					}
+					uint16_t length = uint16_t(header[0] | (header[1] << 8));
+					uint16_t complement = uint16_t(header[2] | (header[3] << 8));
+					if (length != uint16_t(~complement) || out.size() + length > limit || !reader.ReadBytes(out, length)) {
+						return false;
+					}
+				}
+				else if (type == 1) {
+					static const struct Fixed {
+						Huffman literals;
+						Huffman distances;
+						Fixed() {
+							uint8_t lengths[288];
+							std::fill(lengths, lengths + 144, uint8_t(8));
+							std::fill(lengths + 144, lengths + 256, uint8_t(9));
+							std::fill(lengths + 256, lengths + 280, uint8_t(7));
+							std::fill(lengths + 280, lengths + 288, uint8_t(8));
+							BuildHuffman(literals, lengths, 288);
+							std::fill(lengths, lengths + 30, uint8_t(5));
+							BuildHuffman(distances, lengths, 30);
+						}
+					} fixed;
+					if (!InflateBlock(reader, out, limit, fixed.literals, fixed.distances)) {
+						return false;
+					}
+				}
+				else if (type == 2) {
+					int literalCount = int(reader.Read(5)) + 257;
+					int distanceCount = int(reader.Read(5)) + 1;
+					int codeLengthCount = int(reader.Read(4)) + 4;
+					if (literalCount > 286 || distanceCount > 30) {
+						return false;
+					}
+					uint8_t lengths[320] = {};
+					for (int i = 0; i < codeLengthCount; ++i) {
+						lengths[kCodeLengthOrder[i]] = uint8_t(reader.Read(3));
+					}
+					Huffman codeLengths;
+					if (!BuildHuffman(codeLengths, lengths, 19)) {
+						return false;
+					}
+
+					int index = 0;
+					std::fill(lengths, lengths + 320, uint8_t(0));
+					while (index < literalCount + distanceCount) {
+						int symbol = DecodeSymbol(reader, codeLengths);
+						if (symbol < 0 || reader.HasError()) {
+							return false;
+						}
+						if (symbol < 16) {
+							lengths[index++] = uint8_t(symbol);
+							continue;
+						}
+						uint8_t value = 0;
+						int repeat = 0;
+						if (symbol == 16) {
+							if (index == 0) {
+								return false;
+							}
+							value = lengths[index - 1];
+							repeat = 3 + int(reader.Read(2));
+						}
+						else if (symbol == 17) {
+							repeat = 3 + int(reader.Read(3));
+						}
+						else {
+							repeat = 11 + int(reader.Read(7));
+						}
+						if (index + repeat > literalCount + distanceCount) {
+							return false;
+						}
+						std::fill(lengths + index, lengths + index + repeat, value);
+						index += repeat;
+					}
+
+					Huffman literals;
+					Huffman distances;
+					if (!BuildHuffman(literals, lengths, literalCount) || !BuildHuffman(distances, lengths + literalCount, distanceCount)) {
+						return false;
+					}
+					if (!InflateBlock(reader, out, limit, literals, distances)) {
+						return false;
+					}
+				}
+				else {
+					return false;
+				}
+				if (reader.HasError()) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		uint8_t Paeth(int a, int b, int c) {
+			int p = a + b - c;
+			int pa = std::abs(p - a);
+			int pb = std::abs(p - b);
+			int pc = std::abs(p - c);
+			if (pa <= pb && pa <= pc) {
+				return uint8_t(a);
+			}
+			return uint8_t(pb <= pc ? b : c);
+		}
+
+		//filters one row into out, prior is the unfiltered row above or nullptr for the first one
+		void FilterRow(int filter, const uint8_t* row, const uint8_t* prior, size_t size, size_t bytesPerPixel, uint8_t* out) {
+			for (size_t i = 0; i < size; ++i) {
+				int left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+				int up = prior ? prior[i] : 0;
+				int upLeft = prior && i >= bytesPerPixel ? prior[i - bytesPerPixel] : 0;
+				int predicted = 0;
+				switch (filter) {
+				case 1: predicted = left; break;
+				case 2: predicted = up; break;
+				case 3: predicted = (left + up) / 2; break;
+				case 4: predicted = Paeth(left, up, upLeft); break;
+				default: break;
+				}
+				out[i] = uint8_t(row[i] - predicted);
+			}
+		}
+
+		bool UnfilterRow(int filter, uint8_t* row, const uint8_t* prior, size_t size, size_t bytesPerPixel) {
+			if (filter > 4) {
+				return false;
+			}
+			for (size_t i = 0; i < size; ++i) {
+				int left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+				int up = prior ? prior[i] : 0;
+				int upLeft = prior && i >= bytesPerPixel ? prior[i - bytesPerPixel] : 0;
+				int predicted = 0;
+				switch (filter) {
+				case 1: predicted = left; break;
+				case 2: predicted = up; break;
+				case 3: predicted = (left + up) / 2; break;
+				case 4: predicted = Paeth(left, up, upLeft); break;
+				default: break;
+				}
+				row[i] = uint8_t(row[i] + predicted);
+			}
+			return true;
+		}
+
+		void AppendChunk(std::string& out, const char* type, const std::string& data) {
+			AppendU32(out, uint32_t(data.size()));
+			std::string typed(type, 4);
+			typed += data;
+			out += typed;
+			AppendU32(out, Crc32(reinterpret_cast<const uint8_t*>(typed.data()), typed.size()));
+		}
+
+		bool ReadFile(const std::string& path, std::string& bytes) {
+			std::ifstream file(path, std::ios::binary);
+			if (!file) {
+				return false;
+			}
+			std::stringstream stream;
+			stream << file.rdbuf();
+			bytes = stream.str();
+			return true;
+		}
+
+		bool HasExtension(const std::string& path, const char* extension) {
+			size_t length = std::strlen(extension);
+			if (path.size() < length) {
+				return false;
+			}
+			return std::equal(extension, extension + length, path.end() - length, [](char a, char b) {
+				return a == std::tolower(static_cast<unsigned char>(b));
+			});
+		}
+	}
+
+	bool Image::IsEmpty() const {
+		return width <= 0 || height <= 0 || rgba.size() != size_t(width) * size_t(height) * 4;
+	}
+
+	bool SaveImage(const std::string& path, const Image& image) {
+		if (image.IsEmpty()) {
+			LOG_ERROR(Graphics, "IMAGE: nothing to save to {}", path);
+			return false;
+		}
+		if (HasExtension(path, ".png")) {
+			return WritePNG(path, image);
+		}
+		if (HasExtension(path, ".rgba")) {
+			std::ofstream file(path, std::ios::binary);
+			if (!file) {
+				LOG_ERROR(Graphics, "IMAGE: cannot write {}", path);
+				return false;
+			}
+			uint32_t header[4] = { kRawMagic, uint32_t(image.width), uint32_t(image.height), 0 };
+			file.write(reinterpret_cast<const char*>(header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(image.rgba.data()), std::streamsize(image.rgba.size()));
+			return bool(file);
+		}
+		LOG_ERROR(Graphics, "IMAGE: {} is neither .png nor .rgba", path);
+		return false;
+	}
+
+	bool LoadImage(const std::string& path, Image& image) {
+		std::string bytes;
+		if (!ReadFile(path, bytes)) {
+			LOG_ERROR(Graphics, "IMAGE: cannot read {}", path);
+			return false;
+		}
+		if (HasExtension(path, ".rgba")) {
+			uint32_t header[4];
+			if (bytes.size() < sizeof(header)) {
+				LOG_ERROR(Graphics, "IMAGE: {} is truncated", path);
+				return false;
+			}
+			std::memcpy(header, bytes.data(), sizeof(header));
+			size_t pixelBytes = size_t(header[1]) * size_t(header[2]) * 4;
+			if (header[0] != kRawMagic || bytes.size() - sizeof(header) != pixelBytes) {
+				LOG_ERROR(Graphics, "IMAGE: {} is not a raw rgba capture", path);
+				return false;
+			}
+			image.width = int(header[1]);
+			image.height = int(header[2]);
+			image.rgba.assign(bytes.begin() + sizeof(header), bytes.end());
+			return true;
+		}
+		if (!ReadPNG(bytes, image)) {
+			LOG_ERROR(Graphics, "IMAGE: cannot decode {}", path);
+			return false;
+		}
+		return true;
+	}
+
+	bool WritePNG(const std::string& path, const Image& image) {
+		if (image.IsEmpty()) {
+			return false;
+		}
+		//every row gets the filter with the smallest sum of absolute residuals, the usual heuristic
+		size_t rowSize = size_t(image.width) * 4;
+		std::vector<uint8_t> filtered((rowSize + 1) * size_t(image.height));
+		std::vector<uint8_t> candidate(rowSize);
+		for (int y = 0; y < image.height; ++y) {
+			const uint8_t* row = image.rgba.data() + size_t(y) * rowSize;
+			const uint8_t* prior = y > 0 ? row - rowSize : nullptr;
+			uint8_t* out = filtered.data() + size_t(y) * (rowSize + 1);
+			uint64_t bestCost = UINT64_MAX;
+			for (int filter = 0; filter <= 4; ++filter) {
+				FilterRow(filter, row, prior, rowSize, 4, candidate.data());
+				uint64_t cost = 0;
+				for (uint8_t value : candidate) {
+					cost += value < 128 ? value : 256 - value;
+				}
+				if (cost < bestCost) {
+					bestCost = cost;
+					out[0] = uint8_t(filter);
+					std::memcpy(out + 1, candidate.data(), rowSize);
+				}
+			}
+		}
+
+		std::string header;
+		AppendU32(header, uint32_t(image.width));
+		AppendU32(header, uint32_t(image.height));
+		//8 bit rgba, deflate, adaptive filtering, no interlacing
+		header += std::string("\x08\x06\x00\x00\x00", 5);
+
+		std::string out(reinterpret_cast<const char*>(kPNGSignature), sizeof(kPNGSignature));
+		AppendChunk(out, "IHDR", header);
+		AppendChunk(out, "IDAT", Compress(filtered.data(), filtered.size()));
+		AppendChunk(out, "IEND", std::string());
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file) {
+			LOG_ERROR(Graphics, "IMAGE: cannot write {}", path);
+			return false;
+		}
+		file.write(out.data(), std::streamsize(out.size()));
+		return bool(file);
+	}
+
+	bool ReadPNG(const std::string& bytes, Image& image) {
+		const auto* data = reinterpret_cast<const uint8_t*>(bytes.data());
+		if (bytes.size() < sizeof(kPNGSignature) || std::memcmp(data, kPNGSignature, sizeof(kPNGSignature)) != 0) {
+			return false;
+		}
+
+		uint32_t width = 0;
+		uint32_t height = 0;
+		int colorType = -1;
+		std::vector<uint8_t> compressed;
+		std::vector<uint8_t> palette;
+		std::vector<uint8_t> paletteAlpha;
+		size_t offset = sizeof(kPNGSignature);
+		while (bytes.size() - offset >= 12) {
+			uint32_t length = ReadU32(data + offset);
+			if (bytes.size() - offset - 12 < length) {
+				return false;
+			}
+			const char* type = reinterpret_cast<const char*>(data + offset + 4);
+			const uint8_t* chunk = data + offset + 8;
+			if (std::memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+				width = ReadU32(chunk);
+				height = ReadU32(chunk + 4);
+				int bitDepth = chunk[8];
+				colorType = chunk[9];
+				if (bitDepth != 8 || chunk[10] != 0 || chunk[11] != 0 || chunk[12] != 0) {
+					return false;
+				}
+			}
+			else if (std::memcmp(type, "PLTE", 4) == 0) {
+				palette.assign(chunk, chunk + length);
+			}
+			else if (std::memcmp(type, "tRNS", 4) == 0) {
+				paletteAlpha.assign(chunk, chunk + length);
+			}
+			else if (std::memcmp(type, "IDAT", 4) == 0) {
+				compressed.insert(compressed.end(), chunk, chunk + length);
+			}
+			else if (std::memcmp(type, "IEND", 4) == 0) {
+				break;
+			}
+			offset += 12 + size_t(length);
+		}
+
+		size_t channels = 0;
+		switch (colorType) {
+		case 0: channels = 1; break;
+		case 2: channels = 3; break;
+		case 3: channels = 1; break;
+		case 4: channels = 2; break;
+		case 6: channels = 4; break;
+		default: return false;
+		}
+		if (width == 0 || height == 0 || compressed.size() < 2 || (compressed[0] & 0x0F) != 8) {
+			return false;
+		}
+		if (size_t(width) * height > kMaxPNGPixels) {
+			LOG_ERROR(Graphics, "IMAGE: {}x{} png is larger than the supported {} pixels", width, height, kMaxPNGPixels);
+			return false;
+		}
+
+		//the zlib header is two bytes, the adler checksum at the end is not checked
+		size_t rowSize = size_t(width) * channels;
+		size_t rawSize = (rowSize + 1) * height;
+		std::vector<uint8_t> raw;
+		//deflate expands at most about 1032:1, a header promising more than the data can hold does not get its reservation
+		raw.reserve(std::min(rawSize, compressed.size() * 1032));
+		if (!Inflate(compressed.data() + 2, compressed.size() - 2, raw, rawSize)) {
+			return false;
+		}
+		if (raw.size() < rawSize) {
+			return false;
+		}
+
+		image.width = int(width);
+		image.height = int(height);
+		image.rgba.resize(size_t(width) * height * 4);
+		uint8_t* prior = nullptr;
+		for (uint32_t y = 0; y < height; ++y) {
+			uint8_t* row = raw.data() + size_t(y) * (rowSize + 1);
+			if (!UnfilterRow(row[0], row + 1, prior, rowSize, channels)) {
+				return false;
+			}
+			prior = row + 1;
+
+			uint8_t* out = image.rgba.data() + size_t(y) * width * 4;
+			for (uint32_t x = 0; x < width; ++x) {
+				const uint8_t* pixel = row + 1 + size_t(x) * channels;
+				uint8_t* target = out + size_t(x) * 4;
+				switch (colorType) {
+				case 0:
+					target[0] = target[1] = target[2] = pixel[0];
+					target[3] = 255;
+					break;
+				case 2:
+					target[0] = pixel[0];
+					target[1] = pixel[1];
+					target[2] = pixel[2];
+					target[3] = 255;
+					break;
+				case 3: {
+					size_t entry = pixel[0];
+					if (entry * 3 + 2 >= palette.size()) {
+						return false;
+					}
+					target[0] = palette[entry * 3];
+					target[1] = palette[entry * 3 + 1];
+					target[2] = palette[entry * 3 + 2];
+					target[3] = entry < paletteAlpha.size() ? paletteAlpha[entry] : 255;
+					break;
+				}
+				case 4:
+					target[0] = target[1] = target[2] = pixel[0];
+					target[3] = pixel[1];
+					break;
+				default:
+					std::memcpy(target, pixel, 4);
+					break;
+				}
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace eng {
+
+	//8 bit rgba pixels, top row first
+	struct Image {
+		int width = 0;
+		int height = 0;
+		std::vector<uint8_t> rgba;
+
+		bool IsEmpty() const;
+	};
+
+	//.png or raw .rgba, picked by the extension of path
+	//a .rgba file is a 16 byte header ("RGBA", width, height, 0 as little endian uint32) followed by the pixels as they are in memory
+	bool SaveImage(const std::string& path, const Image& image);
+	//reads 8 bit gray, gray alpha, rgb and rgba pngs without interlacing, and .rgba files
+	bool LoadImage(const std::string& path, Image& image);
+
+	bool WritePNG(const std::string& path, const Image& image);
+	bool ReadPNG(const std::string& bytes, Image& image);
+}
@@ -0,0 +1,124 @@
+#include "graphics/ImageCompare.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace eng {
+
+	namespace {
+
+		//rec. 601 weights, alpha is compared per channel but left out of the structure
+		std::vector<float> Luminance(const Image& image) {
+			std::vector<float> luma(static_cast<size_t>(image.width) * image.height);
+			for (size_t i = 0; i < luma.size(); ++i) {
+				const uint8_t* pixel = &image.rgba[i * 4];
+				luma[i] = 0.299f * pixel[0] + 0.587f * pixel[1] + 0.114f * pixel[2];
+			}
+			return luma;
+		}
+
+		//mean ssim over 8x8 windows placed every 4 pixels
+		double ComputeSSIM(const Image& expected, const Image& actual) {
+			const int window = 8;
+			const int stride = 4;
+			const double c1 = (0.01 * 255.0) * (0.01 * 255.0);
+			const double c2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+			std::vector<float> a = Luminance(expected);
+			std::vector<float> b = Luminance(actual);
+			int width = expected.width;
+			int height = expected.height;
+			//images smaller than a window are measured as a single window
+			int windowWidth = std::min(window, width);
+			int windowHeight = std::min(window, height);
+
+			double total = 0.0;
+			size_t windows = 0;
+			for (int y = 0; y + windowHeight <= height; y += stride) {
+				for (int x = 0; x + windowWidth <= width; x += stride) {
+					double sumA = 0.0, sumB = 0.0, sumAA = 0.0, sumBB = 0.0, sumAB = 0.0;
+					for (int wy = 0; wy < windowHeight; ++wy) {
+						size_t row = static_cast<size_t>(y + wy) * width + x;
+						for (int wx = 0; wx < windowWidth; ++wx) {
+							double va = a[row + wx];
+							double vb = b[row + wx];
+							sumA += va;
+							sumB += vb;
+							sumAA += va * va;
+							sumBB += vb * vb;
+							sumAB += va * vb;
+						}
+					}
+					double n = static_cast<double>(windowWidth) * windowHeight;
+					double meanA = sumA / n;
+					double meanB = sumB / n;
+					double varianceA = sumAA / n - meanA * meanA;
+					double varianceB = sumBB / n - meanB * meanB;
+					double covariance = sumAB / n - meanA * meanB;
+					total += ((2.0 * meanA * meanB + c1) * (2.0 * covariance + c2)) /
+						((meanA * meanA + meanB * meanB + c1) * (varianceA + varianceB + c2));
+					++windows;
+				}
+			}
+			return windows > 0 ? total / windows : 1.0;
+		}
+	}
+
+	ImageDiffResult CompareImages(const Image& expected, const Image& actual, const ImageDiffSettings& settings, Image* diff) {
+		ImageDiffResult result;
+		if (expected.width != actual.width || expected.height != actual.height || expected.IsEmpty() || actual.IsEmpty()) {
+			result.sizeMismatch = true;
+			result.psnr = 0.0;
+			result.ssim = 0.0;
+			return result;
+		}
+
+		size_t pixelCount = static_cast<size_t>(expected.width) * expected.height;
+		if (diff) {
+			diff->width = expected.width;
+			diff->height = expected.height;
+			diff->rgba.resize(pixelCount * 4);
+		}
+
+		double squaredError = 0.0;
+		for (size_t i = 0; i < pixelCount; ++i) {
+			const uint8_t* a = &expected.rgba[i * 4];
+			const uint8_t* b = &actual.rgba[i * 4];
+			int pixelDifference = 0;
+			for (int c = 0; c < 4; ++c) {
+				int difference = std::abs(int(a[c]) - int(b[c]));
+				pixelDifference = std::max(pixelDifference, difference);
+				squaredError += double(difference) * difference;
+			}
+			result.maxChannelDifference = std::max(result.maxChannelDifference, pixelDifference);
+			bool different = pixelDifference > settings.tolerance;
+			if (different) {
+				++result.differentPixels;
+			}
+
+			if (diff) {
+				uint8_t* out = &diff->rgba[i * 4];
+				if (different) {
+					out[0] = 255;
+					out[1] = 0;
+					out[2] = 0;
+				}
+				else {
+					uint8_t gray = static_cast<uint8_t>((0.299f * a[0] + 0.587f * a[1] + 0.114f * a[2]) * 0.3f);
+					out[0] = gray;
+					out[1] = gray;
+					out[2] = gray;
+				}
+				out[3] = 255;
+			}
+		}
+
+		result.differentFraction = double(result.differentPixels) / double(pixelCount);
+		double meanSquaredError = squaredError / (double(pixelCount) * 4.0);
+		result.psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : std::numeric_limits<double>::infinity();
+		result.ssim = result.maxChannelDifference > 0 ? ComputeSSIM(expected, actual) : 1.0;
+		result.passed = result.differentFraction <= settings.maxDifferentFraction && result.ssim >= settings.minSSIM;
+		return result;
+	}
+}
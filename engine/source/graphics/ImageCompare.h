@@ -0,0 +1,29 @@
+#pragma once
+
+#include "graphics/Image.h"
+
+namespace eng {
+
+	struct ImageDiffSettings {
+		//channel differences up to this are treated as equal, covers driver rounding
+		int tolerance = 2;
+		//fails once more than this fraction of the pixels differ beyond tolerance
+		double maxDifferentFraction = 0.001;
+		//structural similarity of the luminance, 1 for identical images
+		double minSSIM = 0.98;
+	};
+
+	struct ImageDiffResult {
+		bool sizeMismatch = false;
+		size_t differentPixels = 0;
+		double differentFraction = 0.0;
+		int maxChannelDifference = 0;
+		//infinite for identical images
+		double psnr = 0.0;
+		double ssim = 1.0;
+		bool passed = false;
+	};
+
+	//diff, when given, gets a dimmed gray copy of expected with every pixel beyond tolerance painted red
+	ImageDiffResult CompareImages(const Image& expected, const Image& actual, const ImageDiffSettings& settings, Image* diff = nullptr);
+}
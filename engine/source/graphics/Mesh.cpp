@@ -0,0 +1,82 @@
+#include "graphics/Mesh.h"
+#include "render/Material.h"
+#include <algorithm>
+
+namespace eng {
+
+	Mesh::Mesh(const MeshData& data) : m_attributes(data.attributes), m_lods(data.lods), m_bounds(data.bounds) {
+
+		//a mesh cooked without lods draws all of its indices
+		if (m_lods.empty()) {
+			m_lods.push_back({ 0, uint32_t(data.indices.size()), 0.0f });
+		}
+		for (const auto& lod : m_lods) {
+			m_lodErrors.push_back(lod.error);
+		}
+
+		glGenVertexArrays(1, &m_vertexArray);
+		glGenBuffers(1, &m_vertexBuffer);
+		glGenBuffers(1, &m_indexBuffer);
+
+		glBindVertexArray(m_vertexArray);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, data.vertices.size() * sizeof(float), data.vertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.indices.size() * sizeof(uint32_t), data.indices.data(), GL_STATIC_DRAW);
+
+		GLsizei stride = GLsizei(data.vertexStride * sizeof(float));
+		for (const auto& attribute : data.attributes) {
+			glEnableVertexAttribArray(attribute.location);
+			glVertexAttribPointer(attribute.location, GLint(attribute.components), GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(size_t(attribute.offset) * sizeof(float)));
+		}
+		//the element buffer binding is part of the vertex array, unbind that first
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	Mesh::~Mesh() {
+
+		glDeleteVertexArrays(1, &m_vertexArray);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		glDeleteBuffers(1, &m_indexBuffer);
+	}
+
+	size_t Mesh::GetLODCount() const {
+		return m_lods.size();
+	}
+
+	const MeshLOD& Mesh::GetLOD(size_t lod) const {
+		return m_lods[std::min(lod, m_lods.size() - 1)];
+	}
+
+	const std::vector<float>& Mesh::GetLODErrors() const {
+		return m_lodErrors;
+	}
+
+	const BoundingSphere& Mesh::GetBounds() const {
+		return m_bounds;
+	}
+
+	const std::vector<VertexAttribute>& Mesh::GetAttributes() const {
+		return m_attributes;
+	}
+
+	RenderCommand Mesh::GetRenderCommand(Material* material, size_t lod, float lodFade) const {
+		const ShaderProgram* program = material ? material->GetShaderProgram().get() : nullptr;
+		if (program && m_validatedProgram.load(std::memory_order_relaxed) != program &&
+			m_validatedProgram.exchange(program, std::memory_order_relaxed) != program) {
+			material->ValidateMesh(*this);
+		}
+
+		const MeshLOD& range = GetLOD(lod);
+		RenderCommand command;
+		command.material = material;
+		command.vertexArray = m_vertexArray;
+		command.count = GLsizei(range.indexCount);
+		command.indexType = GL_UNSIGNED_INT;
+		command.firstIndex = range.indexOffset;
+		command.lodFade = lodFade;
+		return command;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "graphics/MeshData.h"
+#include "render/RenderQueue.h"
+#include <GL/glew.h>
+#include <atomic>
+#include <vector>
+
+namespace eng {
+
+	class Material;
+	class ShaderProgram;
+
+	//vertex and index buffers of a cooked mesh on the gpu, every lod is a range of the one index buffer
+	class Mesh {
+	public:
+		//avoid copying the mesh object, ensures the gl buffers are created and destroyed exactly once
+		Mesh() = delete;
+		Mesh(const Mesh&) = delete;
+		Mesh& operator=(const Mesh&) = delete;
+		explicit Mesh(const MeshData& data);
+		~Mesh();
+
+		size_t GetLODCount() const;
+		const MeshLOD& GetLOD(size_t lod) const;
+		//object space error of every lod, finest first, what the lod selector wants
+		const std::vector<float>& GetLODErrors() const;
+		const BoundingSphere& GetBounds() const;
+		const std::vector<VertexAttribute>& GetAttributes() const;
+
+		//draws the index range of one lod, lodFade is passed through for dithered cross fades
+		//the vertex layout is validated against the material's program the first time the two are paired
+		RenderCommand GetRenderCommand(Material* material, size_t lod, float lodFade = 0.0f) const;
+
+	private:
+		GLuint m_vertexArray = 0;
+		GLuint m_vertexBuffer = 0;
+		GLuint m_indexBuffer = 0;
+		std::vector<VertexAttribute> m_attributes;
+		std::vector<MeshLOD> m_lods;
+		std::vector<float> m_lodErrors;
+		BoundingSphere m_bounds;
+		//the program the layout was last validated against, commands may be built on any thread
+		mutable std::atomic<const ShaderProgram*> m_validatedProgram{ nullptr };
+	};
+}
@@ -0,0 +1,155 @@
+#include "graphics/MeshData.h"
+#include "log/Log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace eng {
+
+	namespace {
+
+		const uint32_t kCookedMeshMagic = 0x4853454D; //"MESH"
+		const uint32_t kCookedMeshVersion = 1;
+
+		struct CookedMeshHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vertexStride;
+			uint32_t attributeCount;
+			uint32_t lodCount;
+			uint32_t vertexFloatCount;
+			uint32_t indexCount;
+			BoundingSphere bounds;
+		};
+
+		template<typename T>
+		void Append(std::string& out, const T* data, size_t count) {
+			out.append(reinterpret_cast<const char*>(data), sizeof(T) * count);
+		}
+
+		template<typename T>
+		bool Consume(const std::string& bytes, size_t& offset, T* data, size_t count) {
+			size_t size = sizeof(T) * count;
+			if (bytes.size() - offset < size) {
+				return false;
+			}
+			std::memcpy(data, bytes.data() + offset, size);
+			offset += size;
+			return true;
+		}
+	}
+
+	size_t MeshData::GetVertexCount() const {
+		return vertexStride == 0 ? 0 : vertices.size() / vertexStride;
+	}
+
+	void MeshData::ComputeBounds() {
+		size_t vertexCount = GetVertexCount();
+		if (vertexCount == 0) {
+			bounds = BoundingSphere{};
+			return;
+		}
+		//center of the box around the positions, then the furthest position from it
+		float minimum[3] = { vertices[0], vertices[1], vertices[2] };
+		float maximum[3] = { vertices[0], vertices[1], vertices[2] };
+		for (size_t i = 0; i < vertexCount; ++i) {
+			const float* position = &vertices[i * vertexStride];
+			for (int axis = 0; axis < 3; ++axis) {
+				minimum[axis] = std::min(minimum[axis], position[axis]);
+				maximum[axis] = std::max(maximum[axis], position[axis]);
+			}
+		}
+		bounds.x = (minimum[0] + maximum[0]) * 0.5f;
+		bounds.y = (minimum[1] + maximum[1]) * 0.5f;
+		bounds.z = (minimum[2] + maximum[2]) * 0.5f;
+		float radiusSquared = 0.0f;
+		for (size_t i = 0; i < vertexCount; ++i) {
+			const float* position = &vertices[i * vertexStride];
+			float dx = position[0] - bounds.x;
+			float dy = position[1] - bounds.y;
+			float dz = position[2] - bounds.z;
+			radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+		}
+		bounds.radius = std::sqrt(radiusSquared);
+	}
+
+	bool WriteCookedMesh(const std::string& path, const MeshData& mesh) {
+		CookedMeshHeader header{};
+		header.magic = kCookedMeshMagic;
+		header.version = kCookedMeshVersion;
+		header.vertexStride = mesh.vertexStride;
+		header.attributeCount = uint32_t(mesh.attributes.size());
+		header.lodCount = uint32_t(mesh.lods.size());
+		header.vertexFloatCount = uint32_t(mesh.vertices.size());
+		header.indexCount = uint32_t(mesh.indices.size());
+		header.bounds = mesh.bounds;
+
+		std::string bytes;
+		Append(bytes, &header, 1);
+		Append(bytes, mesh.attributes.data(), mesh.attributes.size());
+		Append(bytes, mesh.lods.data(), mesh.lods.size());
+		Append(bytes, mesh.vertices.data(), mesh.vertices.size());
+		Append(bytes, mesh.indices.data(), mesh.indices.size());
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.write(bytes.data(), bytes.size())) {
+			LOG_ERROR(Graphics, "COOKED_MESH_WRITE_FAILED: {}", path);
+			return false;
+		}
+		return true;
+	}
+
+	bool ReadCookedMesh(const std::string& bytes, MeshData& mesh) {
+		CookedMeshHeader header{};
+		size_t offset = 0;
+		if (!Consume(bytes, offset, &header, 1) || header.magic != kCookedMeshMagic) {
+			LOG_ERROR(Graphics, "COOKED_MESH_INVALID_HEADER");
+			return false;
+		}
+		if (header.version != kCookedMeshVersion) {
+			LOG_ERROR(Graphics, "COOKED_MESH_UNSUPPORTED_VERSION: {}", header.version);
+			return false;
+		}
+		if (header.vertexStride < 3) {
+			LOG_ERROR(Graphics, "COOKED_MESH_INVALID_STRIDE: {}", header.vertexStride);
+			return false;
+		}
+
+		mesh.vertexStride = header.vertexStride;
+		mesh.bounds = header.bounds;
+		mesh.attributes.resize(header.attributeCount);
+		mesh.lods.resize(header.lodCount);
+		mesh.vertices.resize(header.vertexFloatCount);
+		mesh.indices.resize(header.indexCount);
+		if (!Consume(bytes, offset, mesh.attributes.data(), mesh.attributes.size()) ||
+			!Consume(bytes, offset, mesh.lods.data(), mesh.lods.size()) ||
+			!Consume(bytes, offset, mesh.vertices.data(), mesh.vertices.size()) ||
+			!Consume(bytes, offset, mesh.indices.data(), mesh.indices.size())) {
+			LOG_ERROR(Graphics, "COOKED_MESH_TRUNCATED");
+			return false;
+		}
+
+		//never trust the ranges in a file
+		size_t vertexCount = mesh.GetVertexCount();
+		for (const auto& attribute : mesh.attributes) {
+			if (attribute.components == 0 || attribute.components > 4 || attribute.offset + attribute.components > mesh.vertexStride) {
+				LOG_ERROR(Graphics, "COOKED_MESH_INVALID_ATTRIBUTE");
+				return false;
+			}
+		}
+		for (const auto& lod : mesh.lods) {
+			if (uint64_t(lod.indexOffset) + lod.indexCount > mesh.indices.size()) {
+				LOG_ERROR(Graphics, "COOKED_MESH_INVALID_LOD");
+				return false;
+			}
+		}
+		for (uint32_t index : mesh.indices) {
+			if (index >= vertexCount) {
+				LOG_ERROR(Graphics, "COOKED_MESH_INVALID_INDEX");
+				return false;
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "scene/Bounds.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace eng {
+
+	struct VertexAttribute {
+		uint32_t location = 0;
+		uint32_t components = 0;
+		//in floats from the start of the vertex
+		uint32_t offset = 0;
+	};
+
+	//one level of detail, a range of the shared index buffer
+	struct MeshLOD {
+		uint32_t indexOffset = 0;
+		uint32_t indexCount = 0;
+		//largest distance in object units the simplified surface strays from the original, 0 for the full mesh
+		float error = 0.0f;
+	};
+
+	//cpu side mesh as the cooker produces it
+	//every lod indexes the same vertices, so switching lods only changes the index range that is drawn
+	struct MeshData {
+		//interleaved, the position is always the first three floats of a vertex
+		std::vector<float> vertices;
+		//in floats
+		uint32_t vertexStride = 3;
+		std::vector<VertexAttribute> attributes;
+		//all lods back to back, finest first
+		std::vector<uint32_t> indices;
+		std::vector<MeshLOD> lods;
+		BoundingSphere bounds;
+
+		size_t GetVertexCount() const;
+		//recomputes the bounding sphere from the positions
+		void ComputeBounds();
+	};
+
+	//cooked meshes are a small versioned header followed by the arrays of MeshData as they are in memory
+	bool WriteCookedMesh(const std::string& path, const MeshData& mesh);
+	//bytes is the whole file, e.g. what the asset manager read
+	bool ReadCookedMesh(const std::string& bytes, MeshData& mesh);
+}
@@ -0,0 +1,163 @@
+#include "graphics/ProgramBinaryCache.h"
+#include "log/Log.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace eng {
+
+	namespace {
+		constexpr uint64_t kHashOffset = 14695981039346656037ull;
+		constexpr uint64_t kHashPrime = 1099511628211ull;
+		const char kBinaryMagic[8] = { 'E', 'N', 'G', 'P', 'B', 'I', 'N', '\0' };
+		const uint32_t kBinaryVersion = 1;
+
+		void HashBytes(uint64_t& hash, const void* data, size_t size) {
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (size_t i = 0; i < size; ++i) {
+				hash = (hash ^ bytes[i]) * kHashPrime;
+			}
+		}
+
+		void HashGLString(uint64_t& hash, GLenum name) {
+			const char* value = reinterpret_cast<const char*>(glGetString(name));
+			if (value) {
+				HashBytes(hash, value, std::strlen(value) + 1);
+			}
+		}
+
+		struct BinaryHeader {
+			char magic[8];
+			uint32_t version;
+			uint32_t format;
+			uint64_t driverHash;
+			uint64_t size;
+		};
+	}
+
+	void ProgramBinaryCache::SetDirectory(const std::string& directory) {
+		m_directory = directory;
+		m_supported = false;
+		if (directory.empty()) {
+			return;
+		}
+		GLint formatCount = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+		if (formatCount <= 0) {
+			LOG_WARNING(Graphics, "PROGRAM_BINARY_UNSUPPORTED: the driver has no program binary formats, programs are always compiled");
+			return;
+		}
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		if (error) {
+			LOG_ERROR(Graphics, "PROGRAM_BINARY_CACHE_DIRECTORY: cannot create {}", directory);
+			return;
+		}
+		m_driverHash = kHashOffset;
+		HashGLString(m_driverHash, GL_VENDOR);
+		HashGLString(m_driverHash, GL_RENDERER);
+		HashGLString(m_driverHash, GL_VERSION);
+		m_supported = true;
+	}
+
+	const std::string& ProgramBinaryCache::GetDirectory() const {
+		return m_directory;
+	}
+
+	bool ProgramBinaryCache::IsEnabled() const {
+		return m_supported;
+	}
+
+	GLuint ProgramBinaryCache::Load(uint64_t sourceHash) {
+		if (!m_supported) {
+			return 0;
+		}
+		std::ifstream file(GetPath(sourceHash), std::ios::binary);
+		BinaryHeader header;
+		if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+			std::memcmp(header.magic, kBinaryMagic, sizeof(kBinaryMagic)) != 0 || header.version != kBinaryVersion ||
+			header.driverHash != m_driverHash || header.size == 0 || header.size > (uint64_t(1) << 30)) {
+			++m_misses;
+			return 0;
+		}
+		std::vector<char> binary(size_t(header.size));
+		if (!file.read(binary.data(), std::streamsize(binary.size()))) {
+			++m_misses;
+			return 0;
+		}
+
+		//the driver may still refuse a binary, e.g. after an update that kept the version string
+		GLuint program = glCreateProgram();
+		glProgramBinary(program, GLenum(header.format), binary.data(), GLsizei(binary.size()));
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success) {
+			glDeleteProgram(program);
+			++m_misses;
+			return 0;
+		}
+		++m_hits;
+		return program;
+	}
+
+	void ProgramBinaryCache::Store(uint64_t sourceHash, GLuint program) {
+		if (!m_supported) {
+			return;
+		}
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) {
+			return;
+		}
+		std::vector<char> binary(static_cast<size_t>(length));
+		GLenum format = 0;
+		glGetProgramBinary(program, length, &length, &format, binary.data());
+
+		BinaryHeader header;
+		std::memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+		header.version = kBinaryVersion;
+		header.format = format;
+		header.driverHash = m_driverHash;
+		header.size = uint64_t(length);
+		//written next to the final name and renamed over it, so a crash never leaves half a binary behind
+		std::string path = GetPath(sourceHash);
+		std::string temporaryPath = path + ".tmp";
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			if (!file || !file.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !file.write(binary.data(), length)) {
+				LOG_ERROR(Graphics, "PROGRAM_BINARY_WRITE_FAILED: {}", temporaryPath);
+				return;
+			}
+		}
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error) {
+			LOG_ERROR(Graphics, "PROGRAM_BINARY_WRITE_FAILED: {}", path);
+		}
+	}
+
+	size_t ProgramBinaryCache::GetHitCount() const {
+		return m_hits;
+	}
+
+	size_t ProgramBinaryCache::GetMissCount() const {
+		return m_misses;
+	}
+
+	uint64_t ProgramBinaryCache::HashSources(const std::string& vertexSource, const std::string& fragmentSource) {
+		uint64_t hash = kHashOffset;
+		HashBytes(hash, vertexSource.data(), vertexSource.size());
+		//keeps "ab" + "c" apart from "a" + "bc"
+		HashBytes(hash, "", 1);
+		HashBytes(hash, fragmentSource.data(), fragmentSource.size());
+		return hash;
+	}
+
+	std::string ProgramBinaryCache::GetPath(uint64_t sourceHash) const {
+		char name[24];
+		std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(sourceHash));
+		return m_directory + "/" + name;
+	}
+}
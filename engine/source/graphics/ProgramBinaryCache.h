@@ -0,0 +1,41 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace eng {
+
+	//linked programs saved through glGetProgramBinary, one file per source hash, so the next run skips compiling and linking
+	//binaries only load on the driver that wrote them, files from another driver or version count as misses and get rewritten
+	class ProgramBinaryCache {
+	public:
+		//an empty directory turns the cache off, which is the default, needs the context
+		void SetDirectory(const std::string& directory);
+		const std::string& GetDirectory() const;
+		//false while off or when the driver has no binary formats
+		bool IsEnabled() const;
+
+		//a linked program built from the cached binary, 0 on a miss
+		GLuint Load(uint64_t sourceHash);
+		//the program has to be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+		void Store(uint64_t sourceHash, GLuint program);
+
+		size_t GetHitCount() const;
+		size_t GetMissCount() const;
+
+		//fnv-1a over both stages, what the binaries are filed under
+		static uint64_t HashSources(const std::string& vertexSource, const std::string& fragmentSource);
+
+	private:
+		std::string GetPath(uint64_t sourceHash) const;
+
+		std::string m_directory;
+		bool m_supported = false;
+		//vendor, renderer and version string of the driver, written into every file
+		uint64_t m_driverHash = 0;
+		size_t m_hits = 0;
+		size_t m_misses = 0;
+	};
+}
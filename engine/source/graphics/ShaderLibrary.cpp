@@ -0,0 +1,310 @@
+#include "graphics/ShaderLibrary.h"
+#include "log/Log.h"
+#include "graphics/GraphicsAPI.h"
+#include "graphics/ShaderProgram.h"
+#include "memory/MemoryPool.h"
+#include "Engine.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace eng {
+
+	namespace {
+		//one line per variant in saved lists, the fields are separated by tabs, the keywords by commas
+		std::string JoinKeywords(const std::vector<std::string>& keywords) {
+			std::string joined;
+			for (const auto& keyword : keywords) {
+				if (!joined.empty()) {
+					joined += ',';
+				}
+				joined += keyword;
+			}
+			return joined;
+		}
+
+		std::vector<std::string> Split(const std::string& text, char separator) {
+			std::vector<std::string> parts;
+			std::istringstream stream(text);
+			std::string part;
+			while (std::getline(stream, part, separator)) {
+				parts.push_back(part);
+			}
+			return parts;
+		}
+	}
+
+	void ShaderLibrary::Init(AssetManager* assetManager) {
+		m_assetManager = assetManager;
+	}
+
+	void ShaderLibrary::Shutdown() {
+		m_watcher.Shutdown();
+		//assigning fresh containers releases their storage as well, clear would keep it around past shutdown
+		m_programs = decltype(m_programs)();
+		m_dependents = decltype(m_dependents)();
+		m_permutations = decltype(m_permutations)();
+		m_pendingPrewarmCount = 0;
+		m_deferredReloadCount = 0;
+		m_preprocessor.Clear();
+	}
+
+	void ShaderLibrary::Update() {
+		UpdatePrewarm();
+		if (!m_hotReloadEnabled || m_programs.empty() || !m_assetManager) {
+			return;
+		}
+
+		//start watching lazily, the application usually sets the asset root during its own init
+		const std::string& rootPath = m_assetManager->GetRootPath();
+		if (!m_watcher.IsWatching() || m_watcher.GetRootPath() != rootPath) {
+			if (rootPath.empty() || !m_watcher.Init(rootPath)) {
+				LOG_ERROR(Graphics, "SHADER_HOT_RELOAD_DISABLED: cannot watch {}", rootPath);
+				m_hotReloadEnabled = false;
+				return;
+			}
+		}
+
+		QueueDeferredReloads();
+		auto changed = m_watcher.Poll();
+		if (changed.empty()) {
+			return;
+		}
+
+		std::vector<size_t> reloads;
+		for (const auto& path : changed) {
+			std::string key = ShaderPreprocessor::NormalizePath(path);
+			auto it = m_dependents.find(key);
+			if (it == m_dependents.end()) {
+				continue;
+			}
+			m_preprocessor.Invalidate(key);
+			reloads.insert(reloads.end(), it->second.begin(), it->second.end());
+		}
+
+		//a header shared by many programs changed, rebuild each of them once
+		std::sort(reloads.begin(), reloads.end());
+		reloads.erase(std::unique(reloads.begin(), reloads.end()), reloads.end());
+		for (size_t entryIndex : reloads) {
+			QueueReload(entryIndex);
+		}
+	}
+
+	AssetHandle<ShaderProgram> ShaderLibrary::Load(const std::string& vertexPath, const std::string& fragmentPath, float priority) {
+		m_preprocessor.SetRootPath(m_assetManager->GetRootPath());
+
+		auto preprocessed = MakePooled<PreprocessedProgram>();
+		return m_assetManager->Load<ShaderProgram>({ vertexPath, fragmentPath }, priority, MakeDecodeFunction(vertexPath, fragmentPath, preprocessed),
+			[this, vertexPath, fragmentPath, preprocessed](AssetManager::FileData&) {
+				auto& graphicsAPI = Engine::GetInstance().GetGraphicsAPI();
+				auto program = graphicsAPI.CreateShaderProgram(preprocessed->vertex.source, preprocessed->fragment.source);
+				if (program) {
+					Register(program, vertexPath, fragmentPath, *preprocessed);
+				}
+				return program;
+			});
+	}
+
+	AssetHandle<ShaderPermutation> ShaderLibrary::LoadPermutation(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& keywords, float priority) {
+		std::string name = vertexPath + '\t' + fragmentPath + '\t' + JoinKeywords(keywords);
+		PermutationEntry& entry = m_permutations[name];
+		//a failed load is tried again, the files may have been fixed since
+		if (entry.permutation.IsValid() && entry.permutation.GetState() != AssetState::Failed) {
+			return entry.permutation;
+		}
+		m_preprocessor.SetRootPath(m_assetManager->GetRootPath());
+
+		entry.vertexPath = vertexPath;
+		entry.fragmentPath = fragmentPath;
+		entry.keywords = keywords;
+		auto preprocessed = MakePooled<PreprocessedProgram>();
+		entry.permutation = m_assetManager->Load<ShaderPermutation>({ vertexPath, fragmentPath }, priority, MakeDecodeFunction(vertexPath, fragmentPath, preprocessed),
+			[preprocessed, keywords](AssetManager::FileData&) {
+				return MakePooled<ShaderPermutation>(preprocessed->vertex.source, preprocessed->fragment.source, keywords);
+			});
+		return entry.permutation;
+	}
+
+	bool ShaderLibrary::SaveVariantList(const std::string& path) const {
+		std::ofstream file(path, std::ios::trunc);
+		if (!file) {
+			LOG_ERROR(Graphics, "SHADER_VARIANT_LIST_WRITE_FAILED: {}", path);
+			return false;
+		}
+		for (const auto& pair : m_permutations) {
+			const PermutationEntry& entry = pair.second;
+			auto permutation = entry.permutation.Get();
+			if (!permutation) {
+				continue;
+			}
+			std::string prefix = entry.vertexPath + '\t' + entry.fragmentPath + '\t' + JoinKeywords(entry.keywords) + '\t';
+			for (uint64_t key : permutation->GetRequestedKeys()) {
+				char hex[20];
+				std::snprintf(hex, sizeof(hex), "%llx", static_cast<unsigned long long>(key));
+				file << prefix << hex << '\n';
+			}
+		}
+		return bool(file);
+	}
+
+	bool ShaderLibrary::PrewarmVariants(const std::string& path) {
+		std::ifstream file(path);
+		if (!file) {
+			LOG_ERROR(Graphics, "SHADER_VARIANT_LIST_NOT_FOUND: {}", path);
+			return false;
+		}
+		std::string line;
+		size_t lineNumber = 0;
+		while (std::getline(file, line)) {
+			++lineNumber;
+			if (line.empty()) {
+				continue;
+			}
+			std::vector<std::string> fields = Split(line, '\t');
+			if (fields.size() != 4 || fields[3].empty()) {
+				LOG_WARNING(Graphics, "SHADER_VARIANT_LIST_MALFORMED: {} line {}", path, lineNumber);
+				continue;
+			}
+			uint64_t key = std::strtoull(fields[3].c_str(), nullptr, 16);
+			LoadPermutation(fields[0], fields[1], Split(fields[2], ','));
+			m_permutations[fields[0] + '\t' + fields[1] + '\t' + fields[2]].prewarmKeys.push_back(key);
+			++m_pendingPrewarmCount;
+		}
+		return true;
+	}
+
+	size_t ShaderLibrary::GetPendingPrewarmCount() const {
+		return m_pendingPrewarmCount;
+	}
+
+	void ShaderLibrary::SetHotReloadEnabled(bool enabled) {
+		m_hotReloadEnabled = enabled;
+		if (!enabled) {
+			m_watcher.Shutdown();
+		}
+	}
+
+	bool ShaderLibrary::IsHotReloadEnabled() const {
+		return m_hotReloadEnabled;
+	}
+
+	ShaderPreprocessor& ShaderLibrary::GetPreprocessor() {
+		return m_preprocessor;
+	}
+
+	AssetManager::DecodeFunction ShaderLibrary::MakeDecodeFunction(const std::string& vertexPath, const std::string& fragmentPath, const std::shared_ptr<PreprocessedProgram>& output) {
+		return [this, vertexPath, fragmentPath, output](AssetManager::FileData& files) {
+			return m_preprocessor.Preprocess(vertexPath, files[0], output->vertex) &&
+				m_preprocessor.Preprocess(fragmentPath, files[1], output->fragment);
+		};
+	}
+
+	void ShaderLibrary::Register(const std::shared_ptr<ShaderProgram>& program, const std::string& vertexPath, const std::string& fragmentPath, const PreprocessedProgram& preprocessed) {
+		ProgramEntry entry;
+		entry.vertexPath = vertexPath;
+		entry.fragmentPath = fragmentPath;
+		entry.program = program;
+		m_programs.push_back(std::move(entry));
+		SetDependencies(m_programs.size() - 1, preprocessed);
+	}
+
+	void ShaderLibrary::SetDependencies(size_t entryIndex, const PreprocessedProgram& preprocessed) {
+		if (entryIndex >= m_programs.size()) {
+			return;
+		}
+		auto& entry = m_programs[entryIndex];
+
+		for (const auto& path : entry.dependencies) {
+			auto& dependents = m_dependents[path];
+			dependents.erase(std::remove(dependents.begin(), dependents.end(), entryIndex), dependents.end());
+		}
+
+		entry.dependencies = preprocessed.vertex.dependencies;
+		for (const auto& path : preprocessed.fragment.dependencies) {
+			if (std::find(entry.dependencies.begin(), entry.dependencies.end(), path) == entry.dependencies.end()) {
+				entry.dependencies.push_back(path);
+			}
+		}
+		for (const auto& path : entry.dependencies) {
+			m_dependents[path].push_back(entryIndex);
+		}
+	}
+
+	void ShaderLibrary::QueueReload(size_t entryIndex) {
+		auto& entry = m_programs[entryIndex];
+		if (entry.pendingReload.GetState() == AssetState::Loading) {
+			//one more rebuild once this one is done, however many saves come in meanwhile
+			if (!entry.reloadAgain) {
+				entry.reloadAgain = true;
+				++m_deferredReloadCount;
+			}
+			return;
+		}
+		std::weak_ptr<ShaderProgram> target = entry.program;
+		if (target.expired()) {
+			return;
+		}
+
+		//reloads jump the queue, whoever saved the file is waiting for it
+		auto preprocessed = MakePooled<PreprocessedProgram>();
+		entry.pendingReload = m_assetManager->Load<ShaderProgram>({ entry.vertexPath, entry.fragmentPath }, std::numeric_limits<float>::max(),
+			MakeDecodeFunction(entry.vertexPath, entry.fragmentPath, preprocessed),
+			[this, entryIndex, target, preprocessed](AssetManager::FileData&) -> std::shared_ptr<ShaderProgram> {
+				auto program = target.lock();
+				if (!program) {
+					return nullptr;
+				}
+				//on compile errors the old program simply stays in use
+				auto& graphicsAPI = Engine::GetInstance().GetGraphicsAPI();
+				GLuint shaderProgramID = graphicsAPI.CompileShaderProgram(preprocessed->vertex.source, preprocessed->fragment.source);
+				if (shaderProgramID == 0) {
+					return nullptr;
+				}
+				program->SwapProgram(shaderProgramID);
+				SetDependencies(entryIndex, *preprocessed);
+				return program;
+			});
+	}
+
+	void ShaderLibrary::QueueDeferredReloads() {
+		if (m_deferredReloadCount == 0) {
+			return;
+		}
+		for (size_t entryIndex = 0; entryIndex < m_programs.size(); ++entryIndex) {
+			auto& entry = m_programs[entryIndex];
+			if (!entry.reloadAgain || entry.pendingReload.GetState() == AssetState::Loading) {
+				continue;
+			}
+			entry.reloadAgain = false;
+			--m_deferredReloadCount;
+			//the running rebuild may have cached the includes as they were before the save
+			for (const auto& path : entry.dependencies) {
+				m_preprocessor.Invalidate(path);
+			}
+			QueueReload(entryIndex);
+		}
+	}
+
+	void ShaderLibrary::UpdatePrewarm() {
+		if (m_pendingPrewarmCount == 0) {
+			return;
+		}
+		for (auto& pair : m_permutations) {
+			PermutationEntry& entry = pair.second;
+			if (entry.prewarmKeys.empty() || entry.permutation.GetState() == AssetState::Loading) {
+				continue;
+			}
+			//a permutation that failed to load drops its keys, the error was reported by the load
+			if (auto permutation = entry.permutation.Get()) {
+				for (uint64_t key : entry.prewarmKeys) {
+					permutation->GetVariant(key);
+				}
+			}
+			m_pendingPrewarmCount -= entry.prewarmKeys.size();
+			entry.prewarmKeys.clear();
+		}
+	}
+}
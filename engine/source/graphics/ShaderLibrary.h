@@ -0,0 +1,99 @@
+#pragma once
+
+#include "assets/AssetManager.h"
+#include "assets/FileWatcher.h"
+#include "graphics/ShaderPreprocessor.h"
+#include "graphics/ShaderPermutation.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eng {
+
+	class ShaderProgram;
+
+	//loads shader programs from files through the asset manager and keeps them up to date while the game runs
+	//a changed file only rebuilds the programs that (directly or through an include) depend on it
+	class ShaderLibrary {
+	private:
+		//only the engine creates and owns the shader library
+		ShaderLibrary() = default;
+		ShaderLibrary(const ShaderLibrary&) = delete;
+		ShaderLibrary(ShaderLibrary&&) = delete;
+		ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+		ShaderLibrary& operator=(ShaderLibrary&&) = delete;
+
+	public:
+		void Init(AssetManager* assetManager);
+		void Shutdown();
+		//polls the file watcher and queues rebuilds, called once per frame on the main thread
+		void Update();
+
+		//paths are relative to the asset manager root
+		AssetHandle<ShaderProgram> Load(const std::string& vertexPath, const std::string& fragmentPath, float priority = 0.0f);
+		//the same files and keywords come back as the same permutation, variants it built are shared
+		//permutations are not hot reloaded, their variants keep the sources they were loaded with
+		AssetHandle<ShaderPermutation> LoadPermutation(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& keywords, float priority = 0.0f);
+		//writes every variant requested so far, for PrewarmVariants on the next run
+		bool SaveVariantList(const std::string& path) const;
+		//loads the permutations on a saved list and builds its variants as each one arrives, e.g. behind a loading screen
+		//with the program binary cache on, a warmed up variant costs a binary load from the second run on
+		bool PrewarmVariants(const std::string& path);
+		//variants on the list that are not built yet
+		size_t GetPendingPrewarmCount() const;
+
+		void SetHotReloadEnabled(bool enabled);
+		bool IsHotReloadEnabled() const;
+		ShaderPreprocessor& GetPreprocessor();
+
+	private:
+		struct ProgramEntry {
+			std::string vertexPath;
+			std::string fragmentPath;
+			std::weak_ptr<ShaderProgram> program;
+			std::vector<std::string> dependencies;
+			//keeps a running rebuild alive and stops the same program from being queued twice
+			AssetHandle<ShaderProgram> pendingReload;
+			//a save arrived while the rebuild was running, the rebuild may have read the files before it
+			bool reloadAgain = false;
+		};
+		struct PermutationEntry {
+			std::string vertexPath;
+			std::string fragmentPath;
+			std::vector<std::string> keywords;
+			AssetHandle<ShaderPermutation> permutation;
+			//keys from a variant list waiting for the permutation to finish loading
+			std::vector<uint64_t> prewarmKeys;
+		};
+		//both stages of a program get expanded on the job system, this carries the results to the upload
+		struct PreprocessedProgram {
+			PreprocessedShader vertex;
+			PreprocessedShader fragment;
+		};
+
+		AssetManager::DecodeFunction MakeDecodeFunction(const std::string& vertexPath, const std::string& fragmentPath, const std::shared_ptr<PreprocessedProgram>& output);
+		void Register(const std::shared_ptr<ShaderProgram>& program, const std::string& vertexPath, const std::string& fragmentPath, const PreprocessedProgram& preprocessed);
+		void SetDependencies(size_t entryIndex, const PreprocessedProgram& preprocessed);
+		void QueueReload(size_t entryIndex);
+		//starts the rebuilds that were asked for while the previous one of the same program was running
+		void QueueDeferredReloads();
+		void UpdatePrewarm();
+
+		AssetManager* m_assetManager = nullptr;
+		ShaderPreprocessor m_preprocessor;
+		FileWatcher m_watcher;
+		bool m_hotReloadEnabled = true;
+
+		std::vector<ProgramEntry> m_programs;
+		//file path to every program entry that depends on it
+		std::unordered_map<std::string, std::vector<size_t>> m_dependents;
+		//by paths and keywords, ordered so saved variant lists come out the same every run
+		std::map<std::string, PermutationEntry> m_permutations;
+		size_t m_pendingPrewarmCount = 0;
+		size_t m_deferredReloadCount = 0;
+
+		friend class Engine;
+	};
+}
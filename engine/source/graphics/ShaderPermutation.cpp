@@ -0,0 +1,87 @@
+#include "graphics/ShaderPermutation.h"
+#include "graphics/GraphicsAPI.h"
+#include "graphics/ProgramBinaryCache.h"
+#include "graphics/ShaderPreprocessor.h"
+#include "graphics/ShaderProgram.h"
+#include "log/Log.h"
+#include "Engine.h"
+#include <algorithm>
+
+namespace eng {
+
+	ShaderPermutation::ShaderPermutation(const std::string& vertexSource, const std::string& fragmentSource, const std::vector<std::string>& keywords)
+		: m_vertexSource(vertexSource), m_fragmentSource(fragmentSource), m_keywords(keywords) {
+
+		if (m_keywords.size() > MaxKeywords) {
+			LOG_ERROR(Graphics, "SHADER_PERMUTATION_TOO_MANY_KEYWORDS: {}, the ones past {} are ignored", m_keywords.size(), MaxKeywords);
+			m_keywords.resize(MaxKeywords);
+		}
+		for (size_t i = 0; i < m_keywords.size(); ++i) {
+			if (m_vertexSource.find(m_keywords[i]) != std::string::npos || m_fragmentSource.find(m_keywords[i]) != std::string::npos) {
+				m_usedMask |= uint64_t(1) << i;
+			}
+		}
+	}
+
+	const std::vector<std::string>& ShaderPermutation::GetKeywords() const {
+		return m_keywords;
+	}
+
+	uint64_t ShaderPermutation::GetKey(const std::vector<std::string>& keywords) const {
+		uint64_t key = 0;
+		for (const auto& keyword : keywords) {
+			auto it = std::find(m_keywords.begin(), m_keywords.end(), keyword);
+			if (it == m_keywords.end()) {
+				LOG_WARNING(Graphics, "SHADER_KEYWORD_UNKNOWN: {}", keyword);
+				continue;
+			}
+			key |= uint64_t(1) << (it - m_keywords.begin());
+		}
+		return key;
+	}
+
+	std::shared_ptr<ShaderProgram> ShaderPermutation::GetVariant(uint64_t key) {
+		key &= m_usedMask;
+		auto it = m_variants.find(key);
+		if (it != m_variants.end()) {
+			return it->second;
+		}
+		m_requestedKeys.push_back(key);
+
+		std::shared_ptr<ShaderProgram> program;
+		std::string vertexSource;
+		std::string fragmentSource;
+		if (ShaderPreprocessor::ApplyKeywords(m_vertexSource, m_keywords, key, vertexSource) &&
+			ShaderPreprocessor::ApplyKeywords(m_fragmentSource, m_keywords, key, fragmentSource)) {
+			uint64_t sourceHash = ProgramBinaryCache::HashSources(vertexSource, fragmentSource);
+			auto found = m_programs.find(sourceHash);
+			if (found != m_programs.end()) {
+				program = found->second;
+			}
+			else {
+				program = Engine::GetInstance().GetGraphicsAPI().CreateShaderProgram(vertexSource, fragmentSource);
+				if (program) {
+					m_programs[sourceHash] = program;
+				}
+			}
+		}
+		if (!program) {
+			LOG_ERROR(Graphics, "SHADER_VARIANT_FAILED: key 0x{:x}", key);
+		}
+		m_variants[key] = program;
+		return program;
+	}
+
+	bool ShaderPermutation::HasVariant(uint64_t key) const {
+		auto it = m_variants.find(key & m_usedMask);
+		return it != m_variants.end() && it->second != nullptr;
+	}
+
+	const std::vector<uint64_t>& ShaderPermutation::GetRequestedKeys() const {
+		return m_requestedKeys;
+	}
+
+	size_t ShaderPermutation::GetProgramCount() const {
+		return m_programs.size();
+	}
+}
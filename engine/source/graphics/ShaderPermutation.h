@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eng {
+
+	class ShaderProgram;
+
+	//a shader written once with #ifdef blocks around its optional features, built per combination of keywords it is used with
+	//bit i of a variant key turns keywords[i] on, a variant compiles the first time it is asked for
+	//variants whose keywords do not change the preprocessed source share one program
+	class ShaderPermutation {
+	public:
+		static constexpr size_t MaxKeywords = 64;
+
+		ShaderPermutation(const std::string& vertexSource, const std::string& fragmentSource, const std::vector<std::string>& keywords);
+		ShaderPermutation(const ShaderPermutation&) = delete;
+		ShaderPermutation& operator=(const ShaderPermutation&) = delete;
+
+		const std::vector<std::string>& GetKeywords() const;
+		//unknown keywords are reported and left out
+		uint64_t GetKey(const std::vector<std::string>& keywords) const;
+		//compiles on the calling thread, which has to own the context, nullptr when the variant does not build
+		//failures are remembered, a broken variant is reported once and not compiled again every frame
+		std::shared_ptr<ShaderProgram> GetVariant(uint64_t key);
+		bool HasVariant(uint64_t key) const;
+
+		//every key asked for so far in the order of the first request, with the bits of unused keywords cleared
+		const std::vector<uint64_t>& GetRequestedKeys() const;
+		//distinct programs behind the variants built so far
+		size_t GetProgramCount() const;
+
+	private:
+		std::string m_vertexSource;
+		std::string m_fragmentSource;
+		std::vector<std::string> m_keywords;
+		//keywords neither stage mentions cannot change the source, their bits are dropped before the lookup
+		uint64_t m_usedMask = 0;
+		std::unordered_map<uint64_t, std::shared_ptr<ShaderProgram>> m_variants;
+		//preprocessed source hash to the program built from it
+		std::unordered_map<uint64_t, std::shared_ptr<ShaderProgram>> m_programs;
+		std::vector<uint64_t> m_requestedKeys;
+	};
+}
@@ -0,0 +1,312 @@
+#include "graphics/ShaderPreprocessor.h"
+#include "log/Log.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace eng {
+
+	//include chains deeper than this are almost certainly a mistake
+	static const int kMaxIncludeDepth = 32;
+
+	namespace {
+		struct ConditionalBlock {
+			//false for conditions on something other than a keyword, their lines stay in the source
+			bool evaluated = false;
+			bool parentActive = true;
+			bool active = true;
+			//a branch of an evaluated block was taken already, the remaining ones are dropped
+			bool taken = false;
+		};
+
+		std::string Trim(const std::string& text, size_t begin = 0) {
+			size_t first = text.find_first_not_of(" \t\r\n", begin);
+			if (first == std::string::npos) {
+				return std::string();
+			}
+			size_t comment = text.find("//", first);
+			size_t last = text.find_last_not_of(" \t\r\n", comment == std::string::npos ? std::string::npos : comment - 1);
+			return last == std::string::npos || last < first ? std::string() : text.substr(first, last - first + 1);
+		}
+
+		//index of the keyword, -1 when the name is not one of them
+		int FindKeyword(const std::vector<std::string>& keywords, const std::string& name) {
+			for (size_t i = 0; i < keywords.size(); ++i) {
+				if (keywords[i] == name) {
+					return int(i);
+				}
+			}
+			return -1;
+		}
+
+		//1 or 0 for "defined(NAME)", "defined NAME" and their negations on a keyword, -1 for any other expression
+		int EvaluateCondition(std::string expression, const std::vector<std::string>& keywords, uint64_t key) {
+			bool negate = false;
+			if (!expression.empty() && expression[0] == '!') {
+				negate = true;
+				expression = Trim(expression, 1);
+			}
+			if (expression.compare(0, 7, "defined") != 0) {
+				return -1;
+			}
+			std::string name = Trim(expression, 7);
+			if (!name.empty() && name.front() == '(') {
+				if (name.back() != ')') {
+					return -1;
+				}
+				name = Trim(name.substr(1, name.size() - 2));
+			}
+			int index = FindKeyword(keywords, name);
+			if (index < 0) {
+				return -1;
+			}
+			bool defined = (key >> index) & 1;
+			return defined != negate ? 1 : 0;
+		}
+	}
+
+	void ShaderPreprocessor::SetRootPath(const std::string& rootPath) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_rootPath != rootPath) {
+			m_rootPath = rootPath;
+			m_fileCache.clear();
+			m_resultCache.clear();
+			++m_generation;
+		}
+	}
+
+	bool ShaderPreprocessor::Preprocess(const std::string& path, const std::string& source, PreprocessedShader& result) {
+		std::string key = NormalizePath(path);
+		uint64_t generation = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_resultCache.find(key);
+			if (it != m_resultCache.end()) {
+				result = it->second;
+				return true;
+			}
+			m_fileCache[key] = source;
+			generation = m_generation;
+		}
+
+		//expanded without the lock, includes read from disk would hold up every other decode otherwise
+		PreprocessedShader expanded;
+		std::unordered_set<std::string> included;
+		if (!Expand(key, source, expanded, included, 0, generation)) {
+			return false;
+		}
+		{
+			//an invalidate while we expanded may have dropped a file we read, the result is still handed out but not cached
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_generation == generation) {
+				m_resultCache[key] = expanded;
+			}
+		}
+		result = std::move(expanded);
+		return true;
+	}
+
+	void ShaderPreprocessor::Invalidate(const std::string& path) {
+		std::string key = NormalizePath(path);
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_fileCache.erase(key);
+		++m_generation;
+		for (auto it = m_resultCache.begin(); it != m_resultCache.end();) {
+			const auto& dependencies = it->second.dependencies;
+			if (std::find(dependencies.begin(), dependencies.end(), key) != dependencies.end()) {
+				it = m_resultCache.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+
+	void ShaderPreprocessor::Clear() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_fileCache = decltype(m_fileCache)();
+		m_resultCache = decltype(m_resultCache)();
+		std::string().swap(m_rootPath);
+		++m_generation;
+	}
+
+	std::string ShaderPreprocessor::NormalizePath(const std::string& path) {
+		return std::filesystem::path(path).lexically_normal().generic_string();
+	}
+
+	bool ShaderPreprocessor::ApplyKeywords(const std::string& source, const std::vector<std::string>& keywords, uint64_t key, std::string& result) {
+		std::string body;
+		body.reserve(source.size());
+		std::string versionLine;
+		std::vector<ConditionalBlock> blocks;
+		size_t lineNumber = 0;
+		size_t begin = 0;
+		while (begin < source.size()) {
+			size_t end = source.find('\n', begin);
+			end = end == std::string::npos ? source.size() : end + 1;
+			std::string line = source.substr(begin, end - begin);
+			begin = end;
+			++lineNumber;
+
+			bool active = blocks.empty() || blocks.back().active;
+			std::string trimmed = Trim(line);
+			if (trimmed.empty() || trimmed[0] != '#') {
+				if (active) {
+					body += line;
+				}
+				continue;
+			}
+			std::string directive = Trim(trimmed, 1);
+			size_t nameEnd = directive.find_first_of(" \t(");
+			std::string name = directive.substr(0, nameEnd);
+			std::string argument = nameEnd == std::string::npos ? std::string() : Trim(directive, nameEnd);
+
+			if (name == "version" && versionLine.empty() && blocks.empty()) {
+				versionLine = line;
+				continue;
+			}
+			if (name == "ifdef" || name == "ifndef" || name == "if") {
+				int condition = -1;
+				if (name == "if") {
+					condition = EvaluateCondition(argument, keywords, key);
+				}
+				else {
+					int index = FindKeyword(keywords, argument);
+					condition = index < 0 ? -1 : int(((key >> index) & 1) == (name == "ifdef" ? 1u : 0u));
+				}
+				ConditionalBlock block;
+				block.parentActive = active;
+				block.evaluated = condition >= 0;
+				block.active = active && condition != 0;
+				block.taken = condition == 1;
+				blocks.push_back(block);
+				if (!block.evaluated && active) {
+					body += line;
+				}
+				continue;
+			}
+			if (name == "elif" || name == "else" || name == "endif") {
+				if (blocks.empty()) {
+					LOG_ERROR(Graphics, "SHADER_PERMUTATION_UNBALANCED: #{} without #if on line {}", name, lineNumber);
+					return false;
+				}
+				ConditionalBlock& block = blocks.back();
+				if (!block.evaluated) {
+					if (block.parentActive) {
+						body += line;
+					}
+				}
+				else if (name == "elif") {
+					int condition = EvaluateCondition(argument, keywords, key);
+					if (condition < 0) {
+						LOG_ERROR(Graphics, "SHADER_PERMUTATION_UNSUPPORTED: #elif {} after a keyword condition on line {}", argument, lineNumber);
+						return false;
+					}
+					block.active = block.parentActive && !block.taken && condition == 1;
+					block.taken = block.taken || condition == 1;
+				}
+				else if (name == "else") {
+					block.active = block.parentActive && !block.taken;
+					block.taken = true;
+				}
+				if (name == "endif") {
+					blocks.pop_back();
+				}
+				continue;
+			}
+			if (active) {
+				body += line;
+			}
+		}
+		if (!blocks.empty()) {
+			LOG_ERROR(Graphics, "SHADER_PERMUTATION_UNBALANCED: {} #if without #endif", blocks.size());
+			return false;
+		}
+
+		result = versionLine;
+		if (!result.empty() && result.back() != '\n') {
+			result += '\n';
+		}
+		for (size_t i = 0; i < keywords.size(); ++i) {
+			if (((key >> i) & 1) && body.find(keywords[i]) != std::string::npos) {
+				result += "#define " + keywords[i] + " 1\n";
+			}
+		}
+		result += body;
+		return true;
+	}
+
+	bool ShaderPreprocessor::Expand(const std::string& path, const std::string& source, PreprocessedShader& result, std::unordered_set<std::string>& included, int depth, uint64_t generation) {
+		if (depth > kMaxIncludeDepth) {
+			LOG_ERROR(Graphics, "SHADER_INCLUDE_TOO_DEEP: {}", path);
+			return false;
+		}
+		//every file is pasted at most once, which also breaks include cycles
+		if (!included.insert(path).second) {
+			return true;
+		}
+		result.dependencies.push_back(path);
+
+		std::istringstream stream(source);
+		std::string line;
+		while (std::getline(stream, line)) {
+			size_t start = line.find_first_not_of(" \t");
+			if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+				result.source += line;
+				result.source += '\n';
+				continue;
+			}
+
+			size_t open = line.find('"', start + 8);
+			size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+			if (close == std::string::npos) {
+				LOG_ERROR(Graphics, "SHADER_INCLUDE_MALFORMED: {}: {}", path, line);
+				return false;
+			}
+
+			//includes are resolved relative to the file that contains them
+			std::filesystem::path includePath = std::filesystem::path(path).parent_path() / line.substr(open + 1, close - open - 1);
+			std::string includeKey = NormalizePath(includePath.generic_string());
+
+			std::string includeSource;
+			if (!LoadFile(includeKey, includeSource, generation)) {
+				LOG_ERROR(Graphics, "SHADER_INCLUDE_NOT_FOUND: {} included from {}", includeKey, path);
+				return false;
+			}
+			if (!Expand(includeKey, includeSource, result, included, depth + 1, generation)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ShaderPreprocessor::LoadFile(const std::string& path, std::string& source, uint64_t generation) {
+		std::string fullPath;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_fileCache.find(path);
+			if (it != m_fileCache.end()) {
+				source = it->second;
+				return true;
+			}
+			fullPath = m_rootPath.empty() ? path : m_rootPath + "/" + path;
+		}
+
+		//two decodes may read the same include at once, both get the same contents and the second insert is a no-op
+		std::ifstream file(fullPath, std::ios::binary);
+		if (!file) {
+			return false;
+		}
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		source = contents.str();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		//a file read before an invalidate may be stale, it must not go back into the cache
+		if (m_generation == generation) {
+			m_fileCache.emplace(path, source);
+		}
+		return true;
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace eng {
+
+	struct PreprocessedShader {
+		std::string source;
+		//every file that went into the source, the shader itself first
+		std::vector<std::string> dependencies;
+	};
+
+	//resolves #include "file" directives in shader sources
+	//raw files and expanded results are cached until one of the files they depend on is invalidated
+	//safe to call from several job system workers at once
+	class ShaderPreprocessor {
+	public:
+		void SetRootPath(const std::string& rootPath);
+
+		//path is relative to the root, source is the already loaded contents of that file
+		bool Preprocess(const std::string& path, const std::string& source, PreprocessedShader& result);
+		//drops the cached contents of the file and every expanded result that included it
+		void Invalidate(const std::string& path);
+		//also forgets the root path, SetRootPath has to run again before the next Preprocess
+		void Clear();
+
+		//turns "shaders/a/../b.glsl" into "shaders/b.glsl" so every file has exactly one cache key
+		static std::string NormalizePath(const std::string& path);
+		//resolves #ifdef, #ifndef, #if (!)defined, #elif, #else and #endif on the keywords, bit i of key defines keywords[i]
+		//conditions on anything else are left for the compiler, enabled keywords still mentioned after that get a #define
+		//below #version, so two keys only give the same result when they really build the same shader
+		static bool ApplyKeywords(const std::string& source, const std::vector<std::string>& keywords, uint64_t key, std::string& result);
+
+	private:
+		//both run without the lock held, only the cache lookups and inserts take it
+		//generation is m_generation when the preprocess started, reads from before an invalidate are not cached
+		bool Expand(const std::string& path, const std::string& source, PreprocessedShader& result, std::unordered_set<std::string>& included, int depth, uint64_t generation);
+		bool LoadFile(const std::string& path, std::string& source, uint64_t generation);
+
+		std::mutex m_mutex;
+		//bumped whenever cached files are dropped
+		uint64_t m_generation = 0;
+		std::string m_rootPath;
+		std::unordered_map<std::string, std::string> m_fileCache;
+		std::unordered_map<std::string, PreprocessedShader> m_resultCache;
+	};
+}
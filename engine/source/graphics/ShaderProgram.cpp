@@ -1,9 +1,46 @@
 #include "graphics/ShaderProgram.h"
+#include "graphics/GLTrace.h"
+#include "log/Log.h"
+#include <algorithm>
 
 namespace eng {
 
+	namespace {
+
+		//attributes the engine feeds through glVertexAttribPointer, integer ones would read float bits
+		bool IsFloatAttribute(GLenum type) {
+			switch (type) {
+			case GL_FLOAT:
+			case GL_FLOAT_VEC2:
+			case GL_FLOAT_VEC3:
+			case GL_FLOAT_VEC4:
+			case GL_FLOAT_MAT2:
+			case GL_FLOAT_MAT3:
+			case GL_FLOAT_MAT4:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		//a matrix takes one location per column
+		GLint LocationsPerElement(GLenum type) {
+			switch (type) {
+			case GL_FLOAT_MAT2:
+				return 2;
+			case GL_FLOAT_MAT3:
+				return 3;
+			case GL_FLOAT_MAT4:
+				return 4;
+			default:
+				return 1;
+			}
+		}
+	}
+
 	ShaderProgram::ShaderProgram(GLuint shaderProgramID) : m_shaderProgramID(shaderProgramID) {
 
+		Reflect();
 	}
 	ShaderProgram::~ShaderProgram() {
 
@@ -13,6 +50,29 @@ namespace eng {
 	void ShaderProgram::Bind() {
 
 		glUseProgram(m_shaderProgramID);
+		if (GLTrace* trace = GLTrace::GetActive()) {
+			trace->OnUseProgram(m_shaderProgramID);
+		}
+	}
+
+	void ShaderProgram::SwapProgram(GLuint shaderProgramID) {
+
+		glDeleteProgram(m_shaderProgramID);
+		m_shaderProgramID = shaderProgramID;
+		//locations belong to the old program
+		m_uniformLocationCache.clear();
+		Reflect();
+		++m_version;
+	}
+
+	uint32_t ShaderProgram::GetVersion() const {
+
+		return m_version;
+	}
+
+	GLuint ShaderProgram::GetProgramID() const {
+
+		return m_shaderProgramID;
 	}
 
 	GLint ShaderProgram::GetUniformLocation(const std::string& name) {
@@ -29,7 +89,166 @@ namespace eng {
 
 	void ShaderProgram::SetUniform(const std::string& name, float value) {
 
-		auto location = GetUniformLocation(name);
+		SetUniform(GetUniformLocation(name), value);
+	}
+
+	void ShaderProgram::SetUniform(const std::string& name, int value) {
+
+		SetUniform(GetUniformLocation(name), value);
+	}
+
+	void ShaderProgram::SetUniform(GLint location, float value) {
+
 		glUniform1f(location, value);
+		if (GLTrace* trace = GLTrace::GetActive()) {
+			trace->OnUniform(location, value);
+		}
+	}
+
+	void ShaderProgram::SetUniform(GLint location, int value) {
+
+		glUniform1i(location, value);
+		if (GLTrace* trace = GLTrace::GetActive()) {
+			trace->OnUniform(location, value);
+		}
+	}
+
+	const ShaderReflection& ShaderProgram::GetReflection() const {
+
+		return m_reflection;
+	}
+
+	const ShaderUniformInfo* ShaderProgram::FindUniform(const std::string& name) const {
+
+		auto it = m_uniformIndices.find(name);
+		return it != m_uniformIndices.end() ? &m_reflection.uniforms[it->second] : nullptr;
+	}
+
+	const ShaderBlockInfo* ShaderProgram::FindBlock(const std::string& name) const {
+
+		auto it = m_blockIndices.find(name);
+		return it != m_blockIndices.end() ? &m_reflection.blocks[it->second] : nullptr;
+	}
+
+	const ShaderAttributeInfo* ShaderProgram::FindAttribute(GLint location) const {
+
+		for (const auto& attribute : m_reflection.attributes) {
+			if (attribute.location == location) {
+				return &attribute;
+			}
+		}
+		return nullptr;
+	}
+
+	bool ShaderProgram::ValidateVertexLayout(const std::vector<VertexAttribute>& attributes) const {
+
+		bool valid = true;
+		for (const auto& attribute : m_reflection.attributes) {
+			//built-ins like gl_VertexID have no location and no buffer behind them
+			if (attribute.location < 0) {
+				continue;
+			}
+			if (!IsFloatAttribute(attribute.type)) {
+				LOG_ERROR(Graphics, "VERTEX_LAYOUT_TYPE_MISMATCH: {} at location {} is not a float attribute", attribute.name, attribute.location);
+				valid = false;
+				continue;
+			}
+			//every column of a matrix and every element of an array is fed separately
+			GLint end = attribute.location + LocationsPerElement(attribute.type) * std::max(attribute.size, 1);
+			for (GLint location = attribute.location; location < end; ++location) {
+				auto it = std::find_if(attributes.begin(), attributes.end(), [location](const VertexAttribute& provided) {
+					return GLint(provided.location) == location;
+				});
+				if (it == attributes.end()) {
+					LOG_ERROR(Graphics, "VERTEX_LAYOUT_MISSING_ATTRIBUTE: {} at location {}", attribute.name, location);
+					valid = false;
+				}
+			}
+		}
+		return valid;
+	}
+
+	void ShaderProgram::Reflect() {
+
+		m_reflection = ShaderReflection();
+		m_uniformIndices.clear();
+		m_blockIndices.clear();
+		if (m_shaderProgramID == 0) {
+			return;
+		}
+
+		GLint count = 0;
+		GLint maxLength = 0;
+		glGetProgramiv(m_shaderProgramID, GL_ACTIVE_ATTRIBUTES, &count);
+		glGetProgramiv(m_shaderProgramID, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+		std::string name(size_t(std::max(maxLength, 1)), '\0');
+		for (GLint i = 0; i < count; ++i) {
+			GLsizei length = 0;
+			ShaderAttributeInfo attribute;
+			glGetActiveAttrib(m_shaderProgramID, GLuint(i), GLsizei(name.size()), &length, &attribute.size, &attribute.type, &name[0]);
+			attribute.name.assign(name.data(), size_t(length));
+			attribute.location = glGetAttribLocation(m_shaderProgramID, attribute.name.c_str());
+			m_reflection.attributes.push_back(std::move(attribute));
+		}
+
+		glGetProgramiv(m_shaderProgramID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(m_shaderProgramID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		name.assign(size_t(std::max(maxLength, 1)), '\0');
+		std::vector<GLuint> indices(size_t(std::max(count, 0)));
+		for (GLint i = 0; i < count; ++i) {
+			indices[size_t(i)] = GLuint(i);
+		}
+		std::vector<GLint> blockIndices(indices.size());
+		std::vector<GLint> offsets(indices.size());
+		std::vector<GLint> arrayStrides(indices.size());
+		std::vector<GLint> matrixStrides(indices.size());
+		if (count > 0) {
+			glGetActiveUniformsiv(m_shaderProgramID, count, indices.data(), GL_UNIFORM_BLOCK_INDEX, blockIndices.data());
+			glGetActiveUniformsiv(m_shaderProgramID, count, indices.data(), GL_UNIFORM_OFFSET, offsets.data());
+			glGetActiveUniformsiv(m_shaderProgramID, count, indices.data(), GL_UNIFORM_ARRAY_STRIDE, arrayStrides.data());
+			glGetActiveUniformsiv(m_shaderProgramID, count, indices.data(), GL_UNIFORM_MATRIX_STRIDE, matrixStrides.data());
+		}
+		for (GLint i = 0; i < count; ++i) {
+			GLsizei length = 0;
+			ShaderUniformInfo uniform;
+			glGetActiveUniform(m_shaderProgramID, GLuint(i), GLsizei(name.size()), &length, &uniform.size, &uniform.type, &name[0]);
+			uniform.name.assign(name.data(), size_t(length));
+			if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0) {
+				uniform.name.resize(uniform.name.size() - 3);
+			}
+			uniform.blockIndex = blockIndices[size_t(i)];
+			uniform.arrayStride = arrayStrides[size_t(i)];
+			uniform.matrixStride = matrixStrides[size_t(i)];
+			if (uniform.blockIndex >= 0) {
+				uniform.blockOffset = offsets[size_t(i)];
+			}
+			else {
+				uniform.location = glGetUniformLocation(m_shaderProgramID, uniform.name.c_str());
+				//the first SetUniform of every active uniform skips the driver as well
+				m_uniformLocationCache[uniform.name] = uniform.location;
+			}
+			m_uniformIndices[uniform.name] = m_reflection.uniforms.size();
+			m_reflection.uniforms.push_back(std::move(uniform));
+		}
+
+		glGetProgramiv(m_shaderProgramID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+		glGetProgramiv(m_shaderProgramID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+		name.assign(size_t(std::max(maxLength, 1)), '\0');
+		for (GLint i = 0; i < count; ++i) {
+			GLsizei length = 0;
+			ShaderBlockInfo block;
+			block.index = GLuint(i);
+			glGetActiveUniformBlockName(m_shaderProgramID, block.index, GLsizei(name.size()), &length, &name[0]);
+			block.name.assign(name.data(), size_t(length));
+			glGetActiveUniformBlockiv(m_shaderProgramID, block.index, GL_UNIFORM_BLOCK_BINDING, &block.binding);
+			glGetActiveUniformBlockiv(m_shaderProgramID, block.index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+			for (size_t member = 0; member < m_reflection.uniforms.size(); ++member) {
+				if (m_reflection.uniforms[member].blockIndex == i) {
+					block.members.push_back(member);
+				}
+			}
+			m_blockIndices[block.name] = m_reflection.blocks.size();
+			m_reflection.blocks.push_back(std::move(block));
+		}
 	}
-}
\ No newline at end of file
+}
@@ -1,12 +1,52 @@
 #pragma once
 
 
+#include "graphics/MeshData.h"
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <GL/glew.h>
 
 namespace eng {
 
+	struct ShaderAttributeInfo {
+		std::string name;
+		GLenum type = 0;
+		GLint size = 0;
+		GLint location = -1;
+	};
+
+	//arrays are listed once, under their name without the [0]
+	struct ShaderUniformInfo {
+		std::string name;
+		GLenum type = 0;
+		//array length, 1 for plain uniforms
+		GLint size = 0;
+		//-1 for members of a uniform block, they are set through the block's buffer
+		GLint location = -1;
+		GLint blockIndex = -1;
+		//in bytes from the start of the block, -1 outside of blocks
+		GLint blockOffset = -1;
+		GLint arrayStride = 0;
+		GLint matrixStride = 0;
+	};
+
+	struct ShaderBlockInfo {
+		std::string name;
+		GLuint index = 0;
+		GLint binding = 0;
+		GLint dataSize = 0;
+		//indices into ShaderReflection::uniforms
+		std::vector<size_t> members;
+	};
+
+	//what the linker kept of a program, anything the compiler optimized away is missing
+	struct ShaderReflection {
+		std::vector<ShaderAttributeInfo> attributes;
+		std::vector<ShaderUniformInfo> uniforms;
+		std::vector<ShaderBlockInfo> blocks;
+	};
+
 	class ShaderProgram {
 	public:
 		
@@ -17,11 +57,36 @@ namespace eng {
 		explicit ShaderProgram(GLuint shaderProgramID);
 		~ShaderProgram();
 		void Bind();
+		//takes ownership of a freshly linked program and releases the old one
+		//everything holding this shader program (materials etc) picks up the new one on its next bind
+		void SwapProgram(GLuint shaderProgramID);
+		//bumped by every SwapProgram, lets materials notice a hot reload
+		uint32_t GetVersion() const;
+		GLuint GetProgramID() const;
 		GLint GetUniformLocation(const std::string& name);
 		void SetUniform(const std::string& name, float value);
+		void SetUniform(const std::string& name, int value);
+		//for callers that looked the location up once, -1 is ignored like gl does
+		void SetUniform(GLint location, float value);
+		void SetUniform(GLint location, int value);
+
+		//queried once when the program is created or swapped, lookups never reach the driver
+		const ShaderReflection& GetReflection() const;
+		const ShaderUniformInfo* FindUniform(const std::string& name) const;
+		const ShaderBlockInfo* FindBlock(const std::string& name) const;
+		const ShaderAttributeInfo* FindAttribute(GLint location) const;
+		//every attribute the program reads has to come from the layout as floats, missing ones are reported
+		//call it once when a mesh is paired with the program, not per draw
+		bool ValidateVertexLayout(const std::vector<VertexAttribute>& attributes) const;
 
 	private:
+		void Reflect();
+
 		std::unordered_map<std::string, GLint> m_uniformLocationCache;
+		ShaderReflection m_reflection;
+		std::unordered_map<std::string, size_t> m_uniformIndices;
+		std::unordered_map<std::string, size_t> m_blockIndices;
 		GLuint m_shaderProgramID = 0;
+		uint32_t m_version = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "graphics/StagingBuffer.h"
+#include "log/Log.h"
+#include <cstring>
+
+namespace eng {
+
+	bool StagingBuffer::StagePixels(const void* data, size_t size) {
+		if (!Fill(GL_PIXEL_UNPACK_BUFFER, data, size)) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			return false;
+		}
+		return true;
+	}
+
+	void StagingBuffer::FinishPixels() {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	bool StagingBuffer::UploadBuffer(GLuint buffer, const void* data, size_t size, GLenum usage) {
+		if (!Fill(GL_COPY_READ_BUFFER, data, size)) {
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			return false;
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(size), nullptr, usage);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(size));
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		return true;
+	}
+
+	void StagingBuffer::Destroy() {
+		if (m_bufferID != 0) {
+			glDeleteBuffers(1, &m_bufferID);
+			m_bufferID = 0;
+		}
+	}
+
+	uint64_t StagingBuffer::GetStagedBytes() const {
+		return m_stagedBytes;
+	}
+
+	bool StagingBuffer::Fill(GLenum target, const void* data, size_t size) {
+		if (m_bufferID == 0) {
+			glGenBuffers(1, &m_bufferID);
+		}
+		glBindBuffer(target, m_bufferID);
+		//fresh storage every time, the driver keeps the old one alive until the gpu is done with it
+		glBufferData(target, GLsizeiptr(size), nullptr, GL_STREAM_DRAW);
+		if (size == 0) {
+			return true;
+		}
+		void* mapped = glMapBufferRange(target, 0, GLsizeiptr(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (!mapped) {
+			LOG_ERROR(Graphics, "STAGING_MAP_FAILED: {} bytes", size);
+			return false;
+		}
+		std::memcpy(mapped, data, size);
+		//the contents are undefined when unmapping fails, e.g. after a display mode change
+		if (!glUnmapBuffer(target)) {
+			LOG_ERROR(Graphics, "STAGING_UNMAP_FAILED: {} bytes", size);
+			return false;
+		}
+		m_stagedBytes += size;
+		return true;
+	}
+}
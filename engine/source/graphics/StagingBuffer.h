@@ -0,0 +1,37 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace eng {
+
+	//buffer object uploads are copied through instead of handing client memory to gl directly
+	//it is orphaned on every use, so a copy never waits for the gpu to finish reading the previous one
+	//the buffer lives in whatever context is current on first use, each uploading thread needs its own
+	class StagingBuffer {
+	public:
+		StagingBuffer() = default;
+		StagingBuffer(const StagingBuffer&) = delete;
+		StagingBuffer& operator=(const StagingBuffer&) = delete;
+
+		//copies data in and leaves the buffer bound to GL_PIXEL_UNPACK_BUFFER, the glTexImage calls that follow
+		//take a byte offset into data in place of a pointer, see PixelOffset
+		bool StagePixels(const void* data, size_t size);
+		static const void* PixelOffset(size_t offset) { return reinterpret_cast<const void*>(offset); }
+		//unbinds the pixel unpack buffer again, texture uploads from client memory would read from it otherwise
+		void FinishPixels();
+		//replaces the contents of buffer with data, copied on the gpu from the staging buffer
+		bool UploadBuffer(GLuint buffer, const void* data, size_t size, GLenum usage = GL_STATIC_DRAW);
+
+		//needs the context the buffer was created in, or one sharing with it
+		void Destroy();
+		uint64_t GetStagedBytes() const;
+
+	private:
+		bool Fill(GLenum target, const void* data, size_t size);
+
+		GLuint m_bufferID = 0;
+		uint64_t m_stagedBytes = 0;
+	};
+}
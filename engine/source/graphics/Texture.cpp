@@ -0,0 +1,64 @@
+#include "graphics/Texture.h"
+#include "graphics/GLTrace.h"
+#include <algorithm>
+
+namespace eng {
+
+	Texture::Texture(const std::string& path) : m_path(path) {
+
+	}
+	Texture::~Texture() {
+
+		if (m_textureID != 0) {
+			glDeleteTextures(1, &m_textureID);
+		}
+	}
+
+	void Texture::Bind(int unit) {
+
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, m_textureID);
+		if (GLTrace* trace = GLTrace::GetActive()) {
+			trace->OnBindTexture(unit, m_textureID);
+		}
+		m_usedThisFrame = true;
+	}
+
+	void Texture::RequestResolution(float screenPixels) {
+
+		m_requestedPixels = std::max(m_requestedPixels, screenPixels);
+		m_usedThisFrame = true;
+	}
+
+	const std::string& Texture::GetPath() const {
+		return m_path;
+	}
+
+	bool Texture::IsFailed() const {
+		return m_failed;
+	}
+
+	bool Texture::IsResident() const {
+		return m_headerReady && m_residentMip <= m_tailMip;
+	}
+
+	int Texture::GetWidth() const {
+		return m_info.width;
+	}
+
+	int Texture::GetHeight() const {
+		return m_info.height;
+	}
+
+	int Texture::GetMipCount() const {
+		return int(m_info.levels.size());
+	}
+
+	int Texture::GetResidentMip() const {
+		return m_residentMip;
+	}
+
+	uint64_t Texture::GetResidentBytes() const {
+		return m_residentBytes;
+	}
+}
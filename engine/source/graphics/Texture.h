@@ -0,0 +1,61 @@
+#pragma once
+
+#include "assets/AssetManager.h"
+#include "graphics/TextureFormat.h"
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+
+namespace eng {
+
+	//a block compressed 2D texture whose mips are streamed in and out by the texture manager
+	//only the mips from GetResidentMip() down to the coarsest one live on the gpu at any time
+	class Texture {
+	public:
+		//avoid copying the texture object, ensures the gl texture is created and destroyed exactly once
+		Texture() = delete;
+		Texture(const Texture&) = delete;
+		Texture& operator=(const Texture&) = delete;
+		explicit Texture(const std::string& path);
+		~Texture();
+
+		void Bind(int unit);
+		//tells the streamer how many screen pixels the texture covers along its longest side this frame
+		//call it for every use, the largest request of the frame wins
+		void RequestResolution(float screenPixels);
+
+		const std::string& GetPath() const;
+		bool IsFailed() const;
+		//true once at least the coarse mips are on the gpu and the texture can be sampled
+		bool IsResident() const;
+		int GetWidth() const;
+		int GetHeight() const;
+		int GetMipCount() const;
+		//finest mip currently on the gpu, equal to the mip count while nothing is resident
+		int GetResidentMip() const;
+		uint64_t GetResidentBytes() const;
+
+	private:
+		GLuint m_textureID = 0;
+		std::string m_path;
+		TextureFileInfo m_info;
+		bool m_headerReady = false;
+		bool m_failed = false;
+		int m_residentMip = 0;
+		//coarsest mips are uploaded together and never evicted
+		int m_tailMip = 0;
+		uint64_t m_residentBytes = 0;
+
+		//0 when nobody reported a coverage this frame, a texture that is only bound is wanted at full resolution
+		float m_requestedPixels = 0.0f;
+		bool m_usedThisFrame = false;
+		uint64_t m_lastUsedFrame = 0;
+		int m_desiredMip = 0;
+		//header, tail or the next finer mip that is on its way, at most one per texture
+		AssetHandle<Texture> m_pendingLoad;
+		uint64_t m_pendingBytes = 0;
+
+		//only the texture manager streams mips
+		friend class TextureManager;
+	};
+}
@@ -0,0 +1,262 @@
+#include "graphics/TextureFormat.h"
+#include <algorithm>
+#include <cstring>
+
+namespace eng {
+
+	namespace {
+		//the largest texture gl has to support, the header of a broken file must not decide how many levels get queued
+		const uint32_t kMaxTextureDimension = 16384;
+		//DDS_HEADER flag telling the mip count field is valid
+		const uint32_t kDDSMipMapCount = 0x20000;
+
+		//a full chain ends at 1x1, 1 + floor(log2(max(width, height))) levels
+		uint32_t MaxLevelCount(uint32_t width, uint32_t height) {
+			uint32_t count = 1;
+			for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+				++count;
+			}
+			return count;
+		}
+
+		bool CheckDimensions(uint32_t width, uint32_t height, uint32_t levelCount, const char* container, std::string& error) {
+			if (width == 0 || height == 0 || width > kMaxTextureDimension || height > kMaxTextureDimension) {
+				error = std::string(container) + " size " + std::to_string(width) + "x" + std::to_string(height) + " is outside 1.." + std::to_string(kMaxTextureDimension);
+				return false;
+			}
+			if (levelCount > MaxLevelCount(width, height)) {
+				error = std::string(container) + " claims " + std::to_string(levelCount) + " mip levels, a " + std::to_string(width) + "x" + std::to_string(height) + " texture has at most " + std::to_string(MaxLevelCount(width, height));
+				return false;
+			}
+			return true;
+		}
+
+		template<typename T>
+		T Read(const std::string& data, size_t offset) {
+			T value;
+			std::memcpy(&value, data.data() + offset, sizeof(T));
+			return value;
+		}
+
+		uint32_t FourCC(char a, char b, char c, char d) {
+			return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+		}
+
+		GLenum FormatFromDXGI(uint32_t dxgiFormat) {
+			switch (dxgiFormat) {
+			case 71: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			case 72: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+			case 74: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+			case 75: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+			case 77: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			case 78: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+			case 80: return GL_COMPRESSED_RED_RGTC1;
+			case 81: return GL_COMPRESSED_SIGNED_RED_RGTC1;
+			case 83: return GL_COMPRESSED_RG_RGTC2;
+			case 84: return GL_COMPRESSED_SIGNED_RG_RGTC2;
+			case 95: return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+			case 96: return GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT;
+			case 98: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+			case 99: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+			default: return 0;
+			}
+		}
+
+		GLenum FormatFromVulkan(uint32_t vkFormat) {
+			switch (vkFormat) {
+			case 131: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			case 132: return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+			case 133: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			case 134: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+			case 135: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+			case 136: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+			case 137: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			case 138: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+			case 139: return GL_COMPRESSED_RED_RGTC1;
+			case 140: return GL_COMPRESSED_SIGNED_RED_RGTC1;
+			case 141: return GL_COMPRESSED_RG_RGTC2;
+			case 142: return GL_COMPRESSED_SIGNED_RG_RGTC2;
+			case 143: return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+			case 144: return GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT;
+			case 145: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+			case 146: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+			default: return 0;
+			}
+		}
+	}
+
+	bool TextureFormat::ParseHeader(const std::string& header, TextureFileInfo& info, std::string& error) {
+		static const unsigned char ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+		if (header.size() >= 4 && header.compare(0, 4, "DDS ") == 0) {
+			return ParseDDS(header, info, error);
+		}
+		if (header.size() >= sizeof(ktx2Identifier) && std::memcmp(header.data(), ktx2Identifier, sizeof(ktx2Identifier)) == 0) {
+			return ParseKTX2(header, info, error);
+		}
+		error = "unknown texture container, expected DDS or KTX2";
+		return false;
+	}
+
+	uint64_t TextureFormat::GetLevelSize(GLenum internalFormat, int width, int height) {
+		uint64_t blocksX = std::max(1, (width + 3) / 4);
+		uint64_t blocksY = std::max(1, (height + 3) / 4);
+		return blocksX * blocksY * GetBlockSize(internalFormat);
+	}
+
+	bool TextureFormat::ParseDDS(const std::string& header, TextureFileInfo& info, std::string& error) {
+		//magic + DDS_HEADER
+		const size_t headerSize = 4 + 124;
+		if (header.size() < headerSize || Read<uint32_t>(header, 4) != 124) {
+			error = "truncated DDS header";
+			return false;
+		}
+
+		uint32_t flags = Read<uint32_t>(header, 8);
+		uint32_t height = Read<uint32_t>(header, 12);
+		uint32_t width = Read<uint32_t>(header, 16);
+		//writers leave the count at anything when the flag is not set, the file then holds the top level only
+		uint32_t mipCount = (flags & kDDSMipMapCount) ? std::max<uint32_t>(Read<uint32_t>(header, 28), 1) : 1;
+		if (!CheckDimensions(width, height, mipCount, "DDS", error)) {
+			return false;
+		}
+		info.width = int(width);
+		info.height = int(height);
+		uint32_t depth = Read<uint32_t>(header, 24);
+		uint32_t fourCC = Read<uint32_t>(header, 84);
+		uint32_t caps2 = Read<uint32_t>(header, 112);
+		size_t dataOffset = headerSize;
+
+		//cubemap or volume flags
+		if ((caps2 & 0x200) || (caps2 & 0x200000) || depth > 1) {
+			error = "only 2D DDS textures are supported";
+			return false;
+		}
+
+		if (fourCC == FourCC('D', 'X', 'T', '1')) {
+			info.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		}
+		else if (fourCC == FourCC('D', 'X', 'T', '3')) {
+			info.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+		}
+		else if (fourCC == FourCC('D', 'X', 'T', '5')) {
+			info.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		}
+		else if (fourCC == FourCC('A', 'T', 'I', '1') || fourCC == FourCC('B', 'C', '4', 'U')) {
+			info.internalFormat = GL_COMPRESSED_RED_RGTC1;
+		}
+		else if (fourCC == FourCC('A', 'T', 'I', '2') || fourCC == FourCC('B', 'C', '5', 'U')) {
+			info.internalFormat = GL_COMPRESSED_RG_RGTC2;
+		}
+		else if (fourCC == FourCC('D', 'X', '1', '0')) {
+			//DDS_HEADER_DXT10 follows the regular header
+			if (header.size() < headerSize + 20) {
+				error = "truncated DDS DX10 header";
+				return false;
+			}
+			info.internalFormat = FormatFromDXGI(Read<uint32_t>(header, headerSize));
+			uint32_t arraySize = Read<uint32_t>(header, headerSize + 12);
+			if (arraySize > 1) {
+				error = "DDS texture arrays are not supported";
+				return false;
+			}
+			dataOffset += 20;
+		}
+
+		if (info.internalFormat == 0) {
+			error = "DDS file is not block compressed (BC1-BC7)";
+			return false;
+		}
+
+		//levels are stored largest first, one after the other
+		uint64_t offset = dataOffset;
+		int levelWidth = info.width;
+		int levelHeight = info.height;
+		for (uint32_t i = 0; i < mipCount; ++i) {
+			TextureLevel level;
+			level.width = levelWidth;
+			level.height = levelHeight;
+			level.offset = offset;
+			level.size = GetLevelSize(info.internalFormat, levelWidth, levelHeight);
+			offset += level.size;
+			info.levels.push_back(level);
+			levelWidth = std::max(1, levelWidth / 2);
+			levelHeight = std::max(1, levelHeight / 2);
+		}
+		return true;
+	}
+
+	bool TextureFormat::ParseKTX2(const std::string& header, TextureFileInfo& info, std::string& error) {
+		//identifier, 9 header fields and the index
+		const size_t headerSize = 80;
+		if (header.size() < headerSize) {
+			error = "truncated KTX2 header";
+			return false;
+		}
+
+		uint32_t vkFormat = Read<uint32_t>(header, 12);
+		uint32_t width = Read<uint32_t>(header, 20);
+		uint32_t height = Read<uint32_t>(header, 24);
+		uint32_t depth = Read<uint32_t>(header, 28);
+		uint32_t layerCount = Read<uint32_t>(header, 32);
+		uint32_t faceCount = Read<uint32_t>(header, 36);
+		uint32_t levelCount = std::max<uint32_t>(Read<uint32_t>(header, 40), 1);
+		uint32_t supercompression = Read<uint32_t>(header, 44);
+
+		if (depth > 1 || layerCount > 1 || faceCount != 1 || height == 0) {
+			error = "only 2D KTX2 textures are supported";
+			return false;
+		}
+		if (!CheckDimensions(width, height, levelCount, "KTX2", error)) {
+			return false;
+		}
+		info.width = int(width);
+		info.height = int(height);
+		if (supercompression != 0) {
+			error = "supercompressed KTX2 files are not supported, cook them with supercompression disabled";
+			return false;
+		}
+		info.internalFormat = FormatFromVulkan(vkFormat);
+		if (info.internalFormat == 0) {
+			error = "KTX2 file is not block compressed (BC1-BC7)";
+			return false;
+		}
+
+		//the level index comes right after the header, level 0 first
+		if (header.size() < headerSize + levelCount * 24) {
+			error = "truncated KTX2 level index";
+			return false;
+		}
+		int levelWidth = info.width;
+		int levelHeight = info.height;
+		for (uint32_t i = 0; i < levelCount; ++i) {
+			TextureLevel level;
+			level.width = levelWidth;
+			level.height = levelHeight;
+			level.offset = Read<uint64_t>(header, headerSize + i * 24);
+			level.size = Read<uint64_t>(header, headerSize + i * 24 + 8);
+			if (level.size != GetLevelSize(info.internalFormat, levelWidth, levelHeight)) {
+				error = "KTX2 level size does not match its format";
+				return false;
+			}
+			info.levels.push_back(level);
+			levelWidth = std::max(1, levelWidth / 2);
+			levelHeight = std::max(1, levelHeight / 2);
+		}
+		return true;
+	}
+
+	int TextureFormat::GetBlockSize(GLenum internalFormat) {
+		switch (internalFormat) {
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RED_RGTC1:
+		case GL_COMPRESSED_SIGNED_RED_RGTC1:
+			return 8;
+		default:
+			return 16;
+		}
+	}
+}
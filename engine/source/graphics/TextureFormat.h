@@ -0,0 +1,41 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace eng {
+
+	struct TextureLevel {
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		int width = 0;
+		int height = 0;
+	};
+
+	//everything needed to stream a pre-compressed texture straight from its file, level 0 is the finest mip
+	struct TextureFileInfo {
+		GLenum internalFormat = 0;
+		int width = 0;
+		int height = 0;
+		std::vector<TextureLevel> levels;
+	};
+
+	//block compressed (BCn) 2D textures stored as DDS or KTX2 files
+	class TextureFormat {
+	public:
+		//enough bytes to hold the header and level index of any file we support
+		static const size_t kHeaderReadSize = 4096;
+
+		//header may be cut off after kHeaderReadSize, fileSize is not needed since levels are validated when they arrive
+		static bool ParseHeader(const std::string& header, TextureFileInfo& info, std::string& error);
+		static uint64_t GetLevelSize(GLenum internalFormat, int width, int height);
+
+	private:
+		static bool ParseDDS(const std::string& header, TextureFileInfo& info, std::string& error);
+		static bool ParseKTX2(const std::string& header, TextureFileInfo& info, std::string& error);
+		static int GetBlockSize(GLenum internalFormat);
+	};
+}
@@ -0,0 +1,364 @@
+#include "graphics/TextureManager.h"
+#include "log/Log.h"
+#include "graphics/Texture.h"
+#include "memory/MemoryPool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace eng {
+
+	//mips at or below this size are loaded together with the first request and stay resident
+	static const int kTailSize = 64;
+	//caps how many new mip requests a single frame can queue
+	static const int kMaxRequestsPerFrame = 8;
+	//getting a texture on screen at all beats sharpening one that is already there
+	static const float kTailPriority = 4.0f;
+	static const float kHeaderPriority = 3.0f;
+	static const float kLevelPriority = 1.0f;
+
+	void TextureManager::Init(AssetManager* assetManager) {
+		m_assetManager = assetManager;
+	}
+
+	void TextureManager::Shutdown() {
+		for (auto& texture : m_textures) {
+			ReleaseTexture(*texture);
+		}
+		m_textures = decltype(m_textures)();
+		m_texturesByPath = decltype(m_texturesByPath)();
+		m_residentBytes = 0;
+		m_pendingBytes = 0;
+	}
+
+	void TextureManager::Update() {
+		++m_frame;
+
+		//textures nobody references anymore give their memory back
+		for (auto it = m_textures.begin(); it != m_textures.end();) {
+			if (it->use_count() == 1) {
+				ReleaseTexture(**it);
+				m_texturesByPath.erase((*it)->GetPath());
+				it = m_textures.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+
+		std::vector<std::shared_ptr<Texture>> upgrades;
+		for (auto& texture : m_textures) {
+			SettlePendingLoad(texture);
+			if (!texture->m_headerReady || texture->m_failed) {
+				continue;
+			}
+
+			if (texture->m_usedThisFrame) {
+				texture->m_lastUsedFrame = m_frame;
+				//one mip per halving of the covered size, bound without coverage means full resolution
+				float size = float(std::max(texture->m_info.width, texture->m_info.height));
+				float pixels = texture->m_requestedPixels > 0.0f ? texture->m_requestedPixels : size;
+				int desired = int(std::floor(std::log2(size / std::max(pixels, 1.0f))));
+				texture->m_desiredMip = std::clamp(desired, 0, texture->m_tailMip);
+			}
+			texture->m_usedThisFrame = false;
+			texture->m_requestedPixels = 0.0f;
+
+			if (!texture->m_pendingLoad.IsValid() && texture->IsResident() && texture->m_residentMip > texture->m_desiredMip) {
+				upgrades.push_back(texture);
+			}
+		}
+
+		//the budget may have shrunk, or textures fell out of use
+		MakeRoom(0, nullptr);
+
+		//recently used textures that are furthest from their desired mip go first
+		std::sort(upgrades.begin(), upgrades.end(), [](const std::shared_ptr<Texture>& a, const std::shared_ptr<Texture>& b) {
+			if (a->m_lastUsedFrame != b->m_lastUsedFrame) {
+				return a->m_lastUsedFrame > b->m_lastUsedFrame;
+			}
+			return a->m_residentMip - a->m_desiredMip > b->m_residentMip - b->m_desiredMip;
+		});
+
+		int requests = 0;
+		for (auto& texture : upgrades) {
+			if (requests == kMaxRequestsPerFrame) {
+				break;
+			}
+			//always one level at a time, which streams coarse to fine
+			int level = texture->m_residentMip - 1;
+			if (!MakeRoom(texture->m_info.levels[level].size, texture.get())) {
+				continue;
+			}
+			RequestLevel(texture, level);
+			++requests;
+		}
+	}
+
+	std::shared_ptr<Texture> TextureManager::Load(const std::string& path) {
+		auto existing = m_texturesByPath.find(path);
+		if (existing != m_texturesByPath.end()) {
+			if (auto texture = existing->second.lock()) {
+				return texture;
+			}
+		}
+
+		auto texture = MakePooled<Texture>(path);
+		m_textures.push_back(texture);
+		m_texturesByPath[path] = texture;
+		RequestHeader(texture);
+		return texture;
+	}
+
+	void TextureManager::SetBudget(uint64_t bytes) {
+		m_budget = bytes;
+	}
+
+	uint64_t TextureManager::GetBudget() const {
+		return m_budget;
+	}
+
+	uint64_t TextureManager::GetResidentBytes() const {
+		return m_residentBytes;
+	}
+
+	size_t TextureManager::GetTextureCount() const {
+		return m_textures.size();
+	}
+
+	void TextureManager::RequestHeader(const std::shared_ptr<Texture>& texture) {
+		auto info = MakePooled<TextureFileInfo>();
+		std::weak_ptr<Texture> target = texture;
+		std::string path = texture->GetPath();
+
+		texture->m_pendingLoad = m_assetManager->Load<Texture>({ path }, { AssetFileRange{ 0, TextureFormat::kHeaderReadSize } }, kHeaderPriority,
+			[info, path](AssetManager::FileData& files) {
+				std::string error;
+				if (!TextureFormat::ParseHeader(files[0], *info, error)) {
+					LOG_ERROR(Graphics, "TEXTURE_HEADER_INVALID: {}: {}", path, error);
+					return false;
+				}
+				return true;
+			},
+			[this, target, info](AssetManager::FileData&) -> std::shared_ptr<Texture> {
+				auto texture = target.lock();
+				if (!texture) {
+					return nullptr;
+				}
+				texture->m_info = *info;
+				int mipCount = texture->GetMipCount();
+				texture->m_tailMip = mipCount - 1;
+				for (int i = 0; i < mipCount; ++i) {
+					if (std::max(info->levels[i].width, info->levels[i].height) <= kTailSize) {
+						texture->m_tailMip = i;
+						break;
+					}
+				}
+				texture->m_residentMip = mipCount;
+				texture->m_desiredMip = texture->m_tailMip;
+
+				//base level above max level keeps the texture incomplete until the tail arrives
+				glGenTextures(1, &texture->m_textureID);
+				glBindTexture(GL_TEXTURE_2D, texture->m_textureID);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, mipCount);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipCount - 1);
+				texture->m_headerReady = true;
+				return texture;
+			});
+	}
+
+	void TextureManager::RequestTail(const std::shared_ptr<Texture>& texture) {
+		const auto& levels = texture->m_info.levels;
+		int first = texture->m_tailMip;
+		int last = int(levels.size()) - 1;
+
+		//dds keeps the tail at the end of the file, ktx2 at the start of the data, either way it is one contiguous block
+		uint64_t begin = levels[first].offset;
+		uint64_t end = levels[first].offset + levels[first].size;
+		uint64_t bytes = 0;
+		for (int i = first; i <= last; ++i) {
+			begin = std::min(begin, levels[i].offset);
+			end = std::max(end, levels[i].offset + levels[i].size);
+			bytes += levels[i].size;
+		}
+
+		texture->m_pendingBytes = bytes;
+		m_pendingBytes += bytes;
+		std::weak_ptr<Texture> target = texture;
+		std::string path = texture->GetPath();
+		uint64_t expected = end - begin;
+
+		texture->m_pendingLoad = m_assetManager->Load<Texture>({ path }, { AssetFileRange{ begin, expected } }, kTailPriority,
+			[path, expected](AssetManager::FileData& files) {
+				if (files[0].size() != expected) {
+					LOG_ERROR(Graphics, "TEXTURE_DATA_TRUNCATED: {}", path);
+					return false;
+				}
+				return true;
+			},
+			//the header and the gl texture are in place, the levels go in below the base level where nothing samples them yet
+			[target, first, last, begin](AssetManager::FileData& files, StagingBuffer& staging) {
+				auto texture = target.lock();
+				if (!texture) {
+					return false;
+				}
+				if (!staging.StagePixels(files[0].data(), files[0].size())) {
+					return false;
+				}
+				const auto& info = texture->m_info;
+				glBindTexture(GL_TEXTURE_2D, texture->m_textureID);
+				for (int i = first; i <= last; ++i) {
+					const auto& level = info.levels[i];
+					glCompressedTexImage2D(GL_TEXTURE_2D, i, info.internalFormat, level.width, level.height, 0, GLsizei(level.size), StagingBuffer::PixelOffset(size_t(level.offset - begin)));
+				}
+				staging.FinishPixels();
+				glBindTexture(GL_TEXTURE_2D, 0);
+				return true;
+			},
+			[this, target, first, bytes](AssetManager::FileData&) -> std::shared_ptr<Texture> {
+				auto texture = target.lock();
+				if (!texture) {
+					return nullptr;
+				}
+				//binding again is what makes the levels the upload context wrote visible to this one
+				glBindTexture(GL_TEXTURE_2D, texture->m_textureID);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, first);
+				texture->m_residentMip = first;
+				texture->m_residentBytes += bytes;
+				m_residentBytes += bytes;
+				return texture;
+			});
+	}
+
+	void TextureManager::RequestLevel(const std::shared_ptr<Texture>& texture, int level) {
+		const auto& data = texture->m_info.levels[level];
+		texture->m_pendingBytes = data.size;
+		m_pendingBytes += data.size;
+
+		std::weak_ptr<Texture> target = texture;
+		std::string path = texture->GetPath();
+		uint64_t expected = data.size;
+		//textures on screen right now first, then coarser mips before finer ones
+		float priority = kLevelPriority + (texture->m_lastUsedFrame == m_frame ? 1.0f : 0.0f) + 1.0f / float(level + 2);
+
+		texture->m_pendingLoad = m_assetManager->Load<Texture>({ path }, { AssetFileRange{ data.offset, data.size } }, priority,
+			[path, expected](AssetManager::FileData& files) {
+				if (files[0].size() != expected) {
+					LOG_ERROR(Graphics, "TEXTURE_DATA_TRUNCATED: {}", path);
+					return false;
+				}
+				return true;
+			},
+			//one level below the base level, textures with a load in flight are never evicted so the chain stays intact
+			[target, level](AssetManager::FileData& files, StagingBuffer& staging) {
+				auto texture = target.lock();
+				if (!texture) {
+					return false;
+				}
+				if (!staging.StagePixels(files[0].data(), files[0].size())) {
+					return false;
+				}
+				const auto& info = texture->m_info;
+				const auto& data = info.levels[level];
+				glBindTexture(GL_TEXTURE_2D, texture->m_textureID);
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, info.internalFormat, data.width, data.height, 0, GLsizei(data.size), StagingBuffer::PixelOffset(0));
+				staging.FinishPixels();
+				glBindTexture(GL_TEXTURE_2D, 0);
+				return true;
+			},
+			[this, target, level](AssetManager::FileData&) -> std::shared_ptr<Texture> {
+				auto texture = target.lock();
+				if (!texture) {
+					return nullptr;
+				}
+				const auto& info = texture->m_info;
+				const auto& data = info.levels[level];
+				glBindTexture(GL_TEXTURE_2D, texture->m_textureID);
+				//a coarser mip went away after all, this one would leave a hole in the chain
+				if (texture->m_residentMip != level + 1) {
+					glCompressedTexImage2D(GL_TEXTURE_2D, level, info.internalFormat, 0, 0, 0, 0, nullptr);
+					return texture;
+				}
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+				texture->m_residentMip = level;
+				texture->m_residentBytes += data.size;
+				m_residentBytes += data.size;
+				return texture;
+			});
+	}
+
+	void TextureManager::SettlePendingLoad(const std::shared_ptr<Texture>& texture) {
+		if (!texture->m_pendingLoad.IsValid() || texture->m_pendingLoad.GetState() == AssetState::Loading) {
+			return;
+		}
+		bool failed = texture->m_pendingLoad.GetState() == AssetState::Failed;
+		m_pendingBytes -= texture->m_pendingBytes;
+		texture->m_pendingBytes = 0;
+		texture->m_pendingLoad = AssetHandle<Texture>();
+
+		if (failed) {
+			texture->m_failed = true;
+			return;
+		}
+		//the header is in, the coarse mips follow right away
+		if (texture->m_headerReady && texture->m_residentMip == texture->GetMipCount()) {
+			RequestTail(texture);
+		}
+	}
+
+	bool TextureManager::MakeRoom(uint64_t bytes, const Texture* requester) {
+		while (m_residentBytes + m_pendingBytes + bytes > m_budget) {
+			//first choice are mips finer than anyone asked for, then the least recently used ones
+			Texture* victim = nullptr;
+			for (auto& texture : m_textures) {
+				if (texture.get() == requester || texture->m_residentMip >= texture->m_tailMip || texture->m_pendingLoad.IsValid()) {
+					continue;
+				}
+				if (!victim) {
+					victim = texture.get();
+					continue;
+				}
+				bool wasteful = texture->m_residentMip < texture->m_desiredMip;
+				bool victimWasteful = victim->m_residentMip < victim->m_desiredMip;
+				if (wasteful != victimWasteful) {
+					if (wasteful) {
+						victim = texture.get();
+					}
+				}
+				else if (texture->m_lastUsedFrame < victim->m_lastUsedFrame) {
+					victim = texture.get();
+				}
+			}
+
+			//never evict something that is wanted on screen right now to make room for something else
+			if (!victim || (victim->m_residentMip >= victim->m_desiredMip && victim->m_lastUsedFrame == m_frame && requester)) {
+				return false;
+			}
+			EvictLevel(*victim);
+		}
+		return true;
+	}
+
+	void TextureManager::EvictLevel(Texture& texture) {
+		int level = texture.m_residentMip;
+		const auto& data = texture.m_info.levels[level];
+		//respecifying the level with zero size hands its memory back to the driver
+		glBindTexture(GL_TEXTURE_2D, texture.m_textureID);
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, texture.m_info.internalFormat, 0, 0, 0, 0, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+		texture.m_residentMip = level + 1;
+		texture.m_residentBytes -= data.size;
+		m_residentBytes -= data.size;
+	}
+
+	void TextureManager::ReleaseTexture(Texture& texture) {
+		m_residentBytes -= texture.m_residentBytes;
+		m_pendingBytes -= texture.m_pendingBytes;
+		texture.m_residentBytes = 0;
+		texture.m_pendingBytes = 0;
+		texture.m_pendingLoad = AssetHandle<Texture>();
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "assets/AssetManager.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eng {
+
+	class Texture;
+
+	//streams texture mips coarse to fine according to the screen coverage reported for each texture
+	//all textures share one vram budget, when it runs out the least recently used fine mips are evicted
+	class TextureManager {
+	private:
+		//only the engine creates and owns the texture manager
+		TextureManager() = default;
+		TextureManager(const TextureManager&) = delete;
+		TextureManager(TextureManager&&) = delete;
+		TextureManager& operator=(const TextureManager&) = delete;
+		TextureManager& operator=(TextureManager&&) = delete;
+
+	public:
+		void Init(AssetManager* assetManager);
+		void Shutdown();
+		//decides what to stream in or evict, called once per frame on the main thread after the application update
+		void Update();
+
+		//path is relative to the asset root, returns right away and the texture sharpens over the next frames
+		//loading the same path twice returns the same texture
+		std::shared_ptr<Texture> Load(const std::string& path);
+
+		void SetBudget(uint64_t bytes);
+		uint64_t GetBudget() const;
+		uint64_t GetResidentBytes() const;
+		size_t GetTextureCount() const;
+
+	private:
+		void RequestHeader(const std::shared_ptr<Texture>& texture);
+		void RequestTail(const std::shared_ptr<Texture>& texture);
+		void RequestLevel(const std::shared_ptr<Texture>& texture, int level);
+		void SettlePendingLoad(const std::shared_ptr<Texture>& texture);
+		//evicts fine mips of other textures until bytes more fit into the budget, false if that is not possible
+		bool MakeRoom(uint64_t bytes, const Texture* requester);
+		void EvictLevel(Texture& texture);
+		void ReleaseTexture(Texture& texture);
+
+		AssetManager* m_assetManager = nullptr;
+		std::vector<std::shared_ptr<Texture>> m_textures;
+		std::unordered_map<std::string, std::weak_ptr<Texture>> m_texturesByPath;
+		uint64_t m_budget = 256ull * 1024 * 1024;
+		uint64_t m_residentBytes = 0;
+		//reserved for loads in flight so several requests never overshoot the budget together
+		uint64_t m_pendingBytes = 0;
+		uint64_t m_frame = 0;
+
+		friend class Engine;
+	};
+}
@@ -0,0 +1,338 @@
+#include "input/ActionMap.h"
+#include "log/Log.h"
+#include "input/InputManager.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace eng {
+
+	namespace {
+
+		struct CodeName {
+			InputSource source;
+			const char* name;
+			int code;
+		};
+
+		//letters and digits are handled separately, their GLFW codes are their ascii values
+		const CodeName codeNames[] = {
+			{ InputSource::Key, "SPACE", GLFW_KEY_SPACE },
+			{ InputSource::Key, "APOSTROPHE", GLFW_KEY_APOSTROPHE },
+			{ InputSource::Key, "COMMA", GLFW_KEY_COMMA },
+			{ InputSource::Key, "MINUS", GLFW_KEY_MINUS },
+			{ InputSource::Key, "PERIOD", GLFW_KEY_PERIOD },
+			{ InputSource::Key, "SLASH", GLFW_KEY_SLASH },
+			{ InputSource::Key, "SEMICOLON", GLFW_KEY_SEMICOLON },
+			{ InputSource::Key, "EQUAL", GLFW_KEY_EQUAL },
+			{ InputSource::Key, "LEFT_BRACKET", GLFW_KEY_LEFT_BRACKET },
+			{ InputSource::Key, "BACKSLASH", GLFW_KEY_BACKSLASH },
+			{ InputSource::Key, "RIGHT_BRACKET", GLFW_KEY_RIGHT_BRACKET },
+			{ InputSource::Key, "GRAVE_ACCENT", GLFW_KEY_GRAVE_ACCENT },
+			{ InputSource::Key, "ESCAPE", GLFW_KEY_ESCAPE },
+			{ InputSource::Key, "ENTER", GLFW_KEY_ENTER },
+			{ InputSource::Key, "TAB", GLFW_KEY_TAB },
+			{ InputSource::Key, "BACKSPACE", GLFW_KEY_BACKSPACE },
+			{ InputSource::Key, "INSERT", GLFW_KEY_INSERT },
+			{ InputSource::Key, "DELETE", GLFW_KEY_DELETE },
+			{ InputSource::Key, "RIGHT", GLFW_KEY_RIGHT },
+			{ InputSource::Key, "LEFT", GLFW_KEY_LEFT },
+			{ InputSource::Key, "DOWN", GLFW_KEY_DOWN },
+			{ InputSource::Key, "UP", GLFW_KEY_UP },
+			{ InputSource::Key, "PAGE_UP", GLFW_KEY_PAGE_UP },
+			{ InputSource::Key, "PAGE_DOWN", GLFW_KEY_PAGE_DOWN },
+			{ InputSource::Key, "HOME", GLFW_KEY_HOME },
+			{ InputSource::Key, "END", GLFW_KEY_END },
+			{ InputSource::Key, "F1", GLFW_KEY_F1 },
+			{ InputSource::Key, "F2", GLFW_KEY_F2 },
+			{ InputSource::Key, "F3", GLFW_KEY_F3 },
+			{ InputSource::Key, "F4", GLFW_KEY_F4 },
+			{ InputSource::Key, "F5", GLFW_KEY_F5 },
+			{ InputSource::Key, "F6", GLFW_KEY_F6 },
+			{ InputSource::Key, "F7", GLFW_KEY_F7 },
+			{ InputSource::Key, "F8", GLFW_KEY_F8 },
+			{ InputSource::Key, "F9", GLFW_KEY_F9 },
+			{ InputSource::Key, "F10", GLFW_KEY_F10 },
+			{ InputSource::Key, "F11", GLFW_KEY_F11 },
+			{ InputSource::Key, "F12", GLFW_KEY_F12 },
+			{ InputSource::Key, "LEFT_SHIFT", GLFW_KEY_LEFT_SHIFT },
+			{ InputSource::Key, "LEFT_CONTROL", GLFW_KEY_LEFT_CONTROL },
+			{ InputSource::Key, "LEFT_ALT", GLFW_KEY_LEFT_ALT },
+			{ InputSource::Key, "RIGHT_SHIFT", GLFW_KEY_RIGHT_SHIFT },
+			{ InputSource::Key, "RIGHT_CONTROL", GLFW_KEY_RIGHT_CONTROL },
+			{ InputSource::Key, "RIGHT_ALT", GLFW_KEY_RIGHT_ALT },
+			{ InputSource::MouseButton, "LEFT", GLFW_MOUSE_BUTTON_LEFT },
+			{ InputSource::MouseButton, "RIGHT", GLFW_MOUSE_BUTTON_RIGHT },
+			{ InputSource::MouseButton, "MIDDLE", GLFW_MOUSE_BUTTON_MIDDLE },
+			{ InputSource::GamepadButton, "A", GLFW_GAMEPAD_BUTTON_A },
+			{ InputSource::GamepadButton, "B", GLFW_GAMEPAD_BUTTON_B },
+			{ InputSource::GamepadButton, "X", GLFW_GAMEPAD_BUTTON_X },
+			{ InputSource::GamepadButton, "Y", GLFW_GAMEPAD_BUTTON_Y },
+			{ InputSource::GamepadButton, "LEFT_BUMPER", GLFW_GAMEPAD_BUTTON_LEFT_BUMPER },
+			{ InputSource::GamepadButton, "RIGHT_BUMPER", GLFW_GAMEPAD_BUTTON_RIGHT_BUMPER },
+			{ InputSource::GamepadButton, "BACK", GLFW_GAMEPAD_BUTTON_BACK },
+			{ InputSource::GamepadButton, "START", GLFW_GAMEPAD_BUTTON_START },
+			{ InputSource::GamepadButton, "GUIDE", GLFW_GAMEPAD_BUTTON_GUIDE },
+			{ InputSource::GamepadButton, "LEFT_THUMB", GLFW_GAMEPAD_BUTTON_LEFT_THUMB },
+			{ InputSource::GamepadButton, "RIGHT_THUMB", GLFW_GAMEPAD_BUTTON_RIGHT_THUMB },
+			{ InputSource::GamepadButton, "DPAD_UP", GLFW_GAMEPAD_BUTTON_DPAD_UP },
+			{ InputSource::GamepadButton, "DPAD_RIGHT", GLFW_GAMEPAD_BUTTON_DPAD_RIGHT },
+			{ InputSource::GamepadButton, "DPAD_DOWN", GLFW_GAMEPAD_BUTTON_DPAD_DOWN },
+			{ InputSource::GamepadButton, "DPAD_LEFT", GLFW_GAMEPAD_BUTTON_DPAD_LEFT },
+			{ InputSource::GamepadAxis, "LEFT_X", GLFW_GAMEPAD_AXIS_LEFT_X },
+			{ InputSource::GamepadAxis, "LEFT_Y", GLFW_GAMEPAD_AXIS_LEFT_Y },
+			{ InputSource::GamepadAxis, "RIGHT_X", GLFW_GAMEPAD_AXIS_RIGHT_X },
+			{ InputSource::GamepadAxis, "RIGHT_Y", GLFW_GAMEPAD_AXIS_RIGHT_Y },
+			{ InputSource::GamepadAxis, "LEFT_TRIGGER", GLFW_GAMEPAD_AXIS_LEFT_TRIGGER },
+			{ InputSource::GamepadAxis, "RIGHT_TRIGGER", GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER }
+		};
+
+		const char* sourceNames[] = { "key", "mouse", "gamepad_button", "gamepad_axis" };
+
+		//analog values at or past this count as a press
+		const float pressThreshold = 0.5f;
+
+		float ReadInput(const InputManager& input, InputSource source, int code, float deadzone) {
+			switch (source) {
+			case InputSource::Key:
+				return input.IsKeyPressed(code) ? 1.0f : 0.0f;
+			case InputSource::MouseButton:
+				return input.IsMouseButtonPressed(code) ? 1.0f : 0.0f;
+			case InputSource::GamepadButton:
+				return input.IsGamepadButtonPressed(code) ? 1.0f : 0.0f;
+			case InputSource::GamepadAxis: {
+				float value = input.GetGamepadAxis(code);
+				return std::fabs(value) < deadzone ? 0.0f : value;
+			}
+			default:
+				return 0.0f;
+			}
+		}
+	}
+
+	ActionId ActionMap::AddAction(const std::string& name, ActionType type) {
+		auto it = m_names.find(name);
+		if (it != m_names.end()) {
+			return it->second;
+		}
+		ActionId id = static_cast<ActionId>(m_actions.size());
+		Action action;
+		action.name = name;
+		action.type = type;
+		m_actions.push_back(std::move(action));
+		m_names.emplace(name, id);
+		m_values.push_back(0.0f);
+		m_states.push_back(0);
+		return id;
+	}
+
+	ActionId ActionMap::GetAction(const std::string& name) const {
+		auto it = m_names.find(name);
+		return it != m_names.end() ? it->second : InvalidAction;
+	}
+
+	const std::string& ActionMap::GetName(ActionId action) const {
+		return m_actions[action].name;
+	}
+
+	size_t ActionMap::GetActionCount() const {
+		return m_actions.size();
+	}
+
+	void ActionMap::Bind(ActionId action, const InputBinding& binding) {
+		if (action >= m_actions.size()) {
+			return;
+		}
+		m_actions[action].bindings.push_back(binding);
+		m_dirty = true;
+	}
+
+	void ActionMap::Rebind(ActionId action, const std::vector<InputBinding>& bindings) {
+		if (action >= m_actions.size()) {
+			return;
+		}
+		m_actions[action].bindings = bindings;
+		m_dirty = true;
+	}
+
+	void ActionMap::ClearBindings(ActionId action) {
+		Rebind(action, {});
+	}
+
+	const std::vector<InputBinding>& ActionMap::GetBindings(ActionId action) const {
+		return m_actions[action].bindings;
+	}
+
+	bool ActionMap::Load(const std::string& path) {
+		std::ifstream file(path);
+		if (!file) {
+			LOG_ERROR(Input, "INPUT_BINDINGS_OPEN_FAILED: {}", path);
+			return false;
+		}
+
+		//collect everything first so a broken file leaves the current bindings alone
+		std::vector<std::pair<std::string, ActionType>> actions;
+		std::vector<std::vector<InputBinding>> bindings;
+		std::unordered_map<std::string, size_t> indices;
+
+		std::string line;
+		size_t lineNumber = 0;
+		while (std::getline(file, line)) {
+			++lineNumber;
+			std::istringstream stream(line);
+			std::string type, name, source, code;
+			if (!(stream >> type) || type[0] == '#') {
+				continue;
+			}
+			float scale = 1.0f;
+			stream >> name >> source >> code;
+			if (!(stream >> scale)) {
+				scale = 1.0f;
+			}
+
+			InputBinding binding;
+			binding.scale = scale;
+			if ((type != "button" && type != "axis") || name.empty() || !ParseInputBinding(source, code, binding)) {
+				LOG_ERROR(Input, "INPUT_BINDINGS_INVALID_LINE: {}:{}", path, lineNumber);
+				return false;
+			}
+
+			auto it = indices.find(name);
+			if (it == indices.end()) {
+				it = indices.emplace(name, actions.size()).first;
+				actions.emplace_back(name, type == "axis" ? ActionType::Axis : ActionType::Button);
+				bindings.emplace_back();
+			}
+			bindings[it->second].push_back(binding);
+		}
+
+		//the file only decides the type of actions the game has not added yet
+		for (size_t i = 0; i < actions.size(); ++i) {
+			Rebind(AddAction(actions[i].first, actions[i].second), bindings[i]);
+		}
+		return true;
+	}
+
+	bool ActionMap::Save(const std::string& path) const {
+		std::ofstream file(path);
+		if (!file) {
+			LOG_ERROR(Input, "INPUT_BINDINGS_SAVE_FAILED: {}", path);
+			return false;
+		}
+		for (const Action& action : m_actions) {
+			for (const InputBinding& binding : action.bindings) {
+				file << (action.type == ActionType::Axis ? "axis " : "button ") << action.name << " "
+					<< InputSourceName(binding.source) << " " << InputCodeName(binding.source, binding.code);
+				if (binding.scale != 1.0f) {
+					file << " " << binding.scale;
+				}
+				file << "\n";
+			}
+		}
+		return bool(file);
+	}
+
+	void ActionMap::SetDeadzone(float deadzone) {
+		m_deadzone = deadzone;
+	}
+
+	void ActionMap::Compile() {
+		for (auto& table : m_tables) {
+			table.clear();
+		}
+		for (ActionId id = 0; id < m_actions.size(); ++id) {
+			const Action& action = m_actions[id];
+			for (const InputBinding& binding : action.bindings) {
+				m_tables[static_cast<size_t>(binding.source)].push_back({ binding.code, id, binding.scale, action.type == ActionType::Axis });
+			}
+		}
+		//inputs shared by several actions end up next to each other
+		for (auto& table : m_tables) {
+			std::sort(table.begin(), table.end(), [](const CompiledBinding& a, const CompiledBinding& b) {
+				return a.code < b.code;
+			});
+		}
+		m_dirty = false;
+	}
+
+	void ActionMap::Update(const InputManager& input) {
+		if (m_dirty) {
+			Compile();
+		}
+
+		std::fill(m_values.begin(), m_values.end(), 0.0f);
+		for (size_t source = 0; source < static_cast<size_t>(InputSource::Count); ++source) {
+			int lastCode = -1;
+			float raw = 0.0f;
+			for (const CompiledBinding& binding : m_tables[source]) {
+				if (binding.code != lastCode) {
+					raw = ReadInput(input, static_cast<InputSource>(source), binding.code, m_deadzone);
+					lastCode = binding.code;
+				}
+				float value = raw * binding.scale;
+				float& total = m_values[binding.action];
+				total = binding.axis ? total + value : std::max(total, value);
+			}
+		}
+
+		for (ActionId id = 0; id < m_actions.size(); ++id) {
+			float& value = m_values[id];
+			if (m_actions[id].type == ActionType::Axis) {
+				value = std::clamp(value, -1.0f, 1.0f);
+			}
+			bool wasDown = (m_states[id] & Down) != 0;
+			bool down = std::fabs(value) >= pressThreshold;
+			m_states[id] = uint8_t((down ? Down : 0) | (down && !wasDown ? Pressed : 0) | (!down && wasDown ? Released : 0));
+		}
+	}
+
+	bool ParseInputBinding(const std::string& source, const std::string& code, InputBinding& binding) {
+		size_t sourceIndex = 0;
+		while (sourceIndex < static_cast<size_t>(InputSource::Count) && source != sourceNames[sourceIndex]) {
+			++sourceIndex;
+		}
+		if (sourceIndex == static_cast<size_t>(InputSource::Count) || code.empty()) {
+			return false;
+		}
+		binding.source = static_cast<InputSource>(sourceIndex);
+
+		if (binding.source == InputSource::Key && code.size() == 1 && std::isalnum(static_cast<unsigned char>(code[0]))) {
+			binding.code = std::toupper(static_cast<unsigned char>(code[0]));
+			return true;
+		}
+		for (const CodeName& entry : codeNames) {
+			if (entry.source == binding.source && code == entry.name) {
+				binding.code = entry.code;
+				return true;
+			}
+		}
+		//raw codes for inputs without a name, e.g. mouse 4
+		char* end = nullptr;
+		long value = std::strtol(code.c_str(), &end, 10);
+		if (*end == '\0') {
+			binding.code = int(value);
+			return true;
+		}
+		return false;
+	}
+
+	std::string InputSourceName(InputSource source) {
+		return source < InputSource::Count ? sourceNames[static_cast<size_t>(source)] : "unknown";
+	}
+
+	std::string InputCodeName(InputSource source, int code) {
+		if (source == InputSource::Key && ((code >= GLFW_KEY_A && code <= GLFW_KEY_Z) || (code >= GLFW_KEY_0 && code <= GLFW_KEY_9))) {
+			return std::string(1, char(code));
+		}
+		for (const CodeName& entry : codeNames) {
+			if (entry.source == source && entry.code == code) {
+				return entry.name;
+			}
+		}
+		return std::to_string(code);
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eng {
+
+	class InputManager;
+
+	enum class InputSource : uint8_t {
+		Key,
+		MouseButton,
+		GamepadButton,
+		GamepadAxis,
+		Count
+	};
+
+	//one physical input feeding an action, scale weights or flips it (a key bound to MoveX with -1 moves left)
+	struct InputBinding {
+		InputSource source = InputSource::Key;
+		//GLFW_KEY_*, GLFW_MOUSE_BUTTON_*, GLFW_GAMEPAD_BUTTON_* or GLFW_GAMEPAD_AXIS_*
+		int code = 0;
+		float scale = 1.0f;
+	};
+
+	enum class ActionType : uint8_t {
+		//the strongest binding wins, down from the press threshold on
+		Button,
+		//bindings add up and are clamped to [-1, 1]
+		Axis
+	};
+
+	using ActionId = uint32_t;
+	constexpr ActionId InvalidAction = UINT32_MAX;
+
+	//named buttons and axes bound to keys, mouse buttons and the gamepad
+	//bindings are compiled into flat per source tables so a frame reads every bound input once
+	//and the game reads one array entry per action
+	class ActionMap {
+	public:
+		//returns the existing id when the name is already taken
+		ActionId AddAction(const std::string& name, ActionType type);
+		//InvalidAction for unknown names
+		ActionId GetAction(const std::string& name) const;
+		const std::string& GetName(ActionId action) const;
+		size_t GetActionCount() const;
+
+		void Bind(ActionId action, const InputBinding& binding);
+		//replaces every binding of the action, for rebinding from an options menu
+		void Rebind(ActionId action, const std::vector<InputBinding>& bindings);
+		void ClearBindings(ActionId action);
+		const std::vector<InputBinding>& GetBindings(ActionId action) const;
+
+		//one binding per line: button|axis action key|mouse|gamepad_button|gamepad_axis code [scale]
+		//actions named in the file lose their previous bindings, others keep them
+		bool Load(const std::string& path);
+		bool Save(const std::string& path) const;
+
+		//stick values closer to rest than this read as 0
+		void SetDeadzone(float deadzone);
+
+		//samples the bound inputs, the engine calls this once per frame after events were processed
+		void Update(const InputManager& input);
+
+		bool IsDown(ActionId action) const { return (m_states[action] & Down) != 0; }
+		//true only on the frame the action went down or up
+		bool WasPressed(ActionId action) const { return (m_states[action] & Pressed) != 0; }
+		bool WasReleased(ActionId action) const { return (m_states[action] & Released) != 0; }
+		//0 or 1 for buttons bound to keys, analog for axes and triggers
+		float GetValue(ActionId action) const { return m_values[action]; }
+
+	private:
+		enum StateBits : uint8_t {
+			Down = 1 << 0,
+			Pressed = 1 << 1,
+			Released = 1 << 2
+		};
+
+		struct Action {
+			std::string name;
+			ActionType type = ActionType::Button;
+			std::vector<InputBinding> bindings;
+		};
+
+		struct CompiledBinding {
+			int code;
+			ActionId action;
+			float scale;
+			bool axis;
+		};
+
+		void Compile();
+
+		std::vector<Action> m_actions;
+		std::unordered_map<std::string, ActionId> m_names;
+		//rebuilt from m_actions whenever a binding changes, sorted by code inside each source
+		std::vector<CompiledBinding> m_tables[static_cast<size_t>(InputSource::Count)];
+		bool m_dirty = false;
+		float m_deadzone = 0.2f;
+		std::vector<float> m_values;
+		std::vector<uint8_t> m_states;
+	};
+
+	//names as written in binding files, e.g. key SPACE, mouse LEFT, gamepad_button A, gamepad_axis LEFT_X
+	//plain numbers are accepted as raw codes
+	bool ParseInputBinding(const std::string& source, const std::string& code, InputBinding& binding);
+	std::string InputSourceName(InputSource source);
+	std::string InputCodeName(InputSource source, int code);
+}
@@ -1,19 +1,212 @@
 #include "input/InputManager.h"
+#include <GLFW/glfw3.h>
 
 namespace eng {
-	void InputManager::SetKeyPressed(int key, bool pressed) {
-		//check if the key is in range
-		if (key < 0 || key >= static_cast<int>(m_keys.size())) {
+
+	static_assert(GLFW_KEY_LAST < InputState::KeyCount, "key table does not cover every glfw key");
+	static_assert(GLFW_MOUSE_BUTTON_LAST < InputState::MouseButtonCount, "mouse button table does not cover every glfw button");
+
+	void InputManager::PushEvent(const InputEvent& event) {
+		//only the latest position matters, deltas are taken between positions so nothing is lost
+		if (event.type == InputEventType::MouseMove && !m_queue.empty() && m_queue.back().type == InputEventType::MouseMove) {
+			m_queue.back() = event;
 			return;
 		}
-		m_keys[key] = pressed;
+		m_queue.push_back(event);
+	}
+	void InputManager::SetKeyPressed(int key, bool pressed) {
+		InputEvent event;
+		event.type = InputEventType::Key;
+		event.code = key;
+		event.action = pressed ? GLFW_PRESS : GLFW_RELEASE;
+		PushEvent(event);
+	}
+	void InputManager::SetMouseButtonPressed(int button, bool pressed) {
+		InputEvent event;
+		event.type = InputEventType::MouseButton;
+		event.code = button;
+		event.action = pressed ? GLFW_PRESS : GLFW_RELEASE;
+		PushEvent(event);
 	}
-	bool InputManager::IsKeyPressed(int key) {
+
+	bool InputManager::IsKeyPressed(int key) const {
 		//check if the key is in range
-		if (key < 0 || key >= static_cast<int>(m_keys.size())) {
+		if (key < 0 || key >= InputState::KeyCount) {
+			return false;
+		}
+
+		return m_state.keys[key];
+	}
+	bool InputManager::WasKeyPressed(int key) const {
+		return IsKeyPressed(key) && !m_previousKeys[key];
+	}
+	bool InputManager::WasKeyReleased(int key) const {
+		return key >= 0 && key < InputState::KeyCount && !m_state.keys[key] && m_previousKeys[key];
+	}
+	bool InputManager::IsMouseButtonPressed(int button) const {
+		if (button < 0 || button >= InputState::MouseButtonCount) {
 			return false;
 		}
+		return m_state.mouseButtons[button];
+	}
+	bool InputManager::WasMouseButtonPressed(int button) const {
+		return IsMouseButtonPressed(button) && !m_previousMouseButtons[button];
+	}
+	bool InputManager::WasMouseButtonReleased(int button) const {
+		return button >= 0 && button < InputState::MouseButtonCount && !m_state.mouseButtons[button] && m_previousMouseButtons[button];
+	}
+
+	bool InputManager::IsGamepadConnected(int gamepad) const {
+		return gamepad >= 0 && gamepad < InputState::GamepadCount && m_state.gamepads[gamepad].connected;
+	}
+	bool InputManager::IsGamepadButtonPressed(int button, int gamepad) const {
+		if (!IsGamepadConnected(gamepad) || button < 0 || button >= static_cast<int>(m_state.gamepads[gamepad].buttons.size())) {
+			return false;
+		}
+		return m_state.gamepads[gamepad].buttons[button];
+	}
+	float InputManager::GetGamepadAxis(int axis, int gamepad) const {
+		if (!IsGamepadConnected(gamepad) || axis < 0 || axis >= static_cast<int>(m_state.gamepads[gamepad].axes.size())) {
+			return 0.0f;
+		}
+		return m_state.gamepads[gamepad].axes[axis];
+	}
+
+	const InputState& InputManager::GetState() const {
+		return m_state;
+	}
+	const std::vector<InputEvent>& InputManager::GetEvents() const {
+		return m_events;
+	}
 
-		return m_keys[key];
+	void InputManager::SetMouseCaptured(bool captured) {
+		m_mouseCaptured = captured;
+		m_hasMousePosition = false;
+		if (!m_window) {
+			return;
+		}
+		glfwSetInputMode(m_window, GLFW_CURSOR, captured ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+		if (glfwRawMouseMotionSupported()) {
+			glfwSetInputMode(m_window, GLFW_RAW_MOUSE_MOTION, captured ? GLFW_TRUE : GLFW_FALSE);
+		}
+	}
+	bool InputManager::IsMouseCaptured() const {
+		return m_mouseCaptured;
+	}
+
+	ActionMap& InputManager::GetActions() {
+		return m_actions;
+	}
+
+	void InputManager::SetWindow(GLFWwindow* window) {
+		m_window = window;
+		//a capture requested before the window existed
+		if (m_mouseCaptured) {
+			SetMouseCaptured(true);
+		}
+	}
+
+	void InputManager::Release() {
+		m_queue = decltype(m_queue)();
+		m_events = decltype(m_events)();
+		m_state.text = std::u32string();
+		m_actions = ActionMap();
+	}
+
+	void InputManager::Update() {
+		m_previousKeys = m_state.keys;
+		m_previousMouseButtons = m_state.mouseButtons;
+		m_state.mouseDeltaX = 0.0;
+		m_state.mouseDeltaY = 0.0;
+		m_state.scrollX = 0.0;
+		m_state.scrollY = 0.0;
+		m_state.text.clear();
+		for (int key = 0; key < InputState::KeyCount; ++key) {
+			if (m_pendingKeyReleases[key]) {
+				m_state.keys[key] = false;
+				m_pendingKeyReleases[key] = false;
+			}
+		}
+		for (int button = 0; button < InputState::MouseButtonCount; ++button) {
+			if (m_pendingMouseButtonReleases[button]) {
+				m_state.mouseButtons[button] = false;
+				m_pendingMouseButtonReleases[button] = false;
+			}
+		}
+
+		for (const InputEvent& event : m_queue) {
+			ApplyEvent(event);
+		}
+		m_events.swap(m_queue);
+		m_queue.clear();
+
+		PollGamepads();
+		m_actions.Update(*this);
+	}
+
+	void InputManager::ApplyEvent(const InputEvent& event) {
+		switch (event.type) {
+		case InputEventType::Key:
+		case InputEventType::MouseButton: {
+			bool isKey = event.type == InputEventType::Key;
+			int count = isKey ? InputState::KeyCount : InputState::MouseButtonCount;
+			if (event.code < 0 || event.code >= count || event.action == GLFW_REPEAT) {
+				break;
+			}
+			bool& down = isKey ? m_state.keys[event.code] : m_state.mouseButtons[event.code];
+			bool wasDown = isKey ? m_previousKeys[event.code] : m_previousMouseButtons[event.code];
+			bool& pendingRelease = isKey ? m_pendingKeyReleases[event.code] : m_pendingMouseButtonReleases[event.code];
+			//a tap shorter than a frame stays down for this frame and is released in the next one
+			//the rest of the queue still applies, only this key waits
+			if (event.action == GLFW_RELEASE && down && !wasDown) {
+				pendingRelease = true;
+				break;
+			}
+			down = event.action == GLFW_PRESS;
+			pendingRelease = false;
+			break;
+		}
+		case InputEventType::MouseMove:
+			if (m_hasMousePosition) {
+				m_state.mouseDeltaX += event.x - m_state.mouseX;
+				m_state.mouseDeltaY += event.y - m_state.mouseY;
+			}
+			m_state.mouseX = event.x;
+			m_state.mouseY = event.y;
+			m_hasMousePosition = true;
+			break;
+		case InputEventType::Scroll:
+			m_state.scrollX += event.x;
+			m_state.scrollY += event.y;
+			break;
+		case InputEventType::Char:
+			m_state.text.push_back(static_cast<char32_t>(event.code));
+			break;
+		}
+	}
+
+	void InputManager::PollGamepads() {
+		//glfw has no gamepad callbacks, the state is polled
+		int slot = 0;
+		for (int joystick = GLFW_JOYSTICK_1; joystick <= GLFW_JOYSTICK_LAST && slot < InputState::GamepadCount; ++joystick) {
+			GLFWgamepadstate state;
+			if (!glfwJoystickIsGamepad(joystick) || !glfwGetGamepadState(joystick, &state)) {
+				continue;
+			}
+			GamepadState& gamepad = m_state.gamepads[slot++];
+			gamepad.connected = true;
+			for (size_t i = 0; i < gamepad.buttons.size(); ++i) {
+				gamepad.buttons[i] = state.buttons[i] == GLFW_PRESS;
+			}
+			for (size_t i = 0; i < gamepad.axes.size(); ++i) {
+				gamepad.axes[i] = state.axes[i];
+			}
+			//triggers rest at -1, move them to [0, 1] so they read like a button
+			gamepad.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER] = (state.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER] + 1.0f) * 0.5f;
+			gamepad.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER] = (state.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER] + 1.0f) * 0.5f;
+		}
+		for (; slot < InputState::GamepadCount; ++slot) {
+			m_state.gamepads[slot] = GamepadState();
+		}
 	}
 }
\ No newline at end of file
@@ -1,7 +1,64 @@
 #pragma once
 
+#include "input/ActionMap.h"
 #include <array>
+#include <string>
+#include <vector>
+
+struct GLFWwindow;
 namespace eng {
+
+	enum class InputEventType : uint8_t {
+		Key,
+		MouseButton,
+		MouseMove,
+		Scroll,
+		Char
+	};
+
+	//what the window callbacks record, applied to the snapshot in arrival order once per frame
+	struct InputEvent {
+		InputEventType type = InputEventType::Key;
+		//key, mouse button or unicode codepoint
+		int code = 0;
+		//GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT for keys and buttons
+		int action = 0;
+		int mods = 0;
+		//cursor position or scroll offset
+		double x = 0.0;
+		double y = 0.0;
+	};
+
+	struct GamepadState {
+		bool connected = false;
+		std::array<bool, 15> buttons = { false };
+		//sticks in [-1, 1], triggers in [0, 1] with 0 at rest
+		std::array<float, 6> axes = { 0.0f };
+	};
+
+	//everything the game can read about input, fixed for the whole frame
+	struct InputState {
+		//covers GLFW_KEY_LAST
+		static constexpr int KeyCount = 349;
+		static constexpr int MouseButtonCount = 8;
+		static constexpr int GamepadCount = 4;
+
+		std::array<bool, KeyCount> keys = { false };
+		std::array<bool, MouseButtonCount> mouseButtons = { false };
+		//in screen coordinates, unbounded while the mouse is captured
+		double mouseX = 0.0;
+		double mouseY = 0.0;
+		//accumulated over the frame
+		double mouseDeltaX = 0.0;
+		double mouseDeltaY = 0.0;
+		double scrollX = 0.0;
+		double scrollY = 0.0;
+		//characters typed this frame, with the keyboard layout and dead keys applied
+		std::u32string text;
+		//the first connected gamepads with a standard mapping, in joystick order
+		std::array<GamepadState, GamepadCount> gamepads;
+	};
+
 	class InputManager {
 	private:
 		//we want to enforce that this class will only be created and owned by the engine itself so all constructors will be private
@@ -12,12 +69,60 @@ namespace eng {
 		InputManager& operator=(InputManager&&) = delete;
 
 	public:
+		//the window callbacks only queue events, nothing reads them before the next Update
+		//consecutive mouse moves are merged so high polling rate mice queue one event per frame
+		void PushEvent(const InputEvent& event);
 		void SetKeyPressed(int key, bool pressed);
-		bool IsKeyPressed(int Key);
+		void SetMouseButtonPressed(int button, bool pressed);
+
+		bool IsKeyPressed(int Key) const;
+		//true only on the frame the key went down or up
+		bool WasKeyPressed(int key) const;
+		bool WasKeyReleased(int key) const;
+		bool IsMouseButtonPressed(int button) const;
+		bool WasMouseButtonPressed(int button) const;
+		bool WasMouseButtonReleased(int button) const;
+
+		bool IsGamepadConnected(int gamepad = 0) const;
+		bool IsGamepadButtonPressed(int button, int gamepad = 0) const;
+		float GetGamepadAxis(int axis, int gamepad = 0) const;
+
+		const InputState& GetState() const;
+		//the events applied this frame in the order they arrived, for text fields and the like
+		const std::vector<InputEvent>& GetEvents() const;
+
+		//hides and locks the cursor, with raw (unaccelerated) motion where the platform supports it
+		//use for mouse look, the deltas keep coming when the cursor would hit the screen edge
+		void SetMouseCaptured(bool captured);
+		bool IsMouseCaptured() const;
+
+		//named actions the game reads instead of raw keys
+		ActionMap& GetActions();
 
 	private:
-		//storing key states
-		std::array<bool, 256> m_keys = { false };
+		void SetWindow(GLFWwindow* window);
+		//drops the queued events and the actions, the engine calls it on shutdown before the leak report
+		void Release();
+		//drains the event queue into a new snapshot, polls the gamepads and evaluates the actions
+		//called once per frame after the window events were processed
+		void Update();
+		void ApplyEvent(const InputEvent& event);
+		void PollGamepads();
+
+		GLFWwindow* m_window = nullptr;
+		bool m_mouseCaptured = false;
+		//the first move after startup or a capture change only sets the position
+		bool m_hasMousePosition = false;
+		std::vector<InputEvent> m_queue;
+		std::vector<InputEvent> m_events;
+		InputState m_state;
+		//last frame's buttons for the pressed and released edges
+		std::array<bool, InputState::KeyCount> m_previousKeys = { false };
+		std::array<bool, InputState::MouseButtonCount> m_previousMouseButtons = { false };
+		//released in the frame they went down, they stay down for that frame and go up at the start of the next
+		std::array<bool, InputState::KeyCount> m_pendingKeyReleases = { false };
+		std::array<bool, InputState::MouseButtonCount> m_pendingMouseButtonReleases = { false };
+		ActionMap m_actions;
 
 		//only allow engine to manipulate input manager
 		friend class Engine;
@@ -0,0 +1,145 @@
+#include "jobs/JobSystem.h"
+#include "memory/MemoryTracker.h"
+#include <algorithm>
+
+namespace eng {
+
+	JobSystem::~JobSystem() {
+		Shutdown();
+	}
+
+	void JobSystem::Init(unsigned int workerCount) {
+		if (m_running) {
+			return;
+		}
+		if (workerCount == 0) {
+			unsigned int hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		m_running = true;
+		m_workers.reserve(workerCount);
+		for (unsigned int i = 0; i < workerCount; ++i) {
+			m_workers.emplace_back(&JobSystem::WorkerLoop, this);
+		}
+	}
+
+	void JobSystem::Shutdown() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_running) {
+				return;
+			}
+			m_running = false;
+		}
+		m_condition.notify_all();
+		for (auto& worker : m_workers) {
+			worker.join();
+		}
+		m_workers = decltype(m_workers)();
+
+		//whatever is left over still has to run so nobody waits on a counter forever
+		while (TryRunPendingJob()) {
+		}
+		m_jobs = decltype(m_jobs)();
+	}
+
+	void JobSystem::Schedule(Job job, JobCounter* counter) {
+		if (counter) {
+			counter->value.fetch_add(1, std::memory_order_relaxed);
+		}
+		//the job allocates on behalf of whoever scheduled it
+		auto wrapped = [job = std::move(job), counter, tag = MemoryTracker::GetTag()]() {
+			MemoryTagScope scope(tag);
+			job();
+			if (counter) {
+				counter->value.fetch_sub(1, std::memory_order_acq_rel);
+			}
+		};
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (!m_running) {
+				lock.unlock();
+				wrapped();
+				return;
+			}
+			m_jobs.emplace_back(std::move(wrapped));
+		}
+		m_condition.notify_one();
+	}
+
+	void JobSystem::Wait(JobCounter& counter) {
+		while (counter.value.load(std::memory_order_acquire) > 0) {
+			if (!TryRunPendingJob()) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::ParallelFor(size_t count, size_t chunkSize, const std::function<void(size_t begin, size_t end)>& function) {
+		if (count == 0) {
+			return;
+		}
+		chunkSize = std::max<size_t>(chunkSize, 1);
+		size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+		//a single chunk or no workers, not worth the scheduling overhead
+		if (chunkCount == 1 || m_workers.empty()) {
+			function(0, count);
+			return;
+		}
+
+		//every participant grabs the next chunk index until all chunks are taken
+		std::atomic<size_t> nextChunk{ 0 };
+		auto runChunks = [&]() {
+			size_t chunk;
+			while ((chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunkCount) {
+				size_t begin = chunk * chunkSize;
+				function(begin, std::min(begin + chunkSize, count));
+			}
+		};
+
+		JobCounter counter;
+		size_t helperCount = std::min(m_workers.size(), chunkCount - 1);
+		for (size_t i = 0; i < helperCount; ++i) {
+			Schedule(runChunks, &counter);
+		}
+		runChunks();
+		Wait(counter);
+	}
+
+	size_t JobSystem::GetWorkerCount() const {
+		return m_workers.size();
+	}
+
+	bool JobSystem::TryRunPendingJob() {
+		Job job;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_jobs.empty()) {
+				return false;
+			}
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+		job();
+		return true;
+	}
+
+	void JobSystem::WorkerLoop() {
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_condition.wait(lock, [this]() { return !m_running || !m_jobs.empty(); });
+				if (!m_running && m_jobs.empty()) {
+					return;
+				}
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+			}
+			job();
+		}
+	}
+}
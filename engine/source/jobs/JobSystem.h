@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eng {
+
+	//counts jobs that are still in flight, lets the caller wait on a group of jobs
+	struct JobCounter {
+		std::atomic<int> value{ 0 };
+	};
+
+	//general purpose worker pool used for cpu heavy work (decoding, culling, binning...)
+	class JobSystem {
+	public:
+		using Job = std::function<void()>;
+
+		JobSystem() = default;
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+		~JobSystem();
+
+		//0 picks one worker per hardware thread minus the main thread
+		void Init(unsigned int workerCount = 0);
+		void Shutdown();
+
+		//queue a job, if a counter is passed it is incremented now and decremented once the job finished
+		//without any workers the job runs immediately on the calling thread
+		void Schedule(Job job, JobCounter* counter = nullptr);
+		//blocks until the counter reaches zero, the calling thread helps running jobs in the meantime
+		void Wait(JobCounter& counter);
+
+		//splits [0, count) into chunks of chunkSize and runs them in parallel, the calling thread takes part
+		//returns once every chunk has been processed
+		void ParallelFor(size_t count, size_t chunkSize, const std::function<void(size_t begin, size_t end)>& function);
+
+		size_t GetWorkerCount() const;
+
+	private:
+		bool TryRunPendingJob();
+		void WorkerLoop();
+
+		std::vector<std::thread> m_workers;
+		std::deque<Job> m_jobs;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		bool m_running = false;
+	};
+}
@@ -0,0 +1,396 @@
+#include "log/Log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace eng {
+
+	namespace {
+
+		//per thread, a full ring drops messages rather than stalling the thread
+		const size_t kRingSize = 64 * 1024;
+		//a level value no real record uses, marks the unused tail end of a ring before it wraps
+		const uint8_t kPaddingLevel = 0xFF;
+		//how long the writer sleeps when there is nothing to do
+		const auto kWriterInterval = std::chrono::milliseconds(2);
+
+		//single producer (the owning thread) and single consumer (the writer), head and tail only ever grow
+		struct Ring {
+			std::atomic<size_t> head;
+			std::atomic<size_t> tail;
+			std::atomic<bool> owned;
+			std::atomic<uint64_t> dropped;
+			//only touched by the writer
+			uint64_t reportedDropped;
+			Ring* next;
+			alignas(8) uint8_t data[kRingSize];
+		};
+
+		//rings of threads that exited stay in the list and are handed to the next new thread
+		std::atomic<Ring*> s_rings{ nullptr };
+
+		//gives the ring back when the thread exits
+		struct RingOwner {
+			Ring* ring = nullptr;
+			~RingOwner() {
+				if (ring) {
+					ring->owned.store(false, std::memory_order_release);
+				}
+			}
+		};
+		thread_local RingOwner t_owner;
+		//head including any padding of the record being written
+		thread_local size_t t_pendingHead = 0;
+		//set while a record is built in the scratch buffer because no writer runs
+		thread_local bool t_immediate = false;
+		thread_local std::vector<uint8_t> t_scratch;
+
+		std::atomic<bool> s_running{ false };
+		std::atomic<uint8_t> s_level{ static_cast<uint8_t>(LogLevel::Trace) };
+		std::atomic<uint64_t> s_dropped{ 0 };
+		const auto s_startTime = std::chrono::steady_clock::now();
+
+		uint64_t Now() {
+			return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_startTime).count());
+		}
+
+		std::thread s_writer;
+		std::FILE* s_file = nullptr;
+		std::mutex s_mutex;
+		std::condition_variable s_wake;
+		std::condition_variable s_passDone;
+		uint64_t s_passes = 0;
+		bool s_stop = false;
+
+		Ring* GetRing() {
+			if (t_owner.ring) {
+				return t_owner.ring;
+			}
+			for (Ring* ring = s_rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+				bool expected = false;
+				if (ring->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+					t_owner.ring = ring;
+					return ring;
+				}
+			}
+			//raw memory so a ring never shows up in the memory tracker's leak report
+			void* memory = std::calloc(1, sizeof(Ring));
+			if (!memory) {
+				return nullptr;
+			}
+			Ring* ring = new (memory) Ring();
+			ring->owned.store(true, std::memory_order_relaxed);
+			ring->next = s_rings.load(std::memory_order_relaxed);
+			while (!s_rings.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed)) {
+			}
+			t_owner.ring = ring;
+			return ring;
+		}
+
+		struct Line {
+			uint64_t timestamp;
+			LogLevel level;
+			std::string text;
+		};
+
+		//turns one record into a finished line
+		Line FormatRecord(const uint8_t* record) {
+			LogRecordHeader header;
+			std::memcpy(&header, record, sizeof(header));
+			const uint8_t* argument = record + sizeof(header);
+			size_t remaining = header.argumentCount;
+
+			Line line;
+			line.timestamp = header.timestamp;
+			line.level = static_cast<LogLevel>(header.level);
+			char prefix[64];
+			std::snprintf(prefix, sizeof(prefix), "[%11.6f][%s] %s:", double(header.timestamp) * 1e-9,
+				Log::GetCategoryName(static_cast<LogCategory>(header.category)), Log::GetLevelName(line.level));
+			line.text = prefix;
+
+			for (const char* c = header.format; *c; ++c) {
+				bool placeholder = c[0] == '{' && c[1] == '}';
+				bool hex = c[0] == '{' && c[1] == ':' && c[2] == 'x' && c[3] == '}';
+				if ((!placeholder && !hex) || remaining == 0) {
+					line.text += *c;
+					continue;
+				}
+				c += hex ? 3 : 1;
+				--remaining;
+
+				auto type = static_cast<LogArgType>(*argument++);
+				if (type == LogArgType::String) {
+					uint32_t length;
+					std::memcpy(&length, argument, sizeof(length));
+					line.text.append(reinterpret_cast<const char*>(argument + sizeof(length)), length);
+					argument += sizeof(length) + length;
+					continue;
+				}
+				uint64_t bits;
+				std::memcpy(&bits, argument, sizeof(bits));
+				argument += sizeof(bits);
+				char buffer[32];
+				switch (type) {
+				case LogArgType::Bool:
+					line.text += bits ? "true" : "false";
+					break;
+				case LogArgType::Char:
+					line.text += static_cast<char>(bits);
+					break;
+				case LogArgType::Signed: {
+					long long number;
+					std::memcpy(&number, &bits, sizeof(number));
+					std::snprintf(buffer, sizeof(buffer), hex ? "%llx" : "%lld", number);
+					line.text += buffer;
+					break;
+				}
+				case LogArgType::Unsigned:
+					std::snprintf(buffer, sizeof(buffer), hex ? "%llx" : "%llu", static_cast<unsigned long long>(bits));
+					line.text += buffer;
+					break;
+				case LogArgType::Double: {
+					double number;
+					std::memcpy(&number, &bits, sizeof(number));
+					std::snprintf(buffer, sizeof(buffer), "%g", number);
+					line.text += buffer;
+					break;
+				}
+				default:
+					std::snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(bits));
+					line.text += buffer;
+					break;
+				}
+			}
+			line.text += '\n';
+			return line;
+		}
+
+		void Output(const Line& line) {
+			std::FILE* console = line.level >= LogLevel::Warning ? stderr : stdout;
+			std::fwrite(line.text.data(), 1, line.text.size(), console);
+			if (s_file) {
+				std::fwrite(line.text.data(), 1, line.text.size(), s_file);
+			}
+		}
+
+		//one pass over every ring, lines of different threads are merged by time before they are written
+		void Drain(std::vector<Line>& lines) {
+			lines.clear();
+			for (Ring* ring = s_rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+				size_t tail = ring->tail.load(std::memory_order_relaxed);
+				size_t head = ring->head.load(std::memory_order_acquire);
+				while (tail < head) {
+					const uint8_t* record = ring->data + tail % kRingSize;
+					uint32_t size;
+					std::memcpy(&size, record, sizeof(size));
+					if (record[4] != kPaddingLevel) {
+						lines.push_back(FormatRecord(record));
+					}
+					tail += size;
+				}
+				ring->tail.store(tail, std::memory_order_release);
+
+				uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+				if (dropped != ring->reportedDropped) {
+					uint64_t now = Now();
+					char text[96];
+					std::snprintf(text, sizeof(text), "[%11.6f][Core] WARNING:LOG_MESSAGES_DROPPED: %llu\n", double(now) * 1e-9,
+						static_cast<unsigned long long>(dropped - ring->reportedDropped));
+					lines.push_back({ now, LogLevel::Warning, text });
+					ring->reportedDropped = dropped;
+				}
+			}
+			std::stable_sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) {
+				return a.timestamp < b.timestamp;
+			});
+			for (const Line& line : lines) {
+				Output(line);
+			}
+			if (!lines.empty()) {
+				std::fflush(stdout);
+				std::fflush(stderr);
+				if (s_file) {
+					std::fflush(s_file);
+				}
+			}
+		}
+
+		void WriterLoop() {
+			std::vector<Line> lines;
+			std::unique_lock<std::mutex> lock(s_mutex);
+			while (!s_stop) {
+				lock.unlock();
+				Drain(lines);
+				lock.lock();
+				++s_passes;
+				s_passDone.notify_all();
+				s_wake.wait_for(lock, kWriterInterval);
+			}
+		}
+	}
+
+	bool Log::Start(const std::string& filePath) {
+		if (s_running.load()) {
+			return true;
+		}
+		if (!filePath.empty()) {
+			s_file = std::fopen(filePath.c_str(), "w");
+			if (!s_file) {
+				LOG_ERROR(Core, "LOG_FILE_OPEN_FAILED: {}", filePath);
+			}
+		}
+		s_stop = false;
+		s_writer = std::thread(WriterLoop);
+		s_running.store(true, std::memory_order_release);
+		return s_file != nullptr || filePath.empty();
+	}
+
+	void Log::Shutdown() {
+		if (!s_running.load()) {
+			return;
+		}
+		//new messages go straight out from here on, the writer empties the rings one last time
+		s_running.store(false, std::memory_order_release);
+		{
+			std::lock_guard<std::mutex> lock(s_mutex);
+			s_stop = true;
+		}
+		s_wake.notify_all();
+		s_writer.join();
+		std::vector<Line> lines;
+		Drain(lines);
+		if (s_file) {
+			std::fclose(s_file);
+			s_file = nullptr;
+		}
+	}
+
+	bool Log::IsRunning() {
+		return s_running.load(std::memory_order_acquire);
+	}
+
+	void Log::Flush() {
+		if (!s_running.load()) {
+			return;
+		}
+		//the pass running right now may have missed the latest records, the one after it cannot
+		std::unique_lock<std::mutex> lock(s_mutex);
+		uint64_t target = s_passes + 2;
+		s_wake.notify_all();
+		s_passDone.wait(lock, [target]() { return s_passes >= target || s_stop; });
+	}
+
+	void Log::SetLevel(LogLevel level) {
+		s_level.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+	}
+
+	LogLevel Log::GetLevel() {
+		return static_cast<LogLevel>(s_level.load(std::memory_order_relaxed));
+	}
+
+	uint64_t Log::GetDroppedCount() {
+		uint64_t dropped = s_dropped.load(std::memory_order_relaxed);
+		for (Ring* ring = s_rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+			dropped += ring->dropped.load(std::memory_order_relaxed);
+		}
+		return dropped;
+	}
+
+	const char* Log::GetLevelName(LogLevel level) {
+		switch (level) {
+		case LogLevel::Trace: return "TRACE";
+		case LogLevel::Debug: return "DEBUG";
+		case LogLevel::Info: return "INFO";
+		case LogLevel::Warning: return "WARNING";
+		case LogLevel::Error: return "ERROR";
+		default: return "UNKNOWN";
+		}
+	}
+
+	const char* Log::GetCategoryName(LogCategory category) {
+		switch (category) {
+		case LogCategory::Core: return "Core";
+		case LogCategory::Graphics: return "Graphics";
+		case LogCategory::Assets: return "Assets";
+		case LogCategory::Input: return "Input";
+		case LogCategory::Memory: return "Memory";
+		case LogCategory::Scene: return "Scene";
+		case LogCategory::Game: return "Game";
+		default: return "Unknown";
+		}
+	}
+
+	size_t Log::StringSize(std::string_view text) {
+		return 1 + sizeof(uint32_t) + std::min(text.size(), MaxStringLength);
+	}
+
+	uint8_t* Log::EncodeString(uint8_t* out, std::string_view text) {
+		uint32_t length = static_cast<uint32_t>(std::min(text.size(), MaxStringLength));
+		*out++ = static_cast<uint8_t>(LogArgType::String);
+		std::memcpy(out, &length, sizeof(length));
+		out += sizeof(length);
+		std::memcpy(out, text.data(), length);
+		return out + length;
+	}
+
+	bool Log::IsEnabled(LogLevel level) {
+		return static_cast<uint8_t>(level) >= s_level.load(std::memory_order_relaxed);
+	}
+
+	uint64_t Log::GetTimestamp() {
+		return Now();
+	}
+
+	uint8_t* Log::Reserve(size_t size) {
+		if (!s_running.load(std::memory_order_acquire)) {
+			t_immediate = true;
+			t_scratch.resize(size);
+			return t_scratch.data();
+		}
+		t_immediate = false;
+
+		Ring* ring = GetRing();
+		if (!ring) {
+			s_dropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		size_t head = ring->head.load(std::memory_order_relaxed);
+		size_t tail = ring->tail.load(std::memory_order_acquire);
+		size_t offset = head % kRingSize;
+		size_t toEnd = kRingSize - offset;
+		//records never wrap, the rest of the ring is skipped when one does not fit
+		size_t needed = size > toEnd ? size + toEnd : size;
+		if (size > kRingSize / 2 || head + needed - tail > kRingSize) {
+			ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		if (size > toEnd) {
+			uint32_t padding = static_cast<uint32_t>(toEnd);
+			std::memcpy(ring->data + offset, &padding, sizeof(padding));
+			ring->data[offset + 4] = kPaddingLevel;
+			head += toEnd;
+			offset = 0;
+		}
+		t_pendingHead = head;
+		return ring->data + offset;
+	}
+
+	void Log::Commit(size_t size) {
+		if (t_immediate) {
+			WriteNow(t_scratch.data());
+			return;
+		}
+		t_owner.ring->head.store(t_pendingHead + size, std::memory_order_release);
+	}
+
+	void Log::WriteNow(const uint8_t* record) {
+		Output(FormatRecord(record));
+	}
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+//messages below this level are compiled out, 0 trace, 1 debug, 2 info, 3 warning, 4 error
+#ifndef ENG_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define ENG_LOG_MIN_LEVEL 2
+#else
+#define ENG_LOG_MIN_LEVEL 1
+#endif
+#endif
+
+//one bit per LogCategory, categories whose bit is clear are compiled out
+#ifndef ENG_LOG_CATEGORY_MASK
+#define ENG_LOG_CATEGORY_MASK 0xFFFFFFFFu
+#endif
+
+namespace eng {
+
+	enum class LogLevel : uint8_t {
+		Trace,
+		Debug,
+		Info,
+		Warning,
+		Error
+	};
+
+	enum class LogCategory : uint8_t {
+		Core,
+		Graphics,
+		Assets,
+		Input,
+		Memory,
+		Scene,
+		Game,
+		Count
+	};
+
+	//a record is this header followed by every argument as a type byte and its value
+	//strings are stored as a 32 bit length and the characters, everything else as 8 bytes
+	struct LogRecordHeader {
+		uint32_t size;
+		uint8_t level;
+		uint8_t category;
+		uint16_t argumentCount;
+		uint64_t timestamp;
+		const char* format;
+	};
+
+	enum class LogArgType : uint8_t {
+		Bool,
+		Char,
+		Signed,
+		Unsigned,
+		Double,
+		String,
+		Pointer
+	};
+
+	//producers copy the format pointer and the raw arguments into a ring buffer owned by their thread, no locks and no formatting
+	//a background thread turns the records into text and writes them to the console and the log file
+	//when a ring is full the message is dropped and counted instead of waiting for the writer
+	//before Start and after Shutdown messages are formatted and printed right away on the calling thread
+	class Log {
+	public:
+		//file may be empty for console only output
+		static bool Start(const std::string& filePath = std::string());
+		//writes everything still queued and stops the writer thread
+		static void Shutdown();
+		static bool IsRunning();
+		//blocks until everything logged before the call is written
+		static void Flush();
+
+		//runtime filter on top of the compile time one
+		static void SetLevel(LogLevel level);
+		static LogLevel GetLevel();
+		static uint64_t GetDroppedCount();
+
+		static constexpr bool IsCompiledIn(LogLevel level, LogCategory category) {
+			return static_cast<int>(level) >= ENG_LOG_MIN_LEVEL && ((ENG_LOG_CATEGORY_MASK >> static_cast<unsigned>(category)) & 1u) != 0;
+		}
+
+		//format must outlive the log, a string literal in practice, {} is replaced by the next argument and {:x} prints it in hex
+		template<typename... Args>
+		static void Write(LogLevel level, LogCategory category, const char* format, const Args&... args);
+
+		static const char* GetLevelName(LogLevel level);
+		static const char* GetCategoryName(LogCategory category);
+
+	private:
+		//strings longer than this are cut, so a record always fits a ring
+		static constexpr size_t MaxStringLength = 1024;
+
+		template<typename T>
+		static size_t EncodedSize(const T& value);
+		template<typename T>
+		static uint8_t* Encode(uint8_t* out, const T& value);
+		static size_t StringSize(std::string_view text);
+		static uint8_t* EncodeString(uint8_t* out, std::string_view text);
+
+		static bool IsEnabled(LogLevel level);
+		static uint64_t GetTimestamp();
+		//space for a record of size bytes in the calling thread's ring, null when it is full
+		static uint8_t* Reserve(size_t size);
+		static void Commit(size_t size);
+		//used when no writer is running
+		static void WriteNow(const uint8_t* record);
+	};
+
+	template<typename T>
+	size_t Log::EncodedSize(const T& value) {
+		using Type = std::decay_t<T>;
+		if constexpr (std::is_same_v<Type, std::string> || std::is_same_v<Type, std::string_view> || std::is_array_v<T>) {
+			return StringSize(value);
+		}
+		else if constexpr (std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>) {
+			return StringSize(value ? std::string_view(value) : std::string_view("(null)"));
+		}
+		else {
+			return 1 + 8;
+		}
+	}
+
+	template<typename T>
+	uint8_t* Log::Encode(uint8_t* out, const T& value) {
+		using Type = std::decay_t<T>;
+		if constexpr (std::is_same_v<Type, std::string> || std::is_same_v<Type, std::string_view> || std::is_array_v<T>) {
+			return EncodeString(out, value);
+		}
+		else if constexpr (std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>) {
+			return EncodeString(out, value ? std::string_view(value) : std::string_view("(null)"));
+		}
+		else {
+			LogArgType type = LogArgType::Unsigned;
+			uint64_t bits = 0;
+			if constexpr (std::is_same_v<Type, bool>) {
+				type = LogArgType::Bool;
+				bits = value ? 1 : 0;
+			}
+			else if constexpr (std::is_same_v<Type, char>) {
+				type = LogArgType::Char;
+				bits = static_cast<uint8_t>(value);
+			}
+			else if constexpr (std::is_enum_v<Type>) {
+				type = LogArgType::Signed;
+				int64_t number = static_cast<int64_t>(value);
+				std::memcpy(&bits, &number, sizeof(bits));
+			}
+			else if constexpr (std::is_integral_v<Type> && std::is_signed_v<Type>) {
+				type = LogArgType::Signed;
+				int64_t number = value;
+				std::memcpy(&bits, &number, sizeof(bits));
+			}
+			else if constexpr (std::is_integral_v<Type>) {
+				type = LogArgType::Unsigned;
+				bits = value;
+			}
+			else if constexpr (std::is_floating_point_v<Type>) {
+				type = LogArgType::Double;
+				double number = value;
+				std::memcpy(&bits, &number, sizeof(bits));
+			}
+			else if constexpr (std::is_pointer_v<Type>) {
+				type = LogArgType::Pointer;
+				bits = reinterpret_cast<uintptr_t>(value);
+			}
+			else {
+				static_assert(std::is_pointer_v<Type>, "unsupported log argument type");
+			}
+			*out++ = static_cast<uint8_t>(type);
+			std::memcpy(out, &bits, sizeof(bits));
+			return out + sizeof(bits);
+		}
+	}
+
+	template<typename... Args>
+	void Log::Write(LogLevel level, LogCategory category, const char* format, const Args&... args) {
+		if (!IsEnabled(level)) {
+			return;
+		}
+		//records are padded to 8 bytes so the next header stays aligned
+		size_t size = (sizeof(LogRecordHeader) + (size_t(0) + ... + EncodedSize(args)) + 7) & ~size_t(7);
+		uint8_t* record = Reserve(size);
+		if (!record) {
+			return;
+		}
+		LogRecordHeader header{ static_cast<uint32_t>(size), static_cast<uint8_t>(level), static_cast<uint8_t>(category),
+			static_cast<uint16_t>(sizeof...(Args)), GetTimestamp(), format };
+		std::memcpy(record, &header, sizeof(header));
+		[[maybe_unused]] uint8_t* out = record + sizeof(header);
+		((out = Encode(out, args)), ...);
+		Commit(size);
+	}
+}
+
+//the arguments are not evaluated at all when the level or category is compiled out
+#define ENG_LOG(level, category, ...) \
+	do { \
+		if constexpr (::eng::Log::IsCompiledIn(level, category)) { \
+			::eng::Log::Write(level, category, __VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_TRACE(category, ...) ENG_LOG(::eng::LogLevel::Trace, ::eng::LogCategory::category, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) ENG_LOG(::eng::LogLevel::Debug, ::eng::LogCategory::category, __VA_ARGS__)
+#define LOG_INFO(category, ...) ENG_LOG(::eng::LogLevel::Info, ::eng::LogCategory::category, __VA_ARGS__)
+#define LOG_WARNING(category, ...) ENG_LOG(::eng::LogLevel::Warning, ::eng::LogCategory::category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) ENG_LOG(::eng::LogLevel::Error, ::eng::LogCategory::category, __VA_ARGS__)
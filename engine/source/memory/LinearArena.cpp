@@ -0,0 +1,94 @@
+#include "memory/LinearArena.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace eng {
+
+	namespace {
+		//page starts are cache line aligned so commands never straddle one at a page boundary
+		const size_t kPageAlignment = 64;
+	}
+
+	LinearArena::LinearArena(size_t pageSize, MemoryTag tag) : m_pageSize(std::max<size_t>(pageSize, kPageAlignment)), m_tag(tag) {
+	}
+
+	LinearArena::LinearArena(LinearArena&& other) noexcept
+		: m_pageSize(other.m_pageSize), m_tag(other.m_tag), m_pages(std::move(other.m_pages)),
+		m_page(other.m_page), m_offset(other.m_offset), m_usedBytes(other.m_usedBytes) {
+		other.m_pages.clear();
+		other.Reset();
+	}
+
+	LinearArena& LinearArena::operator=(LinearArena&& other) noexcept {
+		if (this != &other) {
+			Release();
+			m_pageSize = other.m_pageSize;
+			m_tag = other.m_tag;
+			m_pages = std::move(other.m_pages);
+			m_page = other.m_page;
+			m_offset = other.m_offset;
+			m_usedBytes = other.m_usedBytes;
+			other.m_pages.clear();
+			other.Reset();
+		}
+		return *this;
+	}
+
+	LinearArena::~LinearArena() {
+		Release();
+	}
+
+	void* LinearArena::Allocate(size_t size, size_t alignment) {
+		alignment = std::max<size_t>(alignment, 1);
+		//the current page first, then the pages kept from earlier rounds, then a new one
+		while (m_page < m_pages.size()) {
+			Page& page = m_pages[m_page];
+			uintptr_t address = reinterpret_cast<uintptr_t>(page.data) + m_offset;
+			size_t padding = (alignment - address % alignment) % alignment;
+			if (m_offset + padding + size <= page.size) {
+				m_offset += padding + size;
+				m_usedBytes += padding + size;
+				return reinterpret_cast<void*>(address + padding);
+			}
+			++m_page;
+			m_offset = 0;
+		}
+
+		size_t pageSize = std::max(m_pageSize, size + alignment);
+		char* data = static_cast<char*>(MemoryTracker::Allocate(pageSize, m_tag, kPageAlignment));
+		if (!data) {
+			return nullptr;
+		}
+		m_pages.push_back({ data, pageSize });
+		m_page = m_pages.size() - 1;
+		m_offset = 0;
+		return Allocate(size, alignment);
+	}
+
+	void LinearArena::Reset() {
+		m_page = 0;
+		m_offset = 0;
+		m_usedBytes = 0;
+	}
+
+	void LinearArena::Release() {
+		for (const Page& page : m_pages) {
+			MemoryTracker::Free(page.data);
+		}
+		m_pages.clear();
+		Reset();
+	}
+
+	size_t LinearArena::GetUsedBytes() const {
+		return m_usedBytes;
+	}
+
+	size_t LinearArena::GetCapacity() const {
+		size_t capacity = 0;
+		for (const Page& page : m_pages) {
+			capacity += page.size;
+		}
+		return capacity;
+	}
+}
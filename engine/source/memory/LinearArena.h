@@ -0,0 +1,45 @@
+#pragma once
+
+#include "memory/MemoryTracker.h"
+#include <cstddef>
+#include <vector>
+
+namespace eng {
+
+	//bump allocator over fixed size pages, nothing is freed on its own, Reset rewinds to the first page
+	//and keeps every page for the next round so a steady workload stops allocating after its first frame
+	//not thread safe, each recording thread gets its own arena
+	class LinearArena {
+	public:
+		explicit LinearArena(size_t pageSize = 64 * 1024, MemoryTag tag = MemoryTag::Graphics);
+		LinearArena(const LinearArena&) = delete;
+		LinearArena& operator=(const LinearArena&) = delete;
+		LinearArena(LinearArena&& other) noexcept;
+		LinearArena& operator=(LinearArena&& other) noexcept;
+		~LinearArena();
+
+		//alignment has to be a power of two, requests larger than a page get a page of their own
+		void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+		void Reset();
+		//hands the pages back to the memory tracker
+		void Release();
+
+		//bytes handed out since the last reset, alignment padding included
+		size_t GetUsedBytes() const;
+		size_t GetCapacity() const;
+
+	private:
+		struct Page {
+			char* data;
+			size_t size;
+		};
+
+		size_t m_pageSize;
+		MemoryTag m_tag;
+		std::vector<Page> m_pages;
+		//page being filled and the offset of its first free byte
+		size_t m_page = 0;
+		size_t m_offset = 0;
+		size_t m_usedBytes = 0;
+	};
+}
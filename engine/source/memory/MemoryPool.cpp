@@ -0,0 +1,233 @@
+#include "memory/MemoryPool.h"
+#include "log/Log.h"
+#include "memory/MemoryTracker.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace eng {
+
+	namespace {
+
+		const size_t kChunkSize = 64 * 1024;
+		const uint8_t kAllocatedPattern = 0xCD;
+		const uint8_t kFreedPattern = 0xDD;
+
+		//16 byte steps up to 128, then four classes per power of two so no class wastes more than a quarter
+		const size_t kClassSizes[] = {
+			16, 32, 48, 64, 80, 96, 112, 128,
+			160, 192, 224, 256,
+			320, 384, 448, 512,
+			640, 768, 896, 1024
+		};
+		const size_t kClassCount = sizeof(kClassSizes) / sizeof(kClassSizes[0]);
+
+		//the first bytes of a free block link it to the next one
+		struct FreeBlock {
+			FreeBlock* next;
+		};
+
+		struct CentralPool {
+			std::mutex mutex;
+			FreeBlock* freeList = nullptr;
+			size_t freeCount = 0;
+			size_t chunkCount = 0;
+			size_t blocksOutstanding = 0;
+		};
+
+		CentralPool s_pools[kClassCount];
+
+		//blocks moved between a thread cache and the central list at once
+		size_t GetBatchSize(size_t sizeClass) {
+			return std::max<size_t>(4, std::min<size_t>(64, 8192 / kClassSizes[sizeClass]));
+		}
+
+		size_t GetSizeClass(size_t size) {
+			//one entry per 16 bytes, built on first use
+			static const struct Lookup {
+				uint8_t classes[MemoryPool::kMaxBlockSize / 16 + 1];
+				Lookup() {
+					size_t sizeClass = 0;
+					for (size_t i = 0; i <= MemoryPool::kMaxBlockSize / 16; ++i) {
+						while (kClassSizes[sizeClass] < i * 16) {
+							++sizeClass;
+						}
+						classes[i] = uint8_t(sizeClass);
+					}
+				}
+			} lookup;
+			return lookup.classes[(size + 15) / 16];
+		}
+
+		void PoisonBlock(void* block, size_t blockSize, uint8_t pattern) {
+#if ENG_POOL_POISON
+			std::memset(block, pattern, blockSize);
+#else
+			(void)block;
+			(void)blockSize;
+			(void)pattern;
+#endif
+		}
+
+		//everything past the link has to still hold the free pattern, otherwise someone wrote through a dangling pointer
+		void CheckFreedBlock(void* block, size_t blockSize) {
+#if ENG_POOL_POISON
+			auto* bytes = static_cast<const uint8_t*>(block);
+			for (size_t i = sizeof(FreeBlock); i < blockSize; ++i) {
+				if (bytes[i] != kFreedPattern) {
+					LOG_ERROR(Memory, "MEMORY_POOL: block {} of size {} was written after being freed", block, blockSize);
+					return;
+				}
+			}
+#else
+			(void)block;
+			(void)blockSize;
+#endif
+		}
+
+		//moves up to count blocks from the central list to the caller, carving a new chunk when the list is dry
+		FreeBlock* TakeBatch(size_t sizeClass, size_t count, size_t& taken) {
+			CentralPool& pool = s_pools[sizeClass];
+			size_t blockSize = kClassSizes[sizeClass];
+			std::lock_guard<std::mutex> lock(pool.mutex);
+			if (!pool.freeList) {
+				//chunks are shared by every tag, so they are billed to none of them
+				auto* chunk = static_cast<uint8_t*>(MemoryTracker::Allocate(kChunkSize, MemoryTag::Untagged, 64));
+				if (!chunk) {
+					taken = 0;
+					return nullptr;
+				}
+				++pool.chunkCount;
+				size_t blockCount = kChunkSize / blockSize;
+				for (size_t i = blockCount; i-- > 0;) {
+					auto* block = reinterpret_cast<FreeBlock*>(chunk + i * blockSize);
+					PoisonBlock(block, blockSize, kFreedPattern);
+					block->next = pool.freeList;
+					pool.freeList = block;
+				}
+				pool.freeCount += blockCount;
+			}
+
+			FreeBlock* head = pool.freeList;
+			FreeBlock* tail = head;
+			taken = 1;
+			while (taken < count && tail->next) {
+				tail = tail->next;
+				++taken;
+			}
+			pool.freeList = tail->next;
+			tail->next = nullptr;
+			pool.freeCount -= taken;
+			pool.blocksOutstanding += taken;
+			return head;
+		}
+
+		void ReturnBatch(size_t sizeClass, FreeBlock* head, FreeBlock* tail, size_t count) {
+			CentralPool& pool = s_pools[sizeClass];
+			std::lock_guard<std::mutex> lock(pool.mutex);
+			tail->next = pool.freeList;
+			pool.freeList = head;
+			pool.freeCount += count;
+			pool.blocksOutstanding -= count;
+		}
+
+		struct ThreadCache {
+			FreeBlock* freeList[kClassCount] = {};
+			size_t freeCount[kClassCount] = {};
+
+			~ThreadCache() {
+				Flush();
+			}
+
+			void Flush() {
+				for (size_t sizeClass = 0; sizeClass < kClassCount; ++sizeClass) {
+					if (!freeList[sizeClass]) {
+						continue;
+					}
+					FreeBlock* tail = freeList[sizeClass];
+					while (tail->next) {
+						tail = tail->next;
+					}
+					ReturnBatch(sizeClass, freeList[sizeClass], tail, freeCount[sizeClass]);
+					freeList[sizeClass] = nullptr;
+					freeCount[sizeClass] = 0;
+				}
+			}
+		};
+
+		thread_local ThreadCache t_cache;
+	}
+
+	void* MemoryPool::Allocate(size_t size) {
+		if (size > kMaxBlockSize) {
+			return MemoryTracker::Allocate(size, MemoryTracker::GetTag());
+		}
+		size_t sizeClass = GetSizeClass(size);
+		size_t blockSize = kClassSizes[sizeClass];
+
+		ThreadCache& cache = t_cache;
+		if (!cache.freeList[sizeClass]) {
+			size_t taken = 0;
+			cache.freeList[sizeClass] = TakeBatch(sizeClass, GetBatchSize(sizeClass), taken);
+			cache.freeCount[sizeClass] = taken;
+			if (!cache.freeList[sizeClass]) {
+				return nullptr;
+			}
+		}
+
+		FreeBlock* block = cache.freeList[sizeClass];
+		cache.freeList[sizeClass] = block->next;
+		--cache.freeCount[sizeClass];
+		CheckFreedBlock(block, blockSize);
+		PoisonBlock(block, blockSize, kAllocatedPattern);
+		return block;
+	}
+
+	void MemoryPool::Free(void* pointer, size_t size) {
+		if (!pointer) {
+			return;
+		}
+		if (size > kMaxBlockSize) {
+			MemoryTracker::Free(pointer);
+			return;
+		}
+		size_t sizeClass = GetSizeClass(size);
+		size_t blockSize = kClassSizes[sizeClass];
+		PoisonBlock(pointer, blockSize, kFreedPattern);
+
+		ThreadCache& cache = t_cache;
+		auto* block = static_cast<FreeBlock*>(pointer);
+		block->next = cache.freeList[sizeClass];
+		cache.freeList[sizeClass] = block;
+		++cache.freeCount[sizeClass];
+
+		//a thread that only frees, like a consumer of another thread's objects, must not hoard blocks forever
+		size_t batchSize = GetBatchSize(sizeClass);
+		if (cache.freeCount[sizeClass] >= batchSize * 2) {
+			FreeBlock* head = cache.freeList[sizeClass];
+			FreeBlock* tail = head;
+			for (size_t i = 1; i < batchSize; ++i) {
+				tail = tail->next;
+			}
+			cache.freeList[sizeClass] = tail->next;
+			cache.freeCount[sizeClass] -= batchSize;
+			ReturnBatch(sizeClass, head, tail, batchSize);
+		}
+	}
+
+	void MemoryPool::FlushThreadCache() {
+		t_cache.Flush();
+	}
+
+	void MemoryPool::GetStats(std::vector<MemoryPoolStats>& stats) {
+		stats.resize(kClassCount);
+		for (size_t sizeClass = 0; sizeClass < kClassCount; ++sizeClass) {
+			CentralPool& pool = s_pools[sizeClass];
+			std::lock_guard<std::mutex> lock(pool.mutex);
+			stats[sizeClass].blockSize = kClassSizes[sizeClass];
+			stats[sizeClass].chunkCount = pool.chunkCount;
+			stats[sizeClass].blocksOutstanding = pool.blocksOutstanding;
+			stats[sizeClass].blocksInCentralList = pool.freeCount;
+		}
+	}
+}
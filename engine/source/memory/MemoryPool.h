@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+//debug builds fill blocks with a pattern on allocation and free and verify the free pattern when a block is reused
+#ifndef ENG_POOL_POISON
+#ifdef NDEBUG
+#define ENG_POOL_POISON 0
+#else
+#define ENG_POOL_POISON 1
+#endif
+#endif
+
+namespace eng {
+
+	struct MemoryPoolStats {
+		size_t blockSize = 0;
+		size_t chunkCount = 0;
+		//blocks currently handed out to threads, including the ones parked in thread caches
+		size_t blocksOutstanding = 0;
+		size_t blocksInCentralList = 0;
+	};
+
+	//small fixed size blocks grouped into size classes, every class carves 64kb chunks into an intrusive free list
+	//each thread keeps its own free list per class and only takes the class lock to move a whole batch in or out
+	//memory is only ever returned to the pool, never to the system, so long sessions cannot fragment the heap
+	//anything larger than kMaxBlockSize goes straight to the memory tracker, billed to the calling thread's tag
+	//pooled blocks carry no header and chunks are shared by every tag, so the chunks are billed as untagged and a tag scope
+	//around a pooled allocation has no effect on it, GetStats is where the pool's own usage shows up
+	class MemoryPool {
+	public:
+		static const size_t kMaxBlockSize = 1024;
+		static const size_t kBlockAlignment = 16;
+
+		static void* Allocate(size_t size);
+		//the size has to be the one passed to Allocate, blocks carry no header
+		static void Free(void* pointer, size_t size);
+
+		//hands the calling thread's cached blocks back to the shared lists, thread exit does the same
+		static void FlushThreadCache();
+		static void GetStats(std::vector<MemoryPoolStats>& stats);
+	};
+
+	//standard allocator on top of the pool, over aligned types fall back to the memory tracker
+	template<typename T>
+	class PoolAllocator {
+	public:
+		using value_type = T;
+		template<typename U>
+		struct rebind {
+			using other = PoolAllocator<U>;
+		};
+
+		PoolAllocator() = default;
+		template<typename U>
+		PoolAllocator(const PoolAllocator<U>&) {}
+
+		T* allocate(size_t count) {
+			static_assert(alignof(T) <= MemoryPool::kBlockAlignment, "over aligned types cannot come from the pool");
+			void* pointer = MemoryPool::Allocate(count * sizeof(T));
+			if (!pointer) {
+				throw std::bad_alloc();
+			}
+			return static_cast<T*>(pointer);
+		}
+		void deallocate(T* pointer, size_t count) {
+			MemoryPool::Free(pointer, count * sizeof(T));
+		}
+
+		template<typename U>
+		bool operator==(const PoolAllocator<U>&) const { return true; }
+		template<typename U>
+		bool operator!=(const PoolAllocator<U>&) const { return false; }
+	};
+
+	//make_shared with the object and its control block in one pool block
+	template<typename T, typename... Args>
+	std::shared_ptr<T> MakePooled(Args&&... args) {
+		return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+	}
+
+	//deriving from this routes plain new and delete of the type through the pool
+	class PoolObject {
+	public:
+		static void* operator new(size_t size) {
+			void* pointer = MemoryPool::Allocate(size);
+			if (!pointer) {
+				throw std::bad_alloc();
+			}
+			return pointer;
+		}
+		static void operator delete(void* pointer, size_t size) {
+			MemoryPool::Free(pointer, size);
+		}
+	};
+}
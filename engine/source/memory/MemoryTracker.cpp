@@ -0,0 +1,233 @@
+#include "memory/MemoryTracker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+
+namespace eng {
+
+	namespace {
+
+		const size_t kTagCount = size_t(MemoryTag::Count);
+
+		//sits right in front of every tracked block so a free knows what to bill without any lookup
+		struct alignas(16) AllocationHeader {
+			uint64_t size;
+			//from the start of the malloc block to the pointer handed out
+			uint32_t offset;
+			uint8_t tag;
+		};
+		static_assert(sizeof(AllocationHeader) == 16, "allocation header must keep blocks 16 byte aligned");
+
+		//only the owning thread writes its counters, Update reads them from the main thread
+		struct ThreadCounters {
+			std::atomic<int64_t> allocatedBytes[kTagCount];
+			std::atomic<int64_t> freedBytes[kTagCount];
+			std::atomic<uint64_t> allocations[kTagCount];
+			std::atomic<uint64_t> frees[kTagCount];
+			ThreadCounters* next;
+		};
+
+		//counters of threads that exited stay in the list, their totals are still part of the picture
+		std::atomic<ThreadCounters*> s_threads{ nullptr };
+		thread_local ThreadCounters* t_counters = nullptr;
+		thread_local MemoryTag t_tag = MemoryTag::Untagged;
+
+		MemoryTagStats s_stats[kTagCount];
+
+		//called from inside operator new, so it must not allocate through it
+		ThreadCounters* GetCounters() {
+			if (!t_counters) {
+				void* memory = std::calloc(1, sizeof(ThreadCounters));
+				if (!memory) {
+					return nullptr;
+				}
+				auto* counters = new (memory) ThreadCounters{};
+				counters->next = s_threads.load(std::memory_order_relaxed);
+				while (!s_threads.compare_exchange_weak(counters->next, counters, std::memory_order_release, std::memory_order_relaxed)) {
+				}
+				t_counters = counters;
+			}
+			return t_counters;
+		}
+
+		//single writer, a plain load and store is enough and avoids a locked instruction per allocation
+		template<typename T>
+		void Increase(std::atomic<T>& counter, T value) {
+			counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+	}
+
+	MemoryTag MemoryTracker::SetTag(MemoryTag tag) {
+		MemoryTag previous = t_tag;
+		t_tag = tag;
+		return previous;
+	}
+
+	MemoryTag MemoryTracker::GetTag() {
+		return t_tag;
+	}
+
+	const char* MemoryTracker::GetTagName(MemoryTag tag) {
+		switch (tag) {
+		case MemoryTag::Untagged: return "Untagged";
+		case MemoryTag::Graphics: return "Graphics";
+		case MemoryTag::Material: return "Material";
+		case MemoryTag::Input: return "Input";
+		case MemoryTag::Assets: return "Assets";
+		case MemoryTag::Game: return "Game";
+		default: return "Unknown";
+		}
+	}
+
+	bool MemoryTracker::IsGlobalTrackingEnabled() {
+#if ENG_MEMORY_TRACKING
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void* MemoryTracker::Allocate(size_t size, MemoryTag tag, size_t alignment) {
+		if (alignment < alignof(AllocationHeader)) {
+			alignment = alignof(AllocationHeader);
+		}
+		//malloc already hands out 16 byte aligned blocks, only larger alignments need the slack
+		size_t slack = alignment > alignof(std::max_align_t) ? alignment : 0;
+		auto* block = static_cast<uint8_t*>(std::malloc(size + sizeof(AllocationHeader) + slack));
+		if (!block) {
+			return nullptr;
+		}
+		uintptr_t address = reinterpret_cast<uintptr_t>(block) + sizeof(AllocationHeader);
+		address = (address + alignment - 1) & ~uintptr_t(alignment - 1);
+		auto* pointer = reinterpret_cast<uint8_t*>(address);
+
+		auto* header = reinterpret_cast<AllocationHeader*>(pointer) - 1;
+		header->size = size;
+		header->offset = uint32_t(pointer - block);
+		header->tag = uint8_t(tag);
+
+		if (ThreadCounters* counters = GetCounters()) {
+			Increase(counters->allocatedBytes[header->tag], int64_t(size));
+			Increase(counters->allocations[header->tag], uint64_t(1));
+		}
+		return pointer;
+	}
+
+	void MemoryTracker::Free(void* pointer) {
+		if (!pointer) {
+			return;
+		}
+		auto* header = static_cast<AllocationHeader*>(pointer) - 1;
+		//billed to the tag it was allocated with, whichever thread frees it
+		if (ThreadCounters* counters = GetCounters()) {
+			Increase(counters->freedBytes[header->tag], int64_t(header->size));
+			Increase(counters->frees[header->tag], uint64_t(1));
+		}
+		std::free(static_cast<uint8_t*>(pointer) - header->offset);
+	}
+
+	void MemoryTracker::Update() {
+		int64_t liveBytes[kTagCount] = {};
+		int64_t liveAllocations[kTagCount] = {};
+		uint64_t totalAllocations[kTagCount] = {};
+		for (ThreadCounters* counters = s_threads.load(std::memory_order_acquire); counters; counters = counters->next) {
+			for (size_t tag = 0; tag < kTagCount; ++tag) {
+				uint64_t allocations = counters->allocations[tag].load(std::memory_order_relaxed);
+				liveBytes[tag] += counters->allocatedBytes[tag].load(std::memory_order_relaxed) - counters->freedBytes[tag].load(std::memory_order_relaxed);
+				liveAllocations[tag] += int64_t(allocations) - int64_t(counters->frees[tag].load(std::memory_order_relaxed));
+				totalAllocations[tag] += allocations;
+			}
+		}
+
+		for (size_t tag = 0; tag < kTagCount; ++tag) {
+			MemoryTagStats& stats = s_stats[tag];
+			stats.frameAllocations = totalAllocations[tag] - stats.totalAllocations;
+			stats.totalAllocations = totalAllocations[tag];
+			stats.liveBytes = liveBytes[tag];
+			stats.liveAllocations = liveAllocations[tag];
+			stats.peakBytes = std::max(stats.peakBytes, stats.liveBytes);
+		}
+	}
+
+	const MemoryTagStats& MemoryTracker::GetStats(MemoryTag tag) {
+		return s_stats[size_t(tag)];
+	}
+
+	size_t MemoryTracker::ReportLeaks(std::ostream& stream) {
+		stream << "memory by tag" << (IsGlobalTrackingEnabled() ? "" : " (global new/delete not tracked)") << "\n";
+		stream << std::left << std::setw(10) << "tag" << std::right << std::setw(14) << "live bytes" << std::setw(10) << "blocks"
+			<< std::setw(14) << "peak bytes" << std::setw(14) << "allocations" << "\n";
+		size_t leaks = 0;
+		for (size_t tag = 0; tag < kTagCount; ++tag) {
+			const MemoryTagStats& stats = s_stats[tag];
+			stream << std::left << std::setw(10) << GetTagName(MemoryTag(tag)) << std::right << std::setw(14) << stats.liveBytes
+				<< std::setw(10) << stats.liveAllocations << std::setw(14) << stats.peakBytes << std::setw(14) << stats.totalAllocations << "\n";
+		}
+		for (size_t tag = 1; tag < kTagCount; ++tag) {
+			const MemoryTagStats& stats = s_stats[tag];
+			if (stats.liveAllocations != 0) {
+				stream << "LEAK: " << GetTagName(MemoryTag(tag)) << " still holds " << stats.liveBytes << " bytes in " << stats.liveAllocations << " blocks\n";
+				++leaks;
+			}
+		}
+		stream.flush();
+		return leaks;
+	}
+}
+
+#if ENG_MEMORY_TRACKING
+//development builds send every allocation of the program through the tracker and bill it to the active tag of the thread
+void* operator new(std::size_t size) {
+	void* pointer = eng::MemoryTracker::Allocate(size, eng::MemoryTracker::GetTag());
+	if (!pointer) {
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return eng::MemoryTracker::Allocate(size, eng::MemoryTracker::GetTag());
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return eng::MemoryTracker::Allocate(size, eng::MemoryTracker::GetTag());
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	void* pointer = eng::MemoryTracker::Allocate(size, eng::MemoryTracker::GetTag(), size_t(alignment));
+	if (!pointer) {
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return eng::MemoryTracker::Allocate(size, eng::MemoryTracker::GetTag(), size_t(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return eng::MemoryTracker::Allocate(size, eng::MemoryTracker::GetTag(), size_t(alignment));
+}
+
+void operator delete(void* pointer) noexcept { eng::MemoryTracker::Free(pointer); }
+void operator delete[](void* pointer) noexcept { eng::MemoryTracker::Free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { eng::MemoryTracker::Free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { eng::MemoryTracker::Free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { eng::MemoryTracker::Free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { eng::MemoryTracker::Free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { eng::MemoryTracker::Free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { eng::MemoryTracker::Free(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { eng::MemoryTracker::Free(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { eng::MemoryTracker::Free(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { eng::MemoryTracker::Free(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { eng::MemoryTracker::Free(pointer); }
+#endif
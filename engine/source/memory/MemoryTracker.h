@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+
+namespace eng {
+
+	//who an allocation is billed to
+	enum class MemoryTag : uint8_t {
+		//anything allocated outside of a tag scope, third party code and the standard library mostly
+		Untagged,
+		Graphics,
+		Material,
+		Input,
+		Assets,
+		Game,
+		Count
+	};
+
+	struct MemoryTagStats {
+		int64_t liveBytes = 0;
+		int64_t liveAllocations = 0;
+		//largest liveBytes seen by any frame so far
+		int64_t peakBytes = 0;
+		uint64_t totalAllocations = 0;
+		//allocations made since the previous frame
+		uint64_t frameAllocations = 0;
+	};
+
+	//every thread counts its own allocations per tag without any locking, Update folds all threads together once a frame
+	//allocations made through Allocate always count, with ENG_MEMORY_TRACKING global new and delete go through here too
+	//so the standard library and third party code are billed to whatever tag is active on the allocating thread
+	class MemoryTracker {
+	public:
+		//tag for everything the calling thread allocates from now on, returns the previous one
+		static MemoryTag SetTag(MemoryTag tag);
+		static MemoryTag GetTag();
+		static const char* GetTagName(MemoryTag tag);
+		//false when global new and delete are left alone, only explicit Allocate calls are counted then
+		static bool IsGlobalTrackingEnabled();
+
+		static void* Allocate(size_t size, MemoryTag tag, size_t alignment = alignof(std::max_align_t));
+		static void Free(void* pointer);
+
+		//aggregates the thread stats into the frame stats, the engine calls it once per frame
+		static void Update();
+		static const MemoryTagStats& GetStats(MemoryTag tag);
+		//prints the stats of every tag and lists the tags still holding memory, returns the number of leaking tags
+		//the untagged bucket is never reported since static objects and the runtime legitimately outlive the engine
+		static size_t ReportLeaks(std::ostream& stream);
+	};
+
+	//bills every allocation of the calling thread to a tag until the scope ends
+	class MemoryTagScope {
+	public:
+		explicit MemoryTagScope(MemoryTag tag) : m_previous(MemoryTracker::SetTag(tag)) {}
+		~MemoryTagScope() { MemoryTracker::SetTag(m_previous); }
+		MemoryTagScope(const MemoryTagScope&) = delete;
+		MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+	private:
+		MemoryTag m_previous;
+	};
+
+	//standard allocator that always bills its container to one tag, whatever thread or scope it grows in
+	template<typename T, MemoryTag Tag>
+	class TaggedAllocator {
+	public:
+		using value_type = T;
+		template<typename U>
+		struct rebind {
+			using other = TaggedAllocator<U, Tag>;
+		};
+
+		TaggedAllocator() = default;
+		template<typename U>
+		TaggedAllocator(const TaggedAllocator<U, Tag>&) {}
+
+		T* allocate(size_t count) {
+			void* pointer = MemoryTracker::Allocate(count * sizeof(T), Tag, alignof(T));
+			if (!pointer) {
+				throw std::bad_alloc();
+			}
+			return static_cast<T*>(pointer);
+		}
+		void deallocate(T* pointer, size_t) {
+			MemoryTracker::Free(pointer);
+		}
+
+		template<typename U>
+		bool operator==(const TaggedAllocator<U, Tag>&) const { return true; }
+		template<typename U>
+		bool operator!=(const TaggedAllocator<U, Tag>&) const { return false; }
+	};
+}
@@ -0,0 +1,417 @@
+#include "render/ClusteredLighting.h"
+#include "jobs/JobSystem.h"
+#include "log/Log.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace eng {
+
+	namespace {
+		//froxel indices within a slice are stored in 16 bits
+		const int kMaxTilesPerSlice = 65536;
+
+		enum BufferIndex {
+			LightDataBuffer,
+			ClusterBuffer,
+			LightIndexBuffer,
+			ParamsBuffer
+		};
+
+		int TileOf(float ndc, int tiles) {
+			ndc = std::min(std::max(ndc, -1.0f), 1.0f);
+			int tile = static_cast<int>(std::floor((ndc + 1.0f) * 0.5f * static_cast<float>(tiles)));
+			return std::min(std::max(tile, 0), tiles - 1);
+		}
+
+		//range of ndc a span [low, high] of view space can cover between the depths near and far, both positive
+		void NdcRange(float low, float high, float nearDepth, float farDepth, float tanHalf, float& ndcLow, float& ndcHigh) {
+			ndcLow = std::min(low / (nearDepth * tanHalf), low / (farDepth * tanHalf));
+			ndcHigh = std::max(high / (nearDepth * tanHalf), high / (farDepth * tanHalf));
+		}
+	}
+
+	ClusteredLighting::ClusteredLighting() {
+		std::memset(&m_params, 0, sizeof(m_params));
+	}
+
+	void ClusteredLighting::SetGrid(int tilesX, int tilesY, int slices) {
+		if (tilesX <= 0 || tilesY <= 0 || slices <= 0 || tilesX * tilesY > kMaxTilesPerSlice) {
+			LOG_ERROR(Graphics, "CLUSTERED_LIGHTING: invalid grid {}x{}x{}", tilesX, tilesY, slices);
+			return;
+		}
+		m_tilesX = tilesX;
+		m_tilesY = tilesY;
+		m_slices = slices;
+		m_froxelsValid = false;
+	}
+
+	int ClusteredLighting::GetTilesX() const {
+		return m_tilesX;
+	}
+
+	int ClusteredLighting::GetTilesY() const {
+		return m_tilesY;
+	}
+
+	int ClusteredLighting::GetSlices() const {
+		return m_slices;
+	}
+
+	void ClusteredLighting::BuildFroxels(const ClusterCamera& camera) {
+		m_fovY = camera.fovY;
+		m_aspect = camera.aspect;
+		m_nearPlane = camera.nearPlane;
+		m_farPlane = camera.farPlane;
+		m_tanHalfY = std::tan(camera.fovY * 0.5f);
+		m_tanHalfX = m_tanHalfY * camera.aspect;
+		m_sliceScale = static_cast<float>(m_slices) / std::log(camera.farPlane / camera.nearPlane);
+
+		//exponential slices keep the froxels roughly cube shaped all the way to the far plane
+		m_sliceDepths.resize(m_slices + 1);
+		for (int slice = 0; slice <= m_slices; ++slice) {
+			m_sliceDepths[slice] = camera.nearPlane * std::pow(camera.farPlane / camera.nearPlane, static_cast<float>(slice) / static_cast<float>(m_slices));
+		}
+
+		//a tile is a pyramid piece, its box covers both the near and the far end of the slice
+		m_minX.resize(size_t(m_slices) * m_tilesX);
+		m_maxX.resize(size_t(m_slices) * m_tilesX);
+		m_minY.resize(size_t(m_slices) * m_tilesY);
+		m_maxY.resize(size_t(m_slices) * m_tilesY);
+		for (int slice = 0; slice < m_slices; ++slice) {
+			float nearDepth = m_sliceDepths[slice];
+			float farDepth = m_sliceDepths[slice + 1];
+			for (int x = 0; x < m_tilesX; ++x) {
+				float low = -1.0f + 2.0f * static_cast<float>(x) / static_cast<float>(m_tilesX);
+				float high = -1.0f + 2.0f * static_cast<float>(x + 1) / static_cast<float>(m_tilesX);
+				m_minX[size_t(slice) * m_tilesX + x] = std::min(low * nearDepth, low * farDepth) * m_tanHalfX;
+				m_maxX[size_t(slice) * m_tilesX + x] = std::max(high * nearDepth, high * farDepth) * m_tanHalfX;
+			}
+			for (int y = 0; y < m_tilesY; ++y) {
+				float low = -1.0f + 2.0f * static_cast<float>(y) / static_cast<float>(m_tilesY);
+				float high = -1.0f + 2.0f * static_cast<float>(y + 1) / static_cast<float>(m_tilesY);
+				m_minY[size_t(slice) * m_tilesY + y] = std::min(low * nearDepth, low * farDepth) * m_tanHalfY;
+				m_maxY[size_t(slice) * m_tilesY + y] = std::max(high * nearDepth, high * farDepth) * m_tanHalfY;
+			}
+		}
+		m_sliceBins.resize(m_slices);
+		m_froxelsValid = true;
+	}
+
+	void ClusteredLighting::Build(const ClusterCamera& camera, const std::vector<PointLight>& lights, JobSystem* jobSystem) {
+		auto start = std::chrono::steady_clock::now();
+		if (camera.nearPlane <= 0.0f || camera.farPlane <= camera.nearPlane) {
+			LOG_ERROR(Graphics, "CLUSTERED_LIGHTING: invalid depth range {} to {}", camera.nearPlane, camera.farPlane);
+			return;
+		}
+		if (!m_froxelsValid || camera.fovY != m_fovY || camera.aspect != m_aspect || camera.nearPlane != m_nearPlane || camera.farPlane != m_farPlane) {
+			BuildFroxels(camera);
+		}
+
+		//lights to view space and into the depth slices they overlap, one pass over the lights
+		size_t lightCount = lights.size();
+		m_viewX.resize(lightCount);
+		m_viewY.resize(lightCount);
+		m_viewDepth.resize(lightCount);
+		m_radius.resize(lightCount);
+		for (Slice& bin : m_sliceBins) {
+			bin.lights.clear();
+		}
+		const float* view = camera.view;
+		for (size_t i = 0; i < lightCount; ++i) {
+			const PointLight& light = lights[i];
+			float x = view[0] * light.x + view[4] * light.y + view[8] * light.z + view[12];
+			float y = view[1] * light.x + view[5] * light.y + view[9] * light.z + view[13];
+			float depth = -(view[2] * light.x + view[6] * light.y + view[10] * light.z + view[14]);
+			m_viewX[i] = x;
+			m_viewY[i] = y;
+			m_viewDepth[i] = depth;
+			m_radius[i] = light.radius;
+			if (light.radius <= 0.0f || depth + light.radius < m_nearPlane || depth - light.radius > m_farPlane) {
+				continue;
+			}
+			int first = std::min(static_cast<int>(std::log(std::max(depth - light.radius, m_nearPlane) / m_nearPlane) * m_sliceScale), m_slices - 1);
+			int last = std::min(static_cast<int>(std::log(std::min(depth + light.radius, m_farPlane) / m_nearPlane) * m_sliceScale), m_slices - 1);
+			for (int slice = first; slice <= last; ++slice) {
+				m_sliceBins[slice].lights.push_back(static_cast<uint32_t>(i));
+			}
+		}
+
+		//slices never share a froxel, so each one is binned on its own
+		if (jobSystem) {
+			jobSystem->ParallelFor(m_slices, 1, [this](size_t begin, size_t end) {
+				for (size_t slice = begin; slice < end; ++slice) {
+					BinSlice(static_cast<int>(slice));
+				}
+			});
+		}
+		else {
+			for (int slice = 0; slice < m_slices; ++slice) {
+				BinSlice(slice);
+			}
+		}
+
+		//the slices' lists go back to back in froxel order
+		size_t tilesPerSlice = size_t(m_tilesX) * m_tilesY;
+		size_t indexCount = 0;
+		for (const Slice& bin : m_sliceBins) {
+			indexCount += bin.indices.size();
+		}
+		m_clusters.resize(tilesPerSlice * m_slices * 2);
+		m_lightIndices.resize(indexCount);
+		size_t offset = 0;
+		size_t maxLights = 0;
+		for (int slice = 0; slice < m_slices; ++slice) {
+			const Slice& bin = m_sliceBins[slice];
+			uint32_t* clusters = m_clusters.data() + tilesPerSlice * slice * 2;
+			//counts hold the end of every froxel's range after the scatter
+			uint32_t previousEnd = 0;
+			for (size_t cluster = 0; cluster < tilesPerSlice; ++cluster) {
+				uint32_t end = bin.counts[cluster];
+				clusters[cluster * 2] = static_cast<uint32_t>(offset + previousEnd);
+				clusters[cluster * 2 + 1] = end - previousEnd;
+				maxLights = std::max<size_t>(maxLights, end - previousEnd);
+				previousEnd = end;
+			}
+			if (!bin.indices.empty()) {
+				std::memcpy(m_lightIndices.data() + offset, bin.indices.data(), bin.indices.size() * sizeof(uint32_t));
+			}
+			offset += bin.indices.size();
+		}
+
+		//what the shaders need of every light, the lists index into it
+		m_lightData.resize(lightCount * 8);
+		size_t visibleCount = 0;
+		std::vector<bool> visible(lightCount, false);
+		for (uint32_t index : m_lightIndices) {
+			visible[index] = true;
+		}
+		for (size_t i = 0; i < lightCount; ++i) {
+			const PointLight& light = lights[i];
+			float* data = m_lightData.data() + i * 8;
+			data[0] = light.x;
+			data[1] = light.y;
+			data[2] = light.z;
+			data[3] = light.radius;
+			data[4] = light.r * light.intensity;
+			data[5] = light.g * light.intensity;
+			data[6] = light.b * light.intensity;
+			data[7] = 0.0f;
+			visibleCount += visible[i] ? 1 : 0;
+		}
+
+		std::memcpy(m_params.view, camera.view, sizeof(m_params.view));
+		m_params.grid[0] = static_cast<float>(m_tilesX);
+		m_params.grid[1] = static_cast<float>(m_tilesY);
+		m_params.grid[2] = static_cast<float>(m_slices);
+		m_params.grid[3] = static_cast<float>(lightCount);
+		m_params.depth[0] = m_sliceScale;
+		m_params.depth[1] = std::log(m_nearPlane) * m_sliceScale;
+		m_params.depth[2] = m_nearPlane;
+		m_params.depth[3] = m_farPlane;
+		m_cameraViewport[0] = camera.viewportWidth;
+		m_cameraViewport[1] = camera.viewportHeight;
+		ApplyViewport();
+		m_uploaded = false;
+
+		m_stats.lightCount = lightCount;
+		m_stats.visibleLightCount = visibleCount;
+		m_stats.clusterCount = tilesPerSlice * m_slices;
+		m_stats.indexCount = indexCount;
+		m_stats.maxLightsPerCluster = maxLights;
+		m_stats.binMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void ClusteredLighting::BinSlice(int slice) {
+		Slice& bin = m_sliceBins[slice];
+		bin.hitClusters.clear();
+		bin.hitLights.clear();
+
+		float nearDepth = m_sliceDepths[slice];
+		float farDepth = m_sliceDepths[slice + 1];
+		const float* minX = m_minX.data() + size_t(slice) * m_tilesX;
+		const float* maxX = m_maxX.data() + size_t(slice) * m_tilesX;
+		const float* minY = m_minY.data() + size_t(slice) * m_tilesY;
+		const float* maxY = m_maxY.data() + size_t(slice) * m_tilesY;
+
+		for (uint32_t light : bin.lights) {
+			float x = m_viewX[light];
+			float y = m_viewY[light];
+			float depth = m_viewDepth[light];
+			float radius = m_radius[light];
+
+			//squared radius left after the distance to the slice along depth
+			float distanceZ = std::max(std::max(nearDepth - depth, depth - farDepth), 0.0f);
+			float remaining = radius * radius - distanceZ * distanceZ;
+			if (remaining < 0.0f) {
+				continue;
+			}
+
+			//tiles the sphere can project to within the part of the slice it overlaps, the sphere tests below trim them
+			float sphereNear = std::max(nearDepth, depth - radius);
+			float sphereFar = std::min(farDepth, depth + radius);
+			float ndcLowX, ndcHighX, ndcLowY, ndcHighY;
+			NdcRange(x - radius, x + radius, sphereNear, sphereFar, m_tanHalfX, ndcLowX, ndcHighX);
+			NdcRange(y - radius, y + radius, sphereNear, sphereFar, m_tanHalfY, ndcLowY, ndcHighY);
+			if (ndcHighX < -1.0f || ndcLowX > 1.0f || ndcHighY < -1.0f || ndcLowY > 1.0f) {
+				continue;
+			}
+			int firstX = TileOf(ndcLowX, m_tilesX);
+			int lastX = TileOf(ndcHighX, m_tilesX);
+			int firstY = TileOf(ndcLowY, m_tilesY);
+			int lastY = TileOf(ndcHighY, m_tilesY);
+
+			for (int tileY = firstY; tileY <= lastY; ++tileY) {
+				float distanceY = std::max(std::max(minY[tileY] - y, y - maxY[tileY]), 0.0f);
+				float rowRemaining = remaining - distanceY * distanceY;
+				if (rowRemaining < 0.0f) {
+					continue;
+				}
+				uint16_t rowStart = static_cast<uint16_t>(tileY * m_tilesX);
+				for (int tileX = firstX; tileX <= lastX; ++tileX) {
+					float distanceX = std::max(std::max(minX[tileX] - x, x - maxX[tileX]), 0.0f);
+					if (distanceX * distanceX <= rowRemaining) {
+						bin.hitClusters.push_back(static_cast<uint16_t>(rowStart + tileX));
+						bin.hitLights.push_back(light);
+					}
+				}
+			}
+		}
+
+		//counting sort by froxel, stable so every froxel lists its lights in ascending order
+		size_t tilesPerSlice = size_t(m_tilesX) * m_tilesY;
+		bin.counts.assign(tilesPerSlice, 0);
+		for (uint16_t cluster : bin.hitClusters) {
+			++bin.counts[cluster];
+		}
+		uint32_t sum = 0;
+		for (uint32_t& count : bin.counts) {
+			uint32_t current = count;
+			count = sum;
+			sum += current;
+		}
+		bin.indices.resize(bin.hitLights.size());
+		for (size_t hit = 0; hit < bin.hitLights.size(); ++hit) {
+			bin.indices[bin.counts[bin.hitClusters[hit]]++] = bin.hitLights[hit];
+		}
+	}
+
+	uint32_t ClusteredLighting::GetClusterIndex(int x, int y, int slice) const {
+		return static_cast<uint32_t>((slice * m_tilesY + y) * m_tilesX + x);
+	}
+
+	const std::vector<uint32_t>& ClusteredLighting::GetClusters() const {
+		return m_clusters;
+	}
+
+	const std::vector<uint32_t>& ClusteredLighting::GetLightIndices() const {
+		return m_lightIndices;
+	}
+
+	const ClusteredLightingStats& ClusteredLighting::GetStats() const {
+		return m_stats;
+	}
+
+	void ClusteredLighting::SetViewport(int width, int height) {
+		m_viewportOverride[0] = width;
+		m_viewportOverride[1] = height;
+		ApplyViewport();
+	}
+
+	void ClusteredLighting::ApplyViewport() {
+		bool overridden = m_viewportOverride[0] > 0 && m_viewportOverride[1] > 0;
+		float width = static_cast<float>(overridden ? m_viewportOverride[0] : m_cameraViewport[0]);
+		float height = static_cast<float>(overridden ? m_viewportOverride[1] : m_cameraViewport[1]);
+		if (m_params.viewport[0] != width || m_params.viewport[1] != height) {
+			m_params.viewport[0] = width;
+			m_params.viewport[1] = height;
+			m_uploaded = false;
+		}
+	}
+
+	void ClusteredLighting::Upload() {
+		//nothing built yet
+		if (m_uploaded || m_stats.clusterCount == 0) {
+			return;
+		}
+		if (!m_buffers[0]) {
+			glGenBuffers(4, m_buffers);
+			glGenTextures(3, m_textures);
+		}
+
+		//buffer storage is respecified every frame so the driver never waits for last frame's draws
+		auto fill = [](GLenum target, GLuint buffer, const void* data, size_t size) {
+			glBindBuffer(target, buffer);
+			//empty buffer textures are not allowed everywhere
+			glBufferData(target, std::max<size_t>(size, 16), nullptr, GL_STREAM_DRAW);
+			if (size) {
+				glBufferSubData(target, 0, size, data);
+			}
+		};
+		fill(GL_TEXTURE_BUFFER, m_buffers[LightDataBuffer], m_lightData.data(), m_lightData.size() * sizeof(float));
+		fill(GL_TEXTURE_BUFFER, m_buffers[ClusterBuffer], m_clusters.data(), m_clusters.size() * sizeof(uint32_t));
+		fill(GL_TEXTURE_BUFFER, m_buffers[LightIndexBuffer], m_lightIndices.data(), m_lightIndices.size() * sizeof(uint32_t));
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		fill(GL_UNIFORM_BUFFER, m_buffers[ParamsBuffer], &m_params, sizeof(m_params));
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+		for (int i = 0; i < 3; ++i) {
+			glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+			glTexBuffer(GL_TEXTURE_BUFFER, formats[i], m_buffers[i]);
+		}
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		m_uploaded = true;
+	}
+
+	void ClusteredLighting::Bind() const {
+		if (!m_buffers[0]) {
+			return;
+		}
+		const int units[3] = { LightDataUnit, ClusterUnit, LightIndexUnit };
+		for (int i = 0; i < 3; ++i) {
+			glActiveTexture(GL_TEXTURE0 + units[i]);
+			glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+		}
+		glActiveTexture(GL_TEXTURE0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, ParamsBinding, m_buffers[ParamsBuffer]);
+	}
+
+	void ClusteredLighting::Destroy() {
+		if (m_buffers[0]) {
+			glDeleteTextures(3, m_textures);
+			glDeleteBuffers(4, m_buffers);
+			std::memset(m_textures, 0, sizeof(m_textures));
+			std::memset(m_buffers, 0, sizeof(m_buffers));
+		}
+		m_uploaded = false;
+		m_froxelsValid = false;
+		m_sliceBins = std::vector<Slice>();
+		m_clusters = std::vector<uint32_t>();
+		m_lightIndices = std::vector<uint32_t>();
+		m_lightData = std::vector<float>();
+	}
+
+	void ClusteredLighting::SetupProgram(GLuint program) {
+		GLuint block = glGetUniformBlockIndex(program, "ClusterParams");
+		if (block == GL_INVALID_INDEX) {
+			return;
+		}
+		glUniformBlockBinding(program, block, ParamsBinding);
+
+		//sampler units are program state, set once after linking
+		GLint previous = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+		glUseProgram(program);
+		const char* names[3] = { "u_lightData", "u_clusters", "u_lightIndices" };
+		const int units[3] = { LightDataUnit, ClusterUnit, LightIndexUnit };
+		for (int i = 0; i < 3; ++i) {
+			GLint location = glGetUniformLocation(program, names[i]);
+			if (location >= 0) {
+				glUniform1i(location, units[i]);
+			}
+		}
+		glUseProgram(GLuint(previous));
+	}
+}
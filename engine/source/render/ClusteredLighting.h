@@ -0,0 +1,167 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace eng {
+
+	class JobSystem;
+
+	//point light in world space, it reaches nothing beyond its radius
+	struct PointLight {
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+		float radius = 1.0f;
+		float r = 1.0f;
+		float g = 1.0f;
+		float b = 1.0f;
+		float intensity = 1.0f;
+	};
+
+	//the camera the clusters are built for, a symmetric perspective projection
+	struct ClusterCamera {
+		//column major world to view matrix, the camera looks down -z
+		float view[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+		//vertical, in radians
+		float fovY = 1.0471976f;
+		float aspect = 16.0f / 9.0f;
+		float nearPlane = 0.1f;
+		float farPlane = 500.0f;
+		//in pixels, the shaders map gl_FragCoord to a tile with it
+		int viewportWidth = 1280;
+		int viewportHeight = 720;
+	};
+
+	struct ClusteredLightingStats {
+		size_t lightCount = 0;
+		//touching at least one cluster
+		size_t visibleLightCount = 0;
+		size_t clusterCount = 0;
+		size_t indexCount = 0;
+		size_t maxLightsPerCluster = 0;
+		float binMilliseconds = 0.0f;
+	};
+
+	//clustered forward shading, the view frustum is split into froxels (screen tiles times exponential depth slices)
+	//and every froxel gets the list of lights whose sphere touches it, so a fragment only loops over the lights of its froxel
+	//binning costs one pass over the lights plus one sphere test per froxel a light can touch, the depth slices
+	//are binned in parallel on the job system
+	//the lists are packed back to back into buffer textures that include/clustered_lights.glsl reads
+	class ClusteredLighting {
+	public:
+		//texture units taken by the buffer textures, materials count their textures up from unit 0
+		static constexpr int LightDataUnit = 13;
+		static constexpr int ClusterUnit = 14;
+		static constexpr int LightIndexUnit = 15;
+		//uniform block binding point of ClusterParams
+		static constexpr GLuint ParamsBinding = 1;
+
+		ClusteredLighting();
+		ClusteredLighting(const ClusteredLighting&) = delete;
+		ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+		//tilesX * tilesY * slices froxels, 16 x 9 x 24 by default
+		void SetGrid(int tilesX, int tilesY, int slices);
+		int GetTilesX() const;
+		int GetTilesY() const;
+		int GetSlices() const;
+
+		//bins the lights, the light indices in the lists refer to this vector
+		void Build(const ClusterCamera& camera, const std::vector<PointLight>& lights, JobSystem* jobSystem = nullptr);
+
+		//x fastest, then y from the bottom of the screen, then depth slice from the near plane
+		uint32_t GetClusterIndex(int x, int y, int slice) const;
+		//offset into the light indices and light count, two values per froxel
+		const std::vector<uint32_t>& GetClusters() const;
+		const std::vector<uint32_t>& GetLightIndices() const;
+		const ClusteredLightingStats& GetStats() const;
+
+		//the pixel size the scene is drawn at when it differs from the camera's viewport, e.g. with dynamic resolution
+		//0 x 0 goes back to the camera's, the froxels stay the same since they only depend on the projection
+		void SetViewport(int width, int height);
+		//copies the last Build to the gpu, does nothing when it was uploaded already, needs the context
+		void Upload();
+		//binds the buffer textures and the parameter block for the draws that follow
+		void Bind() const;
+		//deletes the gl objects, needs the context
+		void Destroy();
+
+		//points the samplers and the ClusterParams block of a freshly linked program at the units above
+		//programs that do not include clustered_lights.glsl are left alone
+		static void SetupProgram(GLuint program);
+
+	private:
+		//bins per depth slice, each job owns a few of them
+		struct Slice {
+			//lights whose depth range overlaps the slice
+			std::vector<uint32_t> lights;
+			//froxel within the slice and light for every hit, in light order
+			std::vector<uint16_t> hitClusters;
+			std::vector<uint32_t> hitLights;
+			std::vector<uint32_t> counts;
+			//the hits sorted by froxel
+			std::vector<uint32_t> indices;
+		};
+
+		//std140 layout of ClusterParams
+		struct Params {
+			float view[16];
+			//tiles x, tiles y, slices, light count
+			float grid[4];
+			//slice scale and bias, near and far plane
+			float depth[4];
+			//viewport width and height
+			float viewport[4];
+		};
+
+		void BuildFroxels(const ClusterCamera& camera);
+		//writes the override or the camera's viewport into the parameters
+		void ApplyViewport();
+		void BinSlice(int slice);
+
+		int m_tilesX = 16;
+		int m_tilesY = 9;
+		int m_slices = 24;
+
+		//camera the froxel bounds were built for, they only depend on the projection
+		float m_fovY = 0.0f;
+		float m_aspect = 0.0f;
+		float m_nearPlane = 0.0f;
+		float m_farPlane = 0.0f;
+		bool m_froxelsValid = false;
+		float m_tanHalfX = 0.0f;
+		float m_tanHalfY = 0.0f;
+		//slices per unit of log depth
+		float m_sliceScale = 0.0f;
+		//view space bounds with depth positive in front of the camera, x only depends on tile x and slice,
+		//y on tile y and slice, so they are stored per slice
+		std::vector<float> m_minX;
+		std::vector<float> m_maxX;
+		std::vector<float> m_minY;
+		std::vector<float> m_maxY;
+		std::vector<float> m_sliceDepths;
+
+		//lights moved to view space, depth positive in front of the camera
+		std::vector<float> m_viewX;
+		std::vector<float> m_viewY;
+		std::vector<float> m_viewDepth;
+		std::vector<float> m_radius;
+		std::vector<Slice> m_sliceBins;
+
+		std::vector<uint32_t> m_clusters;
+		std::vector<uint32_t> m_lightIndices;
+		//two rgba32f texels per light, position and radius then color times intensity
+		std::vector<float> m_lightData;
+		Params m_params;
+		ClusteredLightingStats m_stats;
+		int m_cameraViewport[2] = { 0, 0 };
+		int m_viewportOverride[2] = { 0, 0 };
+
+		bool m_uploaded = false;
+		GLuint m_buffers[4] = { 0, 0, 0, 0 };
+		GLuint m_textures[3] = { 0, 0, 0 };
+	};
+}
@@ -0,0 +1,353 @@
+#include "render/CommandList.h"
+#include "render/RenderQueue.h"
+#include "render/Material.h"
+#include "graphics/GraphicsAPI.h"
+#include "graphics/ShaderProgram.h"
+#include "graphics/Texture.h"
+#include "jobs/JobSystem.h"
+#include <algorithm>
+#include <type_traits>
+
+namespace eng {
+
+	namespace {
+
+		//every command is a multiple of this, so commands recorded one after another stay contiguous in the arena
+		const size_t kCommandAlignment = 8;
+
+		struct BindMaterialCommand {
+			CommandHeader header;
+			Material* material;
+		};
+
+		struct BindVertexArrayCommand {
+			CommandHeader header;
+			GLuint vertexArray;
+		};
+
+		struct SetLodFadeCommand {
+			CommandHeader header;
+			float fade;
+		};
+
+		struct DrawCommand {
+			CommandHeader header;
+			GLenum mode;
+			GLuint first;
+			GLsizei count;
+		};
+
+		struct DrawIndexedCommand {
+			CommandHeader header;
+			GLenum mode;
+			GLenum indexType;
+			GLuint firstIndex;
+			GLsizei count;
+		};
+
+		struct BindTextureCommand {
+			CommandHeader header;
+			Texture* texture;
+			int unit;
+		};
+
+		struct SetViewportCommand {
+			CommandHeader header;
+			int x;
+			int y;
+			int width;
+			int height;
+		};
+
+		struct ClearCommand {
+			CommandHeader header;
+			float color[4];
+			float depth;
+			GLbitfield mask;
+		};
+
+		constexpr uint32_t CommandSize(size_t size) {
+			return static_cast<uint32_t>((size + kCommandAlignment - 1) / kCommandAlignment * kCommandAlignment);
+		}
+
+		size_t IndexSize(GLenum indexType) {
+			return indexType == GL_UNSIGNED_INT ? 4 : indexType == GL_UNSIGNED_SHORT ? 2 : 1;
+		}
+	}
+
+	CommandList::CommandList(size_t pageSize) : m_arena(pageSize, MemoryTag::Graphics) {
+	}
+
+	template<typename T>
+	T* CommandList::Record(CommandType type) {
+		static_assert(std::is_trivially_copyable<T>::value, "commands have to be plain data");
+		static_assert(alignof(T) <= kCommandAlignment, "commands are only aligned to kCommandAlignment");
+		const uint32_t size = CommandSize(sizeof(T));
+		char* memory = static_cast<char*>(m_arena.Allocate(size, kCommandAlignment));
+		//a new page starts a new block, otherwise the command simply extends the last one
+		if (!m_blocks.empty() && m_blocks.back().begin + m_blocks.back().size == memory) {
+			m_blocks.back().size += size;
+		}
+		else {
+			m_blocks.push_back({ memory, size });
+		}
+		++m_commandCount;
+		T* command = reinterpret_cast<T*>(memory);
+		command->header.type = type;
+		command->header.size = size;
+		return command;
+	}
+
+	void CommandList::BindMaterial(Material* material) {
+		Record<BindMaterialCommand>(CommandType::BindMaterial)->material = material;
+		m_material = material;
+		//binding a material resets the fade on replay
+		m_lodFade = 0.0f;
+	}
+
+	void CommandList::BindVertexArray(GLuint vertexArray) {
+		Record<BindVertexArrayCommand>(CommandType::BindVertexArray)->vertexArray = vertexArray;
+		m_vertexArray = vertexArray;
+	}
+
+	void CommandList::SetLodFade(float fade) {
+		Record<SetLodFadeCommand>(CommandType::SetLodFade)->fade = fade;
+		m_lodFade = fade;
+	}
+
+	void CommandList::Draw(GLenum mode, GLuint firstVertex, GLsizei count) {
+		auto* command = Record<DrawCommand>(CommandType::Draw);
+		command->mode = mode;
+		command->first = firstVertex;
+		command->count = count;
+		++m_drawCount;
+	}
+
+	void CommandList::DrawIndexed(GLenum mode, GLenum indexType, GLuint firstIndex, GLsizei count) {
+		auto* command = Record<DrawIndexedCommand>(CommandType::DrawIndexed);
+		command->mode = mode;
+		command->indexType = indexType;
+		command->firstIndex = firstIndex;
+		command->count = count;
+		++m_drawCount;
+	}
+
+	void CommandList::BindTexture(Texture* texture, int unit) {
+		auto* command = Record<BindTextureCommand>(CommandType::BindTexture);
+		command->texture = texture;
+		command->unit = unit;
+	}
+
+	void CommandList::SetViewport(int x, int y, int width, int height) {
+		auto* command = Record<SetViewportCommand>(CommandType::SetViewport);
+		command->x = x;
+		command->y = y;
+		command->width = width;
+		command->height = height;
+	}
+
+	void CommandList::Clear(GLbitfield mask, float r, float g, float b, float a, float depth) {
+		auto* command = Record<ClearCommand>(CommandType::Clear);
+		command->color[0] = r;
+		command->color[1] = g;
+		command->color[2] = b;
+		command->color[3] = a;
+		command->depth = depth;
+		command->mask = mask;
+	}
+
+	void CommandList::Draw(const RenderCommand& command) {
+		//the first draw of a list cannot know what the previous list left bound, replay skips it if it matches
+		if (!m_stateKnown || command.material != m_material) {
+			BindMaterial(command.material);
+		}
+		if (!m_stateKnown || command.vertexArray != m_vertexArray) {
+			BindVertexArray(command.vertexArray);
+		}
+		m_stateKnown = true;
+		if (command.lodFade != m_lodFade) {
+			SetLodFade(command.lodFade);
+		}
+		if (command.indexType != 0) {
+			DrawIndexed(command.mode, command.indexType, command.firstIndex, command.count);
+		}
+		else {
+			Draw(command.mode, command.firstIndex, command.count);
+		}
+	}
+
+	void CommandList::Reset() {
+		m_arena.Reset();
+		m_blocks.clear();
+		m_commandCount = 0;
+		m_drawCount = 0;
+		m_material = nullptr;
+		m_vertexArray = 0;
+		m_lodFade = 0.0f;
+		m_stateKnown = false;
+	}
+
+	size_t CommandList::GetCommandCount() const {
+		return m_commandCount;
+	}
+
+	size_t CommandList::GetDrawCount() const {
+		return m_drawCount;
+	}
+
+	size_t CommandList::GetByteSize() const {
+		return m_arena.GetUsedBytes();
+	}
+
+	void CommandList::Execute(GraphicsAPI& graphicsAPI) const {
+		ReplayState state;
+		Replay(graphicsAPI, state);
+		graphicsAPI.BindVertexArray(0);
+	}
+
+	void CommandList::Replay(GraphicsAPI& graphicsAPI, ReplayState& state) const {
+		//draws stay skipped until a material with a program is bound, the same rule the render queue applies
+		bool drawable = state.material && state.material->GetShaderProgram();
+		for (const Block& block : m_blocks) {
+			const char* cursor = block.begin;
+			const char* end = block.begin + block.size;
+			while (cursor < end) {
+				const auto* header = reinterpret_cast<const CommandHeader*>(cursor);
+				switch (header->type) {
+				case CommandType::BindMaterial: {
+					Material* material = reinterpret_cast<const BindMaterialCommand*>(cursor)->material;
+					drawable = material && material->GetShaderProgram();
+					if (drawable && material != state.material) {
+						graphicsAPI.BindMaterial(material);
+						//shaders without the lod fade include simply get -1 and ignore it
+						state.lodFadeLocation = material->GetShaderProgram()->GetUniformLocation("u_lodFade");
+						state.lodFade = 0.0f;
+						material->GetShaderProgram()->SetUniform(state.lodFadeLocation, state.lodFade);
+					}
+					else if (drawable && state.lodFade != 0.0f) {
+						//the bind was skipped, but the recording relies on a bind leaving the fade at 0
+						state.lodFade = 0.0f;
+						material->GetShaderProgram()->SetUniform(state.lodFadeLocation, state.lodFade);
+					}
+					state.material = material;
+					break;
+				}
+				case CommandType::BindVertexArray: {
+					GLuint vertexArray = reinterpret_cast<const BindVertexArrayCommand*>(cursor)->vertexArray;
+					if (vertexArray != state.vertexArray) {
+						graphicsAPI.BindVertexArray(vertexArray);
+						state.vertexArray = vertexArray;
+					}
+					break;
+				}
+				case CommandType::SetLodFade: {
+					float fade = reinterpret_cast<const SetLodFadeCommand*>(cursor)->fade;
+					if (drawable && fade != state.lodFade) {
+						state.material->GetShaderProgram()->SetUniform(state.lodFadeLocation, fade);
+						state.lodFade = fade;
+					}
+					break;
+				}
+				case CommandType::Draw: {
+					const auto* command = reinterpret_cast<const DrawCommand*>(cursor);
+					if (drawable) {
+						graphicsAPI.DrawArrays(command->mode, GLint(command->first), command->count);
+						++state.drawCount;
+					}
+					break;
+				}
+				case CommandType::DrawIndexed: {
+					const auto* command = reinterpret_cast<const DrawIndexedCommand*>(cursor);
+					if (drawable) {
+						graphicsAPI.DrawElements(command->mode, command->count, command->indexType, command->firstIndex * IndexSize(command->indexType));
+						++state.drawCount;
+					}
+					break;
+				}
+				case CommandType::BindTexture: {
+					const auto* command = reinterpret_cast<const BindTextureCommand*>(cursor);
+					graphicsAPI.BindTexture(command->texture, command->unit);
+					break;
+				}
+				case CommandType::SetViewport: {
+					const auto* command = reinterpret_cast<const SetViewportCommand*>(cursor);
+					glViewport(command->x, command->y, command->width, command->height);
+					break;
+				}
+				case CommandType::Clear: {
+					const auto* command = reinterpret_cast<const ClearCommand*>(cursor);
+					glClearColor(command->color[0], command->color[1], command->color[2], command->color[3]);
+					glClearDepth(command->depth);
+					glClear(command->mask);
+					break;
+				}
+				}
+				cursor += header->size;
+			}
+		}
+	}
+
+	CommandList& CommandListPool::Acquire() {
+		if (m_acquired == m_lists.size()) {
+			m_lists.push_back(std::make_unique<CommandList>());
+		}
+		CommandList& list = *m_lists[m_acquired++];
+		list.Reset();
+		return list;
+	}
+
+	void CommandListPool::RecordParallel(JobSystem& jobSystem, const std::vector<RenderCommand>& commands, const std::vector<uint32_t>& visible, size_t chunkSize) {
+		chunkSize = std::max<size_t>(chunkSize, 1);
+		size_t first = m_acquired;
+		for (size_t begin = 0; begin < visible.size(); begin += chunkSize) {
+			Acquire();
+		}
+		//without workers ParallelFor hands over the whole range at once, so split it into the lists here
+		jobSystem.ParallelFor(visible.size(), chunkSize, [&](size_t begin, size_t end) {
+			for (size_t chunk = begin; chunk < end; chunk += chunkSize) {
+				CommandList& list = *m_lists[first + chunk / chunkSize];
+				size_t chunkEnd = std::min(chunk + chunkSize, end);
+				for (size_t i = chunk; i < chunkEnd; ++i) {
+					list.Draw(commands[visible[i]]);
+				}
+			}
+		});
+	}
+
+	void CommandListPool::Execute(GraphicsAPI& graphicsAPI) {
+		m_stats = Stats();
+		CommandList::ReplayState state;
+		for (size_t i = 0; i < m_acquired; ++i) {
+			const CommandList& list = *m_lists[i];
+			list.Replay(graphicsAPI, state);
+			m_stats.commands += list.GetCommandCount();
+			m_stats.bytes += list.GetByteSize();
+		}
+		m_stats.lists = m_acquired;
+		m_stats.draws = state.drawCount;
+		if (m_acquired > 0) {
+			graphicsAPI.BindVertexArray(0);
+		}
+		Reset();
+	}
+
+	void CommandListPool::Reset() {
+		for (size_t i = 0; i < m_acquired; ++i) {
+			m_lists[i]->Reset();
+		}
+		m_acquired = 0;
+	}
+
+	void CommandListPool::Release() {
+		m_lists.clear();
+		m_acquired = 0;
+	}
+
+	size_t CommandListPool::GetAcquiredCount() const {
+		return m_acquired;
+	}
+
+	const CommandListPool::Stats& CommandListPool::GetStats() const {
+		return m_stats;
+	}
+}
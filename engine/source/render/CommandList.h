@@ -0,0 +1,137 @@
+#pragma once
+
+#include "memory/LinearArena.h"
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace eng {
+
+	class Material;
+	class Texture;
+	class GraphicsAPI;
+	class JobSystem;
+	struct RenderCommand;
+
+	enum class CommandType : uint32_t {
+		BindMaterial,
+		BindVertexArray,
+		SetLodFade,
+		Draw,
+		DrawIndexed,
+		BindTexture,
+		SetViewport,
+		Clear
+	};
+
+	//starts every recorded command, size covers the header and the payload
+	struct CommandHeader {
+		CommandType type;
+		uint32_t size;
+	};
+
+	//plain data recording of draws and the state they need, nothing touches the graphics api while recording
+	//so any thread can fill a list, the commands are packed back to back into the list's own arena
+	//and only Execute on the context thread turns them into gl calls
+	class CommandList {
+	public:
+		explicit CommandList(size_t pageSize = 64 * 1024);
+		CommandList(const CommandList&) = delete;
+		CommandList& operator=(const CommandList&) = delete;
+
+		void BindMaterial(Material* material);
+		void BindVertexArray(GLuint vertexArray);
+		void SetLodFade(float fade);
+		void Draw(GLenum mode, GLuint firstVertex, GLsizei count);
+		void DrawIndexed(GLenum mode, GLenum indexType, GLuint firstIndex, GLsizei count);
+		void BindTexture(Texture* texture, int unit);
+		void SetViewport(int x, int y, int width, int height);
+		//mask is the usual gl clear mask
+		void Clear(GLbitfield mask, float r, float g, float b, float a, float depth = 1.0f);
+		//records the state changes the command needs relative to what this list recorded last and the draw itself
+		void Draw(const RenderCommand& command);
+
+		//forgets the commands, the arena pages are kept
+		void Reset();
+
+		size_t GetCommandCount() const;
+		size_t GetDrawCount() const;
+		size_t GetByteSize() const;
+
+		//context thread only, draws without a usable material are skipped like the render queue does
+		void Execute(GraphicsAPI& graphicsAPI) const;
+
+	private:
+		//the gl state replay tracks so consecutive lists skip the binds their predecessor already made
+		struct ReplayState {
+			Material* material = nullptr;
+			GLuint vertexArray = 0;
+			GLint lodFadeLocation = -1;
+			float lodFade = 0.0f;
+			size_t drawCount = 0;
+		};
+
+		//contiguous run of commands inside one arena page
+		struct Block {
+			const char* begin;
+			size_t size;
+		};
+
+		template<typename T>
+		T* Record(CommandType type);
+		void Replay(GraphicsAPI& graphicsAPI, ReplayState& state) const;
+
+		LinearArena m_arena;
+		std::vector<Block> m_blocks;
+		size_t m_commandCount = 0;
+		size_t m_drawCount = 0;
+
+		//what the recorded commands leave bound, Draw(RenderCommand) skips redundant changes with it
+		Material* m_material = nullptr;
+		GLuint m_vertexArray = 0;
+		float m_lodFade = 0.0f;
+		bool m_stateKnown = false;
+
+		friend class CommandListPool;
+	};
+
+	//hands out command lists in submission order, the lists are recorded on any thread and replayed
+	//in exactly that order on the context thread, so recording scales across cores while submission stays serial
+	class CommandListPool {
+	public:
+		struct Stats {
+			size_t lists = 0;
+			size_t commands = 0;
+			size_t bytes = 0;
+			size_t draws = 0;
+		};
+
+		CommandListPool() = default;
+		CommandListPool(const CommandListPool&) = delete;
+		CommandListPool& operator=(const CommandListPool&) = delete;
+
+		//call from one thread, the order of the calls is the replay order, the list stays valid until Execute or Reset
+		CommandList& Acquire();
+		//acquires count consecutive lists and records commands[visible[i]] into them on the job system,
+		//chunkSize draws per list, keeping the order of visible
+		void RecordParallel(JobSystem& jobSystem, const std::vector<RenderCommand>& commands, const std::vector<uint32_t>& visible, size_t chunkSize = 1024);
+
+		//every recording into the acquired lists has to be finished, replays them in order and resets the pool
+		void Execute(GraphicsAPI& graphicsAPI);
+		//drops the acquired lists without drawing them
+		void Reset();
+		//frees the arenas of every list
+		void Release();
+
+		size_t GetAcquiredCount() const;
+		//of the last Execute
+		const Stats& GetStats() const;
+
+	private:
+		std::vector<std::unique_ptr<CommandList>> m_lists;
+		size_t m_acquired = 0;
+		Stats m_stats;
+	};
+}
@@ -0,0 +1,178 @@
+#include "render/DynamicResolution.h"
+#include "Engine.h"
+#include "log/Log.h"
+#include <algorithm>
+#include <cmath>
+
+namespace eng {
+
+	namespace {
+		//one triangle covering the screen, generated from the vertex id so no buffers are needed
+		const char* kCompositeVertexSource = R"(#version 330 core
+out vec2 vTexCoord;
+void main() {
+	vec2 position = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+	vTexCoord = position * 0.5 + 0.5;
+	gl_Position = vec4(position, 0.0, 1.0);
+}
+)";
+
+		const char* kCompositeFragmentSource = R"(#version 330 core
+in vec2 vTexCoord;
+out vec4 FragColor;
+uniform sampler2D u_source;
+//the rendered part of the source in uv, and its last texel centres so the filter never reads past it
+uniform vec2 u_uvScale;
+uniform vec2 u_uvMax;
+void main() {
+	FragColor = texture(u_source, min(vTexCoord * u_uvScale, u_uvMax));
+}
+)";
+	}
+
+	DynamicResolution::~DynamicResolution() {
+		Destroy();
+	}
+
+	void DynamicResolution::SetEnabled(bool enabled) {
+		m_enabled = enabled;
+		Reset();
+	}
+
+	bool DynamicResolution::IsEnabled() const {
+		return m_enabled;
+	}
+
+	void DynamicResolution::SetSettings(const DynamicResolutionSettings& settings) {
+		m_settings = settings;
+		m_settings.minScale = std::min(std::max(m_settings.minScale, 0.1f), 1.0f);
+		m_settings.maxScale = std::min(std::max(m_settings.maxScale, m_settings.minScale), 1.0f);
+		m_settings.sizeStep = std::max(m_settings.sizeStep, 1);
+		m_scale = std::min(std::max(m_scale, m_settings.minScale), m_settings.maxScale);
+	}
+
+	const DynamicResolutionSettings& DynamicResolution::GetSettings() const {
+		return m_settings;
+	}
+
+	void DynamicResolution::Update(float frameMilliseconds, float gpuMilliseconds, float deltaSeconds) {
+		if (!m_enabled || deltaSeconds <= 0.0f) {
+			return;
+		}
+		//a hitch (loading, a breakpoint) says nothing about the resolution
+		deltaSeconds = std::min(deltaSeconds, 0.1f);
+
+		float measured = gpuMilliseconds > 0.0f ? gpuMilliseconds : frameMilliseconds;
+		float budget = m_settings.targetMilliseconds * m_settings.headroom;
+		//relative, positive while there is time to spare
+		float error = std::min(std::max((budget - measured) / budget, -1.0f), 1.0f);
+
+		//no integrating against a limit the scale already sits at, otherwise it takes ages to come back
+		bool atMinimum = m_scale <= m_settings.minScale && error < 0.0f;
+		bool atMaximum = m_scale >= m_settings.maxScale && error > 0.0f;
+		if (!atMinimum && !atMaximum) {
+			m_integral = std::min(std::max(m_integral + error * deltaSeconds, -1.0f), 1.0f);
+		}
+		float derivative = m_hasPreviousError ? (error - m_previousError) / deltaSeconds : 0.0f;
+		m_previousError = error;
+		m_hasPreviousError = true;
+
+		float rate = m_settings.proportional * error + m_settings.integral * m_integral + m_settings.derivative * derivative;
+		m_scale = std::min(std::max(m_scale + rate * deltaSeconds, m_settings.minScale), m_settings.maxScale);
+	}
+
+	void DynamicResolution::Reset() {
+		m_scale = m_settings.maxScale;
+		m_integral = 0.0f;
+		m_previousError = 0.0f;
+		m_hasPreviousError = false;
+	}
+
+	float DynamicResolution::GetScale() const {
+		return m_enabled ? m_scale : 1.0f;
+	}
+
+	void DynamicResolution::GetRenderSize(int width, int height, int& renderWidth, int& renderHeight) const {
+		float scale = GetScale();
+		if (scale >= 1.0f) {
+			renderWidth = width;
+			renderHeight = height;
+			return;
+		}
+		int step = m_settings.sizeStep;
+		auto scaled = [&](int size) {
+			int rounded = static_cast<int>(std::lround(static_cast<float>(size) * scale / static_cast<float>(step))) * step;
+			return std::min(std::max(rounded, std::min(step, size)), size);
+		};
+		renderWidth = scaled(width);
+		renderHeight = scaled(height);
+	}
+
+	void DynamicResolution::AddCompositePass(RenderGraph& graph, RenderResource source, RenderResource target, int renderWidth, int renderHeight) {
+		const RenderTextureDesc& desc = graph.GetDesc(source);
+		float width = static_cast<float>(std::max(desc.width, 1));
+		float height = static_cast<float>(std::max(desc.height, 1));
+		float uvScaleX = static_cast<float>(renderWidth) / width;
+		float uvScaleY = static_cast<float>(renderHeight) / height;
+		float uvMaxX = (static_cast<float>(renderWidth) - 0.5f) / width;
+		float uvMaxY = (static_cast<float>(renderHeight) - 0.5f) / height;
+		graph.AddPass("composite",
+			[&](RenderPassBuilder& builder) {
+				builder.Read(source);
+				builder.Write(target);
+			},
+			[this, source, uvScaleX, uvScaleY, uvMaxX, uvMaxY](RenderPassContext& context) {
+				if (!m_program && !CreateCompositor()) {
+					return;
+				}
+				//the window may still hold last frame's depth, the stretched image goes over everything
+				GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+				GLboolean blend = glIsEnabled(GL_BLEND);
+				glDisable(GL_DEPTH_TEST);
+				glDisable(GL_BLEND);
+				glUseProgram(m_program);
+				glUniform2f(m_uvScaleLocation, uvScaleX, uvScaleY);
+				glUniform2f(m_uvMaxLocation, uvMaxX, uvMaxY);
+				context.BindTexture(source, 0);
+				glBindVertexArray(m_vertexArray);
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+				glBindVertexArray(0);
+				glUseProgram(0);
+				if (depthTest) {
+					glEnable(GL_DEPTH_TEST);
+				}
+				if (blend) {
+					glEnable(GL_BLEND);
+				}
+			});
+	}
+
+	void DynamicResolution::Destroy() {
+		if (m_program) {
+			glDeleteProgram(m_program);
+			m_program = 0;
+		}
+		if (m_vertexArray) {
+			glDeleteVertexArrays(1, &m_vertexArray);
+			m_vertexArray = 0;
+		}
+	}
+
+	bool DynamicResolution::CreateCompositor() {
+		m_program = Engine::GetInstance().GetGraphicsAPI().CompileShaderProgram(kCompositeVertexSource, kCompositeFragmentSource);
+		if (!m_program) {
+			LOG_ERROR(Graphics, "DYNAMIC_RESOLUTION: cannot build the composite shader");
+			//stay at full resolution instead of showing nothing
+			m_enabled = false;
+			return false;
+		}
+		glUseProgram(m_program);
+		glUniform1i(glGetUniformLocation(m_program, "u_source"), 0);
+		m_uvScaleLocation = glGetUniformLocation(m_program, "u_uvScale");
+		m_uvMaxLocation = glGetUniformLocation(m_program, "u_uvMax");
+		glUseProgram(0);
+		//core profile draws need a vertex array even without attributes
+		glGenVertexArrays(1, &m_vertexArray);
+		return true;
+	}
+}
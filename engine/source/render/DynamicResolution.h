@@ -0,0 +1,68 @@
+#pragma once
+
+#include "render/RenderGraph.h"
+#include <GL/glew.h>
+
+namespace eng {
+
+	struct DynamicResolutionSettings {
+		//frame time to hold, the engine sets it to the monitor's refresh interval
+		float targetMilliseconds = 1000.0f / 60.0f;
+		//fraction of the target the gpu time is steered to, leaves room for spikes
+		float headroom = 0.9f;
+		//per axis, 0.5 renders a quarter of the pixels
+		float minScale = 0.5f;
+		float maxScale = 1.0f;
+		//pid gains, the output is the change of the scale per second for a relative error
+		float proportional = 0.6f;
+		float integral = 0.15f;
+		float derivative = 0.02f;
+		//render sizes are rounded to this many pixels so small corrections of the scale keep the previous render size
+		int sizeStep = 8;
+	};
+
+	//picks the resolution the scene is rendered at from the measured gpu time of the previous frames and
+	//stretches the result over the window, a pid controller steers the scale so the gpu time sits just under the target
+	//gpu time goes with the pixel count, so a frame that is cpu bound keeps its resolution
+	class DynamicResolution {
+	public:
+		DynamicResolution() = default;
+		DynamicResolution(const DynamicResolution&) = delete;
+		DynamicResolution& operator=(const DynamicResolution&) = delete;
+		~DynamicResolution();
+
+		//disabling goes back to full resolution right away
+		void SetEnabled(bool enabled);
+		bool IsEnabled() const;
+		void SetSettings(const DynamicResolutionSettings& settings);
+		const DynamicResolutionSettings& GetSettings() const;
+
+		//feeds one frame, gpuMilliseconds is 0 while no timer result is available and the frame time is used instead
+		void Update(float frameMilliseconds, float gpuMilliseconds, float deltaSeconds);
+		//forgets the controller state and returns to the maximum scale
+		void Reset();
+		float GetScale() const;
+		//the size the scene renders at for a window of width x height
+		void GetRenderSize(int width, int height, int& renderWidth, int& renderHeight) const;
+
+		//adds a pass that draws the bottom left renderWidth x renderHeight of source stretched over target with bilinear filtering
+		void AddCompositePass(RenderGraph& graph, RenderResource source, RenderResource target, int renderWidth, int renderHeight);
+		//deletes the composite shader, needs the context
+		void Destroy();
+
+	private:
+		bool CreateCompositor();
+
+		bool m_enabled = false;
+		DynamicResolutionSettings m_settings;
+		float m_scale = 1.0f;
+		float m_integral = 0.0f;
+		float m_previousError = 0.0f;
+		bool m_hasPreviousError = false;
+
+		GLuint m_program = 0;
+		GLuint m_vertexArray = 0;
+		GLint m_uvScaleLocation = -1;
+		GLint m_uvMaxLocation = -1;
+	};
+}
@@ -0,0 +1,53 @@
+#include "render/Frustum.h"
+#include <cmath>
+
+namespace eng {
+
+	Frustum Frustum::FromMatrix(const float* m) {
+		//gribb/hartmann plane extraction, row i of a column major matrix is m[i], m[4 + i], m[8 + i], m[12 + i]
+		auto combine = [m](int row, float sign) {
+			Plane plane;
+			plane.nx = m[3] + sign * m[row];
+			plane.ny = m[7] + sign * m[4 + row];
+			plane.nz = m[11] + sign * m[8 + row];
+			plane.d = m[15] + sign * m[12 + row];
+			float length = std::sqrt(plane.nx * plane.nx + plane.ny * plane.ny + plane.nz * plane.nz);
+			if (length > 0.0f) {
+				plane.nx /= length;
+				plane.ny /= length;
+				plane.nz /= length;
+				plane.d /= length;
+			}
+			return plane;
+		};
+
+		Frustum frustum;
+		frustum.planes[Left] = combine(0, 1.0f);
+		frustum.planes[Right] = combine(0, -1.0f);
+		frustum.planes[Bottom] = combine(1, 1.0f);
+		frustum.planes[Top] = combine(1, -1.0f);
+		frustum.planes[Near] = combine(2, 1.0f);
+		frustum.planes[Far] = combine(2, -1.0f);
+		return frustum;
+	}
+
+	bool Frustum::Intersects(const BoundingSphere& sphere) const {
+		for (const auto& plane : planes) {
+			if (plane.nx * sphere.x + plane.ny * sphere.y + plane.nz * sphere.z + plane.d <= -sphere.radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Frustum::Intersects(const AABB& box) const {
+		for (const auto& plane : planes) {
+			float distance = plane.nx * box.centerX + plane.ny * box.centerY + plane.nz * box.centerZ + plane.d;
+			float radius = std::fabs(plane.nx) * box.extentX + std::fabs(plane.ny) * box.extentY + std::fabs(plane.nz) * box.extentZ;
+			if (distance <= -radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "scene/Bounds.h"
+
+namespace eng {
+
+	//plane is nx * x + ny * y + nz * z + d = 0 with the normal pointing into the frustum
+	struct Plane {
+		float nx = 0.0f;
+		float ny = 0.0f;
+		float nz = 0.0f;
+		float d = 0.0f;
+	};
+
+	class Frustum {
+	public:
+		enum PlaneIndex {
+			Left = 0,
+			Right,
+			Bottom,
+			Top,
+			Near,
+			Far,
+			PlaneCount
+		};
+
+		//viewProjection is a column major 4x4 matrix as handed to glUniformMatrix4fv, planes come out normalized
+		static Frustum FromMatrix(const float* viewProjection);
+
+		bool Intersects(const BoundingSphere& sphere) const;
+		bool Intersects(const AABB& box) const;
+
+		Plane planes[PlaneCount];
+	};
+}
@@ -0,0 +1,338 @@
+#include "render/FrustumCuller.h"
+#include "jobs/JobSystem.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ENG_CULL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+//msvc accepts any intrinsic without per function target flags
+#define ENG_TARGET_AVX2
+#else
+#define ENG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define ENG_CULL_X86 0
+#endif
+
+namespace eng {
+
+	//objects per job, small enough to balance across workers and big enough to hide the scheduling cost
+	static const size_t kChunkSize = 16 * 1024;
+
+	namespace {
+
+		size_t CullSpheresScalar(const Frustum& frustum, const void* bounds, size_t begin, size_t end, uint32_t* output) {
+			const auto& spheres = *static_cast<const BoundingSphereSoA*>(bounds);
+			size_t written = 0;
+			for (size_t i = begin; i < end; ++i) {
+				if (frustum.Intersects(spheres.Get(i))) {
+					output[written++] = uint32_t(i);
+				}
+			}
+			return written;
+		}
+
+		size_t CullBoxesScalar(const Frustum& frustum, const void* bounds, size_t begin, size_t end, uint32_t* output) {
+			const auto& boxes = *static_cast<const AABBSoA*>(bounds);
+			size_t written = 0;
+			for (size_t i = begin; i < end; ++i) {
+				if (frustum.Intersects(boxes.Get(i))) {
+					output[written++] = uint32_t(i);
+				}
+			}
+			return written;
+		}
+
+#if ENG_CULL_X86
+		//for every lane mask the offsets of the set lanes packed to the front, turns a mask into compacted indices with one add
+		struct CompactTable {
+			alignas(32) int32_t lanes[256][8];
+			uint8_t counts[256];
+
+			CompactTable() {
+				for (int mask = 0; mask < 256; ++mask) {
+					int count = 0;
+					for (int lane = 0; lane < 8; ++lane) {
+						lanes[mask][lane] = 0;
+					}
+					for (int lane = 0; lane < 8; ++lane) {
+						if (mask & (1 << lane)) {
+							lanes[mask][count++] = lane;
+						}
+					}
+					counts[mask] = uint8_t(count);
+				}
+			}
+		};
+		const CompactTable s_compactTable;
+
+		bool CpuSupportsAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) {
+				return false;
+			}
+			//the os has to save the ymm registers too
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+				return false;
+			}
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+
+		size_t CullSpheresSSE(const Frustum& frustum, const void* bounds, size_t begin, size_t end, uint32_t* output) {
+			const auto& spheres = *static_cast<const BoundingSphereSoA*>(bounds);
+			__m128 nx[Frustum::PlaneCount], ny[Frustum::PlaneCount], nz[Frustum::PlaneCount], d[Frustum::PlaneCount];
+			for (int p = 0; p < Frustum::PlaneCount; ++p) {
+				nx[p] = _mm_set1_ps(frustum.planes[p].nx);
+				ny[p] = _mm_set1_ps(frustum.planes[p].ny);
+				nz[p] = _mm_set1_ps(frustum.planes[p].nz);
+				d[p] = _mm_set1_ps(frustum.planes[p].d);
+			}
+
+			size_t written = 0;
+			size_t i = begin;
+			for (; i + 4 <= end; i += 4) {
+				__m128 x = _mm_loadu_ps(&spheres.x[i]);
+				__m128 y = _mm_loadu_ps(&spheres.y[i]);
+				__m128 z = _mm_loadu_ps(&spheres.z[i]);
+				__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (int p = 0; p < Frustum::PlaneCount; ++p) {
+					__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)), _mm_add_ps(_mm_mul_ps(nz[p], z), d[p]));
+					inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negativeRadius));
+				}
+
+				int mask = _mm_movemask_ps(inside);
+				if (mask != 0) {
+					__m128i lanes = _mm_load_si128(reinterpret_cast<const __m128i*>(s_compactTable.lanes[mask]));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(output + written), _mm_add_epi32(_mm_set1_epi32(int32_t(i)), lanes));
+					written += s_compactTable.counts[mask];
+				}
+			}
+			return written + CullSpheresScalar(frustum, bounds, i, end, output + written);
+		}
+
+		size_t CullBoxesSSE(const Frustum& frustum, const void* bounds, size_t begin, size_t end, uint32_t* output) {
+			const auto& boxes = *static_cast<const AABBSoA*>(bounds);
+			__m128 nx[Frustum::PlaneCount], ny[Frustum::PlaneCount], nz[Frustum::PlaneCount], d[Frustum::PlaneCount];
+			__m128 ax[Frustum::PlaneCount], ay[Frustum::PlaneCount], az[Frustum::PlaneCount];
+			for (int p = 0; p < Frustum::PlaneCount; ++p) {
+				nx[p] = _mm_set1_ps(frustum.planes[p].nx);
+				ny[p] = _mm_set1_ps(frustum.planes[p].ny);
+				nz[p] = _mm_set1_ps(frustum.planes[p].nz);
+				d[p] = _mm_set1_ps(frustum.planes[p].d);
+				ax[p] = _mm_set1_ps(std::fabs(frustum.planes[p].nx));
+				ay[p] = _mm_set1_ps(std::fabs(frustum.planes[p].ny));
+				az[p] = _mm_set1_ps(std::fabs(frustum.planes[p].nz));
+			}
+
+			size_t written = 0;
+			size_t i = begin;
+			for (; i + 4 <= end; i += 4) {
+				__m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+				__m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+				__m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+				__m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+				__m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+				__m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (int p = 0; p < Frustum::PlaneCount; ++p) {
+					__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_add_ps(_mm_mul_ps(nz[p], cz), d[p]));
+					__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+					inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+				}
+
+				int mask = _mm_movemask_ps(inside);
+				if (mask != 0) {
+					__m128i lanes = _mm_load_si128(reinterpret_cast<const __m128i*>(s_compactTable.lanes[mask]));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(output + written), _mm_add_epi32(_mm_set1_epi32(int32_t(i)), lanes));
+					written += s_compactTable.counts[mask];
+				}
+			}
+			return written + CullBoxesScalar(frustum, bounds, i, end, output + written);
+		}
+
+		//the stores below write all eight lanes, which never runs past the current group of the chunk
+		ENG_TARGET_AVX2 size_t CullSpheresAVX2(const Frustum& frustum, const void* bounds, size_t begin, size_t end, uint32_t* output) {
+			const auto& spheres = *static_cast<const BoundingSphereSoA*>(bounds);
+			__m256 nx[Frustum::PlaneCount], ny[Frustum::PlaneCount], nz[Frustum::PlaneCount], d[Frustum::PlaneCount];
+			for (int p = 0; p < Frustum::PlaneCount; ++p) {
+				nx[p] = _mm256_set1_ps(frustum.planes[p].nx);
+				ny[p] = _mm256_set1_ps(frustum.planes[p].ny);
+				nz[p] = _mm256_set1_ps(frustum.planes[p].nz);
+				d[p] = _mm256_set1_ps(frustum.planes[p].d);
+			}
+
+			size_t written = 0;
+			size_t i = begin;
+			for (; i + 8 <= end; i += 8) {
+				__m256 x = _mm256_loadu_ps(&spheres.x[i]);
+				__m256 y = _mm256_loadu_ps(&spheres.y[i]);
+				__m256 z = _mm256_loadu_ps(&spheres.z[i]);
+				__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (int p = 0; p < Frustum::PlaneCount; ++p) {
+					__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y)), _mm256_add_ps(_mm256_mul_ps(nz[p], z), d[p]));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GT_OQ));
+				}
+
+				int mask = _mm256_movemask_ps(inside);
+				if (mask != 0) {
+					__m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i*>(s_compactTable.lanes[mask]));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + written), _mm256_add_epi32(_mm256_set1_epi32(int32_t(i)), lanes));
+					written += s_compactTable.counts[mask];
+				}
+			}
+			return written + CullSpheresScalar(frustum, bounds, i, end, output + written);
+		}
+
+		ENG_TARGET_AVX2 size_t CullBoxesAVX2(const Frustum& frustum, const void* bounds, size_t begin, size_t end, uint32_t* output) {
+			const auto& boxes = *static_cast<const AABBSoA*>(bounds);
+			__m256 nx[Frustum::PlaneCount], ny[Frustum::PlaneCount], nz[Frustum::PlaneCount], d[Frustum::PlaneCount];
+			__m256 ax[Frustum::PlaneCount], ay[Frustum::PlaneCount], az[Frustum::PlaneCount];
+			for (int p = 0; p < Frustum::PlaneCount; ++p) {
+				nx[p] = _mm256_set1_ps(frustum.planes[p].nx);
+				ny[p] = _mm256_set1_ps(frustum.planes[p].ny);
+				nz[p] = _mm256_set1_ps(frustum.planes[p].nz);
+				d[p] = _mm256_set1_ps(frustum.planes[p].d);
+				ax[p] = _mm256_set1_ps(std::fabs(frustum.planes[p].nx));
+				ay[p] = _mm256_set1_ps(std::fabs(frustum.planes[p].ny));
+				az[p] = _mm256_set1_ps(std::fabs(frustum.planes[p].nz));
+			}
+
+			size_t written = 0;
+			size_t i = begin;
+			for (; i + 8 <= end; i += 8) {
+				__m256 cx = _mm256_loadu_ps(&boxes.centerX[i]);
+				__m256 cy = _mm256_loadu_ps(&boxes.centerY[i]);
+				__m256 cz = _mm256_loadu_ps(&boxes.centerZ[i]);
+				__m256 ex = _mm256_loadu_ps(&boxes.extentX[i]);
+				__m256 ey = _mm256_loadu_ps(&boxes.extentY[i]);
+				__m256 ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (int p = 0; p < Frustum::PlaneCount; ++p) {
+					__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)), _mm256_add_ps(_mm256_mul_ps(nz[p], cz), d[p]));
+					__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_mul_ps(az[p], ez));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GT_OQ));
+				}
+
+				int mask = _mm256_movemask_ps(inside);
+				if (mask != 0) {
+					__m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i*>(s_compactTable.lanes[mask]));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + written), _mm256_add_epi32(_mm256_set1_epi32(int32_t(i)), lanes));
+					written += s_compactTable.counts[mask];
+				}
+			}
+			return written + CullBoxesScalar(frustum, bounds, i, end, output + written);
+		}
+#endif
+	}
+
+	FrustumCuller::FrustumCuller() {
+		SetInstructionSet(InstructionSet::AVX2);
+	}
+
+	bool FrustumCuller::IsSupported(InstructionSet instructionSet) {
+		switch (instructionSet) {
+#if ENG_CULL_X86
+		case InstructionSet::AVX2: {
+			static const bool supported = CpuSupportsAVX2();
+			return supported;
+		}
+		//every x86 cpu we can run on has sse2
+		case InstructionSet::SSE:
+			return true;
+#endif
+		case InstructionSet::Scalar:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void FrustumCuller::SetInstructionSet(InstructionSet instructionSet) {
+		if (instructionSet == InstructionSet::AVX2 && !IsSupported(InstructionSet::AVX2)) {
+			instructionSet = InstructionSet::SSE;
+		}
+		if (instructionSet == InstructionSet::SSE && !IsSupported(InstructionSet::SSE)) {
+			instructionSet = InstructionSet::Scalar;
+		}
+		m_instructionSet = instructionSet;
+	}
+
+	FrustumCuller::InstructionSet FrustumCuller::GetInstructionSet() const {
+		return m_instructionSet;
+	}
+
+	void FrustumCuller::Cull(const Frustum& frustum, const BoundingSphereSoA& spheres, std::vector<uint32_t>& visible, JobSystem* jobSystem) {
+		Kernel kernel = CullSpheresScalar;
+#if ENG_CULL_X86
+		if (m_instructionSet == InstructionSet::AVX2) {
+			kernel = CullSpheresAVX2;
+		}
+		else if (m_instructionSet == InstructionSet::SSE) {
+			kernel = CullSpheresSSE;
+		}
+#endif
+		Run(kernel, frustum, &spheres, spheres.Size(), visible, jobSystem);
+	}
+
+	void FrustumCuller::Cull(const Frustum& frustum, const AABBSoA& boxes, std::vector<uint32_t>& visible, JobSystem* jobSystem) {
+		Kernel kernel = CullBoxesScalar;
+#if ENG_CULL_X86
+		if (m_instructionSet == InstructionSet::AVX2) {
+			kernel = CullBoxesAVX2;
+		}
+		else if (m_instructionSet == InstructionSet::SSE) {
+			kernel = CullBoxesSSE;
+		}
+#endif
+		Run(kernel, frustum, &boxes, boxes.Size(), visible, jobSystem);
+	}
+
+	void FrustumCuller::Run(Kernel kernel, const Frustum& frustum, const void* bounds, size_t count, std::vector<uint32_t>& visible, JobSystem* jobSystem) {
+		visible.resize(count);
+		if (count == 0) {
+			return;
+		}
+
+		//every chunk writes its visible indices to the front of its own slice of the output
+		size_t chunkCount = (count + kChunkSize - 1) / kChunkSize;
+		m_chunkCounts.assign(chunkCount, 0);
+		auto cullChunks = [&](size_t begin, size_t end) {
+			for (size_t chunkBegin = begin; chunkBegin < end; chunkBegin += kChunkSize) {
+				size_t chunkEnd = chunkBegin + kChunkSize < end ? chunkBegin + kChunkSize : end;
+				m_chunkCounts[chunkBegin / kChunkSize] = uint32_t(kernel(frustum, bounds, chunkBegin, chunkEnd, visible.data() + chunkBegin));
+			}
+		};
+		if (jobSystem) {
+			jobSystem->ParallelFor(count, kChunkSize, cullChunks);
+		}
+		else {
+			cullChunks(0, count);
+		}
+
+		//then the slices are packed back to back, which keeps the indices sorted
+		size_t total = m_chunkCounts[0];
+		for (size_t chunk = 1; chunk < chunkCount; ++chunk) {
+			std::memmove(visible.data() + total, visible.data() + chunk * kChunkSize, m_chunkCounts[chunk] * sizeof(uint32_t));
+			total += m_chunkCounts[chunk];
+		}
+		visible.resize(total);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "render/Frustum.h"
+#include "scene/Bounds.h"
+#include <cstdint>
+#include <vector>
+
+namespace eng {
+
+	class JobSystem;
+
+	//tests structure of arrays bounds against a frustum eight (avx2) or four (sse) at a time
+	//large inputs are split into chunks that run in parallel on the job system
+	class FrustumCuller {
+	public:
+		enum class InstructionSet {
+			Scalar,
+			SSE,
+			AVX2
+		};
+
+		//picks the widest instruction set the cpu supports
+		FrustumCuller();
+
+		static bool IsSupported(InstructionSet instructionSet);
+		//mostly for benchmarks and comparisons, unsupported sets fall back to the best supported one
+		void SetInstructionSet(InstructionSet instructionSet);
+		InstructionSet GetInstructionSet() const;
+
+		//visible receives the index of every object touching the frustum in ascending order, ready to feed the render queue
+		void Cull(const Frustum& frustum, const BoundingSphereSoA& spheres, std::vector<uint32_t>& visible, JobSystem* jobSystem = nullptr);
+		void Cull(const Frustum& frustum, const AABBSoA& boxes, std::vector<uint32_t>& visible, JobSystem* jobSystem = nullptr);
+
+	private:
+		using Kernel = size_t(*)(const Frustum& frustum, const void* bounds, size_t begin, size_t end, uint32_t* output);
+
+		void Run(Kernel kernel, const Frustum& frustum, const void* bounds, size_t count, std::vector<uint32_t>& visible, JobSystem* jobSystem);
+
+		InstructionSet m_instructionSet = InstructionSet::Scalar;
+		std::vector<uint32_t> m_chunkCounts;
+	};
+}
@@ -0,0 +1,145 @@
+#include "render/LODSelector.h"
+#include "render/RenderQueue.h"
+#include "graphics/Mesh.h"
+#include "jobs/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace eng {
+
+	namespace {
+
+		//objects are cheap to select, batches only pay off when they are large
+		const size_t kChunkSize = 4096;
+	}
+
+	uint32_t LODSelector::Add(const BoundingSphere& bounds, const std::vector<float>& lodErrors) {
+		uint32_t id = m_bounds.Add(bounds);
+		m_lodOffsets.push_back(uint32_t(m_lodErrors.size()));
+		//lods are stored as uint8_t, more than that would never be worth it anyway
+		size_t lodCount = std::min<size_t>(std::max<size_t>(lodErrors.size(), 1), std::numeric_limits<uint8_t>::max());
+		m_lodCounts.push_back(uint8_t(lodCount));
+		for (size_t lod = 0; lod < lodCount; ++lod) {
+			m_lodErrors.push_back(lod < lodErrors.size() ? lodErrors[lod] : 0.0f);
+		}
+		m_states.push_back(LODState());
+		return id;
+	}
+
+	void LODSelector::SetBounds(uint32_t id, const BoundingSphere& bounds) {
+		m_bounds.Set(id, bounds);
+	}
+
+	void LODSelector::Clear() {
+		m_bounds.Clear();
+		m_lodErrors.clear();
+		m_lodOffsets.clear();
+		m_lodCounts.clear();
+		m_states.clear();
+		m_histogram.clear();
+	}
+
+	size_t LODSelector::Size() const {
+		return m_states.size();
+	}
+
+	void LODSelector::SetPixelError(float pixels) {
+		m_pixelError = pixels;
+	}
+
+	void LODSelector::SetHysteresis(float hysteresis) {
+		m_hysteresis = std::clamp(hysteresis, 0.0f, 0.9f);
+	}
+
+	void LODSelector::SetCrossFadeDuration(float seconds) {
+		m_crossFadeDuration = std::max(seconds, 0.0f);
+	}
+
+	void LODSelector::Update(const LODCamera& camera, float deltaTime, JobSystem* jobSystem) {
+		if (jobSystem && m_states.size() > kChunkSize) {
+			jobSystem->ParallelFor(m_states.size(), kChunkSize, [this, &camera, deltaTime](size_t begin, size_t end) {
+				UpdateRange(camera, deltaTime, begin, end);
+			});
+		}
+		else {
+			UpdateRange(camera, deltaTime, 0, m_states.size());
+		}
+
+		m_histogram.assign(std::numeric_limits<uint8_t>::max() + 1, 0);
+		uint8_t coarsest = 0;
+		for (const auto& state : m_states) {
+			++m_histogram[state.lod];
+			coarsest = std::max(coarsest, state.lod);
+		}
+		m_histogram.resize(m_states.empty() ? 0 : coarsest + 1);
+	}
+
+	void LODSelector::UpdateRange(const LODCamera& camera, float deltaTime, size_t begin, size_t end) {
+		const float fadeStep = m_crossFadeDuration > 0.0f ? deltaTime / m_crossFadeDuration : 1.0f;
+		const float refineLimit = m_pixelError * (1.0f + m_hysteresis);
+		const float coarsenLimit = m_pixelError * (1.0f - m_hysteresis);
+
+		for (size_t i = begin; i < end; ++i) {
+			LODState& state = m_states[i];
+			//let a running cross fade finish before starting the next one
+			if (state.IsFading()) {
+				state.fade = std::min(state.fade + fadeStep, 1.0f);
+				continue;
+			}
+
+			//distance to the closest point of the sphere, the camera inside it wants full detail
+			float dx = m_bounds.x[i] - camera.x;
+			float dy = m_bounds.y[i] - camera.y;
+			float dz = m_bounds.z[i] - camera.z;
+			float distance = std::sqrt(dx * dx + dy * dy + dz * dz) - m_bounds.radius[i];
+			const float* errors = &m_lodErrors[m_lodOffsets[i]];
+			uint8_t lodCount = m_lodCounts[i];
+
+			uint8_t lod = 0;
+			if (distance > 0.0f) {
+				float pixelsPerUnit = camera.projectionScale / distance;
+				auto coarsestWithin = [errors, lodCount, pixelsPerUnit](float limit) {
+					uint8_t candidate = 0;
+					while (candidate + 1 < lodCount && errors[candidate + 1] * pixelsPerUnit <= limit) {
+						++candidate;
+					}
+					return candidate;
+				};
+
+				lod = state.lod;
+				if (errors[lod] * pixelsPerUnit > refineLimit) {
+					lod = coarsestWithin(m_pixelError);
+				}
+				else {
+					lod = std::max(lod, coarsestWithin(coarsenLimit));
+				}
+			}
+
+			if (lod != state.lod) {
+				state.previousLod = state.lod;
+				state.lod = lod;
+				state.fade = std::min(fadeStep, 1.0f);
+			}
+		}
+	}
+
+	const LODState& LODSelector::GetState(uint32_t id) const {
+		return m_states[id];
+	}
+
+	const std::vector<uint32_t>& LODSelector::GetHistogram() const {
+		return m_histogram;
+	}
+
+	void LODSelector::Submit(RenderQueue& renderQueue, Material* material, const Mesh& mesh, const LODState& state) {
+		if (!state.IsFading()) {
+			renderQueue.Submit(mesh.GetRenderCommand(material, state.lod));
+			return;
+		}
+		//the incoming lod takes over the dither pattern as the fade progresses, the outgoing one keeps the rest
+		float fade = std::max(state.fade, std::numeric_limits<float>::min());
+		renderQueue.Submit(mesh.GetRenderCommand(material, state.lod, fade));
+		renderQueue.Submit(mesh.GetRenderCommand(material, state.previousLod, -fade));
+	}
+}
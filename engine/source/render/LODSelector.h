@@ -0,0 +1,75 @@
+#pragma once
+
+#include "scene/Bounds.h"
+#include <cstdint>
+#include <vector>
+
+namespace eng {
+
+	class JobSystem;
+	class RenderQueue;
+	class Material;
+	class Mesh;
+
+	struct LODCamera {
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+		//pixels covered by one world unit at distance one, 0.5 * viewport height * projection[1][1]
+		float projectionScale = 1.0f;
+	};
+
+	struct LODState {
+		uint8_t lod = 0;
+		//lod that is fading out while fade is below 1
+		uint8_t previousLod = 0;
+		//cross fade progress from previousLod to lod, 1 once the transition is done
+		float fade = 1.0f;
+
+		bool IsFading() const { return fade < 1.0f; }
+	};
+
+	//picks a level of detail per object from how many pixels its simplification error covers on screen
+	//switching coarser needs the error to drop a hysteresis margin below the limit and switching finer
+	//a margin above it, so objects sitting on a threshold don't flicker between lods every frame
+	class LODSelector {
+	public:
+		//lodErrors are the object space errors of the lods, finest first (see Mesh::GetLODErrors)
+		//returns the id of the object
+		uint32_t Add(const BoundingSphere& bounds, const std::vector<float>& lodErrors);
+		void SetBounds(uint32_t id, const BoundingSphere& bounds);
+		void Clear();
+		size_t Size() const;
+
+		//largest error in pixels a lod may show on screen
+		void SetPixelError(float pixels);
+		//fraction of the pixel error used as dead zone around every threshold
+		void SetHysteresis(float hysteresis);
+		//seconds a lod switch cross fades, 0 switches instantly
+		void SetCrossFadeDuration(float seconds);
+
+		//selects the lods of all objects and advances running cross fades, optionally spread over the job system
+		void Update(const LODCamera& camera, float deltaTime, JobSystem* jobSystem = nullptr);
+		const LODState& GetState(uint32_t id) const;
+		//objects at each lod after the last update
+		const std::vector<uint32_t>& GetHistogram() const;
+
+		//submits the mesh at the selected lod, or both lods with complementary dither fades during a cross fade
+		static void Submit(RenderQueue& renderQueue, Material* material, const Mesh& mesh, const LODState& state);
+
+	private:
+		void UpdateRange(const LODCamera& camera, float deltaTime, size_t begin, size_t end);
+
+		BoundingSphereSoA m_bounds;
+		//errors of every object back to back, an object owns lodCount entries starting at lodOffset
+		std::vector<float> m_lodErrors;
+		std::vector<uint32_t> m_lodOffsets;
+		std::vector<uint8_t> m_lodCounts;
+		std::vector<LODState> m_states;
+		std::vector<uint32_t> m_histogram;
+
+		float m_pixelError = 1.0f;
+		float m_hysteresis = 0.15f;
+		float m_crossFadeDuration = 0.25f;
+	};
+}
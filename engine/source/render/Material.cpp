@@ -1,19 +1,76 @@
 #include "render/Material.h"
 #include "graphics/ShaderProgram.h"
+#include "graphics/Texture.h"
+#include "graphics/Mesh.h"
+#include "log/Log.h"
 
 namespace eng {
 
 	void Material::SetShaderProgram(const std::shared_ptr<ShaderProgram>& shaderProgram) {
 		m_shaderProgram = shaderProgram;
+		CheckParams(true);
 	}
-	void Material::SetParam(const std::string& name, float value) {
+	const std::shared_ptr<ShaderProgram>& Material::GetShaderProgram() const {
+		return m_shaderProgram;
+	}
+	bool Material::SetParam(const std::string& name, float value) {
+		if (!CheckParam(name, GL_FLOAT)) {
+			return false;
+		}
 		m_floatParams[name] = value;
+		return true;
+	}
+	bool Material::SetParam(const std::string& name, const std::shared_ptr<Texture>& texture) {
+		if (!CheckParam(name, GL_SAMPLER_2D)) {
+			return false;
+		}
+		m_textureParams[name] = texture;
+		return true;
+	}
+	bool Material::ValidateMesh(const Mesh& mesh) const {
+		return m_shaderProgram && m_shaderProgram->ValidateVertexLayout(mesh.GetAttributes());
+	}
+	bool Material::CheckParam(const std::string& name, GLenum type) {
+		if (!m_shaderProgram) {
+			return true;
+		}
+		//one hash lookup in the reflection, the driver is not asked
+		const ShaderUniformInfo* uniform = m_shaderProgram->FindUniform(name);
+		bool known = uniform && uniform->location >= 0;
+		if (known && uniform->type == type && uniform->size == 1) {
+			return true;
+		}
+		if (!m_reportedParams.insert(name).second) {
+			return false;
+		}
+		if (!known) {
+			//also what an unused uniform the compiler optimized away looks like, so only a warning
+			LOG_WARNING(Graphics, "MATERIAL_PARAM_UNKNOWN: {} is not an active uniform of the program", name);
+		}
+		else {
+			LOG_ERROR(Graphics, "MATERIAL_PARAM_TYPE_MISMATCH: {} is a 0x{:x} uniform, not 0x{:x}", name, uniform->type, type);
+		}
+		return false;
+	}
+	void Material::CheckParams(bool erase) {
+		m_reportedParams.clear();
+		m_programVersion = m_shaderProgram ? m_shaderProgram->GetVersion() : 0;
+		for (auto it = m_floatParams.begin(); it != m_floatParams.end();) {
+			it = CheckParam(it->first, GL_FLOAT) || !erase ? std::next(it) : m_floatParams.erase(it);
+		}
+		for (auto it = m_textureParams.begin(); it != m_textureParams.end();) {
+			it = CheckParam(it->first, GL_SAMPLER_2D) || !erase ? std::next(it) : m_textureParams.erase(it);
+		}
 	}
 	//activates material, binds shader and sets all uniforms
 	void Material::Bind() {
 		if (!m_shaderProgram) {
 			return;
 		}
+		//the program was hot reloaded since the params were checked
+		if (m_shaderProgram->GetVersion() != m_programVersion) {
+			CheckParams(false);
+		}
 		m_shaderProgram->Bind();
 		//iterate over all parameters and set the parameters for the shader program
 		for (auto& param : m_floatParams) {
@@ -21,6 +78,16 @@ namespace eng {
 			m_shaderProgram->SetUniform(param.first, param.second);
 
 		}
+		//bind every texture to its own unit and point the sampler at it
+		int unit = 0;
+		for (auto& param : m_textureParams) {
+
+			if (param.second) {
+				param.second->Bind(unit);
+				m_shaderProgram->SetUniform(param.first, unit);
+				++unit;
+			}
+		}
 	}
 
 }
\ No newline at end of file
@@ -1,19 +1,49 @@
 #pragma once
 
+#include "memory/MemoryPool.h"
+#include <GL/glew.h>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 
 namespace eng {
 	class ShaderProgram;
+	class Texture;
+	class Mesh;
 	class Material {
 	public:
+		//params set before that no longer match the program's uniforms are reported and dropped
 		void SetShaderProgram(const std::shared_ptr<ShaderProgram>& shaderProgram);
-		void SetParam(const std::string& name, float value);
+		const std::shared_ptr<ShaderProgram>& GetShaderProgram() const;
+		//false when the program has no such float uniform, the param is not stored then
+		//without a program yet everything is accepted and checked once the program is set
+		bool SetParam(const std::string& name, float value);
+		//sampler2D uniforms, each texture gets its own texture unit in bind order
+		bool SetParam(const std::string& name, const std::shared_ptr<Texture>& texture);
+		//checks the mesh feeds every attribute the program reads, once when the two are paired, Bind does no checks
+		bool ValidateMesh(const Mesh& mesh) const;
+		//after a hot reload of the program the params are checked again on the next bind and mismatches reported,
+		//they are kept so a uniform that comes back with the next save still gets its value
 		void Bind();
 	private: 
+		//false with the reason logged when the uniform is missing or has another type
+		//each name is reported once per program, a param rejected every frame does not flood the log
+		bool CheckParam(const std::string& name, GLenum type);
+		//against a new or reloaded program, erase drops the params that no longer match
+		void CheckParams(bool erase);
+
 		std::shared_ptr<ShaderProgram> m_shaderProgram;
-		std::unordered_map<std::string, float> m_floatparams;
+		//nodes come from the pool, which bills them to no tag
+		template<typename T>
+		using ParamMap = std::unordered_map<std::string, T, std::hash<std::string>, std::equal_to<std::string>, PoolAllocator<std::pair<const std::string, T>>>;
+
+		ParamMap<float> m_floatParams;
+		ParamMap<std::shared_ptr<Texture>> m_textureParams;
+		std::unordered_set<std::string> m_reportedParams;
+		//of the program the params were last checked against
+		uint32_t m_programVersion = 0;
 	
 
 	};
@@ -0,0 +1,475 @@
+#include "render/OcclusionCuller.h"
+#include "jobs/JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENG_OCCLUSION_SSE 1
+#include <emmintrin.h>
+#else
+#define ENG_OCCLUSION_SSE 0
+#endif
+
+namespace eng {
+
+	namespace {
+
+		//rows per rasterization job and boxes per test job
+		const size_t kRowsPerJob = 8;
+		const size_t kBoxesPerJob = 1024;
+		//corners closer to the eye than this are treated as crossing the near plane
+		const float kMinW = 1e-6f;
+
+		//column major c = a * b
+		void Multiply(const float* a, const float* b, float* c) {
+			for (int column = 0; column < 4; ++column) {
+				for (int row = 0; row < 4; ++row) {
+					c[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1] + a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+				}
+			}
+		}
+
+		struct ClipVertex {
+			float x, y, z, w;
+		};
+
+		//edge function of the edge from a to b, positive on the inside of a counter clockwise triangle
+		struct Edge {
+			float a, b, c;
+
+			Edge(float ax, float ay, float bx, float by) : a(ay - by), b(bx - ax), c(ax * by - ay * bx) {}
+		};
+	}
+
+	OcclusionCuller::OcclusionCuller() {
+		SetResolution(256, 128);
+		std::fill(m_viewProjection, m_viewProjection + 16, 0.0f);
+	}
+
+	void OcclusionCuller::SetResolution(int width, int height) {
+		m_width = std::max((width + 3) & ~3, 4);
+		m_height = std::max(height, 1);
+
+		m_levels.clear();
+		size_t offset = 0;
+		int levelWidth = m_width;
+		int levelHeight = m_height;
+		while (true) {
+			m_levels.push_back({ offset, levelWidth, levelHeight });
+			offset += size_t(levelWidth) * levelHeight;
+			if (levelWidth == 1 && levelHeight == 1) {
+				break;
+			}
+			levelWidth = (levelWidth + 1) / 2;
+			levelHeight = (levelHeight + 1) / 2;
+		}
+		//nothing rasterized yet, nothing is hidden
+		m_depth.assign(offset, 1.0f);
+	}
+
+	int OcclusionCuller::GetWidth() const {
+		return m_width;
+	}
+
+	int OcclusionCuller::GetHeight() const {
+		return m_height;
+	}
+
+	void OcclusionCuller::SetSIMDEnabled(bool enabled) {
+		m_simdEnabled = enabled;
+	}
+
+	bool OcclusionCuller::IsSIMDEnabled() const {
+		return m_simdEnabled && ENG_OCCLUSION_SSE;
+	}
+
+	void OcclusionCuller::BeginFrame(const float* viewProjection) {
+		std::memcpy(m_viewProjection, viewProjection, sizeof(m_viewProjection));
+		m_occluders.clear();
+		m_stats = OcclusionStats();
+	}
+
+	void OcclusionCuller::AddOccluder(const float* vertices, size_t vertexCount, size_t vertexStride, const uint32_t* indices, size_t indexCount, const float* model) {
+		Occluder occluder{ vertices, vertexCount, vertexStride, indices, indexCount, {} };
+		if (model) {
+			Multiply(m_viewProjection, model, occluder.modelViewProjection);
+		}
+		else {
+			std::memcpy(occluder.modelViewProjection, m_viewProjection, sizeof(m_viewProjection));
+		}
+		m_occluders.push_back(occluder);
+	}
+
+	void OcclusionCuller::Rasterize(JobSystem* jobSystem) {
+		auto start = std::chrono::steady_clock::now();
+
+		//transform and clip every occluder on its own, the lists are kept between frames to reuse their memory
+		if (m_triangles.size() < m_occluders.size()) {
+			m_triangles.resize(m_occluders.size());
+		}
+		auto setup = [this](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				SetupTriangles(m_occluders[i], m_triangles[i]);
+			}
+		};
+		if (jobSystem) {
+			jobSystem->ParallelFor(m_occluders.size(), 1, setup);
+		}
+		else {
+			setup(0, m_occluders.size());
+		}
+
+		//then every job owns a band of rows and walks all triangles touching it, no two jobs write the same pixel
+		std::fill(m_depth.begin(), m_depth.begin() + size_t(m_width) * m_height, 1.0f);
+		auto rasterize = [this](size_t begin, size_t end) {
+			RasterizeRows(int(begin), int(end));
+		};
+		if (jobSystem) {
+			jobSystem->ParallelFor(size_t(m_height), kRowsPerJob, rasterize);
+		}
+		else {
+			rasterize(0, size_t(m_height));
+		}
+		BuildHierarchy();
+
+		m_stats.occluderCount = m_occluders.size();
+		m_stats.triangleCount = 0;
+		for (size_t i = 0; i < m_occluders.size(); ++i) {
+			m_stats.triangleCount += m_triangles[i].size();
+		}
+		m_stats.rasterizeMilliseconds += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void OcclusionCuller::SetupTriangles(const Occluder& occluder, std::vector<ScreenTriangle>& triangles) const {
+		triangles.clear();
+		const float* m = occluder.modelViewProjection;
+		const float halfWidth = float(m_width) * 0.5f;
+		const float halfHeight = float(m_height) * 0.5f;
+
+		auto transform = [&occluder, m](uint32_t index) {
+			const float* p = occluder.vertices + size_t(index) * occluder.vertexStride;
+			ClipVertex v;
+			v.x = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+			v.y = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+			v.z = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+			v.w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+			return v;
+		};
+
+		auto emit = [&](const ClipVertex& a, const ClipVertex& b, const ClipVertex& c) {
+			ScreenTriangle triangle;
+			const ClipVertex* corners[3] = { &a, &b, &c };
+			for (int i = 0; i < 3; ++i) {
+				float inverseW = 1.0f / corners[i]->w;
+				triangle.x[i] = (corners[i]->x * inverseW + 1.0f) * halfWidth;
+				triangle.y[i] = (corners[i]->y * inverseW + 1.0f) * halfHeight;
+				triangle.z[i] = corners[i]->z * inverseW;
+			}
+			float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+			if (!(area > 0.0f)) {
+				return;
+			}
+			float minX = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+			float maxX = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+			float minY = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+			float maxY = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+			if (maxX < 0.0f || minX > float(m_width) || maxY < 0.0f || minY > float(m_height)) {
+				return;
+			}
+			//rows whose pixel centers fall inside the vertical extent
+			triangle.minY = std::max(int(std::ceil(minY - 0.5f)), 0);
+			triangle.maxY = std::min(int(std::floor(maxY - 0.5f)), m_height - 1);
+			if (triangle.minY > triangle.maxY) {
+				return;
+			}
+			triangles.push_back(triangle);
+		};
+
+		for (size_t i = 0; i + 2 < occluder.indexCount; i += 3) {
+			ClipVertex in[3] = { transform(occluder.indices[i]), transform(occluder.indices[i + 1]), transform(occluder.indices[i + 2]) };
+
+			//clip against the near plane z = -w, a triangle turns into at most a quad
+			ClipVertex out[4];
+			int count = 0;
+			for (int e = 0; e < 3; ++e) {
+				const ClipVertex& current = in[e];
+				const ClipVertex& next = in[(e + 1) % 3];
+				float currentDistance = current.z + current.w;
+				float nextDistance = next.z + next.w;
+				if (currentDistance >= 0.0f) {
+					out[count++] = current;
+				}
+				if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+					float t = currentDistance / (currentDistance - nextDistance);
+					out[count++] = { current.x + (next.x - current.x) * t, current.y + (next.y - current.y) * t,
+						current.z + (next.z - current.z) * t, current.w + (next.w - current.w) * t };
+				}
+			}
+			bool usable = count >= 3;
+			for (int v = 0; v < count; ++v) {
+				usable = usable && out[v].w > kMinW;
+			}
+			if (!usable) {
+				continue;
+			}
+			for (int v = 2; v < count; ++v) {
+				emit(out[0], out[v - 1], out[v]);
+			}
+		}
+	}
+
+	void OcclusionCuller::RasterizeRows(int beginRow, int endRow) {
+		for (size_t occluder = 0; occluder < m_occluders.size(); ++occluder) {
+			for (const auto& triangle : m_triangles[occluder]) {
+				int firstRow = std::max(triangle.minY, beginRow);
+				int lastRow = std::min(triangle.maxY, endRow - 1);
+				if (firstRow > lastRow) {
+					continue;
+				}
+
+				const float* x = triangle.x;
+				const float* y = triangle.y;
+				const float* z = triangle.z;
+				//edge i is opposite vertex i, so at vertex i it equals twice the area
+				Edge edges[3] = { Edge(x[1], y[1], x[2], y[2]), Edge(x[2], y[2], x[0], y[0]), Edge(x[0], y[0], x[1], y[1]) };
+				float area = edges[0].a * x[0] + edges[0].b * y[0] + edges[0].c;
+				//depth is affine in screen space: z = za * x + zb * y + zc
+				float za = (z[0] * edges[0].a + z[1] * edges[1].a + z[2] * edges[2].a) / area;
+				float zb = (z[0] * edges[0].b + z[1] * edges[1].b + z[2] * edges[2].b) / area;
+				float zc = (z[0] * edges[0].c + z[1] * edges[1].c + z[2] * edges[2].c) / area;
+
+				int minX = std::max(int(std::ceil(std::min({ x[0], x[1], x[2] }) - 0.5f)), 0);
+				int maxX = std::min(int(std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f)), m_width - 1);
+				if (minX > maxX) {
+					continue;
+				}
+				//whole groups of four, the width is a multiple of four so a group never leaves the row
+				int startX = minX & ~3;
+
+				for (int row = firstRow; row <= lastRow; ++row) {
+					float* depth = m_depth.data() + size_t(row) * m_width;
+					float py = float(row) + 0.5f;
+					float rowEdge0 = edges[0].b * py + edges[0].c;
+					float rowEdge1 = edges[1].b * py + edges[1].c;
+					float rowEdge2 = edges[2].b * py + edges[2].c;
+					float rowDepth = zb * py + zc;
+
+#if ENG_OCCLUSION_SSE
+					if (m_simdEnabled) {
+						const __m128 zero = _mm_setzero_ps();
+						const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+						const __m128 edgeA0 = _mm_set1_ps(edges[0].a);
+						const __m128 edgeA1 = _mm_set1_ps(edges[1].a);
+						const __m128 edgeA2 = _mm_set1_ps(edges[2].a);
+						const __m128 depthA = _mm_set1_ps(za);
+						const __m128 row0 = _mm_set1_ps(rowEdge0);
+						const __m128 row1 = _mm_set1_ps(rowEdge1);
+						const __m128 row2 = _mm_set1_ps(rowEdge2);
+						const __m128 rowZ = _mm_set1_ps(rowDepth);
+						for (int px = startX; px <= maxX; px += 4) {
+							__m128 centers = _mm_add_ps(_mm_set1_ps(float(px)), laneOffsets);
+							__m128 e0 = _mm_add_ps(_mm_mul_ps(edgeA0, centers), row0);
+							__m128 e1 = _mm_add_ps(_mm_mul_ps(edgeA1, centers), row1);
+							__m128 e2 = _mm_add_ps(_mm_mul_ps(edgeA2, centers), row2);
+							__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+							if (_mm_movemask_ps(inside) == 0) {
+								continue;
+							}
+							__m128 old = _mm_loadu_ps(depth + px);
+							__m128 closer = _mm_min_ps(old, _mm_add_ps(_mm_mul_ps(depthA, centers), rowZ));
+							_mm_storeu_ps(depth + px, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, old)));
+						}
+						continue;
+					}
+#endif
+					for (int px = startX; px <= maxX; px += 4) {
+						for (int lane = 0; lane < 4; ++lane) {
+							float center = float(px) + (0.5f + float(lane));
+							if (edges[0].a * center + rowEdge0 >= 0.0f && edges[1].a * center + rowEdge1 >= 0.0f && edges[2].a * center + rowEdge2 >= 0.0f) {
+								float& target = depth[px + lane];
+								target = std::min(target, za * center + rowDepth);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void OcclusionCuller::BuildHierarchy() {
+		for (size_t level = 1; level < m_levels.size(); ++level) {
+			const Level& source = m_levels[level - 1];
+			const Level& target = m_levels[level];
+			const float* in = m_depth.data() + source.offset;
+			float* out = m_depth.data() + target.offset;
+			for (int y = 0; y < target.height; ++y) {
+				int y0 = y * 2;
+				int y1 = std::min(y0 + 1, source.height - 1);
+				for (int x = 0; x < target.width; ++x) {
+					int x0 = x * 2;
+					int x1 = std::min(x0 + 1, source.width - 1);
+					//farthest depth, a box has to be in front of all of it to be hidden
+					out[y * target.width + x] = std::max(std::max(in[y0 * source.width + x0], in[y0 * source.width + x1]),
+						std::max(in[y1 * source.width + x0], in[y1 * source.width + x1]));
+				}
+			}
+		}
+	}
+
+	bool OcclusionCuller::IsOccluded(const AABB& box) const {
+		const float* m = m_viewProjection;
+		float minX, minY, maxX, maxY, nearest;
+
+#if ENG_OCCLUSION_SSE
+		if (m_simdEnabled) {
+			//the eight corners as two groups of four, near face then far face
+			__m128 xs = _mm_setr_ps(box.centerX - box.extentX, box.centerX + box.extentX, box.centerX - box.extentX, box.centerX + box.extentX);
+			__m128 ys = _mm_setr_ps(box.centerY - box.extentY, box.centerY - box.extentY, box.centerY + box.extentY, box.centerY + box.extentY);
+			__m128 low = _mm_set1_ps(box.centerZ - box.extentZ);
+			__m128 high = _mm_set1_ps(box.centerZ + box.extentZ);
+			__m128 minimum[3];
+			__m128 maximum[2];
+			for (int face = 0; face < 2; ++face) {
+				__m128 zs = face == 0 ? low : high;
+				auto row = [&](int r) {
+					return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[r]), xs), _mm_mul_ps(_mm_set1_ps(m[4 + r]), ys)),
+						_mm_mul_ps(_mm_set1_ps(m[8 + r]), zs)), _mm_set1_ps(m[12 + r]));
+				};
+				__m128 clipX = row(0);
+				__m128 clipY = row(1);
+				__m128 clipZ = row(2);
+				__m128 clipW = row(3);
+				//any corner in front of the near plane and the box can't be hidden
+				__m128 crossing = _mm_or_ps(_mm_cmple_ps(clipW, _mm_set1_ps(kMinW)), _mm_cmplt_ps(_mm_add_ps(clipZ, clipW), _mm_setzero_ps()));
+				if (_mm_movemask_ps(crossing) != 0) {
+					return false;
+				}
+				__m128 ndcX = _mm_div_ps(clipX, clipW);
+				__m128 ndcY = _mm_div_ps(clipY, clipW);
+				__m128 ndcZ = _mm_div_ps(clipZ, clipW);
+				if (face == 0) {
+					minimum[0] = ndcX; minimum[1] = ndcY; minimum[2] = ndcZ;
+					maximum[0] = ndcX; maximum[1] = ndcY;
+				}
+				else {
+					minimum[0] = _mm_min_ps(minimum[0], ndcX); minimum[1] = _mm_min_ps(minimum[1], ndcY); minimum[2] = _mm_min_ps(minimum[2], ndcZ);
+					maximum[0] = _mm_max_ps(maximum[0], ndcX); maximum[1] = _mm_max_ps(maximum[1], ndcY);
+				}
+			}
+			float lanes[4];
+			auto reduce = [&lanes](__m128 value, bool takeMin) {
+				_mm_storeu_ps(lanes, value);
+				return takeMin ? std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3])) : std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+			};
+			minX = reduce(minimum[0], true);
+			minY = reduce(minimum[1], true);
+			nearest = reduce(minimum[2], true);
+			maxX = reduce(maximum[0], false);
+			maxY = reduce(maximum[1], false);
+		}
+		else
+#endif
+		{
+			minX = minY = nearest = std::numeric_limits<float>::max();
+			maxX = maxY = -std::numeric_limits<float>::max();
+			for (int corner = 0; corner < 8; ++corner) {
+				float x = box.centerX + ((corner & 1) ? box.extentX : -box.extentX);
+				float y = box.centerY + ((corner & 2) ? box.extentY : -box.extentY);
+				float z = box.centerZ + ((corner & 4) ? box.extentZ : -box.extentZ);
+				float clipX = m[0] * x + m[4] * y + m[8] * z + m[12];
+				float clipY = m[1] * x + m[5] * y + m[9] * z + m[13];
+				float clipZ = m[2] * x + m[6] * y + m[10] * z + m[14];
+				float clipW = m[3] * x + m[7] * y + m[11] * z + m[15];
+				if (clipW <= kMinW || clipZ + clipW < 0.0f) {
+					return false;
+				}
+				float ndcX = clipX / clipW;
+				float ndcY = clipY / clipW;
+				minX = std::min(minX, ndcX);
+				maxX = std::max(maxX, ndcX);
+				minY = std::min(minY, ndcY);
+				maxY = std::max(maxY, ndcY);
+				nearest = std::min(nearest, clipZ / clipW);
+			}
+		}
+
+		//every pixel the projected box touches, boxes that leave the screen are the frustum culler's business
+		float screenMinX = (minX + 1.0f) * 0.5f * float(m_width);
+		float screenMaxX = (maxX + 1.0f) * 0.5f * float(m_width);
+		float screenMinY = (minY + 1.0f) * 0.5f * float(m_height);
+		float screenMaxY = (maxY + 1.0f) * 0.5f * float(m_height);
+		if (screenMaxX <= 0.0f || screenMinX >= float(m_width) || screenMaxY <= 0.0f || screenMinY >= float(m_height)) {
+			return false;
+		}
+		int x0 = std::max(int(std::floor(screenMinX)), 0);
+		int x1 = std::min(int(std::ceil(screenMaxX)) - 1, m_width - 1);
+		int y0 = std::max(int(std::floor(screenMinY)), 0);
+		int y1 = std::min(int(std::ceil(screenMaxY)) - 1, m_height - 1);
+		x1 = std::max(x1, x0);
+		y1 = std::max(y1, y0);
+
+		//coarsest level where the box spans at most three texels per axis, so at most sixteen reads
+		int size = std::max(x1 - x0, y1 - y0) + 1;
+		int level = 0;
+		while (level + 1 < int(m_levels.size()) && (size >> level) > 2) {
+			++level;
+		}
+		const Level& pyramid = m_levels[level];
+		const float* depth = m_depth.data() + pyramid.offset;
+		for (int y = y0 >> level; y <= (y1 >> level); ++y) {
+			for (int x = x0 >> level; x <= (x1 >> level); ++x) {
+				if (depth[y * pyramid.width + x] >= nearest) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	void OcclusionCuller::Cull(const AABBSoA& boxes, std::vector<uint32_t>& visible, JobSystem* jobSystem) {
+		auto start = std::chrono::steady_clock::now();
+
+		m_occluded.assign(visible.size(), 0);
+		auto test = [this, &boxes, &visible](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				m_occluded[i] = IsOccluded(boxes.Get(visible[i])) ? 1 : 0;
+			}
+		};
+		if (jobSystem) {
+			jobSystem->ParallelFor(visible.size(), kBoxesPerJob, test);
+		}
+		else {
+			test(0, visible.size());
+		}
+
+		size_t written = 0;
+		for (size_t i = 0; i < visible.size(); ++i) {
+			if (!m_occluded[i]) {
+				visible[written++] = visible[i];
+			}
+		}
+		m_stats.testedCount += visible.size();
+		m_stats.occludedCount += visible.size() - written;
+		visible.resize(written);
+
+		m_stats.testMilliseconds += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	int OcclusionCuller::GetLevelCount() const {
+		return int(m_levels.size());
+	}
+
+	const float* OcclusionCuller::GetLevel(int level, int& width, int& height) const {
+		const Level& pyramid = m_levels[level];
+		width = pyramid.width;
+		height = pyramid.height;
+		return m_depth.data() + pyramid.offset;
+	}
+
+	const OcclusionStats& OcclusionCuller::GetStats() const {
+		return m_stats;
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "scene/Bounds.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace eng {
+
+	class JobSystem;
+
+	struct OcclusionStats {
+		size_t occluderCount = 0;
+		//after near plane clipping and back face culling
+		size_t triangleCount = 0;
+		size_t testedCount = 0;
+		size_t occludedCount = 0;
+		float rasterizeMilliseconds = 0.0f;
+		float testMilliseconds = 0.0f;
+	};
+
+	//renders a handful of occluder meshes into a small depth buffer on the cpu and rejects objects hidden behind them
+	//the depth buffer is reduced into a max depth pyramid so every box is tested against at most a few texels
+	//a frame goes BeginFrame, AddOccluder for each occluder, Rasterize, then Cull on the frustum culler output
+	class OcclusionCuller {
+	public:
+		OcclusionCuller();
+
+		//the width is rounded up to a multiple of four so rows can be rasterized four pixels at a time
+		void SetResolution(int width, int height);
+		int GetWidth() const;
+		int GetHeight() const;
+		//sse rasterization and testing when the cpu has it, off gives the scalar reference path
+		void SetSIMDEnabled(bool enabled);
+		bool IsSIMDEnabled() const;
+
+		//column major view projection of the camera, also resets the stats of the frame
+		void BeginFrame(const float* viewProjection);
+		//positions are the first three floats of each vertex, the arrays have to stay alive until Rasterize returns
+		//triangles are counter clockwise in front like gl, the back faces are skipped
+		//occluders must never stick out of what they stand for, a simplified lod can and would hide visible objects
+		void AddOccluder(const float* vertices, size_t vertexCount, size_t vertexStride, const uint32_t* indices, size_t indexCount, const float* model = nullptr);
+		void Rasterize(JobSystem* jobSystem = nullptr);
+
+		bool IsOccluded(const AABB& box) const;
+		//removes the indices of occluded boxes from visible, the order of the rest is kept
+		void Cull(const AABBSoA& boxes, std::vector<uint32_t>& visible, JobSystem* jobSystem = nullptr);
+
+		//level 0 is the full resolution depth buffer, every further level halves it keeping the farthest depth
+		int GetLevelCount() const;
+		const float* GetLevel(int level, int& width, int& height) const;
+		const OcclusionStats& GetStats() const;
+
+	private:
+		struct Occluder {
+			const float* vertices;
+			size_t vertexCount;
+			size_t vertexStride;
+			const uint32_t* indices;
+			size_t indexCount;
+			float modelViewProjection[16];
+		};
+
+		//screen space x and y, ndc depth
+		struct ScreenTriangle {
+			float x[3];
+			float y[3];
+			float z[3];
+			int minY;
+			int maxY;
+		};
+
+		struct Level {
+			size_t offset;
+			int width;
+			int height;
+		};
+
+		void SetupTriangles(const Occluder& occluder, std::vector<ScreenTriangle>& triangles) const;
+		void RasterizeRows(int beginRow, int endRow);
+		void BuildHierarchy();
+
+		int m_width = 0;
+		int m_height = 0;
+		bool m_simdEnabled = true;
+		float m_viewProjection[16];
+		std::vector<Occluder> m_occluders;
+		std::vector<std::vector<ScreenTriangle>> m_triangles;
+		//every level back to back
+		std::vector<float> m_depth;
+		std::vector<Level> m_levels;
+		std::vector<uint8_t> m_occluded;
+		OcclusionStats m_stats;
+	};
+}
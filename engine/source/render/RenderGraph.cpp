@@ -0,0 +1,586 @@
+#include "render/RenderGraph.h"
+#include "log/Log.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+namespace eng {
+
+	namespace {
+		constexpr uint32_t kNoPass = UINT32_MAX;
+		constexpr uint64_t kHashOffset = 14695981039346656037ull;
+		constexpr uint64_t kHashPrime = 1099511628211ull;
+
+		void HashBytes(uint64_t& hash, const void* data, size_t size) {
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (size_t i = 0; i < size; ++i) {
+				hash = (hash ^ bytes[i]) * kHashPrime;
+			}
+		}
+		template<typename T>
+		void HashValue(uint64_t& hash, const T& value) {
+			HashBytes(hash, &value, sizeof(value));
+		}
+		void HashHandles(uint64_t& hash, const std::vector<RenderResource>& handles) {
+			HashValue(hash, handles.size());
+			HashBytes(hash, handles.data(), handles.size() * sizeof(RenderResource));
+		}
+
+		struct TextureFormat {
+			GLenum internalFormat;
+			GLenum format;
+			GLenum type;
+		};
+
+		//the formats a transient texture can have, depth ones are attached as depth
+		constexpr TextureFormat kTextureFormats[] = {
+			{ GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE },
+			{ GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE },
+			{ GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT },
+			{ GL_RGBA32F, GL_RGBA, GL_FLOAT },
+			{ GL_R11F_G11F_B10F, GL_RGB, GL_FLOAT },
+			{ GL_R8, GL_RED, GL_UNSIGNED_BYTE },
+			{ GL_R16F, GL_RED, GL_HALF_FLOAT },
+			{ GL_R32F, GL_RED, GL_FLOAT },
+			{ GL_RG8, GL_RG, GL_UNSIGNED_BYTE },
+			{ GL_RG16F, GL_RG, GL_HALF_FLOAT },
+			{ GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT },
+			{ GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT },
+			{ GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8 },
+		};
+
+		const TextureFormat* FindFormat(GLenum internalFormat) {
+			for (const TextureFormat& format : kTextureFormats) {
+				if (format.internalFormat == internalFormat) {
+					return &format;
+				}
+			}
+			return nullptr;
+		}
+
+		bool IsDepthFormat(GLenum internalFormat) {
+			const TextureFormat* format = FindFormat(internalFormat);
+			return format && (format->format == GL_DEPTH_COMPONENT || format->format == GL_DEPTH_STENCIL);
+		}
+	}
+
+	RenderResource RenderPassBuilder::Create(const std::string& name, const RenderTextureDesc& desc) {
+		uint32_t resource = static_cast<uint32_t>(m_graph.m_resources.size());
+		RenderGraph::Resource entry;
+		entry.name = name;
+		entry.desc = desc;
+		m_graph.m_resources.push_back(entry);
+
+		RenderResource handle = m_graph.AddHandle(resource, m_pass);
+		m_graph.m_passes[m_pass].creates.push_back(handle);
+		return handle;
+	}
+
+	RenderResource RenderPassBuilder::Read(RenderResource resource) {
+		if (resource >= m_graph.m_handles.size()) {
+			LOG_ERROR(Graphics, "RENDER_GRAPH: pass {} reads an invalid resource", m_graph.m_passes[m_pass].name);
+			return InvalidRenderResource;
+		}
+		m_graph.m_passes[m_pass].reads.push_back(resource);
+		return resource;
+	}
+
+	RenderResource RenderPassBuilder::Write(RenderResource resource) {
+		if (resource >= m_graph.m_handles.size()) {
+			LOG_ERROR(Graphics, "RENDER_GRAPH: pass {} writes an invalid resource", m_graph.m_passes[m_pass].name);
+			return InvalidRenderResource;
+		}
+		uint32_t index = m_graph.m_handles[resource].resource;
+		RenderResource version = m_graph.AddHandle(index, m_pass);
+		RenderGraph::Pass& pass = m_graph.m_passes[m_pass];
+		pass.writesFrom.push_back(resource);
+		pass.writesTo.push_back(version);
+		//whoever owns an imported framebuffer looks at it after the graph is done
+		if (m_graph.m_resources[index].imported) {
+			pass.sideEffect = true;
+		}
+		return version;
+	}
+
+	void RenderPassBuilder::SetSideEffect() {
+		m_graph.m_passes[m_pass].sideEffect = true;
+	}
+
+	GLuint RenderPassContext::GetTexture(RenderResource resource) const {
+		return m_graph.GetResourceTexture(resource);
+	}
+
+	void RenderPassContext::BindTexture(RenderResource resource, int unit) const {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, GetTexture(resource));
+	}
+
+	RenderGraph::~RenderGraph() {
+		Shutdown();
+	}
+
+	void RenderGraph::Reset() {
+		m_resources.clear();
+		m_handles.clear();
+		m_passes.clear();
+	}
+
+	RenderResource RenderGraph::ImportFramebuffer(const std::string& name, GLuint framebuffer, int width, int height) {
+		Resource resource;
+		resource.name = name;
+		resource.desc.width = width;
+		resource.desc.height = height;
+		resource.imported = true;
+		resource.importedFramebuffer = framebuffer;
+		m_resources.push_back(resource);
+		return AddHandle(static_cast<uint32_t>(m_resources.size() - 1), kNoPass);
+	}
+
+	void RenderGraph::AddPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute) {
+		Pass pass;
+		pass.name = name;
+		pass.execute = std::move(execute);
+		m_passes.push_back(std::move(pass));
+
+		RenderPassBuilder builder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+		if (setup) {
+			setup(builder);
+		}
+	}
+
+	bool RenderGraph::Compile() {
+		m_stats.passes = m_passes.size();
+		m_stats.transientTextures = 0;
+		for (const Resource& resource : m_resources) {
+			m_stats.transientTextures += resource.imported ? 0 : 1;
+		}
+
+		//the same declarations as last frame compile to the same result, only the execute callbacks differ
+		uint64_t hash = HashDeclarations();
+		if (m_compiled && hash == m_compiledHash) {
+			m_stats.recompiled = false;
+			return true;
+		}
+		m_compiled = false;
+		m_order.clear();
+		m_stats.recompiled = true;
+
+		for (const Resource& resource : m_resources) {
+			if (!resource.imported && (resource.desc.width <= 0 || resource.desc.height <= 0 || !FindFormat(resource.desc.format))) {
+				LOG_ERROR(Graphics, "RENDER_GRAPH: {} has an invalid size or format", resource.name);
+				return false;
+			}
+		}
+
+		//culling, a pass lives when a side effect pass depends on it, directly or not
+		std::vector<bool> live(m_passes.size(), false);
+		std::vector<uint32_t> stack;
+		for (uint32_t i = 0; i < m_passes.size(); ++i) {
+			if (m_passes[i].sideEffect) {
+				live[i] = true;
+				stack.push_back(i);
+			}
+		}
+		while (!stack.empty()) {
+			const Pass& pass = m_passes[stack.back()];
+			stack.pop_back();
+			for (const std::vector<RenderResource>* handles : { &pass.reads, &pass.writesFrom }) {
+				for (RenderResource handle : *handles) {
+					uint32_t producer = m_handles[handle].producer;
+					if (producer != kNoPass && !live[producer]) {
+						live[producer] = true;
+						stack.push_back(producer);
+					}
+				}
+			}
+		}
+
+		//ordering, a pass runs after the producers of what it uses and before anyone overwrites what it reads
+		std::vector<std::vector<uint32_t>> readers(m_handles.size());
+		for (uint32_t i = 0; i < m_passes.size(); ++i) {
+			if (live[i]) {
+				for (RenderResource handle : m_passes[i].reads) {
+					readers[handle].push_back(i);
+				}
+			}
+		}
+		std::vector<std::vector<uint32_t>> successors(m_passes.size());
+		std::vector<uint32_t> dependencies(m_passes.size(), 0);
+		auto addEdge = [&](uint32_t from, uint32_t to) {
+			if (from != kNoPass && from != to) {
+				successors[from].push_back(to);
+				++dependencies[to];
+			}
+		};
+		size_t liveCount = 0;
+		for (uint32_t i = 0; i < m_passes.size(); ++i) {
+			if (!live[i]) {
+				continue;
+			}
+			++liveCount;
+			const Pass& pass = m_passes[i];
+			for (RenderResource handle : pass.reads) {
+				addEdge(m_handles[handle].producer, i);
+			}
+			for (RenderResource handle : pass.writesFrom) {
+				addEdge(m_handles[handle].producer, i);
+				for (uint32_t reader : readers[handle]) {
+					addEdge(reader, i);
+				}
+			}
+		}
+		//ties keep the declaration order
+		std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+		for (uint32_t i = 0; i < m_passes.size(); ++i) {
+			if (live[i] && dependencies[i] == 0) {
+				ready.push(i);
+			}
+		}
+		std::vector<uint32_t> order;
+		while (!ready.empty()) {
+			uint32_t index = ready.top();
+			ready.pop();
+			order.push_back(index);
+			for (uint32_t successor : successors[index]) {
+				if (--dependencies[successor] == 0) {
+					ready.push(successor);
+				}
+			}
+		}
+		if (order.size() != liveCount) {
+			LOG_ERROR(Graphics, "RENDER_GRAPH: passes depend on each other in a cycle");
+			return false;
+		}
+		m_stats.culledPasses = m_passes.size() - liveCount;
+
+		//lifetimes of the transient textures, in execution order
+		std::vector<int> firstUse(m_resources.size(), -1);
+		std::vector<int> lastUse(m_resources.size(), -1);
+		for (int position = 0; position < static_cast<int>(order.size()); ++position) {
+			const Pass& pass = m_passes[order[position]];
+			for (const std::vector<RenderResource>* handles : { &pass.creates, &pass.reads, &pass.writesTo }) {
+				for (RenderResource handle : *handles) {
+					uint32_t resource = m_handles[handle].resource;
+					if (firstUse[resource] < 0) {
+						firstUse[resource] = position;
+					}
+					lastUse[resource] = position;
+				}
+			}
+		}
+
+		//aliasing, each texture takes the first pooled one of its kind that is free by the time it is first used
+		std::vector<uint32_t> transient;
+		for (uint32_t i = 0; i < m_resources.size(); ++i) {
+			if (!m_resources[i].imported && firstUse[i] >= 0) {
+				transient.push_back(i);
+			}
+		}
+		std::stable_sort(transient.begin(), transient.end(), [&](uint32_t a, uint32_t b) { return firstUse[a] < firstUse[b]; });
+		for (PhysicalTexture& texture : m_textures) {
+			texture.busyUntil = -1;
+			texture.used = false;
+		}
+		m_resourceTextures.assign(m_resources.size(), 0);
+		for (uint32_t resource : transient) {
+			const RenderTextureDesc& desc = m_resources[resource].desc;
+			PhysicalTexture* match = nullptr;
+			for (PhysicalTexture& texture : m_textures) {
+				if (texture.desc == desc && texture.busyUntil < firstUse[resource]) {
+					match = &texture;
+					break;
+				}
+			}
+			if (!match) {
+				const TextureFormat* format = FindFormat(desc.format);
+				PhysicalTexture texture;
+				texture.desc = desc;
+				glGenTextures(1, &texture.textureID);
+				glBindTexture(GL_TEXTURE_2D, texture.textureID);
+				glTexImage2D(GL_TEXTURE_2D, 0, format->internalFormat, desc.width, desc.height, 0, format->format, format->type, nullptr);
+				GLint filter = IsDepthFormat(desc.format) ? GL_NEAREST : GL_LINEAR;
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				glBindTexture(GL_TEXTURE_2D, 0);
+				m_textures.push_back(texture);
+				match = &m_textures.back();
+			}
+			match->busyUntil = lastUse[resource];
+			match->used = true;
+			m_resourceTextures[resource] = match->textureID;
+		}
+
+		//framebuffers, one per distinct attachment list
+		for (auto& entry : m_framebuffers) {
+			entry.second.used = false;
+		}
+		GLint previousFramebuffer = 0;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		bool failed = false;
+		for (uint32_t index : order) {
+			const Pass& pass = m_passes[index];
+			CompiledPass compiled{ index, 0, 0, 0, false, {}, 0 };
+
+			std::vector<uint32_t> targets;
+			std::vector<bool> created;
+			for (const std::vector<RenderResource>* handles : { &pass.creates, &pass.writesTo }) {
+				for (RenderResource handle : *handles) {
+					uint32_t resource = m_handles[handle].resource;
+					if (std::find(targets.begin(), targets.end(), resource) == targets.end()) {
+						targets.push_back(resource);
+						created.push_back(handles == &pass.creates);
+					}
+				}
+			}
+
+			std::vector<GLuint> colors;
+			GLuint depth = 0;
+			GLenum depthAttachment = 0;
+			const Resource* imported = nullptr;
+			for (size_t i = 0; i < targets.size() && !failed; ++i) {
+				const Resource& resource = m_resources[targets[i]];
+				if (compiled.bindsTarget && (resource.desc.width != compiled.width || resource.desc.height != compiled.height)) {
+					LOG_ERROR(Graphics, "RENDER_GRAPH: pass {} writes targets of different sizes", pass.name);
+					failed = true;
+					break;
+				}
+				compiled.bindsTarget = true;
+				compiled.width = resource.desc.width;
+				compiled.height = resource.desc.height;
+				if (resource.imported) {
+					imported = &resource;
+					continue;
+				}
+				if (IsDepthFormat(resource.desc.format)) {
+					if (depth) {
+						LOG_ERROR(Graphics, "RENDER_GRAPH: pass {} writes more than one depth target", pass.name);
+						failed = true;
+						break;
+					}
+					depth = m_resourceTextures[targets[i]];
+					depthAttachment = resource.desc.format == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+					if (created[i]) {
+						compiled.clearDepth = resource.desc.format == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL : GL_DEPTH;
+					}
+				}
+				else {
+					if (created[i]) {
+						compiled.clearColor.push_back(static_cast<GLint>(colors.size()));
+					}
+					colors.push_back(m_resourceTextures[targets[i]]);
+				}
+			}
+			if (failed) {
+				break;
+			}
+
+			if (imported) {
+				//someone else's framebuffer comes with its own attachments
+				if (targets.size() > 1) {
+					LOG_ERROR(Graphics, "RENDER_GRAPH: pass {} mixes {} with other targets", pass.name, imported->name);
+					failed = true;
+					break;
+				}
+				compiled.framebuffer = imported->importedFramebuffer;
+			}
+			else if (compiled.bindsTarget) {
+				compiled.framebuffer = GetFramebuffer(colors, depth, depthAttachment);
+				if (!compiled.framebuffer) {
+					failed = true;
+					break;
+				}
+			}
+			m_order.push_back(compiled);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previousFramebuffer));
+
+		//whatever this compile did not ask for goes, the framebuffers first since they reference the textures
+		for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+			if (!it->second.used) {
+				glDeleteFramebuffers(1, &it->second.framebufferID);
+				it = m_framebuffers.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+		for (auto it = m_textures.begin(); it != m_textures.end();) {
+			if (!it->used) {
+				glDeleteTextures(1, &it->textureID);
+				it = m_textures.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+		m_stats.physicalTextures = m_textures.size();
+		m_stats.framebuffers = m_framebuffers.size();
+
+		if (failed) {
+			m_order.clear();
+			return false;
+		}
+		m_compiledHash = hash;
+		m_compiled = true;
+		return true;
+	}
+
+	void RenderGraph::Execute() {
+		if (!Compile()) {
+			return;
+		}
+		for (const CompiledPass& compiled : m_order) {
+			const Pass& pass = m_passes[compiled.pass];
+			if (compiled.bindsTarget) {
+				glBindFramebuffer(GL_FRAMEBUFFER, compiled.framebuffer);
+				glViewport(0, 0, compiled.width, compiled.height);
+			}
+			//clears honour the write masks
+			if (!compiled.clearColor.empty()) {
+				const GLfloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+				for (GLint drawBuffer : compiled.clearColor) {
+					glClearBufferfv(GL_COLOR, drawBuffer, black);
+				}
+			}
+			if (compiled.clearDepth) {
+				glDepthMask(GL_TRUE);
+				if (compiled.clearDepth == GL_DEPTH_STENCIL) {
+					glStencilMask(0xFF);
+					glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+				}
+				else {
+					const GLfloat farDepth = 1.0f;
+					glClearBufferfv(GL_DEPTH, 0, &farDepth);
+				}
+			}
+			if (pass.execute) {
+				RenderPassContext context(*this);
+				context.m_width = compiled.width;
+				context.m_height = compiled.height;
+				pass.execute(context);
+			}
+		}
+	}
+
+	void RenderGraph::Shutdown() {
+		for (auto& entry : m_framebuffers) {
+			glDeleteFramebuffers(1, &entry.second.framebufferID);
+		}
+		for (PhysicalTexture& texture : m_textures) {
+			glDeleteTextures(1, &texture.textureID);
+		}
+		m_framebuffers.clear();
+		m_textures.clear();
+		m_resourceTextures.clear();
+		m_order.clear();
+		m_compiled = false;
+		m_stats = Stats();
+		Reset();
+	}
+
+	const RenderTextureDesc& RenderGraph::GetDesc(RenderResource resource) const {
+		return m_resources[m_handles[resource].resource].desc;
+	}
+
+	RenderResource RenderGraph::GetLatestVersion(RenderResource resource) const {
+		if (resource >= m_handles.size()) {
+			return InvalidRenderResource;
+		}
+		for (size_t handle = m_handles.size(); handle-- > resource;) {
+			if (m_handles[handle].resource == m_handles[resource].resource) {
+				return static_cast<RenderResource>(handle);
+			}
+		}
+		return resource;
+	}
+
+	const RenderGraph::Stats& RenderGraph::GetStats() const {
+		return m_stats;
+	}
+
+	uint64_t RenderGraph::HashDeclarations() const {
+		uint64_t hash = kHashOffset;
+		HashValue(hash, m_resources.size());
+		for (const Resource& resource : m_resources) {
+			HashBytes(hash, resource.name.data(), resource.name.size());
+			HashValue(hash, resource.name.size());
+			HashValue(hash, resource.desc.width);
+			HashValue(hash, resource.desc.height);
+			HashValue(hash, resource.desc.format);
+			HashValue(hash, resource.imported);
+			HashValue(hash, resource.importedFramebuffer);
+		}
+		HashValue(hash, m_handles.size());
+		for (const Handle& handle : m_handles) {
+			HashValue(hash, handle.resource);
+			HashValue(hash, handle.producer);
+		}
+		HashValue(hash, m_passes.size());
+		for (const Pass& pass : m_passes) {
+			HashBytes(hash, pass.name.data(), pass.name.size());
+			HashValue(hash, pass.name.size());
+			HashHandles(hash, pass.creates);
+			HashHandles(hash, pass.reads);
+			HashHandles(hash, pass.writesFrom);
+			HashHandles(hash, pass.writesTo);
+			HashValue(hash, pass.sideEffect);
+		}
+		return hash;
+	}
+
+	RenderResource RenderGraph::AddHandle(uint32_t resource, uint32_t producer) {
+		m_handles.push_back({ resource, producer });
+		return static_cast<RenderResource>(m_handles.size() - 1);
+	}
+
+	GLuint RenderGraph::GetFramebuffer(const std::vector<GLuint>& colors, GLuint depth, GLenum depthAttachment) {
+		uint64_t key = kHashOffset;
+		HashValue(key, colors.size());
+		HashBytes(key, colors.data(), colors.size() * sizeof(GLuint));
+		HashValue(key, depth);
+		auto found = m_framebuffers.find(key);
+		if (found != m_framebuffers.end()) {
+			found->second.used = true;
+			return found->second.framebufferID;
+		}
+
+		GLuint framebuffer = 0;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		std::vector<GLenum> drawBuffers;
+		for (size_t i = 0; i < colors.size(); ++i) {
+			GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, colors[i], 0);
+			drawBuffers.push_back(attachment);
+		}
+		if (depth) {
+			glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depth, 0);
+		}
+		if (drawBuffers.empty()) {
+			//depth only
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		else {
+			glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+		}
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR(Graphics, "RENDER_GRAPH: framebuffer incomplete, status 0x{:x}", status);
+			glDeleteFramebuffers(1, &framebuffer);
+			return 0;
+		}
+		m_framebuffers[key] = { framebuffer, true };
+		return framebuffer;
+	}
+
+	GLuint RenderGraph::GetResourceTexture(RenderResource resource) const {
+		if (resource >= m_handles.size() || m_handles[resource].resource >= m_resourceTextures.size()) {
+			return 0;
+		}
+		return m_resourceTextures[m_handles[resource].resource];
+	}
+}
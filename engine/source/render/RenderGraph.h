@@ -0,0 +1,188 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eng {
+
+	//one version of a resource, every write hands out a new one so passes are ordered by what they consume
+	using RenderResource = uint32_t;
+	constexpr RenderResource InvalidRenderResource = UINT32_MAX;
+
+	struct RenderTextureDesc {
+		int width = 0;
+		int height = 0;
+		//sized internal format, depth formats become the depth attachment of the passes writing them
+		GLenum format = GL_RGBA8;
+
+		bool operator==(const RenderTextureDesc& other) const {
+			return width == other.width && height == other.height && format == other.format;
+		}
+	};
+
+	class RenderGraph;
+
+	//what a pass declares while the frame is being set up
+	class RenderPassBuilder {
+	public:
+		//a transient texture only this frame's graph knows about, cleared when the creating pass starts
+		//its memory is shared with other transient textures whose lifetimes do not overlap, so never rely on last frame's contents
+		RenderResource Create(const std::string& name, const RenderTextureDesc& desc);
+		//sampled by the pass
+		RenderResource Read(RenderResource resource);
+		//rendered into on top of the current contents, use the returned version from here on
+		RenderResource Write(RenderResource resource);
+		//keeps the pass even when nothing reads its output, passes writing imported resources have one implicitly
+		void SetSideEffect();
+
+	private:
+		RenderPassBuilder(RenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+		RenderGraph& m_graph;
+		uint32_t m_pass;
+
+		friend class RenderGraph;
+	};
+
+	//handed to a pass while it executes, its attachments are bound and the viewport covers them
+	class RenderPassContext {
+	public:
+		GLuint GetTexture(RenderResource resource) const;
+		void BindTexture(RenderResource resource, int unit) const;
+		int GetWidth() const { return m_width; }
+		int GetHeight() const { return m_height; }
+
+	private:
+		RenderPassContext(const RenderGraph& graph) : m_graph(graph) {}
+
+		const RenderGraph& m_graph;
+		int m_width = 0;
+		int m_height = 0;
+
+		friend class RenderGraph;
+	};
+
+	//frame graph, passes are declared every frame with the resources they read and write
+	//compiling culls passes nobody consumes, orders the rest by their dependencies and packs transient textures
+	//with disjoint lifetimes onto the same gl textures and framebuffers, which live on from frame to frame
+	//the compiled result is reused as long as the declarations match the previous frame's exactly
+	class RenderGraph {
+	public:
+		using SetupFunction = std::function<void(RenderPassBuilder&)>;
+		using ExecuteFunction = std::function<void(RenderPassContext&)>;
+
+		struct Stats {
+			size_t passes = 0;
+			size_t culledPasses = 0;
+			size_t transientTextures = 0;
+			//gl textures backing the transient ones
+			size_t physicalTextures = 0;
+			size_t framebuffers = 0;
+			//false when the previous frame's compile was reused
+			bool recompiled = false;
+		};
+
+		RenderGraph() = default;
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+		RenderGraph(RenderGraph&&) = default;
+		RenderGraph& operator=(RenderGraph&&) = default;
+		~RenderGraph();
+
+		//forgets the declared passes, gl objects and the compiled result are kept
+		void Reset();
+		//a framebuffer owned by someone else, 0 for the window's
+		RenderResource ImportFramebuffer(const std::string& name, GLuint framebuffer, int width, int height);
+		//setup runs right away, execute during Execute if the pass survives culling
+		void AddPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute);
+
+		bool Compile();
+		//compiles first when needed
+		void Execute();
+		//deletes every gl object, needs the context
+		void Shutdown();
+
+		const RenderTextureDesc& GetDesc(RenderResource resource) const;
+		//the newest version of the same resource, what a pass added after all the others should read or write
+		RenderResource GetLatestVersion(RenderResource resource) const;
+		const Stats& GetStats() const;
+
+	private:
+		struct Resource {
+			std::string name;
+			RenderTextureDesc desc;
+			bool imported = false;
+			GLuint importedFramebuffer = 0;
+		};
+
+		struct Handle {
+			uint32_t resource;
+			//pass that produced this version, UINT32_MAX for imports
+			uint32_t producer;
+		};
+
+		struct Pass {
+			std::string name;
+			ExecuteFunction execute;
+			std::vector<RenderResource> creates;
+			std::vector<RenderResource> reads;
+			//versions written on top of, the pass depends on their producers
+			std::vector<RenderResource> writesFrom;
+			std::vector<RenderResource> writesTo;
+			bool sideEffect = false;
+		};
+
+		//results of Compile, indexed like the declarations they were built from
+		struct CompiledPass {
+			uint32_t pass;
+			GLuint framebuffer;
+			int width;
+			int height;
+			bool bindsTarget;
+			//draw buffers of the attachments the pass created, they start out cleared
+			std::vector<GLint> clearColor;
+			//GL_DEPTH, GL_DEPTH_STENCIL or 0
+			GLenum clearDepth;
+		};
+
+		struct PhysicalTexture {
+			RenderTextureDesc desc;
+			GLuint textureID = 0;
+			//execution index of the last pass using it during the compile in progress
+			int busyUntil = -1;
+			bool used = false;
+		};
+
+		struct CachedFramebuffer {
+			GLuint framebufferID = 0;
+			bool used = false;
+		};
+
+		uint64_t HashDeclarations() const;
+		RenderResource AddHandle(uint32_t resource, uint32_t producer);
+		//creates or reuses the framebuffer for exactly these attachments
+		GLuint GetFramebuffer(const std::vector<GLuint>& colors, GLuint depth, GLenum depthAttachment);
+		GLuint GetResourceTexture(RenderResource resource) const;
+
+		std::vector<Resource> m_resources;
+		std::vector<Handle> m_handles;
+		std::vector<Pass> m_passes;
+
+		uint64_t m_compiledHash = 0;
+		bool m_compiled = false;
+		std::vector<CompiledPass> m_order;
+		//gl texture per resource, 0 for imports
+		std::vector<GLuint> m_resourceTextures;
+		std::vector<PhysicalTexture> m_textures;
+		//keyed by a hash of the attachment list, the ones the latest compile did not ask for are deleted with it
+		std::unordered_map<uint64_t, CachedFramebuffer> m_framebuffers;
+		Stats m_stats;
+
+		friend class RenderPassBuilder;
+		friend class RenderPassContext;
+	};
+}
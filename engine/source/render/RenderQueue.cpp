@@ -0,0 +1,81 @@
+#include "render/RenderQueue.h"
+#include "render/Material.h"
+#include "graphics/GraphicsAPI.h"
+#include "graphics/ShaderProgram.h"
+#include <algorithm>
+
+namespace eng {
+
+	void RenderQueue::Submit(const RenderCommand& command) {
+		m_commands.push_back(command);
+	}
+
+	void RenderQueue::SubmitVisible(const std::vector<RenderCommand>& commands, const std::vector<uint32_t>& visible) {
+		m_commands.reserve(m_commands.size() + visible.size());
+		for (uint32_t index : visible) {
+			m_commands.push_back(commands[index]);
+		}
+	}
+
+	void RenderQueue::Flush(GraphicsAPI& graphicsAPI) {
+		//group by shader program first, then material, so state only changes when it has to
+		std::sort(m_commands.begin(), m_commands.end(), [](const RenderCommand& a, const RenderCommand& b) {
+			const void* programA = a.material ? a.material->GetShaderProgram().get() : nullptr;
+			const void* programB = b.material ? b.material->GetShaderProgram().get() : nullptr;
+			if (programA != programB) {
+				return programA < programB;
+			}
+			return a.material < b.material;
+		});
+
+		Material* boundMaterial = nullptr;
+		GLuint boundVertexArray = 0;
+		GLint lodFadeLocation = -1;
+		float boundLodFade = 0.0f;
+		m_lastDrawCount = 0;
+		for (const auto& command : m_commands) {
+			if (!command.material || !command.material->GetShaderProgram()) {
+				continue;
+			}
+			if (command.material != boundMaterial) {
+				graphicsAPI.BindMaterial(command.material);
+				boundMaterial = command.material;
+				//shaders without the lod fade include simply get -1 and ignore it
+				lodFadeLocation = command.material->GetShaderProgram()->GetUniformLocation("u_lodFade");
+				boundLodFade = 0.0f;
+				command.material->GetShaderProgram()->SetUniform(lodFadeLocation, boundLodFade);
+			}
+			if (command.lodFade != boundLodFade) {
+				boundLodFade = command.lodFade;
+				command.material->GetShaderProgram()->SetUniform(lodFadeLocation, boundLodFade);
+			}
+			if (command.vertexArray != boundVertexArray) {
+				graphicsAPI.BindVertexArray(command.vertexArray);
+				boundVertexArray = command.vertexArray;
+			}
+
+			if (command.indexType != 0) {
+				size_t indexSize = command.indexType == GL_UNSIGNED_INT ? 4 : command.indexType == GL_UNSIGNED_SHORT ? 2 : 1;
+				graphicsAPI.DrawElements(command.mode, command.count, command.indexType, command.firstIndex * indexSize);
+			}
+			else {
+				graphicsAPI.DrawArrays(command.mode, GLint(command.firstIndex), command.count);
+			}
+			++m_lastDrawCount;
+		}
+		graphicsAPI.BindVertexArray(0);
+		m_commands.clear();
+	}
+
+	void RenderQueue::Clear() {
+		m_commands.clear();
+	}
+
+	size_t RenderQueue::GetCommandCount() const {
+		return m_commands.size();
+	}
+
+	size_t RenderQueue::GetLastDrawCount() const {
+		return m_lastDrawCount;
+	}
+}
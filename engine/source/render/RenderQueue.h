@@ -0,0 +1,47 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+
+namespace eng {
+
+	class Material;
+	class GraphicsAPI;
+
+	//everything needed to issue one draw call
+	struct RenderCommand {
+		Material* material = nullptr;
+		GLuint vertexArray = 0;
+		//index count for indexed draws, vertex count otherwise
+		GLsizei count = 0;
+		//0 draws with glDrawArrays, otherwise the type of the element buffer bound to the vertex array
+		GLenum indexType = 0;
+		GLenum mode = GL_TRIANGLES;
+		//first index (or vertex) to draw, lods of one mesh share their buffers and differ only in this range
+		GLuint firstIndex = 0;
+		//dithered lod cross fade, 0 draws every pixel, a positive fade keeps the pixels below it in the dither pattern
+		//and a negative one the complementary rest, so two lods drawn with fade and -fade cover the surface exactly once
+		float lodFade = 0.0f;
+	};
+
+	//collects the draws of a frame, sorts them by shader and material and submits them in one go
+	class RenderQueue {
+	public:
+		void Submit(const RenderCommand& command);
+		//submits commands[index] for every index the culler reported as visible
+		void SubmitVisible(const std::vector<RenderCommand>& commands, const std::vector<uint32_t>& visible);
+
+		//draws everything submitted since the last flush and empties the queue
+		void Flush(GraphicsAPI& graphicsAPI);
+		void Clear();
+
+		size_t GetCommandCount() const;
+		//draw calls issued by the last flush
+		size_t GetLastDrawCount() const;
+
+	private:
+		std::vector<RenderCommand> m_commands;
+		size_t m_lastDrawCount = 0;
+	};
+}
@@ -0,0 +1,97 @@
+#include "scene/Bounds.h"
+
+namespace eng {
+
+	AABB AABB::FromMinMax(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) {
+		AABB box;
+		box.centerX = (minX + maxX) * 0.5f;
+		box.centerY = (minY + maxY) * 0.5f;
+		box.centerZ = (minZ + maxZ) * 0.5f;
+		box.extentX = (maxX - minX) * 0.5f;
+		box.extentY = (maxY - minY) * 0.5f;
+		box.extentZ = (maxZ - minZ) * 0.5f;
+		return box;
+	}
+
+	size_t BoundingSphereSoA::Size() const {
+		return x.size();
+	}
+
+	void BoundingSphereSoA::Reserve(size_t count) {
+		x.reserve(count);
+		y.reserve(count);
+		z.reserve(count);
+		radius.reserve(count);
+	}
+
+	void BoundingSphereSoA::Clear() {
+		x.clear();
+		y.clear();
+		z.clear();
+		radius.clear();
+	}
+
+	uint32_t BoundingSphereSoA::Add(const BoundingSphere& sphere) {
+		x.push_back(sphere.x);
+		y.push_back(sphere.y);
+		z.push_back(sphere.z);
+		radius.push_back(sphere.radius);
+		return uint32_t(x.size() - 1);
+	}
+
+	void BoundingSphereSoA::Set(size_t index, const BoundingSphere& sphere) {
+		x[index] = sphere.x;
+		y[index] = sphere.y;
+		z[index] = sphere.z;
+		radius[index] = sphere.radius;
+	}
+
+	BoundingSphere BoundingSphereSoA::Get(size_t index) const {
+		return BoundingSphere{ x[index], y[index], z[index], radius[index] };
+	}
+
+	size_t AABBSoA::Size() const {
+		return centerX.size();
+	}
+
+	void AABBSoA::Reserve(size_t count) {
+		centerX.reserve(count);
+		centerY.reserve(count);
+		centerZ.reserve(count);
+		extentX.reserve(count);
+		extentY.reserve(count);
+		extentZ.reserve(count);
+	}
+
+	void AABBSoA::Clear() {
+		centerX.clear();
+		centerY.clear();
+		centerZ.clear();
+		extentX.clear();
+		extentY.clear();
+		extentZ.clear();
+	}
+
+	uint32_t AABBSoA::Add(const AABB& box) {
+		centerX.push_back(box.centerX);
+		centerY.push_back(box.centerY);
+		centerZ.push_back(box.centerZ);
+		extentX.push_back(box.extentX);
+		extentY.push_back(box.extentY);
+		extentZ.push_back(box.extentZ);
+		return uint32_t(centerX.size() - 1);
+	}
+
+	void AABBSoA::Set(size_t index, const AABB& box) {
+		centerX[index] = box.centerX;
+		centerY[index] = box.centerY;
+		centerZ[index] = box.centerZ;
+		extentX[index] = box.extentX;
+		extentY[index] = box.extentY;
+		extentZ[index] = box.extentZ;
+	}
+
+	AABB AABBSoA::Get(size_t index) const {
+		return AABB{ centerX[index], centerY[index], centerZ[index], extentX[index], extentY[index], extentZ[index] };
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace eng {
+
+	struct BoundingSphere {
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+		float radius = 0.0f;
+	};
+
+	//axis aligned box stored as center and half extents, which is what plane tests want
+	struct AABB {
+		float centerX = 0.0f;
+		float centerY = 0.0f;
+		float centerZ = 0.0f;
+		float extentX = 0.0f;
+		float extentY = 0.0f;
+		float extentZ = 0.0f;
+
+		static AABB FromMinMax(float minX, float minY, float minZ, float maxX, float maxY, float maxZ);
+	};
+
+	//structure of arrays so culling can load eight spheres per component with a single instruction
+	struct BoundingSphereSoA {
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+		std::vector<float> radius;
+
+		size_t Size() const;
+		void Reserve(size_t count);
+		void Clear();
+		//returns the index of the new sphere
+		uint32_t Add(const BoundingSphere& sphere);
+		void Set(size_t index, const BoundingSphere& sphere);
+		BoundingSphere Get(size_t index) const;
+	};
+
+	struct AABBSoA {
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> extentX;
+		std::vector<float> extentY;
+		std::vector<float> extentZ;
+
+		size_t Size() const;
+		void Reserve(size_t count);
+		void Clear();
+		uint32_t Add(const AABB& box);
+		void Set(size_t index, const AABB& box);
+		AABB Get(size_t index) const;
+	};
+}
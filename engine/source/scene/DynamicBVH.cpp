@@ -0,0 +1,519 @@
+#include "scene/DynamicBVH.h"
+#include "render/Frustum.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace eng {
+
+	int32_t DynamicBVH::CreateProxy(const AABB& bounds, uint32_t userData) {
+		int32_t leaf = AllocateNode();
+		Node& node = m_nodes[leaf];
+		node.tight = ToBox(bounds);
+		node.box = Fatten(node.tight, 0.0f, 0.0f, 0.0f);
+		node.userData = userData;
+		node.height = 0;
+		InsertLeaf(leaf);
+		++m_proxyCount;
+		return leaf;
+	}
+
+	void DynamicBVH::DestroyProxy(int32_t proxyId) {
+		assert(proxyId >= 0 && proxyId < int32_t(m_nodes.size()) && m_nodes[proxyId].IsLeaf());
+		RemoveLeaf(proxyId);
+		FreeNode(proxyId);
+		--m_proxyCount;
+	}
+
+	bool DynamicBVH::MoveProxy(int32_t proxyId, const AABB& bounds, float displacementX, float displacementY, float displacementZ) {
+		Node& node = m_nodes[proxyId];
+		node.tight = ToBox(bounds);
+		//still inside its fat box, the tree does not change
+		if (Contains(node.box, node.tight)) {
+			return false;
+		}
+
+		RemoveLeaf(proxyId);
+		m_nodes[proxyId].box = Fatten(m_nodes[proxyId].tight, displacementX, displacementY, displacementZ);
+		InsertLeaf(proxyId);
+		return true;
+	}
+
+	void DynamicBVH::RefitProxies(const std::vector<ProxyBounds>& updates) {
+		for (const auto& update : updates) {
+			Node& node = m_nodes[update.proxyId];
+			node.tight = ToBox(update.bounds);
+			if (Contains(node.box, node.tight)) {
+				continue;
+			}
+			node.box = Fatten(node.tight, 0.0f, 0.0f, 0.0f);
+			//mark the path to the root, stopping where an earlier update already did
+			for (int32_t parent = node.parent; parent != kNullNode && !m_nodes[parent].dirty; parent = m_nodes[parent].parent) {
+				m_nodes[parent].dirty = true;
+			}
+		}
+		//every marked node is refit exactly once, children before parents
+		if (m_root != kNullNode) {
+			RefitDirty(m_root);
+		}
+	}
+
+	void DynamicBVH::Clear() {
+		m_nodes.clear();
+		m_root = kNullNode;
+		m_freeList = kNullNode;
+		m_proxyCount = 0;
+	}
+
+	uint32_t DynamicBVH::GetUserData(int32_t proxyId) const {
+		return m_nodes[proxyId].userData;
+	}
+
+	AABB DynamicBVH::GetBounds(int32_t proxyId) const {
+		return ToAABB(m_nodes[proxyId].tight);
+	}
+
+	AABB DynamicBVH::GetFatBounds(int32_t proxyId) const {
+		return ToAABB(m_nodes[proxyId].box);
+	}
+
+	size_t DynamicBVH::GetProxyCount() const {
+		return m_proxyCount;
+	}
+
+	void DynamicBVH::SetFatMargin(float margin) {
+		m_fatMargin = margin;
+	}
+
+	void DynamicBVH::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& userData) const {
+		if (m_root == kNullNode) {
+			return;
+		}
+
+		//the flag marks subtrees that are completely inside, their leaves are taken without further tests
+		std::vector<std::pair<int32_t, bool>> stack;
+		stack.reserve(64);
+		stack.push_back({ m_root, false });
+		while (!stack.empty()) {
+			auto [index, inside] = stack.back();
+			stack.pop_back();
+			const Node& node = m_nodes[index];
+
+			if (!inside) {
+				const Box& box = node.IsLeaf() ? node.tight : node.box;
+				bool outside = false;
+				bool intersecting = false;
+				for (const auto& plane : frustum.planes) {
+					float center[3] = { (box.min[0] + box.max[0]) * 0.5f, (box.min[1] + box.max[1]) * 0.5f, (box.min[2] + box.max[2]) * 0.5f };
+					float extent[3] = { box.max[0] - center[0], box.max[1] - center[1], box.max[2] - center[2] };
+					float distance = plane.nx * center[0] + plane.ny * center[1] + plane.nz * center[2] + plane.d;
+					float radius = std::fabs(plane.nx) * extent[0] + std::fabs(plane.ny) * extent[1] + std::fabs(plane.nz) * extent[2];
+					if (distance <= -radius) {
+						outside = true;
+						break;
+					}
+					if (distance < radius) {
+						intersecting = true;
+					}
+				}
+				if (outside) {
+					continue;
+				}
+				inside = !intersecting;
+			}
+
+			if (node.IsLeaf()) {
+				userData.push_back(node.userData);
+			}
+			else {
+				stack.push_back({ node.child1, inside });
+				stack.push_back({ node.child2, inside });
+			}
+		}
+	}
+
+	bool DynamicBVH::RayCastClosest(const Ray& ray, float maxDistance, RayHit& hit) const {
+		bool found = false;
+		RayCast(ray, maxDistance, [&](int32_t proxyId, float distance) {
+			hit.proxyId = proxyId;
+			hit.userData = m_nodes[proxyId].userData;
+			hit.distance = distance;
+			found = true;
+			return distance;
+		});
+		return found;
+	}
+
+	void DynamicBVH::QueryNearest(float x, float y, float z, size_t k, std::vector<NearestProxy>& results) const {
+		results.clear();
+		if (m_root == kNullNode || k == 0) {
+			return;
+		}
+
+		//best first: always expand the node closest to the point, stop once it is further than the k-th result
+		using Candidate = std::pair<float, int32_t>;
+		std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+		auto farther = [](const NearestProxy& a, const NearestProxy& b) { return a.distanceSquared < b.distanceSquared; };
+		candidates.push({ DistanceSquared(m_nodes[m_root].box, x, y, z), m_root });
+
+		while (!candidates.empty()) {
+			auto [distance, index] = candidates.top();
+			candidates.pop();
+			if (results.size() == k && distance >= results.front().distanceSquared) {
+				break;
+			}
+
+			const Node& node = m_nodes[index];
+			if (!node.IsLeaf()) {
+				candidates.push({ DistanceSquared(m_nodes[node.child1].box, x, y, z), node.child1 });
+				candidates.push({ DistanceSquared(m_nodes[node.child2].box, x, y, z), node.child2 });
+				continue;
+			}
+
+			//results is kept as a max heap on distance while searching
+			NearestProxy proxy{ index, node.userData, DistanceSquared(node.tight, x, y, z) };
+			if (results.size() < k) {
+				results.push_back(proxy);
+				std::push_heap(results.begin(), results.end(), farther);
+			}
+			else if (proxy.distanceSquared < results.front().distanceSquared) {
+				std::pop_heap(results.begin(), results.end(), farther);
+				results.back() = proxy;
+				std::push_heap(results.begin(), results.end(), farther);
+			}
+		}
+		std::sort_heap(results.begin(), results.end(), farther);
+	}
+
+	int DynamicBVH::GetHeight() const {
+		return m_root == kNullNode ? 0 : m_nodes[m_root].height;
+	}
+
+	float DynamicBVH::GetAreaRatio() const {
+		if (m_root == kNullNode) {
+			return 0.0f;
+		}
+		float rootArea = Area(m_nodes[m_root].box);
+		float totalArea = 0.0f;
+		for (const auto& node : m_nodes) {
+			if (node.height > 0) {
+				totalArea += Area(node.box);
+			}
+		}
+		return rootArea > 0.0f ? totalArea / rootArea : 0.0f;
+	}
+
+	DynamicBVH::Box DynamicBVH::ToBox(const AABB& bounds) {
+		Box box;
+		box.min[0] = bounds.centerX - bounds.extentX;
+		box.min[1] = bounds.centerY - bounds.extentY;
+		box.min[2] = bounds.centerZ - bounds.extentZ;
+		box.max[0] = bounds.centerX + bounds.extentX;
+		box.max[1] = bounds.centerY + bounds.extentY;
+		box.max[2] = bounds.centerZ + bounds.extentZ;
+		return box;
+	}
+
+	AABB DynamicBVH::ToAABB(const Box& box) {
+		return AABB::FromMinMax(box.min[0], box.min[1], box.min[2], box.max[0], box.max[1], box.max[2]);
+	}
+
+	DynamicBVH::Box DynamicBVH::Union(const Box& a, const Box& b) {
+		Box box;
+		for (int axis = 0; axis < 3; ++axis) {
+			box.min[axis] = std::min(a.min[axis], b.min[axis]);
+			box.max[axis] = std::max(a.max[axis], b.max[axis]);
+		}
+		return box;
+	}
+
+	float DynamicBVH::Area(const Box& box) {
+		float x = box.max[0] - box.min[0];
+		float y = box.max[1] - box.min[1];
+		float z = box.max[2] - box.min[2];
+		return 2.0f * (x * y + y * z + z * x);
+	}
+
+	bool DynamicBVH::Contains(const Box& outer, const Box& inner) {
+		for (int axis = 0; axis < 3; ++axis) {
+			if (inner.min[axis] < outer.min[axis] || inner.max[axis] > outer.max[axis]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool DynamicBVH::Overlaps(const Box& a, const Box& b) {
+		for (int axis = 0; axis < 3; ++axis) {
+			if (a.max[axis] < b.min[axis] || b.max[axis] < a.min[axis]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool DynamicBVH::IntersectRay(const Box& box, const float* origin, const float* inverseDirection, float maxDistance, float& distance) {
+		float entry = 0.0f;
+		float exit = maxDistance;
+		for (int axis = 0; axis < 3; ++axis) {
+			//parallel to this slab, either always inside it or never
+			if (std::isinf(inverseDirection[axis])) {
+				if (origin[axis] < box.min[axis] || origin[axis] > box.max[axis]) {
+					return false;
+				}
+				continue;
+			}
+			float t1 = (box.min[axis] - origin[axis]) * inverseDirection[axis];
+			float t2 = (box.max[axis] - origin[axis]) * inverseDirection[axis];
+			entry = std::max(entry, std::min(t1, t2));
+			exit = std::min(exit, std::max(t1, t2));
+			if (entry > exit) {
+				return false;
+			}
+		}
+		distance = entry;
+		return true;
+	}
+
+	float DynamicBVH::DistanceSquared(const Box& box, float x, float y, float z) {
+		const float point[3] = { x, y, z };
+		float distance = 0.0f;
+		for (int axis = 0; axis < 3; ++axis) {
+			float outside = std::max(std::max(box.min[axis] - point[axis], point[axis] - box.max[axis]), 0.0f);
+			distance += outside * outside;
+		}
+		return distance;
+	}
+
+	int32_t DynamicBVH::AllocateNode() {
+		if (m_freeList == kNullNode) {
+			m_nodes.emplace_back();
+			return int32_t(m_nodes.size() - 1);
+		}
+		int32_t index = m_freeList;
+		m_freeList = m_nodes[index].parent;
+		m_nodes[index] = Node();
+		return index;
+	}
+
+	void DynamicBVH::FreeNode(int32_t index) {
+		m_nodes[index] = Node();
+		m_nodes[index].parent = m_freeList;
+		m_freeList = index;
+	}
+
+	DynamicBVH::Box DynamicBVH::Fatten(const Box& tight, float displacementX, float displacementY, float displacementZ) const {
+		Box box = tight;
+		const float displacement[3] = { displacementX * m_displacementMultiplier, displacementY * m_displacementMultiplier, displacementZ * m_displacementMultiplier };
+		for (int axis = 0; axis < 3; ++axis) {
+			box.min[axis] -= m_fatMargin;
+			box.max[axis] += m_fatMargin;
+			//predict where the proxy is heading so a steadily moving object is not reinserted every frame
+			if (displacement[axis] < 0.0f) {
+				box.min[axis] += displacement[axis];
+			}
+			else {
+				box.max[axis] += displacement[axis];
+			}
+		}
+		return box;
+	}
+
+	void DynamicBVH::InsertLeaf(int32_t leaf) {
+		if (m_root == kNullNode) {
+			m_root = leaf;
+			m_nodes[leaf].parent = kNullNode;
+			return;
+		}
+
+		int32_t sibling = FindBestSibling(m_nodes[leaf].box);
+
+		//a new parent takes the place of the sibling and adopts both
+		int32_t oldParent = m_nodes[sibling].parent;
+		int32_t newParent = AllocateNode();
+		Node& parentNode = m_nodes[newParent];
+		parentNode.parent = oldParent;
+		parentNode.box = Union(m_nodes[leaf].box, m_nodes[sibling].box);
+		parentNode.height = m_nodes[sibling].height + 1;
+		parentNode.child1 = sibling;
+		parentNode.child2 = leaf;
+
+		if (oldParent != kNullNode) {
+			if (m_nodes[oldParent].child1 == sibling) {
+				m_nodes[oldParent].child1 = newParent;
+			}
+			else {
+				m_nodes[oldParent].child2 = newParent;
+			}
+		}
+		else {
+			m_root = newParent;
+		}
+		m_nodes[sibling].parent = newParent;
+		m_nodes[leaf].parent = newParent;
+
+		RefitAncestors(newParent, true);
+	}
+
+	void DynamicBVH::RemoveLeaf(int32_t leaf) {
+		if (leaf == m_root) {
+			m_root = kNullNode;
+			return;
+		}
+
+		//the sibling takes the place of the parent, which goes away
+		int32_t parent = m_nodes[leaf].parent;
+		int32_t grandParent = m_nodes[parent].parent;
+		int32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+		if (grandParent != kNullNode) {
+			if (m_nodes[grandParent].child1 == parent) {
+				m_nodes[grandParent].child1 = sibling;
+			}
+			else {
+				m_nodes[grandParent].child2 = sibling;
+			}
+			m_nodes[sibling].parent = grandParent;
+			FreeNode(parent);
+			RefitAncestors(grandParent, false);
+		}
+		else {
+			m_root = sibling;
+			m_nodes[sibling].parent = kNullNode;
+			FreeNode(parent);
+		}
+	}
+
+	int32_t DynamicBVH::FindBestSibling(const Box& box) const {
+		//branch and bound over the surface area heuristic (bittner et al.)
+		//the cost of picking a node is the area of its union with the new box plus the growth it causes in every ancestor
+		float leafArea = Area(box);
+		int32_t best = m_root;
+		float bestCost = Area(Union(m_nodes[m_root].box, box));
+
+		std::vector<std::pair<int32_t, float>> stack;
+		stack.reserve(64);
+		stack.push_back({ m_root, 0.0f });
+		while (!stack.empty()) {
+			auto [index, inheritedCost] = stack.back();
+			stack.pop_back();
+			const Node& node = m_nodes[index];
+
+			float directCost = Area(Union(node.box, box));
+			float cost = directCost + inheritedCost;
+			if (cost < bestCost) {
+				best = index;
+				bestCost = cost;
+			}
+
+			//no descendant can do better than the new box alone plus what every ancestor grows
+			float childInheritedCost = inheritedCost + directCost - Area(node.box);
+			if (!node.IsLeaf() && leafArea + childInheritedCost < bestCost) {
+				stack.push_back({ node.child1, childInheritedCost });
+				stack.push_back({ node.child2, childInheritedCost });
+			}
+		}
+		return best;
+	}
+
+	void DynamicBVH::RefitAncestors(int32_t index, bool rotate) {
+		while (index != kNullNode) {
+			if (rotate) {
+				Rotate(index);
+			}
+			Node& node = m_nodes[index];
+			node.box = Union(m_nodes[node.child1].box, m_nodes[node.child2].box);
+			node.height = 1 + std::max(m_nodes[node.child1].height, m_nodes[node.child2].height);
+			index = node.parent;
+		}
+	}
+
+	void DynamicBVH::Rotate(int32_t index) {
+		//tree rotations (kopta et al.): swap a child with a grandchild on the other side when that shrinks the other child
+		Node& node = m_nodes[index];
+		int32_t b = node.child1;
+		int32_t c = node.child2;
+		if (m_nodes[b].IsLeaf() && m_nodes[c].IsLeaf()) {
+			return;
+		}
+
+		enum class Rotation { None, BF, BG, CD, CE };
+		Rotation bestRotation = Rotation::None;
+		float bestDelta = 0.0f;
+
+		if (!m_nodes[c].IsLeaf()) {
+			int32_t f = m_nodes[c].child1;
+			int32_t g = m_nodes[c].child2;
+			float area = Area(m_nodes[c].box);
+			float deltaBF = Area(Union(m_nodes[b].box, m_nodes[g].box)) - area;
+			float deltaBG = Area(Union(m_nodes[b].box, m_nodes[f].box)) - area;
+			if (deltaBF < bestDelta) {
+				bestRotation = Rotation::BF;
+				bestDelta = deltaBF;
+			}
+			if (deltaBG < bestDelta) {
+				bestRotation = Rotation::BG;
+				bestDelta = deltaBG;
+			}
+		}
+		if (!m_nodes[b].IsLeaf()) {
+			int32_t d = m_nodes[b].child1;
+			int32_t e = m_nodes[b].child2;
+			float area = Area(m_nodes[b].box);
+			float deltaCD = Area(Union(m_nodes[c].box, m_nodes[e].box)) - area;
+			float deltaCE = Area(Union(m_nodes[c].box, m_nodes[d].box)) - area;
+			if (deltaCD < bestDelta) {
+				bestRotation = Rotation::CD;
+				bestDelta = deltaCD;
+			}
+			if (deltaCE < bestDelta) {
+				bestRotation = Rotation::CE;
+				bestDelta = deltaCE;
+			}
+		}
+
+		//swaps child with grandChild, where grandChild is a child of parent
+		auto swap = [this, index](int32_t child, int32_t parent, int32_t grandChild) {
+			Node& node = m_nodes[index];
+			Node& parentNode = m_nodes[parent];
+			if (node.child1 == child) {
+				node.child1 = grandChild;
+			}
+			else {
+				node.child2 = grandChild;
+			}
+			if (parentNode.child1 == grandChild) {
+				parentNode.child1 = child;
+			}
+			else {
+				parentNode.child2 = child;
+			}
+			m_nodes[grandChild].parent = index;
+			m_nodes[child].parent = parent;
+			parentNode.box = Union(m_nodes[parentNode.child1].box, m_nodes[parentNode.child2].box);
+			parentNode.height = 1 + std::max(m_nodes[parentNode.child1].height, m_nodes[parentNode.child2].height);
+		};
+
+		switch (bestRotation) {
+		case Rotation::BF: swap(b, c, m_nodes[c].child1); break;
+		case Rotation::BG: swap(b, c, m_nodes[c].child2); break;
+		case Rotation::CD: swap(c, b, m_nodes[b].child1); break;
+		case Rotation::CE: swap(c, b, m_nodes[b].child2); break;
+		case Rotation::None: break;
+		}
+	}
+
+	void DynamicBVH::RefitDirty(int32_t index) {
+		Node& node = m_nodes[index];
+		if (node.IsLeaf() || !node.dirty) {
+			return;
+		}
+		node.dirty = false;
+		RefitDirty(node.child1);
+		RefitDirty(node.child2);
+		Node& refit = m_nodes[index];
+		refit.box = Union(m_nodes[refit.child1].box, m_nodes[refit.child2].box);
+	}
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "scene/Bounds.h"
+#include <cstdint>
+#include <vector>
+
+namespace eng {
+
+	class Frustum;
+
+	struct Ray {
+		float originX = 0.0f;
+		float originY = 0.0f;
+		float originZ = 0.0f;
+		//distances along the ray are measured in multiples of the direction, so a unit direction gives world units
+		float directionX = 0.0f;
+		float directionY = 0.0f;
+		float directionZ = 1.0f;
+	};
+
+	struct RayHit {
+		int32_t proxyId = -1;
+		uint32_t userData = 0;
+		float distance = 0.0f;
+	};
+
+	struct NearestProxy {
+		int32_t proxyId = -1;
+		uint32_t userData = 0;
+		float distanceSquared = 0.0f;
+	};
+
+	struct ProxyBounds {
+		int32_t proxyId = -1;
+		AABB bounds;
+	};
+
+	//incremental bounding volume hierarchy over axis aligned boxes
+	//leaves store a fattened box so small movements don't touch the tree at all,
+	//inserts pick their sibling with the surface area heuristic and rotations keep the tree balanced
+	class DynamicBVH {
+	public:
+		static const int32_t kNullNode = -1;
+
+		DynamicBVH() = default;
+
+		//userData is handed back by every query, usually an entity or render object index
+		int32_t CreateProxy(const AABB& bounds, uint32_t userData);
+		void DestroyProxy(int32_t proxyId);
+		//returns true when the proxy left its fat box and had to be reinserted
+		//the displacement (movement expected until the next update) stretches the new fat box in that direction
+		bool MoveProxy(int32_t proxyId, const AABB& bounds, float displacementX = 0.0f, float displacementY = 0.0f, float displacementZ = 0.0f);
+		//updates many proxies at once and refits each touched branch a single time, no reinsertion
+		//cheaper than MoveProxy for lots of small movements, at the cost of slowly degrading tree quality
+		void RefitProxies(const std::vector<ProxyBounds>& updates);
+		void Clear();
+
+		uint32_t GetUserData(int32_t proxyId) const;
+		AABB GetBounds(int32_t proxyId) const;
+		AABB GetFatBounds(int32_t proxyId) const;
+		size_t GetProxyCount() const;
+		//every proxy is fattened by this much on each side
+		void SetFatMargin(float margin);
+
+		//callback(proxyId) returns false to stop the query early
+		template<typename Callback>
+		void QueryOverlap(const AABB& bounds, Callback&& callback) const;
+		//appends the user data of every proxy inside or touching the frustum
+		void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& userData) const;
+		//callback(proxyId, distance) returns the new maximum distance: the hit distance to only keep closer hits,
+		//the current maximum to ignore the proxy or a negative value to stop
+		template<typename Callback>
+		void RayCast(const Ray& ray, float maxDistance, Callback&& callback) const;
+		//closest proxy whose box the ray hits, for picking
+		bool RayCastClosest(const Ray& ray, float maxDistance, RayHit& hit) const;
+		//the k proxies whose boxes are closest to the point, nearest first
+		void QueryNearest(float x, float y, float z, size_t k, std::vector<NearestProxy>& results) const;
+
+		//0 for an empty tree or a single leaf
+		int GetHeight() const;
+		//total surface area of the internal nodes relative to the root, lower is a better tree
+		float GetAreaRatio() const;
+
+	private:
+		struct Box {
+			float min[3];
+			float max[3];
+		};
+
+		struct Node {
+			//fat box for leaves
+			Box box;
+			//exact box of the proxy, leaves only
+			Box tight;
+			//next free node while the node sits in the free list
+			int32_t parent = kNullNode;
+			int32_t child1 = kNullNode;
+			int32_t child2 = kNullNode;
+			//leaves are 0, free nodes -1
+			int32_t height = -1;
+			uint32_t userData = 0;
+			bool dirty = false;
+
+			bool IsLeaf() const { return child1 == kNullNode; }
+		};
+
+		static Box ToBox(const AABB& bounds);
+		static AABB ToAABB(const Box& box);
+		static Box Union(const Box& a, const Box& b);
+		static float Area(const Box& box);
+		static bool Contains(const Box& outer, const Box& inner);
+		static bool Overlaps(const Box& a, const Box& b);
+		//entry distance of the ray into the box, false if it misses or enters beyond maxDistance
+		static bool IntersectRay(const Box& box, const float* origin, const float* inverseDirection, float maxDistance, float& distance);
+		static float DistanceSquared(const Box& box, float x, float y, float z);
+
+		int32_t AllocateNode();
+		void FreeNode(int32_t node);
+		Box Fatten(const Box& tight, float displacementX, float displacementY, float displacementZ) const;
+		void InsertLeaf(int32_t leaf);
+		void RemoveLeaf(int32_t leaf);
+		int32_t FindBestSibling(const Box& box) const;
+		//walks from node to the root fixing boxes and heights, optionally rotating on the way
+		void RefitAncestors(int32_t node, bool rotate);
+		void Rotate(int32_t node);
+		void RefitDirty(int32_t node);
+
+		std::vector<Node> m_nodes;
+		int32_t m_root = kNullNode;
+		int32_t m_freeList = kNullNode;
+		size_t m_proxyCount = 0;
+		float m_fatMargin = 0.1f;
+		//fat boxes stretch this many times the expected displacement
+		float m_displacementMultiplier = 2.0f;
+	};
+
+	template<typename Callback>
+	void DynamicBVH::QueryOverlap(const AABB& bounds, Callback&& callback) const {
+		if (m_root == kNullNode) {
+			return;
+		}
+		Box box = ToBox(bounds);
+		std::vector<int32_t> stack;
+		stack.reserve(64);
+		stack.push_back(m_root);
+		while (!stack.empty()) {
+			int32_t index = stack.back();
+			stack.pop_back();
+			const Node& node = m_nodes[index];
+			if (!Overlaps(node.box, box)) {
+				continue;
+			}
+			if (node.IsLeaf()) {
+				if (Overlaps(node.tight, box) && !callback(index)) {
+					return;
+				}
+				continue;
+			}
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+
+	template<typename Callback>
+	void DynamicBVH::RayCast(const Ray& ray, float maxDistance, Callback&& callback) const {
+		if (m_root == kNullNode) {
+			return;
+		}
+		const float origin[3] = { ray.originX, ray.originY, ray.originZ };
+		//infinities for axis parallel rays are what the slab test wants
+		const float inverseDirection[3] = { 1.0f / ray.directionX, 1.0f / ray.directionY, 1.0f / ray.directionZ };
+
+		std::vector<int32_t> stack;
+		stack.reserve(64);
+		stack.push_back(m_root);
+		while (!stack.empty()) {
+			int32_t index = stack.back();
+			stack.pop_back();
+			const Node& node = m_nodes[index];
+			float distance;
+			if (!IntersectRay(node.box, origin, inverseDirection, maxDistance, distance)) {
+				continue;
+			}
+			if (node.IsLeaf()) {
+				if (!IntersectRay(node.tight, origin, inverseDirection, maxDistance, distance)) {
+					continue;
+				}
+				maxDistance = callback(index, distance);
+				if (maxDistance < 0.0f) {
+					return;
+				}
+				continue;
+			}
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+}
@@ -0,0 +1,318 @@
+#include "scene/SceneFile.h"
+#include "log/Log.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace eng {
+
+	namespace {
+
+		const size_t kSectionAlignment = 16;
+
+		const char* GetSectionName(uint32_t type) {
+			switch (SceneSectionType(type)) {
+			case SceneSectionType::Entities: return "entities";
+			case SceneSectionType::Transforms: return "transforms";
+			case SceneSectionType::Bounds: return "bounds";
+			case SceneSectionType::Meshes: return "meshes";
+			case SceneSectionType::Strings: return "strings";
+			default: return "unknown";
+			}
+		}
+
+		void Pad(std::string& bytes) {
+			bytes.resize((bytes.size() + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment, '\0');
+		}
+	}
+
+	bool SceneFile::Open(const std::string& path) {
+		Close();
+		if (!m_mappedFile.Open(path)) {
+			return false;
+		}
+		if (!Parse(m_mappedFile.GetData(), m_mappedFile.GetSize())) {
+			LOG_ERROR(Scene, "SCENE_FILE_INVALID: {}", path);
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	bool SceneFile::OpenMemory(std::string&& bytes) {
+		Close();
+		m_bytes = std::move(bytes);
+		if (!Parse(reinterpret_cast<const uint8_t*>(m_bytes.data()), m_bytes.size())) {
+			LOG_ERROR(Scene, "SCENE_FILE_INVALID");
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void SceneFile::Close() {
+		m_mappedFile.Close();
+		m_bytes.clear();
+		m_header = nullptr;
+		m_sections = nullptr;
+		m_entities = nullptr;
+		m_transforms = nullptr;
+		m_meshes = nullptr;
+		m_bounds = nullptr;
+		m_strings = nullptr;
+		m_stringsSize = 0;
+	}
+
+	bool SceneFile::Parse(const uint8_t* data, size_t size) {
+		if (size < sizeof(SceneFileHeader)) {
+			return false;
+		}
+		const auto* header = reinterpret_cast<const SceneFileHeader*>(data);
+		if (header->magic != kSceneMagic) {
+			return false;
+		}
+		if (header->version != kSceneVersion) {
+			LOG_ERROR(Scene, "SCENE_FILE_UNSUPPORTED_VERSION: {}", header->version);
+			return false;
+		}
+		if (header->fileSize != size || header->sectionTableOffset % alignof(SceneSection) != 0 ||
+			header->sectionTableOffset > size || uint64_t(header->sectionCount) * sizeof(SceneSection) > size - header->sectionTableOffset) {
+			return false;
+		}
+
+		const auto* sections = reinterpret_cast<const SceneSection*>(data + header->sectionTableOffset);
+		const uint64_t entityCount = header->entityCount;
+		for (uint32_t i = 0; i < header->sectionCount; ++i) {
+			const SceneSection& section = sections[i];
+			if (section.offset % kSectionAlignment != 0 || section.offset > size || section.elementSize == 0 ||
+				section.count > (size - section.offset) / section.elementSize) {
+				return false;
+			}
+			const uint8_t* payload = data + section.offset;
+			//a known section with an unexpected layout is an error, unknown sections are skipped
+			switch (SceneSectionType(section.type)) {
+			case SceneSectionType::Entities:
+				if (section.elementSize != sizeof(SceneEntity) || section.count != entityCount) {
+					return false;
+				}
+				m_entities = reinterpret_cast<const SceneEntity*>(payload);
+				break;
+			case SceneSectionType::Transforms:
+				if (section.elementSize != sizeof(SceneTransform) || section.count != entityCount) {
+					return false;
+				}
+				m_transforms = reinterpret_cast<const SceneTransform*>(payload);
+				break;
+			case SceneSectionType::Bounds:
+				if (section.elementSize != sizeof(float) * 6 || section.count != entityCount) {
+					return false;
+				}
+				m_bounds = reinterpret_cast<const float*>(payload);
+				break;
+			case SceneSectionType::Meshes:
+				if (section.elementSize != sizeof(SceneMeshReference) || section.count != entityCount) {
+					return false;
+				}
+				m_meshes = reinterpret_cast<const SceneMeshReference*>(payload);
+				break;
+			case SceneSectionType::Strings:
+				//every string is terminated, so any offset inside the section is a valid c string
+				if (section.elementSize != 1 || section.count == 0 || payload[section.count - 1] != '\0') {
+					return false;
+				}
+				m_strings = reinterpret_cast<const char*>(payload);
+				m_stringsSize = size_t(section.count);
+				break;
+			default:
+				break;
+			}
+		}
+		if (!m_entities || !m_transforms) {
+			return false;
+		}
+
+		//the references are all that could send a reader out of bounds, so they are checked once here
+		for (uint64_t i = 0; i < entityCount; ++i) {
+			const SceneEntity& entity = m_entities[i];
+			if (entity.parent != kSceneNoParent && entity.parent >= i) {
+				return false;
+			}
+			if (entity.name != kSceneNoString && entity.name >= m_stringsSize) {
+				return false;
+			}
+			if (m_meshes && ((m_meshes[i].mesh != kSceneNoString && m_meshes[i].mesh >= m_stringsSize) ||
+				(m_meshes[i].material != kSceneNoString && m_meshes[i].material >= m_stringsSize))) {
+				return false;
+			}
+		}
+
+		m_header = header;
+		m_sections = sections;
+		return true;
+	}
+
+	uint32_t SceneFile::GetEntityCount() const {
+		return m_header ? m_header->entityCount : 0;
+	}
+
+	const SceneEntity* SceneFile::GetEntities() const {
+		return m_entities;
+	}
+
+	const SceneTransform* SceneFile::GetTransforms() const {
+		return m_transforms;
+	}
+
+	const SceneMeshReference* SceneFile::GetMeshes() const {
+		return m_meshes;
+	}
+
+	const float* SceneFile::GetBoundsComponent(int component) const {
+		return m_bounds ? m_bounds + size_t(component) * GetEntityCount() : nullptr;
+	}
+
+	const char* SceneFile::GetString(uint32_t offset) const {
+		return offset == kSceneNoString || offset >= m_stringsSize ? "" : m_strings + offset;
+	}
+
+	bool SceneFile::CopyBounds(AABBSoA& boxes) const {
+		if (!m_bounds) {
+			return false;
+		}
+		size_t count = GetEntityCount();
+		std::vector<float>* components[6] = { &boxes.centerX, &boxes.centerY, &boxes.centerZ, &boxes.extentX, &boxes.extentY, &boxes.extentZ };
+		for (int component = 0; component < 6; ++component) {
+			const float* source = GetBoundsComponent(component);
+			components[component]->insert(components[component]->end(), source, source + count);
+		}
+		return true;
+	}
+
+	void SceneFile::Dump(std::ostream& stream, size_t maxEntities) const {
+		if (!m_header) {
+			stream << "no scene loaded\n";
+			return;
+		}
+		stream << "scene version " << m_header->version << ", " << m_header->fileSize << " bytes, " << m_header->entityCount << " entities\n";
+		for (uint32_t i = 0; i < m_header->sectionCount; ++i) {
+			const SceneSection& section = m_sections[i];
+			stream << "section " << GetSectionName(section.type) << " (" << section.type << ") offset " << section.offset
+				<< " count " << section.count << " element " << section.elementSize << "\n";
+		}
+
+		size_t count = std::min<size_t>(GetEntityCount(), maxEntities);
+		for (size_t i = 0; i < count; ++i) {
+			const SceneEntity& entity = m_entities[i];
+			const SceneTransform& transform = m_transforms[i];
+			stream << "entity " << i << " id " << entity.id << " \"" << GetString(entity.name) << "\"";
+			if (entity.parent != kSceneNoParent) {
+				stream << " parent " << entity.parent;
+			}
+			if (entity.flags != 0) {
+				stream << " flags " << entity.flags;
+			}
+			stream << "\n  position " << transform.position[0] << " " << transform.position[1] << " " << transform.position[2]
+				<< "\n  rotation " << transform.rotation[0] << " " << transform.rotation[1] << " " << transform.rotation[2] << " " << transform.rotation[3]
+				<< "\n  scale " << transform.scale[0] << " " << transform.scale[1] << " " << transform.scale[2] << "\n";
+			if (m_meshes && m_meshes[i].mesh != kSceneNoString) {
+				stream << "  mesh \"" << GetString(m_meshes[i].mesh) << "\" material \"" << GetString(m_meshes[i].material) << "\"\n";
+			}
+			if (m_bounds) {
+				stream << "  bounds center";
+				for (int component = 0; component < 6; ++component) {
+					if (component == 3) {
+						stream << " extent";
+					}
+					stream << " " << GetBoundsComponent(component)[i];
+				}
+				stream << "\n";
+			}
+		}
+		if (count < GetEntityCount()) {
+			stream << "... " << GetEntityCount() - count << " more entities\n";
+		}
+	}
+
+	uint32_t SceneWriter::AddEntity(const std::string& name, const SceneTransform& transform, uint32_t parent) {
+		uint32_t index = uint32_t(m_entities.size());
+		if (parent != kSceneNoParent && parent >= index) {
+			LOG_ERROR(Scene, "SCENE_PARENT_AFTER_CHILD: {}", name);
+			parent = kSceneNoParent;
+		}
+		m_entities.push_back({ index, parent, name.empty() ? kSceneNoString : AddString(name), 0 });
+		m_transforms.push_back(transform);
+		m_meshes.push_back({ kSceneNoString, kSceneNoString });
+		m_bounds.Add(AABB());
+		return index;
+	}
+
+	void SceneWriter::SetBounds(uint32_t entity, const AABB& bounds) {
+		m_bounds.Set(entity, bounds);
+		m_hasBounds = true;
+	}
+
+	void SceneWriter::SetMesh(uint32_t entity, const std::string& mesh, const std::string& material) {
+		m_meshes[entity] = { AddString(mesh), material.empty() ? kSceneNoString : AddString(material) };
+		m_hasMeshes = true;
+	}
+
+	size_t SceneWriter::GetEntityCount() const {
+		return m_entities.size();
+	}
+
+	uint32_t SceneWriter::AddString(const std::string& value) {
+		auto it = m_stringOffsets.find(value);
+		if (it != m_stringOffsets.end()) {
+			return it->second;
+		}
+		uint32_t offset = uint32_t(m_strings.size());
+		m_strings.append(value.c_str(), value.size() + 1);
+		m_stringOffsets.emplace(value, offset);
+		return offset;
+	}
+
+	bool SceneWriter::Write(const std::string& path) const {
+		std::string bytes(sizeof(SceneFileHeader), '\0');
+		std::vector<SceneSection> sections;
+		auto addSection = [&bytes, &sections](SceneSectionType type, uint32_t elementSize, uint64_t count, const void* data, size_t size) {
+			Pad(bytes);
+			sections.push_back({ uint32_t(type), elementSize, uint64_t(bytes.size()), count });
+			bytes.append(static_cast<const char*>(data), size);
+		};
+
+		size_t count = m_entities.size();
+		addSection(SceneSectionType::Entities, sizeof(SceneEntity), count, m_entities.data(), count * sizeof(SceneEntity));
+		addSection(SceneSectionType::Transforms, sizeof(SceneTransform), count, m_transforms.data(), count * sizeof(SceneTransform));
+		if (m_hasMeshes) {
+			addSection(SceneSectionType::Meshes, sizeof(SceneMeshReference), count, m_meshes.data(), count * sizeof(SceneMeshReference));
+		}
+		if (m_hasBounds) {
+			Pad(bytes);
+			sections.push_back({ uint32_t(SceneSectionType::Bounds), sizeof(float) * 6, uint64_t(bytes.size()), count });
+			for (const auto* component : { &m_bounds.centerX, &m_bounds.centerY, &m_bounds.centerZ, &m_bounds.extentX, &m_bounds.extentY, &m_bounds.extentZ }) {
+				bytes.append(reinterpret_cast<const char*>(component->data()), count * sizeof(float));
+			}
+		}
+		//always present and never empty so a lone terminator marks the empty string
+		std::string strings = m_strings.empty() ? std::string(1, '\0') : m_strings;
+		addSection(SceneSectionType::Strings, 1, strings.size(), strings.data(), strings.size());
+
+		Pad(bytes);
+		SceneFileHeader header{};
+		header.magic = kSceneMagic;
+		header.version = kSceneVersion;
+		header.entityCount = uint32_t(count);
+		header.sectionCount = uint32_t(sections.size());
+		header.sectionTableOffset = bytes.size();
+		bytes.append(reinterpret_cast<const char*>(sections.data()), sections.size() * sizeof(SceneSection));
+		header.fileSize = bytes.size();
+		std::memcpy(&bytes[0], &header, sizeof(header));
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.write(bytes.data(), bytes.size())) {
+			LOG_ERROR(Scene, "SCENE_FILE_WRITE_FAILED: {}", path);
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "assets/MappedFile.h"
+#include "scene/Bounds.h"
+#include "scene/SceneFormat.h"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eng {
+
+	//a cooked scene mapped into memory, the arrays point straight into the file and are valid until Close
+	class SceneFile {
+	public:
+		SceneFile() = default;
+		SceneFile(const SceneFile&) = delete;
+		SceneFile& operator=(const SceneFile&) = delete;
+
+		//maps the file, only the header and section table are read here
+		bool Open(const std::string& path);
+		//takes over bytes that were already read, e.g. by the asset manager
+		bool OpenMemory(std::string&& bytes);
+		void Close();
+
+		uint32_t GetEntityCount() const;
+		const SceneEntity* GetEntities() const;
+		const SceneTransform* GetTransforms() const;
+		//null when the scene was cooked without it
+		const SceneMeshReference* GetMeshes() const;
+		//one array per component, null when the scene has no bounds
+		const float* GetBoundsComponent(int component) const;
+		//empty for kSceneNoString
+		const char* GetString(uint32_t offset) const;
+
+		//appends the bounds of every entity, a straight copy of each component array
+		bool CopyBounds(AABBSoA& boxes) const;
+
+		//human readable listing of the header, the sections and up to maxEntities entities
+		void Dump(std::ostream& stream, size_t maxEntities = size_t(-1)) const;
+
+	private:
+		bool Parse(const uint8_t* data, size_t size);
+
+		MappedFile m_mappedFile;
+		std::string m_bytes;
+		const SceneFileHeader* m_header = nullptr;
+		const SceneSection* m_sections = nullptr;
+		const SceneEntity* m_entities = nullptr;
+		const SceneTransform* m_transforms = nullptr;
+		const SceneMeshReference* m_meshes = nullptr;
+		const float* m_bounds = nullptr;
+		const char* m_strings = nullptr;
+		size_t m_stringsSize = 0;
+	};
+
+	//collects entities and writes them as a cooked scene
+	class SceneWriter {
+	public:
+		//parents have to be added before their children, returns the index of the entity
+		uint32_t AddEntity(const std::string& name, const SceneTransform& transform, uint32_t parent = kSceneNoParent);
+		void SetBounds(uint32_t entity, const AABB& bounds);
+		void SetMesh(uint32_t entity, const std::string& mesh, const std::string& material);
+		size_t GetEntityCount() const;
+
+		bool Write(const std::string& path) const;
+
+	private:
+		uint32_t AddString(const std::string& value);
+
+		std::vector<SceneEntity> m_entities;
+		std::vector<SceneTransform> m_transforms;
+		std::vector<SceneMeshReference> m_meshes;
+		AABBSoA m_bounds;
+		std::string m_strings;
+		std::unordered_map<std::string, uint32_t> m_stringOffsets;
+		bool m_hasMeshes = false;
+		bool m_hasBounds = false;
+	};
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+//on disk layout of cooked scenes
+//a header, a table of sections and the section payloads, every reference is an offset from the start of the file
+//or an index into another array, so the file can be mapped anywhere and used without any fix ups
+//all sections start on a 16 byte boundary and the file is little endian
+namespace eng {
+
+	static const uint32_t kSceneMagic = 0x454E4353; //"SCNE"
+	//bump whenever the layout of an existing section changes, new sections don't need a bump since readers skip unknown ones
+	static const uint32_t kSceneVersion = 1;
+	static const uint32_t kSceneNoParent = 0xFFFFFFFFu;
+	static const uint32_t kSceneNoString = 0xFFFFFFFFu;
+
+	enum class SceneSectionType : uint32_t {
+		Entities = 1,
+		Transforms = 2,
+		//structure of arrays, count center x values, then center y and so on for the six AABB components
+		Bounds = 3,
+		Meshes = 4,
+		//zero terminated utf8 strings, referenced by byte offset into the section
+		Strings = 5
+	};
+
+	struct SceneFileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t fileSize;
+		uint32_t entityCount;
+		uint32_t sectionCount;
+		uint64_t sectionTableOffset;
+	};
+
+	struct SceneSection {
+		uint32_t type;
+		//size of one element, lets a reader reject a section it does not understand
+		uint32_t elementSize;
+		uint64_t offset;
+		uint64_t count;
+	};
+
+	struct SceneEntity {
+		uint32_t id;
+		//index of the parent entity, parents always come before their children
+		uint32_t parent;
+		uint32_t name;
+		uint32_t flags;
+	};
+
+	//local to the parent
+	struct SceneTransform {
+		float position[3];
+		//x, y, z, w
+		float rotation[4];
+		float scale[3];
+	};
+
+	struct SceneMeshReference {
+		uint32_t mesh;
+		uint32_t material;
+	};
+
+	static_assert(sizeof(SceneFileHeader) == 32, "scene header layout changed");
+	static_assert(sizeof(SceneSection) == 24, "scene section layout changed");
+	static_assert(sizeof(SceneEntity) == 16, "scene entity layout changed");
+	static_assert(sizeof(SceneTransform) == 40, "scene transform layout changed");
+	static_assert(sizeof(SceneMeshReference) == 8, "scene mesh reference layout changed");
+}
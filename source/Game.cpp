@@ -1,44 +1,37 @@
 #include "Game.h"
-#include <iostream>
 #include <GLFW/glfw3.h>
 
 bool Game::Init(){
-    //vertex shader source code
-    std::string vertexShaderSource = R"(
-    #version 330 core
-    layout (location = 0) in vec3 position;
-    layout (location = 1) in vec3 color;
-
-    out vec3 vColor;
-    
-    void main() {
-        vColor = color;
-        gl_Position = vec4(position.x, position.y, position.z, 1.0);
-    }
-)";
-    //fragment shader source code
-    std::string fragmentShaderSource = R"(
-    #version 330 core
-    out vec4 FragColor;
-
-    in vec3 vColor;
-    
-    void main() {
-        FragColor = vec4(vColor, 1.0);
-    }
-)";
-    auto& graphicsAPI = eng::Engine::GetInstance().GetGraphicsAPI();
-    auto shaderProgram = graphicsAPI.CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
-    m_material.SetShaderProgram(shaderProgram);
+    //shaders live in the assets folder and are reloaded whenever one of their files is saved
+    auto& engine = eng::Engine::GetInstance();
+    engine.GetAssetManager().SetRootPath(ASSETS_ROOT);
+    m_shaderProgram = engine.GetShaderLibrary().Load("shaders/vertex_color.vert", "shaders/vertex_color.frag");
+
+	//defaults in code, the bindings file can override them
+	auto& actions = engine.GetInputManager().GetActions();
+	m_jump = actions.AddAction("Jump", eng::ActionType::Button);
+	m_moveX = actions.AddAction("MoveX", eng::ActionType::Axis);
+	actions.Bind(m_jump, { eng::InputSource::Key, GLFW_KEY_SPACE });
+	actions.Bind(m_moveX, { eng::InputSource::Key, GLFW_KEY_D, 1.0f });
+	actions.Bind(m_moveX, { eng::InputSource::Key, GLFW_KEY_A, -1.0f });
+	actions.Load(std::string(ASSETS_ROOT) + "/input/bindings.txt");
     return true;
 
 }
 void Game::Update(float deltaTime){
 
-	//get instance of input manager
-	auto& input = eng::Engine::GetInstance().GetInputManager();
-	if (input.IsKeyPressed(GLFW_KEY_A)) {
-		std::cout << "the A button has been pressed " << std::endl;
+	//the shader streams in the background, hand it to the material as soon as it is ready
+	if (!m_material.GetShaderProgram() && m_shaderProgram.IsReady()) {
+		m_material.SetShaderProgram(m_shaderProgram.Get());
+	}
+
+	//actions were evaluated before the update, reading them is one array lookup each
+	auto& actions = eng::Engine::GetInstance().GetInputManager().GetActions();
+	if (actions.WasPressed(m_jump)) {
+		LOG_INFO(Game, "jump");
+	}
+	if (actions.GetValue(m_moveX) != 0.0f) {
+		LOG_DEBUG(Game, "move {}", actions.GetValue(m_moveX));
 	}
 
 
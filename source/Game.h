@@ -10,4 +10,7 @@ public:
 
 private:
 	eng::Material m_material;
+	eng::AssetHandle<eng::ShaderProgram> m_shaderProgram;
+	eng::ActionId m_jump = eng::InvalidAction;
+	eng::ActionId m_moveX = eng::InvalidAction;
 };
\ No newline at end of file
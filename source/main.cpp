@@ -1,7 +1,36 @@
 #include "Game.h"
 #include <eng.h>
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char** argv) {
+	//--headless renders off-screen without a window, --frames n stops after n frames
+	//--log path writes the engine log to a file as well as the console
+	//--capture path saves the last frame (or the first one without --frames) as .png or .rgba
+	bool headless = false;
+	uint64_t frameCount = 0;
+	std::string capturePath;
+	std::string logPath;
+	for (int i = 1; i < argc; ++i) {
+		std::string argument = argv[i];
+		if (argument == "--headless") {
+			headless = true;
+		}
+		else if (argument == "--frames" && i + 1 < argc) {
+			frameCount = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (argument == "--capture" && i + 1 < argc) {
+			capturePath = argv[++i];
+		}
+		else if (argument == "--log" && i + 1 < argc) {
+			logPath = argv[++i];
+		}
+	}
+
+	if (!logPath.empty()) {
+		eng::Log::Start(logPath);
+	}
 
-int main() {
 	//create game instance
 	Game* game = new Game();
 
@@ -13,12 +42,15 @@ int main() {
 
 	//initialize engine and game
 	//if initialization is successful, enter the main loop
-	if (engine.Init(1200, 720)) {
+	if (engine.Init(1200, 720, headless)) {
 
-		engine.Run();
+		if (!capturePath.empty()) {
+			engine.RequestCapture(capturePath, frameCount != 0 ? frameCount - 1 : 0);
+		}
+		engine.Run(frameCount);
 	}
 
 	//after exiting the loop, free up resources
 	engine.Destroy();
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,133 @@
+#include "graphics/GLTrace.h"
+#include "graphics/HeadlessContext.h"
+#include "graphics/Framebuffer.h"
+#include "graphics/Image.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//replays a trace written by Engine::RequestTraceCapture in a loop and reports what a frame of it costs
+//usage: GLReplay trace [--frames n] [--null] [--capture out.png]
+//--null only decodes the stream without a context or gl calls, the cost of the replay loop itself
+//--capture saves the last replayed frame, compare it with ImageDiff against a capture of the same frame
+namespace {
+
+	struct Options {
+		std::string tracePath;
+		int frames = 100;
+		bool null = false;
+		std::string capturePath;
+	};
+
+	void PrintTiming(const char* mode, const std::vector<double>& milliseconds, const eng::GLTraceStats& stats) {
+		std::vector<double> sorted = milliseconds;
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0.0;
+		for (double value : sorted) {
+			total += value;
+		}
+		std::printf("%s: %zu frames, %.4f ms mean, %.4f ms median, %.4f ms min, %.4f ms max\n", mode, sorted.size(),
+			total / double(sorted.size()), sorted[sorted.size() / 2], sorted.front(), sorted.back());
+		std::printf("per frame: %zu calls, %zu draws, %.1f ns per call\n", stats.calls, stats.draws,
+			stats.calls ? total / double(sorted.size()) * 1.0e6 / double(stats.calls) : 0.0);
+	}
+
+	int ReplayNull(eng::GLTrace& trace, const Options& options) {
+		std::vector<double> milliseconds;
+		for (int i = 0; i < options.frames; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			trace.Replay(false);
+			milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		PrintTiming("null", milliseconds, trace.GetStats());
+		return 0;
+	}
+
+	int ReplayOffscreen(eng::GLTrace& trace, const Options& options) {
+		eng::HeadlessContext context;
+		if (!context.Create()) {
+			std::fprintf(stderr, "ERROR:GL_REPLAY: cannot create the headless context\n");
+			return 1;
+		}
+		GLenum glewResult = glewInit();
+		if (glewResult != GLEW_OK && glewResult != GLEW_ERROR_NO_GLX_DISPLAY) {
+			std::fprintf(stderr, "ERROR:GL_REPLAY: cannot initialize glew\n");
+			return 1;
+		}
+		int width = std::max(trace.GetWidth(), 1);
+		int height = std::max(trace.GetHeight(), 1);
+		eng::Framebuffer framebuffer;
+		if (!framebuffer.Create(width, height)) {
+			return 1;
+		}
+		if (!trace.PrepareReplay()) {
+			std::fprintf(stderr, "WARNING:GL_REPLAY: some programs did not build, their draws are skipped\n");
+		}
+		//the first frames pay for shader compiles and uploads the driver deferred
+		glFinish();
+
+		std::vector<double> milliseconds;
+		for (int i = 0; i < options.frames; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			framebuffer.Bind();
+			glViewport(0, 0, width, height);
+			glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+			trace.Replay();
+			glFinish();
+			milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		PrintTiming("offscreen", milliseconds, trace.GetStats());
+
+		int result = 0;
+		if (!options.capturePath.empty()) {
+			eng::Image image;
+			image.width = width;
+			image.height = height;
+			if (!framebuffer.ReadPixels(image.rgba) || !eng::SaveImage(options.capturePath, image)) {
+				result = 1;
+			}
+		}
+		trace.ReleaseReplay();
+		framebuffer.Destroy();
+		context.Destroy();
+		return result;
+	}
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			options.frames = std::max(std::atoi(argv[++i]), 1);
+		}
+		else if (std::strcmp(argv[i], "--null") == 0) {
+			options.null = true;
+		}
+		else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+			options.capturePath = argv[++i];
+		}
+		else if (options.tracePath.empty()) {
+			options.tracePath = argv[i];
+		}
+	}
+	if (options.tracePath.empty()) {
+		std::fprintf(stderr, "usage: GLReplay trace [--frames n] [--null] [--capture out.png]\n");
+		return 1;
+	}
+
+	eng::GLTrace trace;
+	if (!trace.Load(options.tracePath)) {
+		return 1;
+	}
+	const eng::GLTraceStats& stats = trace.GetStats();
+	std::printf("%s: %dx%d, %zu programs, %zu textures, %zu vertex arrays, %zu buffers, %.2f MB of resources\n",
+		options.tracePath.c_str(), trace.GetWidth(), trace.GetHeight(), stats.programs, stats.textures, stats.vertexArrays,
+		stats.buffers, double(stats.resourceBytes) / (1024.0 * 1024.0));
+	return options.null ? ReplayNull(trace, options) : ReplayOffscreen(trace, options);
+}
@@ -0,0 +1,165 @@
+#include "graphics/Image.h"
+#include "graphics/ImageCompare.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+//compares frame captures against stored goldens
+//usage: ImageDiff golden capture [options]
+//       ImageDiff --dir goldens captures [options]
+//options: --tolerance n, --max-fraction f, --min-ssim s, --diff out.png (single pair) or out dir (--dir), --update
+//exit code 0 when everything passed, 1 when something differs, 2 when an image could not be read
+namespace {
+
+	enum Outcome {
+		Passed = 0,
+		Failed = 1,
+		Error = 2
+	};
+
+	struct Options {
+		eng::ImageDiffSettings settings;
+		std::string diffPath;
+		//overwrites the golden with the capture instead of comparing, for intended changes
+		bool update = false;
+	};
+
+	Outcome ComparePair(const std::string& goldenPath, const std::string& capturePath, const std::string& diffPath, const Options& options) {
+		eng::Image capture;
+		if (!eng::LoadImage(capturePath, capture)) {
+			return Error;
+		}
+		if (options.update) {
+			if (!eng::SaveImage(goldenPath, capture)) {
+				return Error;
+			}
+			std::printf("UPDATED %s\n", goldenPath.c_str());
+			return Passed;
+		}
+
+		eng::Image golden;
+		if (!eng::LoadImage(goldenPath, golden)) {
+			return Error;
+		}
+
+		eng::Image diff;
+		eng::ImageDiffResult result = eng::CompareImages(golden, capture, options.settings, diffPath.empty() ? nullptr : &diff);
+		if (result.sizeMismatch) {
+			std::printf("FAIL %s: size %dx%d, golden is %dx%d\n", capturePath.c_str(), capture.width, capture.height, golden.width, golden.height);
+			return Failed;
+		}
+
+		std::printf("%s %s: %zu pixels differ (%.4f%%), max channel difference %d, psnr %.2f dB, ssim %.5f\n",
+			result.passed ? "PASS" : "FAIL", capturePath.c_str(), result.differentPixels, result.differentFraction * 100.0,
+			result.maxChannelDifference, result.psnr, result.ssim);
+		if (!result.passed && !diffPath.empty()) {
+			eng::SaveImage(diffPath, diff);
+		}
+		return result.passed ? Passed : Failed;
+	}
+
+	//every capture needs a golden of the same name, goldens without a capture are reported as missing
+	Outcome CompareDirectories(const std::string& goldenDirectory, const std::string& captureDirectory, const Options& options) {
+		namespace fs = std::filesystem;
+		std::error_code error;
+		if (!fs::is_directory(captureDirectory, error) || (!options.update && !fs::is_directory(goldenDirectory, error))) {
+			std::fprintf(stderr, "ERROR:IMAGE_DIFF: %s or %s is not a directory\n", goldenDirectory.c_str(), captureDirectory.c_str());
+			return Error;
+		}
+		if (options.update) {
+			fs::create_directories(goldenDirectory, error);
+		}
+		if (!options.diffPath.empty()) {
+			fs::create_directories(options.diffPath, error);
+		}
+
+		Outcome outcome = Passed;
+		size_t compared = 0;
+		size_t failed = 0;
+		for (const auto& entry : fs::directory_iterator(captureDirectory)) {
+			std::string extension = entry.path().extension().string();
+			if (!entry.is_regular_file() || (extension != ".png" && extension != ".rgba")) {
+				continue;
+			}
+			fs::path golden = fs::path(goldenDirectory) / entry.path().filename();
+			if (!options.update && !fs::exists(golden)) {
+				std::printf("MISSING %s: no golden\n", entry.path().string().c_str());
+				outcome = std::max(outcome, Failed);
+				++failed;
+				continue;
+			}
+			std::string diffPath;
+			if (!options.diffPath.empty()) {
+				diffPath = (fs::path(options.diffPath) / entry.path().stem()).string() + "_diff.png";
+			}
+
+			Outcome result = ComparePair(golden.string(), entry.path().string(), diffPath, options);
+			++compared;
+			if (result != Passed) {
+				++failed;
+			}
+			outcome = std::max(outcome, result);
+		}
+
+		if (!options.update) {
+			for (const auto& entry : fs::directory_iterator(goldenDirectory)) {
+				if (entry.is_regular_file() && !fs::exists(fs::path(captureDirectory) / entry.path().filename())) {
+					std::printf("MISSING %s: no capture\n", entry.path().string().c_str());
+					outcome = std::max(outcome, Failed);
+					++failed;
+				}
+			}
+		}
+		std::printf("%zu compared, %zu failed\n", compared, failed);
+		return outcome;
+	}
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	std::string paths[2];
+	int pathCount = 0;
+	bool directories = false;
+
+	for (int i = 1; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--tolerance") == 0 && hasValue) {
+			options.settings.tolerance = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--max-fraction") == 0 && hasValue) {
+			options.settings.maxDifferentFraction = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--min-ssim") == 0 && hasValue) {
+			options.settings.minSSIM = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--diff") == 0 && hasValue) {
+			options.diffPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--update") == 0) {
+			options.update = true;
+		}
+		else if (std::strcmp(argv[i], "--dir") == 0) {
+			directories = true;
+		}
+		else if (argv[i][0] != '-' && pathCount < 2) {
+			paths[pathCount++] = argv[i];
+		}
+		else {
+			pathCount = 0;
+			break;
+		}
+	}
+
+	if (pathCount != 2) {
+		std::printf("usage: %s golden capture [options]\n       %s --dir goldens captures [options]\n"
+			"options: --tolerance n --max-fraction f --min-ssim s --diff path --update\n", argv[0], argv[0]);
+		return Error;
+	}
+	if (directories) {
+		return CompareDirectories(paths[0], paths[1], options);
+	}
+	return ComparePair(paths[0], paths[1], options.diffPath, options);
+}
@@ -0,0 +1,46 @@
+#include "assets/MeshCooker.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+//turns a wavefront obj into a cooked mesh with a chain of simplified lods
+//usage: MeshCooker input.obj output.mesh [--lods n] [--reduction r] [--error e]
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::printf("usage: %s input.obj output.mesh [--lods n] [--reduction r] [--error e]\n", argv[0]);
+		return 1;
+	}
+
+	eng::LODChainSettings settings;
+	for (int i = 3; i + 1 < argc; i += 2) {
+		if (std::strcmp(argv[i], "--lods") == 0) {
+			settings.maxLODCount = uint32_t(std::atoi(argv[i + 1]));
+		}
+		else if (std::strcmp(argv[i], "--reduction") == 0) {
+			settings.reduction = float(std::atof(argv[i + 1]));
+		}
+		else if (std::strcmp(argv[i], "--error") == 0) {
+			settings.maxRelativeError = float(std::atof(argv[i + 1]));
+		}
+		else {
+			std::printf("unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	eng::MeshData mesh;
+	if (!eng::ImportObj(argv[1], mesh)) {
+		return 1;
+	}
+	eng::BuildLODChain(mesh, settings);
+
+	std::printf("%zu vertices, radius %.3f\n", mesh.GetVertexCount(), mesh.bounds.radius);
+	std::printf("%-4s %12s %10s %12s\n", "lod", "triangles", "ratio", "error");
+	for (size_t lod = 0; lod < mesh.lods.size(); ++lod) {
+		std::printf("%-4zu %12u %9.1f%% %12.5f\n", lod, mesh.lods[lod].indexCount / 3,
+			100.0f * float(mesh.lods[lod].indexCount) / float(mesh.lods[0].indexCount), mesh.lods[lod].error);
+	}
+
+	return eng::WriteCookedMesh(argv[2], mesh) ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+#include "scene/SceneFile.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+//inspects cooked scenes
+//usage: SceneTool dump scene [max entities]
+//       SceneTool load scene
+//       SceneTool generate scene entity count
+namespace {
+
+	int Dump(const char* path, size_t maxEntities) {
+		eng::SceneFile scene;
+		if (!scene.Open(path)) {
+			return 1;
+		}
+		scene.Dump(std::cout, maxEntities);
+		return 0;
+	}
+
+	//maps the scene and copies what the renderer wants out of it, the way a level load would
+	int Load(const char* path) {
+		auto start = std::chrono::steady_clock::now();
+		eng::SceneFile scene;
+		if (!scene.Open(path)) {
+			return 1;
+		}
+		auto opened = std::chrono::steady_clock::now();
+
+		eng::AABBSoA boxes;
+		boxes.Reserve(scene.GetEntityCount());
+		scene.CopyBounds(boxes);
+		std::vector<eng::SceneTransform> transforms(scene.GetTransforms(), scene.GetTransforms() + scene.GetEntityCount());
+		auto copied = std::chrono::steady_clock::now();
+
+		std::printf("%u entities, open %.3f ms, copy %.3f ms\n", scene.GetEntityCount(),
+			std::chrono::duration<double, std::milli>(opened - start).count(),
+			std::chrono::duration<double, std::milli>(copied - opened).count());
+		return 0;
+	}
+
+	int Generate(const char* path, size_t count) {
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> size(0.5f, 5.0f);
+		const char* meshes[] = { "meshes/rock.mesh", "meshes/tree.mesh", "meshes/crate.mesh" };
+
+		eng::SceneWriter writer;
+		uint32_t root = writer.AddEntity("root", eng::SceneTransform{ { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } });
+		for (size_t i = 1; i < count; ++i) {
+			float extent = size(random);
+			eng::SceneTransform transform{ { position(random), position(random), position(random) }, { 0.0f, 0.0f, 0.0f, 1.0f }, { extent, extent, extent } };
+			uint32_t entity = writer.AddEntity("entity_" + std::to_string(i), transform, root);
+			writer.SetMesh(entity, meshes[i % 3], "materials/default.mat");
+			writer.SetBounds(entity, eng::AABB{ transform.position[0], transform.position[1], transform.position[2], extent, extent, extent });
+		}
+		return writer.Write(path) ? 0 : 1;
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc >= 3 && std::strcmp(argv[1], "dump") == 0) {
+		return Dump(argv[2], argc >= 4 ? size_t(std::strtoull(argv[3], nullptr, 10)) : size_t(-1));
+	}
+	if (argc >= 3 && std::strcmp(argv[1], "load") == 0) {
+		return Load(argv[2]);
+	}
+	if (argc >= 4 && std::strcmp(argv[1], "generate") == 0) {
+		return Generate(argv[2], size_t(std::strtoull(argv[3], nullptr, 10)));
+	}
+	std::printf("usage: %s dump scene [max entities]\n       %s load scene\n       %s generate scene entity count\n", argv[0], argv[0], argv[0]);
+	return 1;
+}